@@ -0,0 +1,342 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#include "AudioConverter.h"
+#include "utils/Log.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define AUDIO_CONVERTER_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define AUDIO_CONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+const double PI = 3.14159265358979323846;
+const double KAISER_BETA = 8.0;				// ~80 dB stop band attenuation
+const double ROLLOFF = 0.95;				// cutoff as a fraction of the lower nyquist frequency
+
+static unsigned int GreatestCommonDivisor( unsigned int a, unsigned int b )
+{
+	while( b != 0 )
+	{
+		unsigned int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+//! Zeroth order modified bessel function of the first kind, for the kaiser window.
+static double BesselI0( double x )
+{
+	double sum = 1.0, term = 1.0;
+	for(int k=1;k<32;++k)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if ( term < sum * 1e-12 )
+			break;
+	}
+	return sum;
+}
+
+AudioConverter::AudioConverter() :
+	m_MixChannels( 1 ),
+	m_Up( 1 ),
+	m_Down( 1 ),
+	m_Taps( 0 ),
+	m_Position( 0 ),
+	m_Phase( 0 )
+{}
+
+bool AudioConverter::Configure( const AudioFormat & a_In, const AudioFormat & a_Out )
+{
+	if (! a_In.IsValid() || ! a_Out.IsValid() )
+	{
+		Log::Error( "AudioConverter", "Unsupported conversion from %s to %s", 
+			a_In.ToString().c_str(), a_Out.ToString().c_str() );
+		return false;
+	}
+
+	unsigned int gcd = GreatestCommonDivisor( a_In.m_Rate, a_Out.m_Rate );
+	if ( (a_Out.m_Rate / gcd) > MAX_PHASES )
+	{
+		Log::Error( "AudioConverter", "Can't resample from %u to %u", a_In.m_Rate, a_Out.m_Rate );
+		return false;
+	}
+
+	m_In = a_In;
+	m_Out = a_Out;
+	m_MixChannels = m_In.m_Channels < m_Out.m_Channels ? m_In.m_Channels : m_Out.m_Channels;
+	m_Up = m_Out.m_Rate / gcd;
+	m_Down = m_In.m_Rate / gcd;
+
+	BuildFilter();
+	Reset();
+
+	if (! IsPassThrough() )
+		Log::Debug( "AudioConverter", "Converting %s to %s, %u phases of %u taps", 
+			m_In.ToString().c_str(), m_Out.ToString().c_str(), m_Up, m_Taps );
+	return true;
+}
+
+bool AudioConverter::Configure( const std::string & a_In, const std::string & a_Out )
+{
+	AudioFormat in, out;
+	if (! in.Parse( a_In ) || ! out.Parse( a_Out ) )
+	{
+		Log::Error( "AudioConverter", "Failed to parse audio formats %s and %s", a_In.c_str(), a_Out.c_str() );
+		return false;
+	}
+
+	return Configure( in, out );
+}
+
+void AudioConverter::Reset()
+{
+	m_History.resize( m_MixChannels );
+	m_Resampled.resize( m_MixChannels );
+	for(size_t c=0;c<m_MixChannels;++c)
+	{
+		// prime with silence so the first output sample lines up with the first input sample
+		m_History[c].assign( m_Taps > 0 ? (m_Taps / 2) - 1 : 0, 0.0f );
+		m_Resampled[c].clear();
+	}
+	m_Position = 0;
+	m_Phase = 0;
+	m_Partial.clear();
+}
+
+void AudioConverter::Convert( const char * a_pInput, size_t a_Bytes, std::string & a_Output )
+{
+	if ( IsPassThrough() )
+	{
+		a_Output.append( a_pInput, a_Bytes );
+		return;
+	}
+
+	const size_t frameBytes = m_In.GetFrameBytes();
+	if ( m_Partial.size() > 0 )
+	{
+		size_t needed = frameBytes - m_Partial.size();
+		if ( a_Bytes < needed )
+		{
+			m_Partial.append( a_pInput, a_Bytes );
+			return;
+		}
+
+		m_Partial.append( a_pInput, needed );
+		Decode( m_Partial.data(), 1 );
+		m_Partial.clear();
+
+		a_pInput += needed;
+		a_Bytes -= needed;
+	}
+
+	size_t frames = a_Bytes / frameBytes;
+	Decode( a_pInput, frames );
+	m_Partial.assign( a_pInput + (frames * frameBytes), a_Bytes - (frames * frameBytes) );
+
+	Resample();
+	Encode( a_Output );
+}
+
+void AudioConverter::BuildFilter()
+{
+	if ( m_Up == 1 && m_Down == 1 )
+	{
+		m_Taps = 0;
+		m_Coefs.clear();
+		return;
+	}
+
+	// cutoff relative to the input nyquist, lower when decimating so we don't alias
+	double cutoff = ROLLOFF * (m_Up < m_Down ? (double)m_Up / (double)m_Down : 1.0);
+	m_Taps = 2 * (unsigned int)ceil( HALF_TAPS / cutoff );
+	m_Coefs.resize( m_Up * m_Taps );
+
+	const double center = (m_Taps / 2.0) - 1.0;
+	const double half = m_Taps / 2.0;
+	const double norm = BesselI0( KAISER_BETA );
+	for(unsigned int p=0;p<m_Up;++p)
+	{
+		float * pPhase = &m_Coefs[p * m_Taps];
+
+		double sum = 0.0;
+		for(unsigned int j=0;j<m_Taps;++j)
+		{
+			double d = (double)j - (center + (double)p / (double)m_Up);
+			double x = cutoff * d;
+			double sinc = fabs( x ) < 1e-9 ? 1.0 : sin( PI * x ) / (PI * x);
+			double w = d / half;
+			double window = fabs( w ) >= 1.0 ? 0.0 : BesselI0( KAISER_BETA * sqrt( 1.0 - w * w ) ) / norm;
+
+			double coef = sinc * window;
+			pPhase[j] = (float)coef;
+			sum += coef;
+		}
+
+		// unity gain at DC for every phase, otherwise the phases beat against each other
+		for(unsigned int j=0;j<m_Taps;++j)
+			pPhase[j] = (float)(pPhase[j] / sum);
+	}
+}
+
+void AudioConverter::Decode( const char * a_pInput, size_t a_Frames )
+{
+	const unsigned int inChannels = m_In.m_Channels;
+	for(unsigned int c=0;c<m_MixChannels;++c)
+	{
+		const unsigned int folded = (inChannels - c + m_MixChannels - 1) / m_MixChannels;
+		const float scale = 1.0f / (float)folded;
+
+		std::vector<float> & history = m_History[c];
+		size_t start = history.size();
+		history.resize( start + a_Frames );
+
+		float * pDest = &history[start];
+		for(size_t f=0;f<a_Frames;++f)
+		{
+			// input channels are folded onto the mixed channels, e.g. stereo to mono averages left and right
+			float sample = 0.0f;
+			for(unsigned int j=c;j<inChannels;j += m_MixChannels)
+			{
+				size_t i = (f * inChannels) + j;
+				if ( m_In.m_Bits == 16 )
+				{
+					short s;
+					memcpy( &s, a_pInput + (i * 2), sizeof(s) );
+					sample += (float)s;
+				}
+				else
+					sample += (float)(((int)(unsigned char)a_pInput[i] - 128) * 256);
+			}
+			pDest[f] = folded > 1 ? sample * scale : sample;
+		}
+	}
+}
+
+void AudioConverter::Resample()
+{
+	for(unsigned int c=0;c<m_MixChannels;++c)
+	{
+		std::vector<float> & history = m_History[c];
+		std::vector<float> & output = m_Resampled[c];
+
+		if ( m_Taps == 0 )
+		{
+			output.swap( history );
+			history.clear();
+			continue;
+		}
+
+		size_t position = m_Position;
+		unsigned int phase = m_Phase;
+		while( position + m_Taps <= history.size() )
+		{
+			output.push_back( DotProduct( &m_Coefs[phase * m_Taps], &history[position], m_Taps ) );
+
+			phase += m_Down;
+			position += phase / m_Up;
+			phase %= m_Up;
+		}
+
+		// every channel advances identically, so only store the position once we are done with the last one
+		if ( c + 1 == m_MixChannels )
+		{
+			m_Position = position;
+			m_Phase = phase;
+		}
+	}
+
+	if ( m_Taps > 0 )
+	{
+		size_t consumed = m_Position;
+		for(unsigned int c=0;c<m_MixChannels;++c)
+		{
+			std::vector<float> & history = m_History[c];
+			size_t drop = consumed < history.size() ? consumed : history.size();
+			history.erase( history.begin(), history.begin() + drop );
+		}
+		m_Position -= consumed;
+	}
+}
+
+void AudioConverter::Encode( std::string & a_Output )
+{
+	const size_t frames = m_Resampled.size() > 0 ? m_Resampled[0].size() : 0;
+	const unsigned int outChannels = m_Out.m_Channels;
+	const unsigned int sampleBytes = m_Out.m_Bits / 8;
+
+	size_t start = a_Output.size();
+	a_Output.resize( start + (frames * outChannels * sampleBytes) );
+	char * pDest = &a_Output[start];
+
+	for(size_t f=0;f<frames;++f)
+	{
+		for(unsigned int c=0;c<outChannels;++c)
+		{
+			// mixed channels are copied onto the output channels, e.g. mono to stereo duplicates the channel
+			float sample = m_Resampled[c % m_MixChannels][f];
+			if ( sampleBytes == 2 )
+			{
+				float r = sample < 0.0f ? sample - 0.5f : sample + 0.5f;
+				short s = r >= 32767.0f ? 32767 : r <= -32768.0f ? -32768 : (short)r;
+				memcpy( pDest, &s, sizeof(s) );
+			}
+			else
+			{
+				int s = (int)floor( (sample / 256.0f) + 128.5f );
+				*pDest = (char)(s > 255 ? 255 : s < 0 ? 0 : s);
+			}
+			pDest += sampleBytes;
+		}
+	}
+
+	for(unsigned int c=0;c<m_MixChannels;++c)
+		m_Resampled[c].clear();
+}
+
+float AudioConverter::DotProduct( const float * a_pA, const float * a_pB, unsigned int a_Count )
+{
+	unsigned int i = 0;
+	float sum = 0.0f;
+#if defined(AUDIO_CONVERTER_SSE)
+	__m128 acc = _mm_setzero_ps();
+	for(;i + 4 <= a_Count;i += 4)
+		acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( a_pA + i ), _mm_loadu_ps( a_pB + i ) ) );
+	float lanes[4];
+	_mm_storeu_ps( lanes, acc );
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(AUDIO_CONVERTER_NEON)
+	float32x4_t acc = vdupq_n_f32( 0.0f );
+	for(;i + 4 <= a_Count;i += 4)
+		acc = vmlaq_f32( acc, vld1q_f32( a_pA + i ), vld1q_f32( a_pB + i ) );
+	float lanes[4];
+	vst1q_f32( lanes, acc );
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+	for(;i<a_Count;++i)
+		sum += a_pA[i] * a_pB[i];
+	return sum;
+}
+
@@ -0,0 +1,94 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#ifndef SELF_AUDIO_CONVERTER_H
+#define SELF_AUDIO_CONVERTER_H
+
+#include <vector>
+#include <string>
+
+#include "AudioFormat.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Streaming converter between two PCM formats. Channels are mixed down before resampling and mixed up 
+//! after, so we never resample more channels than needed. Resampling uses a polyphase windowed-sinc 
+//! filter for the exact rational ratio between the two rates, the filter state is kept between calls
+//! so audio can be pushed through in blocks of any size.
+class AudioConverter
+{
+public:
+	//! Construction
+	AudioConverter();
+
+	//! Accessors
+	const AudioFormat & GetInputFormat() const
+	{
+		return m_In;
+	}
+	const AudioFormat & GetOutputFormat() const
+	{
+		return m_Out;
+	}
+	bool IsPassThrough() const
+	{
+		return m_In == m_Out;
+	}
+
+	//! Setup the conversion, returns false if either format is not supported.
+	bool Configure( const AudioFormat & a_In, const AudioFormat & a_Out );
+	bool Configure( const std::string & a_In, const std::string & a_Out );
+	//! Clear any history, call when the stream is interrupted.
+	void Reset();
+	//! Convert a block of audio, the converted audio is appended onto a_Output.
+	void Convert( const char * a_pInput, size_t a_Bytes, std::string & a_Output );
+	void Convert( const std::string & a_Input, std::string & a_Output )
+	{
+		Convert( a_Input.data(), a_Input.size(), a_Output );
+	}
+
+private:
+	//! Constants
+	static const unsigned int	HALF_TAPS = 16;				// filter taps either side of the output sample at full bandwidth
+	static const unsigned int	MAX_PHASES = 4096;			// largest interpolation factor we will build a filter for
+
+	//! Data
+	AudioFormat			m_In;
+	AudioFormat			m_Out;
+	unsigned int		m_MixChannels;						// channels we actually resample
+	unsigned int		m_Up;								// interpolation factor, number of filter phases
+	unsigned int		m_Down;								// decimation factor
+	unsigned int		m_Taps;								// taps in each filter phase
+	std::vector<float>	m_Coefs;							// m_Up phases of m_Taps each
+	std::vector< std::vector<float> >
+						m_History;							// input samples still needed by the filter, per channel
+	size_t				m_Position;							// first input sample of the next output sample
+	unsigned int		m_Phase;
+	std::string			m_Partial;							// trailing bytes of an incomplete input frame
+	std::vector< std::vector<float> >
+						m_Resampled;						// scratch, converted samples per channel
+
+	void				BuildFilter();
+	void				Decode( const char * a_pInput, size_t a_Frames );
+	void				Resample();
+	void				Encode( std::string & a_Output );
+
+	static float		DotProduct( const float * a_pA, const float * a_pB, unsigned int a_Count );
+};
+
+#endif //SELF_AUDIO_CONVERTER_H
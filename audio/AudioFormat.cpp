@@ -0,0 +1,50 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#include "AudioFormat.h"
+#include "sensors/AudioData.h"
+#include "utils/StringUtil.h"
+
+const unsigned int MAX_CHANNELS = 8;
+
+bool AudioFormat::Parse( const std::string & a_Format )
+{
+	unsigned int rate, bits, channels;
+	if (! AudioData::ParseAudioFormat( a_Format, rate, bits, channels ) )
+		return false;
+
+	m_Rate = rate;
+	m_Bits = bits;
+	m_Channels = channels;
+	return IsValid();
+}
+
+std::string AudioFormat::ToString() const
+{
+	std::string format( StringUtil::Format( "audio/L%u;rate=%u", m_Bits, m_Rate ) );
+	if ( m_Channels != 1 )
+		format += StringUtil::Format( ";channels=%u", m_Channels );
+	return format;
+}
+
+bool AudioFormat::IsValid() const
+{
+	return m_Rate > 0 && m_Channels > 0 && m_Channels <= MAX_CHANNELS 
+		&& (m_Bits == 8 || m_Bits == 16);
+}
+
@@ -0,0 +1,61 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#ifndef SELF_AUDIO_FORMAT_H
+#define SELF_AUDIO_FORMAT_H
+
+#include <string>
+
+#include "SelfLib.h"			// include last always
+
+//! Describes a stream of linear PCM audio, e.g. audio/L16;rate=16000;channels=1. Producers and consumers 
+//! that may disagree on the format parse both sides into one of these, then hand the pair to an AudioConverter.
+struct AudioFormat
+{
+	//! Construction
+	AudioFormat( unsigned int a_Rate = 16000, unsigned int a_Channels = 1, unsigned int a_Bits = 16 ) :
+		m_Rate( a_Rate ), m_Channels( a_Channels ), m_Bits( a_Bits )
+	{}
+
+	//! Data
+	unsigned int	m_Rate;
+	unsigned int	m_Channels;
+	unsigned int	m_Bits;
+
+	//! Parse a MIME audio format, returns false if the format is not supported.
+	bool Parse( const std::string & a_Format );
+	//! Returns the MIME type for this format.
+	std::string ToString() const;
+	//! Returns true if this is a format we can convert to and from.
+	bool IsValid() const;
+
+	unsigned int GetFrameBytes() const
+	{
+		return m_Channels * (m_Bits / 8);
+	}
+	bool operator==( const AudioFormat & a_Other ) const
+	{
+		return m_Rate == a_Other.m_Rate && m_Channels == a_Other.m_Channels && m_Bits == a_Other.m_Bits;
+	}
+	bool operator!=( const AudioFormat & a_Other ) const
+	{
+		return !(*this == a_Other);
+	}
+};
+
+#endif //SELF_AUDIO_FORMAT_H
@@ -0,0 +1,424 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "EchoCanceller.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const float STEP_SIZE = 0.5f;			// NLMS step size
+const float POWER_SMOOTHING = 0.9f;		// smoothing of the far-end power estimate
+const float REGULARIZATION = 1e-3f;		// avoids dividing by zero during far-end silence
+const float GEIGEL_THRESHOLD = 0.5f;	// near-end peaks above half the far-end peak over the tail are double-talk
+const float ENVELOPE_FLOOR = -70.0f;	// block energies below this many dB are treated as silence
+const float MIN_ENVELOPE_VARIANCE = 9.0f;	// both envelopes must move by ~3 dB before we trust a delay estimate
+const float MIN_DELAY_CORRELATION = 0.5f;	// weakest envelope correlation accepted as a delay
+
+static float EnergyToDb( float a_Energy )
+{
+	float db = 10.0f * log10f( a_Energy + 1e-12f );
+	return db > ENVELOPE_FLOOR ? db : ENVELOPE_FLOOR;
+}
+
+EchoCanceller::EchoCanceller() : 
+	m_SampleRate( 0 ), 
+	m_Partitions( 0 ), 
+	m_ConstrainIndex( 0 ), 
+	m_DoubleTalkBlocks( 0 ),
+	m_MaxDelayBlocks( 0 ),
+	m_DelayBlocks( 0 ),
+	m_CandidateBlocks( -1 ),
+	m_DelayChanges( 0 ),
+	m_FarWrite( 0 ),
+	m_FarBlocks( 0 ),
+	m_FarPartial( 0 ),
+	m_FarEnergy( 0.0f ),
+	m_NearBlocks( 0 )
+{}
+
+void EchoCanceller::Reset( unsigned int a_SampleRate, unsigned int a_TailMs, unsigned int a_DelayMs, unsigned int a_MaxDelayMs )
+{
+	unsigned int tailSamples = (a_SampleRate * a_TailMs) / 1000;
+	m_SampleRate = a_SampleRate;
+	m_Partitions = (tailSamples + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_DoubleTalkBlocks = 0;
+
+	const size_t bins = FFT_SIZE * m_Partitions;
+	m_XRe.resize( bins );
+	m_XIm.resize( bins );
+	m_WRe.resize( bins );
+	m_WIm.resize( bins );
+	m_Power.resize( FFT_SIZE );
+	m_FarHistory.resize( FFT_SIZE );
+	m_FarPeaks.resize( m_Partitions > 0 ? m_Partitions : 1 );
+	ClearFilter();
+
+	m_Re.resize( FFT_SIZE );
+	m_Im.resize( FFT_SIZE );
+	m_ERe.resize( FFT_SIZE );
+	m_EIm.resize( FFT_SIZE );
+	m_FarBlock.resize( BLOCK_SIZE );
+
+	m_TwRe.resize( FFT_SIZE / 2 );
+	m_TwIm.resize( FFT_SIZE / 2 );
+	for(unsigned int i=0;i<FFT_SIZE / 2;++i)
+	{
+		double angle = -2.0 * 3.14159265358979323846 * i / FFT_SIZE;
+		m_TwRe[i] = (float)cos( angle );
+		m_TwIm[i] = (float)sin( angle );
+	}
+
+	unsigned int bits = 0;
+	while( (1u << bits) < FFT_SIZE )
+		++bits;
+	m_BitReverse.resize( FFT_SIZE );
+	for(unsigned int i=0;i<FFT_SIZE;++i)
+	{
+		unsigned int r = 0;
+		for(unsigned int b=0;b<bits;++b)
+			if ( i & (1u << b) )
+				r |= 1u << (bits - 1 - b);
+		m_BitReverse[i] = r;
+	}
+
+	// both timelines start together, the far-end ring holds enough history for the longest delay
+	m_MaxDelayBlocks = ((a_SampleRate * a_MaxDelayMs) / 1000) / BLOCK_SIZE;
+	m_DelayBlocks = ((a_SampleRate * a_DelayMs) / 1000) / BLOCK_SIZE;
+	if ( m_DelayBlocks > m_MaxDelayBlocks )
+		m_DelayBlocks = m_MaxDelayBlocks;
+	m_CandidateBlocks = -1;
+	m_DelayChanges = 0;
+
+	m_FarEnd.assign( (m_MaxDelayBlocks + FAR_SLACK) * BLOCK_SIZE, 0 );
+	m_FarWrite = 0;
+	m_FarBlocks = 0;
+	m_FarPartial = 0;
+	m_FarEnergy = 0.0f;
+	m_NearBlocks = 0;
+	m_FarEnvelope.assign( DELAY_WINDOW + m_MaxDelayBlocks + FAR_SLACK, ENVELOPE_FLOOR );
+	m_NearEnvelope.assign( DELAY_WINDOW, ENVELOPE_FLOOR );
+}
+
+void EchoCanceller::PlayFarEnd( const short * a_pSamples, size_t a_Count )
+{
+	if ( m_Partitions == 0 )
+		return;
+
+	const size_t capacity = m_FarEnd.size();
+	for(size_t i=0;i<a_Count;++i)
+	{
+		m_FarEnd[m_FarWrite] = a_pSamples[i];
+		if ( ++m_FarWrite == capacity )
+			m_FarWrite = 0;
+
+		float s = a_pSamples[i] / 32768.0f;
+		m_FarEnergy += s * s;
+		if ( ++m_FarPartial == BLOCK_SIZE )
+		{
+			m_FarEnvelope[m_FarBlocks % m_FarEnvelope.size()] = EnergyToDb( m_FarEnergy / BLOCK_SIZE );
+			m_FarBlocks += 1;
+			m_FarPartial = 0;
+			m_FarEnergy = 0.0f;
+		}
+	}
+}
+
+void EchoCanceller::ProcessNearEnd( short * a_pSamples, size_t a_Count )
+{
+	if ( m_Partitions == 0 )
+		return;
+
+	for(size_t i=0;i + BLOCK_SIZE <= a_Count;i += BLOCK_SIZE)
+	{
+		short * pNear = a_pSamples + i;
+
+		float energy = 0.0f;
+		for(unsigned int k=0;k<BLOCK_SIZE;++k)
+		{
+			float s = pNear[k] / 32768.0f;
+			energy += s * s;
+		}
+		m_NearEnvelope[m_NearBlocks % DELAY_WINDOW] = EnergyToDb( energy / BLOCK_SIZE );
+
+		ProcessBlock( pNear );
+
+		m_NearBlocks += 1;
+		if ( m_NearBlocks >= DELAY_WINDOW && (m_NearBlocks % DELAY_INTERVAL) == 0 )
+			EstimateDelay();
+	}
+}
+
+void EchoCanceller::FFT( float * a_pRe, float * a_pIm, bool a_bInverse )
+{
+	for(unsigned int i=0;i<FFT_SIZE;++i)
+	{
+		unsigned int j = m_BitReverse[i];
+		if ( j > i )
+		{
+			float t = a_pRe[i]; a_pRe[i] = a_pRe[j]; a_pRe[j] = t;
+			t = a_pIm[i]; a_pIm[i] = a_pIm[j]; a_pIm[j] = t;
+		}
+	}
+
+	const float sign = a_bInverse ? -1.0f : 1.0f;
+	for(unsigned int size=2;size<=FFT_SIZE;size <<= 1)
+	{
+		unsigned int half = size >> 1;
+		unsigned int step = FFT_SIZE / size;
+		for(unsigned int start=0;start<FFT_SIZE;start += size)
+		{
+			for(unsigned int k=0;k<half;++k)
+			{
+				float wr = m_TwRe[k * step];
+				float wi = sign * m_TwIm[k * step];
+				unsigned int a = start + k, b = a + half;
+				float tr = a_pRe[b] * wr - a_pIm[b] * wi;
+				float ti = a_pRe[b] * wi + a_pIm[b] * wr;
+				a_pRe[b] = a_pRe[a] - tr;
+				a_pIm[b] = a_pIm[a] - ti;
+				a_pRe[a] += tr;
+				a_pIm[a] += ti;
+			}
+		}
+	}
+
+	if ( a_bInverse )
+	{
+		const float scale = 1.0f / FFT_SIZE;
+		for(unsigned int i=0;i<FFT_SIZE;++i)
+		{
+			a_pRe[i] *= scale;
+			a_pIm[i] *= scale;
+		}
+	}
+}
+
+void EchoCanceller::ProcessBlock( short * a_pNear )
+{
+	const unsigned int N = FFT_SIZE;
+	const unsigned int P = m_Partitions;
+
+	// pull the far-end block that was playing the measured delay before this near-end block
+	ReadReference();
+
+	// slide the far-end history and track the block peak for double-talk detection
+	memmove( &m_FarHistory[0], &m_FarHistory[BLOCK_SIZE], BLOCK_SIZE * sizeof(float) );
+	float farPeak = 0.0f;
+	for(unsigned int i=0;i<BLOCK_SIZE;++i)
+	{
+		float s = m_FarBlock[i] / 32768.0f;
+		m_FarHistory[BLOCK_SIZE + i] = s;
+		farPeak = fabsf( s ) > farPeak ? fabsf( s ) : farPeak;
+	}
+	memmove( &m_FarPeaks[1], &m_FarPeaks[0], (m_FarPeaks.size() - 1) * sizeof(float) );
+	m_FarPeaks[0] = farPeak;
+
+	// shift the partition spectra, newest goes in slot 0
+	memmove( &m_XRe[N], &m_XRe[0], (P - 1) * N * sizeof(float) );
+	memmove( &m_XIm[N], &m_XIm[0], (P - 1) * N * sizeof(float) );
+	float * pXRe = &m_XRe[0];
+	float * pXIm = &m_XIm[0];
+	memcpy( pXRe, &m_FarHistory[0], N * sizeof(float) );
+	memset( pXIm, 0, N * sizeof(float) );
+	FFT( pXRe, pXIm, false );
+
+	float * pPower = &m_Power[0];
+	for(unsigned int k=0;k<N;++k)
+		pPower[k] = POWER_SMOOTHING * pPower[k] + (1.0f - POWER_SMOOTHING) * (pXRe[k] * pXRe[k] + pXIm[k] * pXIm[k]);
+
+	// echo estimate Y = sum W_p * X_p
+	float * pRe = &m_Re[0];
+	float * pIm = &m_Im[0];
+	memset( pRe, 0, N * sizeof(float) );
+	memset( pIm, 0, N * sizeof(float) );
+	for(unsigned int p=0;p<P;++p)
+	{
+		const float * xr = &m_XRe[p * N];
+		const float * xi = &m_XIm[p * N];
+		const float * wr = &m_WRe[p * N];
+		const float * wi = &m_WIm[p * N];
+		for(unsigned int k=0;k<N;++k)
+		{
+			pRe[k] += wr[k] * xr[k] - wi[k] * xi[k];
+			pIm[k] += wr[k] * xi[k] + wi[k] * xr[k];
+		}
+	}
+	FFT( pRe, pIm, true );
+
+	// error = near - echo, overlap-save keeps the last block of the output
+	float * pERe = &m_ERe[0];
+	float * pEIm = &m_EIm[0];
+	float nearPeak = 0.0f;
+	memset( pERe, 0, N * sizeof(float) );
+	memset( pEIm, 0, N * sizeof(float) );
+	for(unsigned int i=0;i<BLOCK_SIZE;++i)
+	{
+		float d = a_pNear[i] / 32768.0f;
+		nearPeak = fabsf( d ) > nearPeak ? fabsf( d ) : nearPeak;
+
+		float e = d - pRe[BLOCK_SIZE + i];
+		pERe[BLOCK_SIZE + i] = e;
+
+		float out = e * 32768.0f;
+		a_pNear[i] = (short)(out > 32767.0f ? 32767.0f : (out < -32768.0f ? -32768.0f : out));
+	}
+
+	float tailPeak = 0.0f;
+	for(size_t i=0;i<m_FarPeaks.size();++i)
+		tailPeak = m_FarPeaks[i] > tailPeak ? m_FarPeaks[i] : tailPeak;
+	if ( tailPeak <= 0.0f )
+		return;					// nothing played, nothing to learn
+	if ( nearPeak > GEIGEL_THRESHOLD * tailPeak )
+	{
+		m_DoubleTalkBlocks += 1;
+		return;
+	}
+
+	FFT( pERe, pEIm, false );
+
+	// normalized error, then W_p += mu * conj(X_p) * E / power
+	for(unsigned int k=0;k<N;++k)
+	{
+		float norm = STEP_SIZE / (P * pPower[k] + REGULARIZATION);
+		pERe[k] *= norm;
+		pEIm[k] *= norm;
+	}
+
+	for(unsigned int p=0;p<P;++p)
+	{
+		const float * xr = &m_XRe[p * N];
+		const float * xi = &m_XIm[p * N];
+		float * wr = &m_WRe[p * N];
+		float * wi = &m_WIm[p * N];
+		for(unsigned int k=0;k<N;++k)
+		{
+			wr[k] += xr[k] * pERe[k] + xi[k] * pEIm[k];
+			wi[k] += xr[k] * pEIm[k] - xi[k] * pERe[k];
+		}
+	}
+
+	// keep one partition a proper linear convolution per block by zeroing the second half of its
+	// impulse response, rotating through partitions keeps the cost at two FFTs per block.
+	float * wr = &m_WRe[m_ConstrainIndex * N];
+	float * wi = &m_WIm[m_ConstrainIndex * N];
+	FFT( wr, wi, true );
+	memset( wr + BLOCK_SIZE, 0, BLOCK_SIZE * sizeof(float) );
+	memset( wi + BLOCK_SIZE, 0, BLOCK_SIZE * sizeof(float) );
+	FFT( wr, wi, false );
+	m_ConstrainIndex = (m_ConstrainIndex + 1) % P;
+}
+
+void EchoCanceller::ReadReference()
+{
+	// age of the first sample we want, counted back from the newest far-end sample written
+	const int capacity = (int)m_FarEnd.size();
+	const int ahead = (int)(m_FarBlocks - m_NearBlocks) * (int)BLOCK_SIZE + (int)m_FarPartial 
+		+ (int)(m_DelayBlocks * BLOCK_SIZE);
+
+	for(int i=0;i<(int)BLOCK_SIZE;++i)
+	{
+		int age = ahead - i;
+		if ( age >= 1 && age <= capacity )
+		{
+			int index = (int)m_FarWrite - age;
+			m_FarBlock[i] = m_FarEnd[index < 0 ? index + capacity : index];
+		}
+		else
+			m_FarBlock[i] = 0;			// not played yet or older than the ring
+	}
+}
+
+void EchoCanceller::EstimateDelay()
+{
+	const unsigned int W = DELAY_WINDOW;
+	const unsigned int first = m_NearBlocks - W;				// oldest near-end block in the window
+	const size_t farSize = m_FarEnvelope.size();
+
+	float nearMean = 0.0f;
+	for(unsigned int j=0;j<W;++j)
+		nearMean += m_NearEnvelope[(first + j) % W];
+	nearMean /= W;
+	float nearVar = 0.0f;
+	for(unsigned int j=0;j<W;++j)
+	{
+		float n = m_NearEnvelope[(first + j) % W] - nearMean;
+		nearVar += n * n;
+	}
+	if ( nearVar < MIN_ENVELOPE_VARIANCE * W )
+		return;						// near-end is flat, nothing to line up
+
+	// correlate the near-end envelope against the far-end envelope at every delay we allow
+	int best = -1;
+	float bestCorrelation = MIN_DELAY_CORRELATION;
+	for(unsigned int d=0;d<=m_MaxDelayBlocks && d<=first;++d)
+	{
+		unsigned int farFirst = first - d;
+		if ( farFirst + W > m_FarBlocks )
+			continue;				// far-end hasn't played that far yet
+		if ( m_FarBlocks - farFirst > farSize )
+			break;					// far-end history has been overwritten
+
+		float farMean = 0.0f;
+		for(unsigned int j=0;j<W;++j)
+			farMean += m_FarEnvelope[(farFirst + j) % farSize];
+		farMean /= W;
+
+		float farVar = 0.0f, covariance = 0.0f;
+		for(unsigned int j=0;j<W;++j)
+		{
+			float f = m_FarEnvelope[(farFirst + j) % farSize] - farMean;
+			farVar += f * f;
+			covariance += f * (m_NearEnvelope[(first + j) % W] - nearMean);
+		}
+		if ( farVar < MIN_ENVELOPE_VARIANCE * W )
+			continue;
+
+		float correlation = covariance / sqrtf( nearVar * farVar );
+		if ( correlation > bestCorrelation )
+		{
+			bestCorrelation = correlation;
+			best = (int)d;
+		}
+	}
+	if ( best < 0 )
+		return;
+
+	// keep a block of margin so the echo never arrives before its reference, and only move once the
+	// same delay has been measured twice so a single bad window can't throw away a converged filter.
+	unsigned int delay = best > 0 ? (unsigned int)best - 1 : 0;
+	bool bConfirmed = m_CandidateBlocks >= 0 && abs( best - m_CandidateBlocks ) <= 1;
+	if ( bConfirmed && (delay > m_DelayBlocks + 1 || delay + 1 < m_DelayBlocks) )
+	{
+		m_DelayBlocks = delay;
+		m_DelayChanges += 1;
+		ClearFilter();
+	}
+	m_CandidateBlocks = best;
+}
+
+void EchoCanceller::ClearFilter()
+{
+	m_ConstrainIndex = 0;
+	m_XRe.assign( m_XRe.size(), 0.0f );
+	m_XIm.assign( m_XIm.size(), 0.0f );
+	m_WRe.assign( m_WRe.size(), 0.0f );
+	m_WIm.assign( m_WIm.size(), 0.0f );
+	m_Power.assign( m_Power.size(), 0.0f );
+	m_FarHistory.assign( m_FarHistory.size(), 0.0f );
+	m_FarPeaks.assign( m_FarPeaks.size(), 0.0f );
+}
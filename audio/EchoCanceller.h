@@ -0,0 +1,116 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_ECHO_CANCELLER_H
+#define SELF_ECHO_CANCELLER_H
+
+#include <vector>
+
+#include "SelfLib.h"			// include last always
+
+//! Acoustic echo canceller for 16-bit mono PCM. This is a partitioned block frequency domain NLMS 
+//! filter (overlap-save), the far-end reference is whatever audio is being played out of the speaker
+//! and the near-end is the microphone. The estimated echo is subtracted from the near-end in place.
+//! Adaptation is frozen while a Geigel detector sees double-talk. The inner loops work on separate
+//! real & imaginary float arrays so the compiler can vectorize them.
+//!
+//! The far-end and near-end are two timelines that must advance at the same rate, so callers should 
+//! queue silence as the far-end when nothing is playing. The bulk delay between the timelines is 
+//! measured by correlating the per-block energy of both, and the reference is re-aligned when it moves.
+class EchoCanceller
+{
+public:
+	//! Construction
+	EchoCanceller();
+
+	//! Accessors
+	bool IsEnabled() const
+	{
+		return m_Partitions > 0;
+	}
+	unsigned int GetBlockSize() const
+	{
+		return BLOCK_SIZE;
+	}
+	unsigned int GetDoubleTalkBlocks() const
+	{
+		return m_DoubleTalkBlocks;
+	}
+	//! Returns the delay currently applied to the far-end reference.
+	unsigned int GetDelayMs() const
+	{
+		return m_SampleRate > 0 ? (m_DelayBlocks * BLOCK_SIZE * 1000) / m_SampleRate : 0;
+	}
+	unsigned int GetDelayChanges() const
+	{
+		return m_DelayChanges;
+	}
+
+	//! Configure for the given sample rate, a_TailMs is the longest echo path to cancel, a_DelayMs is 
+	//! the delay to start with and a_MaxDelayMs is the longest delay between playing the far-end and 
+	//! hearing it in the microphone that we will search for.
+	void Reset( unsigned int a_SampleRate, unsigned int a_TailMs, unsigned int a_DelayMs, unsigned int a_MaxDelayMs );
+	//! Queue far-end reference audio, this should be called as audio is handed to the speaker.
+	void PlayFarEnd( const short * a_pSamples, size_t a_Count );
+	//! Remove echo from the near-end audio in place, a_Count should be a multiple of GetBlockSize().
+	void ProcessNearEnd( short * a_pSamples, size_t a_Count );
+
+private:
+	//! Constants
+	static const unsigned int	BLOCK_SIZE = 64;
+	static const unsigned int	FFT_SIZE = BLOCK_SIZE * 2;
+	static const unsigned int	DELAY_WINDOW = 500;			// near-end blocks correlated for each delay estimate
+	static const unsigned int	DELAY_INTERVAL = 125;		// near-end blocks between delay estimates
+	static const unsigned int	FAR_SLACK = 64;				// blocks the far-end may run ahead of the near-end
+
+	//! Data
+	unsigned int		m_SampleRate;
+	unsigned int		m_Partitions;
+	unsigned int		m_ConstrainIndex;		// the gradient constraint is applied to one partition per block
+	unsigned int		m_DoubleTalkBlocks;
+	unsigned int		m_MaxDelayBlocks;
+	unsigned int		m_DelayBlocks;			// delay applied to the far-end reference
+	int					m_CandidateBlocks;		// last measured delay, it must repeat before we move to it
+	unsigned int		m_DelayChanges;
+	std::vector<short>	m_FarEnd;				// far-end ring covering the longest delay
+	size_t				m_FarWrite;
+	unsigned int		m_FarBlocks;			// complete blocks on the far-end timeline
+	unsigned int		m_FarPartial;			// samples into the next far-end block
+	float				m_FarEnergy;			// energy of the partial far-end block
+	unsigned int		m_NearBlocks;			// blocks on the near-end timeline
+	std::vector<float>	m_FarEnvelope;			// per block log energy of both timelines, for the delay estimate
+	std::vector<float>	m_NearEnvelope;
+	std::vector<float>	m_FarHistory;			// previous + current far-end block
+	std::vector<float>	m_FarPeaks;				// per-block far-end peaks over the tail, for double-talk detection
+	std::vector<float>	m_XRe, m_XIm;			// far-end spectra, one per partition, newest first
+	std::vector<float>	m_WRe, m_WIm;			// filter weights, one spectrum per partition
+	std::vector<float>	m_Power;				// smoothed far-end power per bin
+	std::vector<float>	m_TwRe, m_TwIm;			// FFT twiddles
+	std::vector<unsigned int>
+						m_BitReverse;
+	std::vector<float>	m_Re, m_Im;				// scratch
+	std::vector<float>	m_ERe, m_EIm;			// error spectrum
+	std::vector<short>	m_FarBlock;
+
+	void FFT( float * a_pRe, float * a_pIm, bool a_bInverse );
+	void ProcessBlock( short * a_pNear );
+	void ReadReference();
+	void EstimateDelay();
+	void ClearFilter();
+};
+
+#endif //SELF_ECHO_CANCELLER_H
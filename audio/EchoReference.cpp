@@ -0,0 +1,102 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "EchoReference.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+
+#include <string.h>
+
+EchoReference * EchoReference::Instance()
+{
+	static EchoReference sInstance;
+	return &sInstance;
+}
+
+EchoReference::EchoReference() : m_Rate( 0 ), m_PlayStart( 0.0 )
+{}
+
+bool EchoReference::IsActive() const
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_Rate > 0;
+}
+
+void EchoReference::Attach( unsigned int a_Rate )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Rate = a_Rate;
+	m_Playing.clear();
+}
+
+void EchoReference::Detach()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Rate = 0;
+	m_Playing.clear();
+}
+
+void EchoReference::Play( const std::string & a_PCM, const AudioFormat & a_Format )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	if ( m_Rate == 0 )
+		return;
+
+	m_Playing.clear();
+	if (! m_Converter.Configure( a_Format, AudioFormat( m_Rate, 1, 16 ) ) )
+	{
+		Log::Warning( "EchoReference", "Can't convert %s for the echo reference.", a_Format.ToString().c_str() );
+		return;
+	}
+
+	m_Converted.clear();
+	m_Converter.Convert( a_PCM, m_Converted );
+	m_Playing.resize( m_Converted.size() / sizeof(short) );
+	if ( m_Playing.size() > 0 )
+		memcpy( &m_Playing[0], m_Converted.data(), m_Playing.size() * sizeof(short) );
+	m_PlayStart = Time().GetEpochTime();
+}
+
+void EchoReference::Stop()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	if ( m_Rate == 0 || m_Playing.size() == 0 )
+		return;
+
+	// whatever didn't get played never reaches the microphone
+	double played = (Time().GetEpochTime() - m_PlayStart) * m_Rate;
+	if ( played < 0.0 )
+		m_Playing.clear();
+	else if ( played < (double)m_Playing.size() )
+		m_Playing.resize( (size_t)played );
+}
+
+void EchoReference::Read( double a_StartTime, short * a_pSamples, size_t a_Count )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+
+	memset( a_pSamples, 0, a_Count * sizeof(short) );
+	if ( m_Rate == 0 || m_Playing.size() == 0 )
+		return;
+
+	// copy the overlap between [a_StartTime, a_StartTime + a_Count) and the sound
+	double offset = (a_StartTime - m_PlayStart) * m_Rate;
+	long first = offset < 0.0 ? (long)(offset - 0.5) : (long)(offset + 0.5);
+	long size = (long)m_Playing.size();
+	for(long i=first < 0 ? -first : 0;i<(long)a_Count && first + i < size;++i)
+		a_pSamples[i] = m_Playing[first + i];
+}
@@ -0,0 +1,70 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_ECHO_REFERENCE_H
+#define SELF_ECHO_REFERENCE_H
+
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include "AudioFormat.h"
+#include "AudioConverter.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Record of the audio going out of the robot speaker, so a microphone can cancel its own echo instead of 
+//! being paused every time the robot talks. A speech gesture registers each sound as it starts playing, 
+//! the microphone pulls back whatever was playing over the span of every block it captures and hands
+//! both to its EchoCanceller. Sounds are kept as 16-bit mono at the rate of the attached microphone.
+//! There is one of these per library that compiles it, so the player and the microphone have to be in 
+//! the same plugin, as they are in platform/linux.
+class EchoReference
+{
+public:
+	//! Singleton
+	static EchoReference * Instance();
+
+	//! Construction
+	EchoReference();
+
+	//! Returns true while a microphone is taking the reference, speech gestures should keep the 
+	//! microphones running while this is true and pause them otherwise.
+	bool IsActive() const;
+
+	//! A microphone capturing at the given rate starts taking the reference.
+	void Attach( unsigned int a_Rate );
+	//! The microphone stopped.
+	void Detach();
+	//! A sound is starting to play out of the speaker now.
+	void Play( const std::string & a_PCM, const AudioFormat & a_Format );
+	//! Playback ended early or finished.
+	void Stop();
+	//! Fill a_pSamples with what was playing from a_StartTime on, silence where nothing was.
+	void Read( double a_StartTime, short * a_pSamples, size_t a_Count );
+
+private:
+	//! Data
+	mutable boost::mutex	m_Lock;
+	unsigned int			m_Rate;				// rate of the attached microphone, 0 if none
+	AudioConverter			m_Converter;
+	std::string				m_Converted;
+	std::vector<short>		m_Playing;			// the sound that is or was last playing
+	double					m_PlayStart;		// epoch time m_Playing started
+};
+
+#endif //SELF_ECHO_REFERENCE_H
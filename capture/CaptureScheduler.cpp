@@ -0,0 +1,403 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "CaptureScheduler.h"
+#include "SelfInstance.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+
+#include <algorithm>
+
+const std::string DEMAND_TOPIC( "capture-demand" );
+
+CaptureScheduler * CaptureScheduler::Instance()
+{
+	static CaptureScheduler sInstance( true );
+	return &sInstance;
+}
+
+CaptureScheduler::CaptureScheduler( bool a_bShared /*= false*/ ) : 
+	m_bShared( a_bShared ),
+	m_bSubscribed( false ),
+	m_Origin( UniqueID().Get() ),
+	m_NextId( 1 ), 
+	m_fReportInterval( 30.0 ), 
+	m_fLastReport( 0.0 )
+{}
+
+CaptureScheduler::~CaptureScheduler()
+{
+	SelfInstance * pInstance = SelfInstance::GetInstance();
+	if ( m_bSubscribed && pInstance != NULL )
+		pInstance->GetTopics()->Unsubscribe( DEMAND_TOPIC, this );
+	m_spTimer.reset();
+}
+
+int CaptureScheduler::Register( const std::string & a_Name, const std::string & a_Type, float a_fMaxRate, float a_fIdleRate,
+	RateCallback a_Callback )
+{
+	Share();
+
+	bool bStartTimer = false;
+	int id = 0;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		id = m_NextId++;
+
+		Sensor & sensor = m_Sensors[ id ];
+		sensor.m_Name = a_Name;
+		sensor.m_Type = a_Type;
+		sensor.m_fMaxRate = a_fMaxRate > 0.0f ? a_fMaxRate : 0.0f;
+		sensor.m_fIdleRate = a_fIdleRate > 0.0f ? std::min( a_fIdleRate, sensor.m_fMaxRate ) : 0.0f;
+		sensor.m_Callback = a_Callback;
+		sensor.m_fWindowStart = Time().GetEpochTime();
+		sensor.m_fRate = ScheduleRate( sensor );
+
+		bStartTimer = m_spTimer.get() == NULL;
+	}
+
+	if ( bStartTimer )
+	{
+		TimerPool * pTP = TimerPool::Instance();
+		if ( pTP != NULL )
+			m_spTimer = pTP->StartTimer( VOID_DELEGATE( CaptureScheduler, OnTimer, this ), 1.0f, true, true );
+	}
+
+	Log::Debug( "CaptureScheduler", "Registered %s at %.1f fps, max %.1f, idle %.1f", 
+		a_Name.c_str(), GetRate( id ), a_fMaxRate, a_fIdleRate );
+	return id;
+}
+
+void CaptureScheduler::Unregister( int a_Id )
+{
+	bool bStopTimer = false;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		m_Sensors.erase( a_Id );
+		bStopTimer = m_Sensors.size() == 0;
+	}
+
+	if ( bStopTimer )
+		m_spTimer.reset();
+}
+
+void CaptureScheduler::SetPaused( int a_Id, bool a_bPaused )
+{
+	NotifyList notify;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		SensorMap::iterator iSensor = m_Sensors.find( a_Id );
+		if ( iSensor == m_Sensors.end() )
+			return;
+
+		iSensor->second.m_bPaused = a_bPaused;
+		Reschedule( Time().GetEpochTime(), notify );
+	}
+	Notify( notify );
+}
+
+float CaptureScheduler::GetRate( int a_Id )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	SensorMap::iterator iSensor = m_Sensors.find( a_Id );
+	return iSensor != m_Sensors.end() ? iSensor->second.m_fRate : 0.0f;
+}
+
+void CaptureScheduler::Demand( const std::string & a_Target, void * a_pConsumer, float a_fRate, double a_fDuration /*= 0.0*/ )
+{
+	Share();
+
+	std::string consumer( StringUtil::Format( "%p", a_pConsumer ) );
+	NotifyList notify;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		double now = Time().GetEpochTime();
+		SetRequest( m_Origin, consumer, a_Target, a_fRate, a_fDuration, now );
+		Reschedule( now, notify );
+	}
+	Notify( notify );
+
+	Json::Value demand;
+	demand["consumer"] = consumer;
+	demand["target"] = a_Target;
+	demand["rate"] = a_fRate;
+	demand["duration"] = a_fDuration;
+	Publish( demand );
+}
+
+void CaptureScheduler::Release( const std::string & a_Target, void * a_pConsumer )
+{
+	Share();
+
+	std::string consumer( StringUtil::Format( "%p", a_pConsumer ) );
+	NotifyList notify;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		RemoveRequest( m_Origin, consumer, a_Target );
+		Reschedule( Time().GetEpochTime(), notify );
+	}
+	Notify( notify );
+
+	Json::Value release;
+	release["consumer"] = consumer;
+	release["target"] = a_Target;
+	release["release"] = true;
+	Publish( release );
+}
+
+bool CaptureScheduler::BeginCapture( int a_Id )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	SensorMap::iterator iSensor = m_Sensors.find( a_Id );
+	if ( iSensor == m_Sensors.end() )
+		return true;
+
+	Sensor & sensor = iSensor->second;
+	if ( sensor.m_InFlight > 0 )
+	{
+		sensor.m_Skipped += 1;
+		return false;
+	}
+	sensor.m_fCaptureStart = Time().GetEpochTime();
+	return true;
+}
+
+void CaptureScheduler::EndCapture( int a_Id, bool a_bQueued )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	SensorMap::iterator iSensor = m_Sensors.find( a_Id );
+	if ( iSensor == m_Sensors.end() )
+		return;
+
+	Sensor & sensor = iSensor->second;
+	if ( sensor.m_fCaptureStart > 0.0 )
+	{
+		sensor.m_fBusy += Time().GetEpochTime() - sensor.m_fCaptureStart;
+		sensor.m_fCaptureStart = 0.0;
+	}
+	if ( a_bQueued )
+	{
+		sensor.m_Captured += 1;
+		sensor.m_InFlight += 1;
+	}
+}
+
+void CaptureScheduler::Delivered( int a_Id )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	SensorMap::iterator iSensor = m_Sensors.find( a_Id );
+	if ( iSensor == m_Sensors.end() )
+		return;
+
+	// while a capture is still in progress this is its frame, delivered before EndCapture() counted it
+	Sensor & sensor = iSensor->second;
+	if ( sensor.m_InFlight > 0 || sensor.m_fCaptureStart > 0.0 )
+		sensor.m_InFlight -= 1;
+}
+
+bool CaptureScheduler::GetStats( int a_Id, Stats & a_Stats )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	SensorMap::iterator iSensor = m_Sensors.find( a_Id );
+	if ( iSensor == m_Sensors.end() )
+		return false;
+
+	GetStats( iSensor->second, Time().GetEpochTime(), a_Stats );
+	return true;
+}
+
+void CaptureScheduler::Update( double a_fNow )
+{
+	NotifyList notify;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		for( size_t i = 0; i < m_Requests.size(); )
+		{
+			if ( m_Requests[i].m_fExpire > 0.0 && m_Requests[i].m_fExpire <= a_fNow )
+				m_Requests.erase( m_Requests.begin() + i );
+			else
+				++i;
+		}
+		Reschedule( a_fNow, notify );
+
+		if ( m_fReportInterval > 0.0 && (a_fNow - m_fLastReport) >= m_fReportInterval )
+		{
+			m_fLastReport = a_fNow;
+			for( SensorMap::iterator iSensor = m_Sensors.begin(); iSensor != m_Sensors.end(); ++iSensor )
+			{
+				Sensor & sensor = iSensor->second;
+
+				Stats stats;
+				GetStats( sensor, a_fNow, stats );
+				Log::Debug( "CaptureScheduler", "%s scheduled at %.1f fps, captured %.1f fps, duty cycle %.1f%%, %u skipped",
+					stats.m_Name.c_str(), stats.m_fRate, stats.m_fFramesPerSec, stats.m_fDutyCycle * 100.0f, stats.m_Skipped );
+
+				sensor.m_fWindowStart = a_fNow;
+				sensor.m_fBusy = 0.0;
+				sensor.m_Captured = 0;
+				sensor.m_Skipped = 0;
+			}
+		}
+	}
+	Notify( notify );
+}
+
+void CaptureScheduler::OnSharedDemand( const ITopics::Payload & a_Payload )
+{
+	Json::Value json;
+	if (! Json::Reader().parse( a_Payload.m_Data, json ) || !json["origin"].isString() || !json["target"].isString() )
+	{
+		Log::Warning( "CaptureScheduler", "Bad demand on %s: %s", DEMAND_TOPIC.c_str(), a_Payload.m_Data.c_str() );
+		return;
+	}
+
+	// our own demands come back to us, they are already applied
+	const std::string & origin = json["origin"].asString();
+	if ( origin == m_Origin )
+		return;
+
+	NotifyList notify;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		double now = Time().GetEpochTime();
+		if ( json["release"].asBool() )
+			RemoveRequest( origin, json["consumer"].asString(), json["target"].asString() );
+		else
+			SetRequest( origin, json["consumer"].asString(), json["target"].asString(), 
+				json["rate"].asFloat(), json["duration"].asDouble(), now );
+		Reschedule( now, notify );
+	}
+	Notify( notify );
+}
+
+void CaptureScheduler::Share()
+{
+	if (! m_bShared || m_bSubscribed )
+		return;
+	SelfInstance * pInstance = SelfInstance::GetInstance();
+	if ( pInstance == NULL )
+		return;
+
+	m_bSubscribed = true;
+	ITopics * pTopics = pInstance->GetTopics();
+	pTopics->RegisterTopic( DEMAND_TOPIC, "application/json" );
+	pTopics->Subscribe( DEMAND_TOPIC, DELEGATE( CaptureScheduler, OnSharedDemand, const ITopics::Payload &, this ) );
+}
+
+void CaptureScheduler::Publish( const Json::Value & a_Demand )
+{
+	SelfInstance * pInstance = SelfInstance::GetInstance();
+	if (! m_bSubscribed || pInstance == NULL )
+		return;
+
+	Json::Value demand( a_Demand );
+	demand["origin"] = m_Origin;
+	pInstance->GetTopics()->Publish( DEMAND_TOPIC, Json::FastWriter().write( demand ), false, false );
+}
+
+void CaptureScheduler::SetRequest( const std::string & a_Origin, const std::string & a_Consumer, const std::string & a_Target,
+	float a_fRate, double a_fDuration, double a_fNow )
+{
+	Request * pRequest = NULL;
+	for( RequestList::iterator iReq = m_Requests.begin(); iReq != m_Requests.end() && pRequest == NULL; ++iReq )
+		if ( iReq->m_Origin == a_Origin && iReq->m_Consumer == a_Consumer && iReq->m_Target == a_Target )
+			pRequest = &(*iReq);
+	if ( pRequest == NULL )
+	{
+		m_Requests.push_back( Request() );
+		pRequest = &m_Requests.back();
+		pRequest->m_Target = a_Target;
+		pRequest->m_Origin = a_Origin;
+		pRequest->m_Consumer = a_Consumer;
+	}
+	pRequest->m_fRate = a_fRate > 0.0f ? a_fRate : 0.0f;
+	pRequest->m_fExpire = a_fDuration > 0.0 ? a_fNow + a_fDuration : 0.0;
+}
+
+void CaptureScheduler::RemoveRequest( const std::string & a_Origin, const std::string & a_Consumer, const std::string & a_Target )
+{
+	for( size_t i = 0; i < m_Requests.size(); )
+	{
+		const Request & req = m_Requests[i];
+		if ( req.m_Origin == a_Origin && req.m_Consumer == a_Consumer && req.m_Target == a_Target )
+			m_Requests.erase( m_Requests.begin() + i );
+		else
+			++i;
+	}
+}
+
+float CaptureScheduler::ScheduleRate( const Sensor & a_Sensor ) const
+{
+	if ( a_Sensor.m_bPaused )
+		return 0.0f;
+
+	bool bDemanded = false;
+	float rate = 0.0f;
+	for( RequestList::const_iterator iReq = m_Requests.begin(); iReq != m_Requests.end(); ++iReq )
+	{
+		if ( iReq->m_Target != a_Sensor.m_Name && iReq->m_Target != a_Sensor.m_Type )
+			continue;
+
+		bDemanded = true;
+		rate = std::max( rate, iReq->m_fRate > 0.0f ? std::min( iReq->m_fRate, a_Sensor.m_fMaxRate ) : a_Sensor.m_fMaxRate );
+	}
+
+	return bDemanded ? rate : a_Sensor.m_fIdleRate;
+}
+
+void CaptureScheduler::Reschedule( double a_fNow, NotifyList & a_Notify )
+{
+	for( SensorMap::iterator iSensor = m_Sensors.begin(); iSensor != m_Sensors.end(); ++iSensor )
+	{
+		Sensor & sensor = iSensor->second;
+
+		float rate = ScheduleRate( sensor );
+		if ( rate != sensor.m_fRate )
+		{
+			Log::Debug( "CaptureScheduler", "%s rescheduled from %.1f to %.1f fps", 
+				sensor.m_Name.c_str(), sensor.m_fRate, rate );
+			sensor.m_fRate = rate;
+			if ( sensor.m_Callback.IsValid() )
+				a_Notify.push_back( std::make_pair( sensor.m_Callback, rate ) );
+		}
+	}
+}
+
+void CaptureScheduler::GetStats( const Sensor & a_Sensor, double a_fNow, Stats & a_Stats ) const
+{
+	double elapsed = a_fNow - a_Sensor.m_fWindowStart;
+
+	a_Stats.m_Name = a_Sensor.m_Name;
+	a_Stats.m_fRate = a_Sensor.m_fRate;
+	a_Stats.m_fFramesPerSec = elapsed > 0.0 ? (float)(a_Sensor.m_Captured / elapsed) : 0.0f;
+	a_Stats.m_fDutyCycle = elapsed > 0.0 ? (float)std::min( a_Sensor.m_fBusy / elapsed, 1.0 ) : 0.0f;
+	a_Stats.m_Captured = a_Sensor.m_Captured;
+	a_Stats.m_Skipped = a_Sensor.m_Skipped;
+}
+
+void CaptureScheduler::OnTimer()
+{
+	Update( Time().GetEpochTime() );
+}
+
+void CaptureScheduler::Notify( const NotifyList & a_Notify )
+{
+	// called without the lock held, a sensor will usually restart its capture timer from its callback
+	for( NotifyList::const_iterator iNotify = a_Notify.begin(); iNotify != a_Notify.end(); ++iNotify )
+		iNotify->first( iNotify->second );
+}
@@ -0,0 +1,166 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_CAPTURE_SCHEDULER_H
+#define SELF_CAPTURE_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <boost/thread.hpp>
+#include "utils/TimerPool.h"
+#include "utils/Delegate.h"
+#include "topics/ITopics.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Decides how fast each capture sensor should run. Sensors register with the most they can do and 
+//! the rate to fall back to when nobody is asking for data, consumers post demands naming a sensor or 
+//! a data type with the rate they want and for how long. Each sensor runs at the highest rate currently
+//! demanded of it, drops to its idle rate once the demands expire, and stops while it is paused. 
+//! Sensors also report the time they spend capturing and encoding so the duty cycle of each one can be
+//! logged, and may skip a capture while their last frame is still waiting for the main thread.
+//! Each plugin compiles its own copy of this class, so Instance() is per plugin. The instances pass 
+//! every Demand() and Release() to each other on the capture-demand topic, so a consumer in one plugin
+//! still drives the sensors registered in another.
+class CaptureScheduler
+{
+public:
+	//! Types
+	typedef Delegate<float>		RateCallback;			// new capture rate in frames per second, 0 to stop
+
+	struct Stats
+	{
+		Stats() : m_fRate( 0.0f ), m_fFramesPerSec( 0.0f ), m_fDutyCycle( 0.0f ), m_Captured( 0 ), m_Skipped( 0 )
+		{}
+
+		std::string		m_Name;
+		float			m_fRate;							// scheduled rate
+		float			m_fFramesPerSec;					// frames actually captured
+		float			m_fDutyCycle;						// fraction of wall time spent capturing
+		unsigned int	m_Captured;
+		unsigned int	m_Skipped;							// captures skipped because the last frame was not delivered
+	};
+
+	//! Singleton
+	static CaptureScheduler * Instance();
+
+	//! Construction, a_bShared to exchange demands with the other plugins over the capture-demand topic
+	CaptureScheduler( bool a_bShared = false );
+	~CaptureScheduler();
+
+	//! How often the duty cycle of each sensor is logged, 0 to never log.
+	void SetReportInterval( double a_fInterval )
+	{
+		m_fReportInterval = a_fInterval;
+	}
+
+	//! Add a sensor, returns the id used for every other call. a_Type is the data type it produces so 
+	//! consumers can ask for any sensor of that type. The sensor should start capturing at GetRate(), 
+	//! a_Callback is invoked whenever that changes, on the thread making the change.
+	int Register( const std::string & a_Name, const std::string & a_Type, float a_fMaxRate, float a_fIdleRate,
+		RateCallback a_Callback );
+	void Unregister( int a_Id );
+	void SetPaused( int a_Id, bool a_bPaused );
+	float GetRate( int a_Id );
+
+	//! Ask a sensor, by name or data type, to capture at a_fRate for a_fDuration seconds. A rate of 0
+	//! asks for the most the sensor can do, a duration of 0 keeps the demand until it is released. A 
+	//! second demand from the same consumer on the same target replaces the first.
+	void Demand( const std::string & a_Target, void * a_pConsumer, float a_fRate, double a_fDuration = 0.0 );
+	void Release( const std::string & a_Target, void * a_pConsumer );
+
+	//! Called around the work of each capture, from any thread. BeginCapture() returns false if the 
+	//! previous frame is still waiting to be delivered, the sensor should skip this capture. Pass 
+	//! a_bQueued to EndCapture() when a frame was handed to the main thread, and call Delivered() 
+	//! once it has been sent. Delivered() may come before EndCapture() if the main thread is quick.
+	bool BeginCapture( int a_Id );
+	void EndCapture( int a_Id, bool a_bQueued );
+	void Delivered( int a_Id );
+
+	//! Rates and duty cycle since the last report.
+	bool GetStats( int a_Id, Stats & a_Stats );
+	//! Expire demands and log the duty cycles, run once a second by our own timer.
+	void Update( double a_fNow );
+
+	//! Callbacks
+	void OnSharedDemand( const ITopics::Payload & a_Payload );
+
+private:
+	//! Types
+	struct Sensor
+	{
+		Sensor() : m_fMaxRate( 0.0f ), m_fIdleRate( 0.0f ), m_fRate( 0.0f ), m_bPaused( false ), m_InFlight( 0 ),
+			m_fCaptureStart( 0.0 ), m_fBusy( 0.0 ), m_fWindowStart( 0.0 ), m_Captured( 0 ), m_Skipped( 0 )
+		{}
+
+		std::string		m_Name;
+		std::string		m_Type;
+		float			m_fMaxRate;
+		float			m_fIdleRate;
+		float			m_fRate;
+		bool			m_bPaused;
+		RateCallback	m_Callback;
+		int				m_InFlight;
+		double			m_fCaptureStart;
+		double			m_fBusy;
+		double			m_fWindowStart;
+		unsigned int	m_Captured;
+		unsigned int	m_Skipped;
+	};
+	struct Request
+	{
+		Request() : m_fRate( 0.0f ), m_fExpire( 0.0 )
+		{}
+
+		std::string		m_Target;
+		std::string		m_Origin;							// the scheduler the demand was made on
+		std::string		m_Consumer;
+		float			m_fRate;
+		double			m_fExpire;							// 0 if it never expires
+	};
+	typedef std::map<int,Sensor>				SensorMap;
+	typedef std::vector<Request>				RequestList;
+	typedef std::vector< std::pair<RateCallback,float> >	NotifyList;
+
+	//! Data
+	bool					m_bShared;
+	bool					m_bSubscribed;
+	std::string				m_Origin;
+	boost::mutex			m_Lock;
+	SensorMap				m_Sensors;
+	RequestList				m_Requests;
+	int						m_NextId;
+	double					m_fReportInterval;
+	double					m_fLastReport;
+	TimerPool::ITimer::SP	m_spTimer;
+
+	void					Share();
+	void					Publish( const Json::Value & a_Demand );
+	void					SetRequest( const std::string & a_Origin, const std::string & a_Consumer, const std::string & a_Target,
+								float a_fRate, double a_fDuration, double a_fNow );
+	void					RemoveRequest( const std::string & a_Origin, const std::string & a_Consumer, const std::string & a_Target );
+	float					ScheduleRate( const Sensor & a_Sensor ) const;
+	void					Reschedule( double a_fNow, NotifyList & a_Notify );
+	void					GetStats( const Sensor & a_Sensor, double a_fNow, Stats & a_Stats ) const;
+	void					OnTimer();
+
+	static void				Notify( const NotifyList & a_Notify );
+};
+
+#endif //SELF_CAPTURE_SCHEDULER_H
@@ -0,0 +1,199 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "DataDelivery.h"
+#include "utils/ThreadPool.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+
+DataDelivery * DataDelivery::Instance()
+{
+	static DataDelivery sInstance;
+	return &sInstance;
+}
+
+DataDelivery::DataDelivery() : 
+	m_NextId( 1 ), 
+	m_Sequence( 0 ), 
+	m_Queued( 0 ), 
+	m_bDrainQueued( false ), 
+	m_fTimeSlice( 0.01 )
+{}
+
+DataDelivery::~DataDelivery()
+{
+	for( QueueMap::iterator iQueue = m_Queues.begin(); iQueue != m_Queues.end(); ++iQueue )
+		for( size_t i = 0; i < iQueue->second.m_Items.size(); ++i )
+			delete iQueue->second.m_Items[i].m_pData;
+}
+
+int DataDelivery::Register( const std::string & a_Name, Policy a_Policy, Priority a_Priority, size_t a_MaxQueued, 
+	DataCallback a_Callback )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	int id = m_NextId++;
+
+	Queue & queue = m_Queues[ id ];
+	queue.m_Name = a_Name;
+	queue.m_Policy = a_Policy;
+	queue.m_Priority = a_Priority;
+	queue.m_MaxQueued = a_MaxQueued > 0 ? a_MaxQueued : 1;
+	queue.m_Callback = a_Callback;
+
+	return id;
+}
+
+void DataDelivery::Unregister( int a_Id )
+{
+	std::deque<Item> items;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		QueueMap::iterator iQueue = m_Queues.find( a_Id );
+		if ( iQueue == m_Queues.end() )
+			return;
+
+		items.swap( iQueue->second.m_Items );
+		m_Queued -= items.size();
+		m_Queues.erase( iQueue );
+	}
+
+	for( size_t i = 0; i < items.size(); ++i )
+		delete items[i].m_pData;
+}
+
+bool DataDelivery::Send( int a_Id, IData * a_pData )
+{
+	IData * pDropped = NULL;
+	bool bQueueDrain = false;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		QueueMap::iterator iQueue = m_Queues.find( a_Id );
+		if ( iQueue == m_Queues.end() )
+			pDropped = a_pData;
+		else
+		{
+			Queue & queue = iQueue->second;
+			if ( queue.m_Items.size() >= queue.m_MaxQueued )
+			{
+				pDropped = queue.m_Items.front().m_pData;
+				queue.m_Items.pop_front();
+				queue.m_Stats.m_Dropped += 1;
+				m_Queued -= 1;
+
+				double now = Time().GetEpochTime();
+				if ( queue.m_Policy == LOSSLESS && (now - queue.m_fLastOverflow) > 5.0 )
+				{
+					queue.m_fLastOverflow = now;
+					Log::Error( "DataDelivery", "%s overflowed %u queued, %u dropped so far, the main thread is not keeping up.", 
+						queue.m_Name.c_str(), (unsigned int)queue.m_MaxQueued, (unsigned int)queue.m_Stats.m_Dropped );
+				}
+			}
+
+			queue.m_Items.push_back( Item( m_Sequence++, a_pData ) );
+			queue.m_Stats.m_Queued = queue.m_Items.size();
+			if ( queue.m_Stats.m_Queued > queue.m_Stats.m_Peak )
+				queue.m_Stats.m_Peak = queue.m_Stats.m_Queued;
+			m_Queued += 1;
+
+			bQueueDrain = !m_bDrainQueued;
+			m_bDrainQueued = true;
+		}
+	}
+
+	delete pDropped;
+	if ( bQueueDrain )
+		QueueDrain();
+
+	return pDropped == NULL;
+}
+
+bool DataDelivery::GetStats( int a_Id, Stats & a_Stats )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	QueueMap::iterator iQueue = m_Queues.find( a_Id );
+	if ( iQueue == m_Queues.end() )
+		return false;
+
+	a_Stats = iQueue->second.m_Stats;
+	return true;
+}
+
+size_t DataDelivery::GetQueued()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_Queued;
+}
+
+void DataDelivery::Drain()
+{
+	double start = Time().GetEpochTime();
+	for(;;)
+	{
+		IData * pData = NULL;
+		DataCallback callback;
+		{
+			boost::lock_guard<boost::mutex> lock( m_Lock );
+
+			// highest priority first, then whatever has waited longest
+			Queue * pNext = NULL;
+			for( QueueMap::iterator iQueue = m_Queues.begin(); iQueue != m_Queues.end(); ++iQueue )
+			{
+				Queue & queue = iQueue->second;
+				if ( queue.m_Items.size() == 0 )
+					continue;
+				if ( pNext == NULL || queue.m_Priority > pNext->m_Priority 
+					|| (queue.m_Priority == pNext->m_Priority && (int)(queue.m_Items.front().m_Sequence - pNext->m_Items.front().m_Sequence) < 0) )
+					pNext = &queue;
+			}
+			if ( pNext == NULL )
+			{
+				m_bDrainQueued = false;
+				return;
+			}
+
+			if ( (Time().GetEpochTime() - start) > m_fTimeSlice )
+				break;		// leave the rest for the next drain, still queued so m_bDrainQueued stays set
+
+			pData = pNext->m_Items.front().m_pData;
+			pNext->m_Items.pop_front();
+			pNext->m_Stats.m_Queued = pNext->m_Items.size();
+			pNext->m_Stats.m_Delivered += 1;
+			callback = pNext->m_Callback;
+			m_Queued -= 1;
+		}
+
+		if ( callback.IsValid() )
+			callback( pData );
+		else
+			delete pData;
+	}
+
+	QueueDrain();
+}
+
+void DataDelivery::QueueDrain()
+{
+	ThreadPool * pPool = ThreadPool::Instance();
+	if ( pPool != NULL )
+		pPool->InvokeOnMain( VOID_DELEGATE( DataDelivery, Drain, this ) );
+	else
+	{
+		// nothing to drain us yet, the bounded queues hold the data until the next send finds a pool
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		m_bDrainQueued = false;
+	}
+}
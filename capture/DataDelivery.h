@@ -0,0 +1,134 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_DATA_DELIVERY_H
+#define SELF_DATA_DELIVERY_H
+
+#include <string>
+#include <deque>
+#include <map>
+
+#include <boost/thread.hpp>
+#include "sensors/IData.h"
+#include "utils/Delegate.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Hands sensor data from capture threads to the main thread through a bounded queue per sensor. 
+//! Rather than one InvokeOnMain() per piece of data, at most one drain is ever waiting on the main 
+//! thread, it sends the highest priority data first and gives the main thread back after a time 
+//! slice. LATEST queues drop their oldest data when full, so a slow main thread sees the newest 
+//! frames. LOSSLESS queues never drop while under their bound, which should be sized to a few 
+//! seconds of backlog, and overflowing one is logged as an error.
+//! Each plugin compiles its own copy of this class, so Instance() is per plugin and priorities only
+//! order the queues of one plugin. The plugins still share the main thread fairly, since each has 
+//! at most one drain waiting and gives the thread back after its time slice.
+class DataDelivery
+{
+public:
+	//! Types
+	enum Policy
+	{
+		LATEST,						// video and other state where only the newest matters
+		LOSSLESS					// audio and text, every piece is needed
+	};
+	enum Priority
+	{
+		PRIORITY_LOW,				// video
+		PRIORITY_NORMAL,
+		PRIORITY_HIGH				// audio and safety sensors like laser and sonar
+	};
+	typedef Delegate<IData *>	DataCallback;
+
+	struct Stats
+	{
+		Stats() : m_Queued( 0 ), m_Peak( 0 ), m_Delivered( 0 ), m_Dropped( 0 )
+		{}
+
+		size_t			m_Queued;
+		size_t			m_Peak;								// most ever queued at once
+		size_t			m_Delivered;
+		size_t			m_Dropped;
+	};
+
+	//! Singleton
+	static DataDelivery * Instance();
+
+	//! Construction
+	DataDelivery();
+	~DataDelivery();
+
+	//! Most time a drain spends sending before it yields the main thread, in seconds.
+	void SetTimeSlice( double a_fSlice )
+	{
+		m_fTimeSlice = a_fSlice;
+	}
+
+	//! Add a queue, returns the id to send with. a_Callback is invoked on the main thread with each
+	//! piece of data, normally it just passes it to ISensor::SendData().
+	int Register( const std::string & a_Name, Policy a_Policy, Priority a_Priority, size_t a_MaxQueued, 
+		DataCallback a_Callback );
+	//! Remove a queue, anything still queued is deleted.
+	void Unregister( int a_Id );
+	//! Queue data for the main thread from any thread, we take ownership of a_pData. Returns false if 
+	//! any data was dropped to make room, or a_pData was dropped because a_Id is not registered.
+	bool Send( int a_Id, IData * a_pData );
+
+	bool GetStats( int a_Id, Stats & a_Stats );
+	size_t GetQueued();
+	//! Send queued data, invoked on the main thread.
+	void Drain();
+
+private:
+	//! Types
+	struct Item
+	{
+		Item( unsigned int a_Sequence, IData * a_pData ) : m_Sequence( a_Sequence ), m_pData( a_pData )
+		{}
+
+		unsigned int	m_Sequence;							// order of arrival, so equal priorities go first in first out
+		IData *			m_pData;
+	};
+	struct Queue
+	{
+		Queue() : m_Policy( LATEST ), m_Priority( PRIORITY_NORMAL ), m_MaxQueued( 1 ), m_fLastOverflow( 0.0 )
+		{}
+
+		std::string			m_Name;
+		Policy				m_Policy;
+		Priority			m_Priority;
+		size_t				m_MaxQueued;
+		DataCallback		m_Callback;
+		std::deque<Item>	m_Items;
+		Stats				m_Stats;
+		double				m_fLastOverflow;
+	};
+	typedef std::map<int,Queue>		QueueMap;
+
+	//! Data
+	boost::mutex			m_Lock;
+	QueueMap				m_Queues;
+	int						m_NextId;
+	unsigned int			m_Sequence;
+	size_t					m_Queued;
+	bool					m_bDrainQueued;
+	double					m_fTimeSlice;
+
+	void					QueueDrain();
+};
+
+#endif //SELF_DATA_DELIVERY_H
@@ -22,6 +22,7 @@
 #include "SelfInstance.h"
 
 #include "utils/Form.h"
+#include "utils/ThreadPool.h"
 
 const float RETRY_LOGIN_INTERVAL = 30.0f;
 
@@ -29,17 +30,63 @@ REG_SERIALIZABLE(IVA);
 REG_OVERRIDE_SERIALIZABLE(IFaceRecognition,IVA);
 RTTI_IMPL( IVA, IFaceRecognition );
 
-IVA::IVA() : IFaceRecognition("IVAV1")
+IVA::IVA() : IFaceRecognition("IVAV1"),
+	m_bLocalSearch( true ),
+	m_IndexFile( "IVAFaces.idx" ),
+	m_LocalThreshold( 0.8f ),
+	m_WatchlistSyncInterval( 600.0f ),
+	m_MaxFacesPerPerson( 5 ),
+	m_SaveIndexDelay( 10.0f ),
+	m_MaxConcurrentEnrollments( 4 ),
+	m_MaxConnections( 8 ),
+	m_RequestTimeout( 30.0f ),
+	m_IdleTimeout( 30.0f ),
+	m_bLoggingIn( false ),
+	m_Session( 0 ),
+	m_Relogins( 0 ),
+	m_Active( 0 )
 {}
 
 void IVA::Serialize(Json::Value & json)
 {
 	IFaceRecognition::Serialize(json);
+
+	json["m_bLocalSearch"] = m_bLocalSearch;
+	json["m_IndexFile"] = m_IndexFile;
+	json["m_LocalThreshold"] = m_LocalThreshold;
+	json["m_WatchlistSyncInterval"] = m_WatchlistSyncInterval;
+	json["m_MaxFacesPerPerson"] = m_MaxFacesPerPerson;
+	json["m_SaveIndexDelay"] = m_SaveIndexDelay;
+	json["m_MaxConcurrentEnrollments"] = m_MaxConcurrentEnrollments;
+	json["m_MaxConnections"] = m_MaxConnections;
+	json["m_RequestTimeout"] = m_RequestTimeout;
+	json["m_IdleTimeout"] = m_IdleTimeout;
 }
 
 void IVA::Deserialize(const Json::Value & json)
 {
 	IFaceRecognition::Deserialize(json);
+
+	if ( json["m_bLocalSearch"].isBool() )
+		m_bLocalSearch = json["m_bLocalSearch"].asBool();
+	if ( json["m_IndexFile"].isString() )
+		m_IndexFile = json["m_IndexFile"].asString();
+	if ( json["m_LocalThreshold"].isNumeric() )
+		m_LocalThreshold = json["m_LocalThreshold"].asFloat();
+	if ( json["m_WatchlistSyncInterval"].isNumeric() )
+		m_WatchlistSyncInterval = json["m_WatchlistSyncInterval"].asFloat();
+	if ( json["m_MaxFacesPerPerson"].isNumeric() )
+		m_MaxFacesPerPerson = json["m_MaxFacesPerPerson"].asUInt();
+	if ( json["m_SaveIndexDelay"].isNumeric() )
+		m_SaveIndexDelay = json["m_SaveIndexDelay"].asFloat();
+	if ( json["m_MaxConcurrentEnrollments"].isNumeric() )
+		m_MaxConcurrentEnrollments = json["m_MaxConcurrentEnrollments"].asUInt();
+	if ( json["m_MaxConnections"].isNumeric() )
+		m_MaxConnections = json["m_MaxConnections"].asUInt();
+	if ( json["m_RequestTimeout"].isNumeric() )
+		m_RequestTimeout = json["m_RequestTimeout"].asFloat();
+	if ( json["m_IdleTimeout"].isNumeric() )
+		m_IdleTimeout = json["m_IdleTimeout"].asFloat();
 }
 
 bool IVA::Start()
@@ -50,7 +97,20 @@ bool IVA::Start()
 
 	// we don't need to send basic auth
 	m_Headers.erase("Authorization");
-	Login();
+	m_Pool.SetLimits( m_MaxConnections > 0 ? m_MaxConnections : 1, m_IdleTimeout );
+	if ( m_RequestTimeout > 0.0f )
+		m_Pool.SetTimeout( m_RequestTimeout );
+	Relogin();
+
+	if ( m_bLocalSearch )
+	{
+		m_Index.Load( Config::Instance()->GetInstanceDataPath() + m_IndexFile );
+
+		// people deleted from the watchlist, here or anywhere else, have to stop matching locally
+		if ( m_WatchlistSyncInterval > 0.0f && TimerPool::Instance() != NULL )
+			m_spSyncTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( IVA, SyncWatchlist, this ), m_WatchlistSyncInterval, true, true );
+		SyncWatchlist();
+	}
 
 	return true;
 }
@@ -63,44 +123,35 @@ void IVA::ClassifyFace( const std::string & a_Face,
 	form.Finish();
 
 	Headers headers;
-	headers["X-IVA-Request"] = m_SessionId;
 	headers["Content-Type"] = form.GetContentType();
 
-	new RequestXml( this, "/dleProxyFr/:getFeature256SingleImage", "POST", headers, form.GetBody(), a_Callback );
+	SendRequest( "/dleProxyFr/:getFeature256SingleImage", "POST", headers, form.GetBody(), a_Callback );
 }
 
 bool IVA::SearchForFace( const TiXmlDocument & a_F256,
 	float a_fThreshold, int a_MaxResults,
 	Delegate<const Json::Value &> a_Callback )
 {
-	const TiXmlElement * pResult = a_F256.FirstChildElement( "Results" );
-	if ( pResult == NULL )
-		return false;
-	const TiXmlElement * pStatus = pResult->FirstChildElement( "Status" );
-	if ( pStatus == NULL )
-		return false;
-	const TiXmlElement * pFace = pResult->FirstChildElement( "Face" );
-	if ( pFace == NULL )
-		return false;
-	const TiXmlElement * pF256 = pFace->FirstChildElement( "F256" );
-	if ( pF256 == NULL )
+	F256::Face face;
+	if (! F256::Parse( a_F256, face ) )
 		return false;
 
-	Json::Value search;
-	search["_type"] = "frSearch";
-	search["_markup"] = "default";
-	Json::Value item;
-	item["threshold"] = a_fThreshold;
-	item["maxResults"] = a_MaxResults;
-	item["features"] = pF256->GetText();
-	search["items"][0] = item;
+	SearchReq * pReq = new SearchReq( this, face.m_Features, a_Callback );
+	if (! pReq->SearchLocal( a_MaxResults ) )
+		pReq->SearchService( face.m_Text, a_fThreshold, a_MaxResults );
+	return true;
+}
 
-	Headers headers;
-	headers["Accept"] = "application/json";
-	headers["Content-Type"] = "application/json";
-	headers["X-IVA-Request"] = m_SessionId;
+bool IVA::SearchForFace( const std::vector<float> & a_Features,
+	float a_fThreshold, int a_MaxResults,
+	Delegate<const Json::Value &> a_Callback )
+{
+	if ( a_Features.size() != F256::DIMENSIONS )
+		return false;
 
-	new RequestJson( this, "/frSearch/:watchlist", "POST", headers, search.toStyledString(), a_Callback );
+	SearchReq * pReq = new SearchReq( this, a_Features, a_Callback );
+	if (! pReq->SearchLocal( a_MaxResults ) )
+		pReq->SearchService( F256::FormatFeatures( a_Features ), a_fThreshold, a_MaxResults );
 	return true;
 }
 
@@ -111,9 +162,24 @@ bool IVA::AddFace( const TiXmlDocument & a_F256,
 	const std::string & a_Gender,
 	const std::string & a_DOB,
 	Delegate<const Json::Value &> a_Callback )
+{
+	Enrollment enroll;
+	if (! F256::Parse( a_F256, enroll.m_Face ) )
+		return false;
+	enroll.m_FaceImage = a_FaceImage;
+	enroll.m_PersonId = a_PersonId;
+	enroll.m_Name = a_Name;
+	enroll.m_Gender = a_Gender;
+	enroll.m_DOB = a_DOB;
+
+	return AddFace( enroll, a_Callback );
+}
+
+bool IVA::AddFace( const Enrollment & a_Enrollment,
+	Delegate<const Json::Value &> a_Callback )
 {
 	AddFaceReq * pReq = new AddFaceReq( this );
-	if (! pReq->Start( a_F256, a_FaceImage, a_PersonId, a_Name, a_Gender, a_DOB, a_Callback ) )
+	if (! pReq->Start( a_Enrollment, a_Callback ) )
 	{
 		delete pReq;
 		return false;
@@ -122,6 +188,17 @@ bool IVA::AddFace( const TiXmlDocument & a_F256,
 	return true;
 }
 
+bool IVA::AddFaces( const Enrollments & a_Enrollments,
+	Delegate<const Json::Value &> a_Callback )
+{
+	if ( a_Enrollments.size() == 0 )
+		return false;
+
+	BatchReq * pReq = new BatchReq( this, a_Enrollments, a_Callback );
+	pReq->Start();
+	return true;
+}
+
 //------------------------------
 
 void IVA::Login()
@@ -149,12 +226,17 @@ void IVA::Login()
 
 	new Request( this, "/session", "POST", headers, login.toStyledString(), 
 		DELEGATE( IVA, OnLoginSession, IService::Request *, this ) );
+
+	// a login that never answers would hold the queue forever
+	if ( m_RequestTimeout > 0.0f && TimerPool::Instance() != NULL )
+		m_spLoginTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( IVA, OnLoginTimeout, this ), m_RequestTimeout, true, false );
 }
 
 void IVA::OnLoginSession( IService::Request * a_pRequest )
 {
 	Log::Status( "IVA", "OnLoginSession: %s", a_pRequest->GetResponse().c_str() );
 
+	std::string sessionId, jSessionId;
 	const Cookies & cookies = a_pRequest->GetCookies();
 	for( Cookies::const_iterator iSetCookie = cookies.begin(); iSetCookie != cookies.end(); ++iSetCookie )
 	{
@@ -169,84 +251,334 @@ void IVA::OnLoginSession( IService::Request * a_pRequest )
 			if ( kv.size() != 2 )
 				continue;
 			if ( kv[0] == "IVASESSIONID" )
-				m_SessionId = kv[1];
+				sessionId = kv[1];
 			else if ( kv[0] == "JSESSIONID" )
-				m_JSessionId = kv[1];
+				jSessionId = kv[1];
 		}
 	}
 
 	m_spRetryTimer.reset();
-	if ( m_JSessionId.size() == 0 || m_SessionId.size() == 0 )
+	m_spLoginTimer.reset();
+	if ( jSessionId.size() == 0 || sessionId.size() == 0 )
 	{
-		Log::Error( "IVA", "Failed to login to service, will retry in %f seconds.", RETRY_LOGIN_INTERVAL );
-		if ( TimerPool::Instance() != NULL )
-			m_spRetryTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( IVA, Login, this ), RETRY_LOGIN_INTERVAL, true, false );
+		OnLoginFailed();
+		return;
 	}
 
+	m_SessionId = sessionId;
+	m_JSessionId = jSessionId;
 	m_Headers["Cookie"] = "JSESSIONID=" + m_JSessionId + "; IVASESSIONID=" + m_SessionId;
+
+	m_bLoggingIn = false;
+	m_Session += 1;
+	Log::Status( "IVA", "Session %u started, %u requests queued.", m_Session, m_Queued.size() );
+	Dispatch();
+}
+
+void IVA::OnLoginTimeout()
+{
+	m_spLoginTimer.reset();
+	Log::Error( "IVA", "Login timed out after %f seconds.", m_RequestTimeout );
+	OnLoginFailed();
+}
+
+void IVA::OnLoginFailed()
+{
+	Log::Error( "IVA", "Failed to login to service, will retry in %f seconds.", RETRY_LOGIN_INTERVAL );
+	if ( TimerPool::Instance() != NULL )
+		m_spRetryTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( IVA, Relogin, this ), RETRY_LOGIN_INTERVAL, true, false );
+
+	// stop holding the queue, an auth failure before the retry will start the next login itself
+	m_bLoggingIn = false;
+
+	// don't hold callers until the retry, anything queued now fails
+	while( m_Queued.size() > 0 )
+	{
+		SessionReq * pReq = m_Queued.front();
+		m_Queued.pop_front();
+		pReq->Fail();
+	}
+}
+
+void IVA::Relogin()
+{
+	if ( m_bLoggingIn )
+		return;
+	m_spRetryTimer.reset();
+
+	// requests are held in the queue until the new session is ready
+	m_bLoggingIn = true;
+	m_Headers.erase( "Cookie" );
+	if ( m_Session > 0 )
+		m_Relogins += 1;
+	Login();
+}
+
+void IVA::SendRequest( const std::string & a_Path, const std::string & a_Method, 
+	const Headers & a_Headers, const std::string & a_Body, Delegate<const Json::Value &> a_Callback )
+{
+	SessionReq * pReq = new SessionReq( this, a_Path, a_Method, a_Headers, a_Body );
+	pReq->m_JsonCallback = a_Callback;
+	m_Queued.push_back( pReq );
+	Dispatch();
+}
+
+void IVA::SendRequest( const std::string & a_Path, const std::string & a_Method, 
+	const Headers & a_Headers, const std::string & a_Body, Delegate<const TiXmlDocument &> a_Callback )
+{
+	SessionReq * pReq = new SessionReq( this, a_Path, a_Method, a_Headers, a_Body );
+	pReq->m_XmlCallback = a_Callback;
+	m_Queued.push_back( pReq );
+	Dispatch();
+}
+
+void IVA::Dispatch()
+{
+	if ( m_bLoggingIn )
+		return;
+
+	size_t maxActive = m_MaxConnections > 0 ? m_MaxConnections : 1;
+	while( m_Active < maxActive && m_Queued.size() > 0 )
+	{
+		SessionReq * pReq = m_Queued.front();
+		m_Queued.pop_front();
+
+		m_Active += 1;
+		pReq->m_Session = m_Session;
+		pReq->Send();
+	}
+}
+
+void IVA::OnRequestDone( SessionReq * a_pReq, bool a_bAuthFailed )
+{
+	m_Active -= 1;
+	if ( a_bAuthFailed && !a_pReq->m_bReplayed )
+	{
+		// replay it ahead of anything new, and only log in again if nobody has since this request was sent
+		a_pReq->m_bReplayed = true;
+		m_Queued.push_front( a_pReq );
+		if ( a_pReq->m_Session == m_Session && !m_bLoggingIn )
+		{
+			Log::Status( "IVA", "Session %u expired, logging in again (%u times so far).", m_Session, m_Relogins + 1 );
+			Relogin();
+		}
+	}
+	else
+		a_pReq->Deliver();
+
+	Dispatch();
+}
+
+void IVA::IndexFace( const std::string & a_PersonId, const std::string & a_Name, const std::vector<float> & a_Features )
+{
+	if (! m_bLocalSearch || a_PersonId.size() == 0 || a_Features.size() != FaceIndex::DIMENSIONS )
+		return;
+
+	if ( m_Index.Add( a_PersonId, a_Name, &a_Features[0], m_MaxFacesPerPerson ) )
+	{
+		Log::Debug( "IVA", "Indexed face for %s, %u embeddings", a_PersonId.c_str(), m_Index.GetSize() );
+		SaveIndex();
+	}
+}
+
+void IVA::SaveIndex()
+{
+	// batch up saves, the index can be large
+	if (! m_spSaveTimer && TimerPool::Instance() != NULL )
+		m_spSaveTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( IVA, OnSaveIndex, this ), m_SaveIndexDelay, true, false );
+}
+
+void IVA::OnSaveIndex()
+{
+	m_spSaveTimer.reset();
+	m_Index.Save( Config::Instance()->GetInstanceDataPath() + m_IndexFile );
+}
+
+void IVA::SyncWatchlist()
+{
+	if ( m_Index.GetSize() == 0 )
+		return;
+
+	IService::Headers headers;
+	headers["Accept"] = "application/json";
+
+	SendRequest( "/frPerson", "GET", headers, std::string(), 
+		DELEGATE( IVA, OnWatchlist, const Json::Value &, this ) );
+}
+
+void IVA::OnWatchlist( const Json::Value & a_Response )
+{
+	// only a complete listing can tell us who was removed, a failed or partial one changes nothing
+	const Json::Value & items = a_Response["items"];
+	if (! items.isArray() )
+		return;
+	if ( a_Response["_count"].isNumeric() && a_Response["_count"].asUInt() != items.size() )
+	{
+		Log::Warning( "IVA", "Watchlist listing is partial (%u of %u), not pruning the local index.", 
+			items.size(), a_Response["_count"].asUInt() );
+		return;
+	}
+
+	std::set<std::string> people;
+	for(Json::ArrayIndex i=0;i<items.size();++i)
+		if ( items[i]["personId"].isString() )
+			people.insert( items[i]["personId"].asString() );
+
+	size_t removed = m_Index.Retain( people );
+	if ( removed > 0 )
+	{
+		Log::Status( "IVA", "Removed %u people no longer on the watchlist from the local index.", removed );
+		SaveIndex();
+	}
 }
 
 //------------------------------
 
-bool IVA::AddFaceReq::Start( const TiXmlDocument & a_F256,
-	const std::string & a_FaceImage,
-	const std::string & a_PersonId,
-	const std::string & a_Name,
-	const std::string & a_Gender,
-	const std::string & a_DOB,
-	Delegate<const Json::Value &> a_Callback ) 
+void IVA::SessionReq::Send()
 {
-	const TiXmlElement * pResult = a_F256.FirstChildElement( "Results" );
-	if ( pResult == NULL )
-		return false;
+	m_SendHeaders = RestConnectionPool::Headers( m_pService->m_Headers.begin(), m_pService->m_Headers.end() );
+	for( Headers::const_iterator iHeader = m_Headers.begin(); iHeader != m_Headers.end(); ++iHeader )
+		m_SendHeaders[ iHeader->first ] = iHeader->second;
+	m_SendHeaders["X-IVA-Request"] = m_pService->m_SessionId;
+	m_URL = m_pService->GetConfig()->m_URL + m_Path;
+
+	// requests block on a kept connection, so they are made off the main thread
+	m_Response = RestConnectionPool::Response();
+	ThreadPool::Instance()->InvokeOnThread( VOID_DELEGATE( SessionReq, SendThread, this ) );
+}
 
-	//<Results><Timing>0.064</Timing><FileName>image</FileName><DLECode>DLE_W_0109</DLECode><Status>FR Feature Extraction &#x13; Face is not frontal. Facial match quality may degrade with non-frontal enrollment faces.</Status><Face><F256>0.6165 -6.3504 -5.3391 -13.0239 -0.0973 -9.9883 11.4153 -6.4570 15.8355 1.0788 20.1510 17.5951 -7.1724 0.4139 6.6838 -0.4952 -4.5128 12.6722 -5.1063 -2.3089 -10.6055 -6.3417 -14.4717 7.2971 -1.9838 -11.1928 -14.7495 16.4673 -9.1371 -12.1172 -5.5514 9.5825 -2.5176 -8.7385 21.3369 11.5865 12.9833 10.1630 -13.8693 -5.8165 6.6221 -2.2441 13.9780 -13.3803 16.0807 -9.6054 22.7298 5.8675 -18.3747 -16.1750 0.4032 -1.5285 -0.1982 -17.4374 2.5907 -5.2981 38.8106 3.5061 -5.2599 -8.1574 3.4742 -13.1186 -15.2119 -3.4147 -14.0982 2.7981 -13.9356 8.4495 -2.5669 2.0704 11.2463 -0.2928 5.8662 0.2160 -17.2828 4.9715 12.3843 7.0568 0.9047 -11.4179 8.6086 6.8528 10.7366 12.1707 12.2927 -6.5744 2.3041 -0.2815 18.1713 -1.1204 3.5948 13.7386 -2.9349 -17.8446 10.2510 6.2566 -5.1539 -1.1586 -11.4790 -1.4167 15.5319 -7.5912 -8.8199 -5.3994 -2.8592 19.7639 10.6854 -30.3857 -7.3318 6.7663 2.9734 1.9295 -10.7600 6.6638 1.9583 0.9783 -3.2504 2.1342 -11.0027 5.3454 -3.2135 3.3203 -1.8279 5.1674 2.6623 -9.4517 7.7426 1.2461 6.9951 -0.0318 14.8774 2.6740 -3.3000 -17.6370 2.8363 -0.6632 10.5034 6.4909 3.2685 -2.2509 2.7784 1.1734 -10.6742 17.2158 -19.4140 -3.0131 -2.3704 -15.5057 -7.1500 -13.2289 14.8897 -5.8013 15.5160 -13.0325 -0.0089 5.6545 8.8896 10.2119 22.1036 5.5096 1.6021 1.5328 -3.0141 -2.4776 -9.5128 4.7758 -6.6755 -12.2983 6.7337 6.2151 3.8802 -8.7262 12.0917 -4.2497 6.8140 -11.8950 0.5082 -9.5245 -2.3534 -7.9146 24.1788 -12.1433 1.3028 13.7380 3.6334 15.0911 -2.3768 -5.7348 4.7537 -7.5224 0.4359 -2.3956 1.0609 -11.5800 11.3684 7.1299 -3.0010 -1.3893 3.9988 -14.3261 -6.1891 3.2327 7.9145 7.1743 -8.0539 3.4162 9.3426 11.8292 13.8098 4.5767 5.9741 -5.2273 -9.3227 -9.7642 -0.9607 0.5212 -10.6932 -1.7009 -4.8142 -6.2554 -8.9581 2.1592 -5.5884 2.6274 5.7964 7.5079 -7.9041 1.4782 -27.9154 -8.1983 5.4678 -6.9570 -14.5523 1.7548 -6.0349 -14.4482 -12.1545 20.6386 10.8891 -5.8403 7.4397 3.6013 19.6444 8.9889 -10.2813 7.5666 -0.3139 10.8159 -15.1539 9.8051 6.6525 8.7129 -10.8988 2.7195 -6.0143 2.0331</F256><LandMarks><LeftEye>52 62</LeftEye><RightEye>79 59</RightEye><Nose>77 84</Nose><MouthLeft>63 96</MouthLeft><MouthRight>81 93</MouthRight></LandMarks><BBox>29.0 103.0 38.0 112.0</BBox></Face></Results>
-	const TiXmlElement * pStatus = pResult->FirstChildElement( "Status" );
-	if ( pStatus == NULL )
-		return false;
-	const TiXmlElement * pFace = pResult->FirstChildElement( "Face" );
-	if ( pFace == NULL )
-		return false;
-	const TiXmlElement * pF256 = pFace->FirstChildElement( "F256" );
-	if ( pF256 == NULL )
-		return false;
-	const TiXmlElement * pBBOX = pFace->FirstChildElement( "BBox" );
-	if ( pBBOX == NULL )
+void IVA::SessionReq::SendThread()
+{
+	m_pService->m_Pool.Request( m_URL, m_Method, m_SendHeaders, m_Body, m_Response );
+	ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( SessionReq, OnSent, this ) );
+}
+
+void IVA::SessionReq::Deliver()
+{
+	bool bSuccess = m_Response.m_StatusCode >= 200 && m_Response.m_StatusCode < 300;
+	if (! bSuccess )
+		Log::Error( "IVA", "Request %s failed, status %u", m_Path.c_str(), m_Response.m_StatusCode );
+
+	if ( m_JsonCallback.IsValid() )
+	{
+		Json::Value json;
+		if ( bSuccess && !Json::Reader().parse( m_Response.m_Content, json ) )
+			json = Json::Value();
+		m_JsonCallback( json );
+	}
+	if ( m_XmlCallback.IsValid() )
+	{
+		TiXmlDocument xml;
+		if ( bSuccess )
+			xml.Parse( m_Response.m_Content.c_str() );
+		m_XmlCallback( xml );
+	}
+
+	delete this;
+}
+
+void IVA::SessionReq::Fail()
+{
+	m_Response = RestConnectionPool::Response();
+	Deliver();
+}
+
+void IVA::SessionReq::OnSent()
+{
+	// an expired session is either refused outright, or redirected to the login page
+	unsigned int status = m_Response.m_StatusCode;
+	bool bAuthFailed = status == 401 || status == 403 || status == 302 || status == 440;
+	m_pService->OnRequestDone( this, bAuthFailed );
+}
+
+//------------------------------
+
+bool IVA::SearchReq::SearchLocal( int a_MaxResults )
+{
+	if (! m_pService->m_bLocalSearch || m_pService->m_Index.GetSize() == 0 )
 		return false;
-	const TiXmlElement * pLandMarks = pFace->FirstChildElement( "LandMarks" );
-	if ( pLandMarks == NULL )
+
+	// the caller's threshold is in the service's score units, local scores are cosine similarities
+	FaceIndex::Matches matches;
+	m_pService->m_Index.Search( &m_Features[0], m_pService->m_LocalThreshold, a_MaxResults, matches );
+	if ( matches.size() == 0 )
 		return false;
-	if ( a_PersonId.size() > 20 )
+
+	// same shape as the frSearch response, so callers can't tell where the match came from
+	m_Result["_type"] = "frSearch";
+	m_Result["_count"] = (int)matches.size();
+	for(size_t i=0;i<matches.size();++i)
 	{
-		Log::Warning( "IVA", "PersonId can not be any larger than 20 characters." );
-		return false;
+		Json::Value item;
+		item["personId"] = matches[i].m_PersonId;
+		item["fullName"] = matches[i].m_Name;
+		item["score"] = matches[i].m_Score;
+		m_Result["items"][(int)i] = item;
 	}
 
-	m_FaceImage = a_FaceImage;
-	m_PersonId = a_PersonId;
+	// keep the callback asynchronous like the service request
+	ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( SearchReq, OnLocalResult, this ) );
+	return true;
+}
 
-	m_Name = a_Name;
-	m_Gender = a_Gender;
-	if ( m_Gender.size() > 1 )
-		m_Gender = m_Gender.substr( 0, 1 );
-	m_DOB = a_DOB;
-	if ( m_DOB[0] == 0 )
-		m_DOB = m_Time.GetFormattedTime( "%Y-%m-%d" );
-	m_Callback = a_Callback;
+void IVA::SearchReq::SearchService( const std::string & a_Text, float a_fThreshold, int a_MaxResults )
+{
+	Json::Value search;
+	search["_type"] = "frSearch";
+	search["_markup"] = "default";
+	Json::Value item;
+	item["threshold"] = a_fThreshold;
+	item["maxResults"] = a_MaxResults;
+	item["features"] = a_Text;
+	search["items"][0] = item;
 
-	m_Features = pF256->GetText();
-	m_BBox = pBBOX->GetText();
+	IService::Headers headers;
+	headers["Accept"] = "application/json";
+	headers["Content-Type"] = "application/json";
 
-	m_Landmarks.clear();
-	const TiXmlElement * pMark = pLandMarks->FirstChildElement();
-	while( pMark != NULL )
+	m_pService->SendRequest( "/frSearch/:watchlist", "POST", headers, search.toStyledString(), 
+		DELEGATE( SearchReq, OnSearchResponse, const Json::Value &, this ) );
+}
+
+void IVA::SearchReq::OnLocalResult()
+{
+	m_Callback( m_Result );
+	delete this;
+}
+
+void IVA::SearchReq::OnSearchResponse( const Json::Value & a_Response )
+{
+	// remember this embedding for the best match, so next time we find them locally
+	const Json::Value & items = a_Response["items"];
+	if ( items.isArray() && items.size() > 0 && items[0]["personId"].isString() )
+		m_pService->IndexFace( items[0]["personId"].asString(), items[0]["fullName"].asString(), m_Features );
+
+	m_Callback( a_Response );
+	delete this;
+}
+
+//------------------------------
+
+bool IVA::AddFaceReq::Start( const Enrollment & a_Enrollment,
+	Delegate<const Json::Value &> a_Callback ) 
+{
+	if (! a_Enrollment.m_Face.IsValid() )
+		return false;
+	if ( a_Enrollment.m_PersonId.size() > 20 )
 	{
-		if ( m_Landmarks.size() > 0 )
-			m_Landmarks += " ";
-		m_Landmarks += pMark->GetText();
-		pMark = pMark->NextSiblingElement();
+		Log::Warning( "IVA", "PersonId can not be any larger than 20 characters." );
+		return false;
 	}
 
+	m_Enrollment = a_Enrollment;
+	if ( m_Enrollment.m_Gender.size() > 1 )
+		m_Enrollment.m_Gender = m_Enrollment.m_Gender.substr( 0, 1 );
+	if ( m_Enrollment.m_DOB.size() == 0 )
+		m_Enrollment.m_DOB = m_Time.GetFormattedTime( "%Y-%m-%d" );
+	m_Callback = a_Callback;
+
+	// files are only uploaded once the person exists, so a failed enrollment never leaves orphaned files,
+	// throughput comes from running several enrollments at once in BatchReq.
 	EnrollUser();
 	return true;
 }
@@ -260,87 +592,88 @@ void IVA::AddFaceReq::EnrollUser()
 	enroll["_type"] = "frPerson";
 	enroll["_markup"] = "default";
 	Json::Value item;
-	item["personId"] = m_PersonId;
+	item["personId"] = m_Enrollment.m_PersonId;
 
+	const std::string & gender = m_Enrollment.m_Gender;
 	std::vector<std::string> names;
-	StringUtil::Split( m_Name, " ", names ); 
+	StringUtil::Split( m_Enrollment.m_Name, " ", names ); 
 	if ( names.size() > 0 )
 	{
 		item["firstName"] = names[0];
-		item["fullName"] = m_Name;
+		item["fullName"] = m_Enrollment.m_Name;
 	}
 	else
 	{
-		item["firstName"] = m_Gender != "F" ? "John" : "Jane";
-		item["fullName"] = m_Gender != "F" ? "John Doe" : "Jane Doe";
+		item["firstName"] = gender != "F" ? "John" : "Jane";
+		item["fullName"] = gender != "F" ? "John Doe" : "Jane Doe";
 	}
 	item["lastName"] = names.size() > 1 ? names[names.size() - 1] : "";
-	item["dob"] = m_DOB;
-	item["gender"] = m_Gender;
+	item["dob"] = m_Enrollment.m_DOB;
+	item["gender"] = gender;
 
 	enroll["items"][0] = item;
 
 	IService::Headers headers;
 	headers["Accept"] = "application/json";
 	headers["Content-Type"] = "application/json";
-	headers["X-IVA-Request"] = m_pService->m_SessionId;
 
-	new RequestJson( m_pService, "/frPerson", "POST", headers, enroll.toStyledString(), 
+	m_pService->SendRequest( "/frPerson", "POST", headers, enroll.toStyledString(), 
 		DELEGATE( AddFaceReq, OnEnrollUser, const Json::Value &, this ) );
 }
 
 void IVA::AddFaceReq::OnEnrollUser( const Json::Value & a_Response )
 {
-	if (! a_Response.isNull() )
-	{
-		Log::Debug( "IVA::AddFaceReq", "Uploading files." );
+	if ( OnStepDone( !a_Response.isNull(), "EnrollUser" ) )
 		UploadFiles();
-	}
-	else
-	{
-		Log::Error( "IVA::AddFaceReq", "EnrollUser failed." );
-		m_Callback( Json::Value() );
-	}
 }
 
 void IVA::AddFaceReq::UploadFiles()
 {
 	m_CID = m_Time.GetFormattedTime( "%Y/%m/%d/wlf");
 
+	const F256::Face & face = m_Enrollment.m_Face;
+	const int * m = face.m_Landmarks;
+
 	Form form;
 	form.AddFormField( "response_type", "json" );		// was "xml"
-	form.AddFormField( "BBox", m_BBox ); 
-	form.AddFormField( "FaceMarks", m_Landmarks );
-	form.AddFormField( "f256", m_Features );
+	form.AddFormField( "BBox", StringUtil::Format( "%.1f %.1f %.1f %.1f", 
+		face.m_BBox[0], face.m_BBox[1], face.m_BBox[2], face.m_BBox[3] ) ); 
+	form.AddFormField( "FaceMarks", StringUtil::Format( "%d %d %d %d %d %d %d %d %d %d", 
+		m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8], m[9] ) );
+	form.AddFormField( "f256", face.m_Text );
 	// Wed Nov 16 2016 00:00:00 GMT-0600 (Central Standard Time)
 	form.AddFormField( "dateTaken", m_Time.GetFormattedTime( "%a %b %d %H:%M:%S %Z" ) );
 	form.AddFormField( "cid", m_CID );
-	form.AddFormField( "imageFileName", m_PersonId + ".jpg" );
-	form.AddFormField( "f256FileName", m_PersonId + ".F256" );
-	form.AddFilePart( "image", "face.jpg", m_FaceImage, "image/jpeg" );
+	form.AddFormField( "imageFileName", m_Enrollment.m_PersonId + ".jpg" );
+	form.AddFormField( "f256FileName", m_Enrollment.m_PersonId + ".F256" );
+	form.AddFilePart( "image", "face.jpg", m_Enrollment.m_FaceImage, "image/jpeg" );
 	form.Finish();
 
 	IService::Headers headers;
 	headers["Accept"] = "application/json";
 	headers["Content-Type"] = form.GetContentType();
-	headers["X-IVA-Request"] = m_pService->m_SessionId;
 
-	new RequestJson( m_pService, "/frFile", "POST", headers, form.GetBody(),
+	m_pService->SendRequest( "/frFile", "POST", headers, form.GetBody(),
 		DELEGATE( AddFaceReq, OnUploadFiles, const Json::Value &, this ) );
 }
 
 void IVA::AddFaceReq::OnUploadFiles( const Json::Value & a_Response )
 {
-	if (! a_Response.isNull() )
+	if ( OnStepDone( !a_Response.isNull(), "UploadFiles" ) )
 	{
 		Log::Debug( "IVA::AddFaceReq", "Uploading features." );
 		UpdateFeatures();
 	}
-	else
+}
+
+bool IVA::AddFaceReq::OnStepDone( bool a_bSuccess, const char * a_pStep )
+{
+	if (! a_bSuccess )
 	{
-		Log::Error( "IVA::AddFaceReq", "UploadFiles failed." );
-		m_Callback( Json::Value() );
+		Log::Error( "IVA::AddFaceReq", "%s failed for %s.", a_pStep, m_Enrollment.m_PersonId.c_str() );
+		Done( Json::Value() );
 	}
+	return a_bSuccess;
 }
 
 void IVA::AddFaceReq::UpdateFeatures()
@@ -350,18 +683,19 @@ void IVA::AddFaceReq::UpdateFeatures()
 	//"imagePath":"2016/11/16/wlf/img1479277955771wdc1frd_1479277956114.jpg",
 	//"featurePath":"2016/11/16/wlf/img1479277955771wdc1frd_1479277956114.F256",
 
+	const std::string & personId = m_Enrollment.m_PersonId;
+
 	Json::Value update;
 	update["_type"] = "watchlistFeature";
 	update["_markup"] = "default";
 	Json::Value item;
-	item["personId"] = m_PersonId;
+	item["personId"] = personId;
 	item["imageTS"] =  m_Time.GetFormattedTime( "%Y-%m-%dT00.00.00.000" );
-	item["imagePath"] = m_CID + "/" + m_PersonId + ".jpg";
-	item["featurePath"] = m_CID + "/" + m_PersonId + ".F256";
+	item["imagePath"] = m_CID + "/" + personId + ".jpg";
+	item["featurePath"] = m_CID + "/" + personId + ".F256";
 
 	//"bBox":{"lTX":10,"lTY":100,"rBX":100,"rBY":10},"eyes":{"lCX":20,"lCY":20,"rCX":80,"rCY":20},"nose":{"CX":50,"CY":50},"mouth":{"lCX":30,"lCY":80,"rCX":80,"rCY":80}}]}
-	float v[ 4 ];
-	sscanf( m_BBox.c_str(),"%f %f %f %f", &v[0], &v[1], &v[2], &v[3] );
+	const float * v = m_Enrollment.m_Face.m_BBox;
 
 	Json::Value bbox;
 	bbox["lTX"] = (int)v[0];
@@ -370,8 +704,7 @@ void IVA::AddFaceReq::UpdateFeatures()
 	bbox["rBY"] = (int)v[2];
 	item["bBox"] = bbox;
 
-	int m[ 10 ];
-	sscanf( m_Landmarks.c_str(), "%d %d %d %d %d %d %d %d %d %d", &m[0], &m[1], &m[2], &m[3], &m[4], &m[5], &m[6], &m[7], &m[8], &m[9] );
+	const int * m = m_Enrollment.m_Face.m_Landmarks;
 
 	Json::Value eyes;
 	eyes["lCX"] = m[0];
@@ -397,19 +730,79 @@ void IVA::AddFaceReq::UpdateFeatures()
 	IService::Headers headers;
 	headers["Accept"] = "application/json";
 	headers["Content-Type"] = "application/json";
-	headers["X-IVA-Request"] = m_pService->m_SessionId;
 
-	new RequestJson( m_pService, "/watchlistFeature", "POST", headers, update.toStyledString(), 
+	m_pService->SendRequest( "/watchlistFeature", "POST", headers, update.toStyledString(), 
 		DELEGATE( AddFaceReq, OnUpdateFeatures, const Json::Value &, this ) );
 }
 
 void IVA::AddFaceReq::OnUpdateFeatures( const Json::Value & a_Response )
 {
 	if (! a_Response.isNull() )
+	{
 		Log::Status( "IVA::AddFaceReq", "Face added." );
+		m_pService->IndexFace( m_Enrollment.m_PersonId, m_Enrollment.m_Name, m_Enrollment.m_Face.m_Features );
+	}
 	else
-		Log::Error( "IVA::AddFaceReq", "UploadFiles failed." );
+		Log::Error( "IVA::AddFaceReq", "UpdateFeatures failed." );
 
-	m_Callback( a_Response );
+	Done( a_Response );
+}
+
+void IVA::AddFaceReq::Done( const Json::Value & a_Response )
+{
+	if ( m_pBatch != NULL )
+		m_pBatch->OnFaceDone( this, a_Response );
+	else
+		m_Callback( a_Response );
+	delete this;
+}
+
+//------------------------------
+
+void IVA::BatchReq::Start()
+{
+	Log::Status( "IVA::BatchReq", "Enrolling %u faces.", m_Enrollments.size() );
+	m_Failed = Json::Value( Json::arrayValue );
+	StartNext();
 }
 
+void IVA::BatchReq::StartNext()
+{
+	size_t maxActive = m_pService->m_MaxConcurrentEnrollments > 0 ? m_pService->m_MaxConcurrentEnrollments : 1;
+	while( m_Active < maxActive && m_Next < m_Enrollments.size() )
+	{
+		const Enrollment & enroll = m_Enrollments[ m_Next++ ];
+
+		AddFaceReq * pReq = new AddFaceReq( m_pService, this );
+		if ( pReq->Start( enroll, Delegate<const Json::Value &>() ) )
+			m_Active += 1;
+		else
+		{
+			m_Failed.append( enroll.m_PersonId );
+			delete pReq;
+		}
+	}
+
+	if ( m_Active == 0 && m_Next >= m_Enrollments.size() )
+	{
+		Log::Status( "IVA::BatchReq", "Enrolled %u of %u faces in %.1f seconds.", 
+			m_Added, m_Enrollments.size(), Time().GetEpochTime() - m_StartTime.GetEpochTime() );
+
+		Json::Value summary;
+		summary["added"] = (int)m_Added;
+		summary["failed"] = m_Failed;
+		m_Callback( summary );
+		delete this;
+	}
+}
+
+void IVA::BatchReq::OnFaceDone( AddFaceReq * a_pReq, const Json::Value & a_Response )
+{
+	m_Active -= 1;
+	if (! a_Response.isNull() )
+		m_Added += 1;
+	else
+		m_Failed.append( a_pReq->GetPersonId() );
+
+	StartNext();
+}
@@ -20,6 +20,11 @@
 #define SELF_IVA_H
 
 #include "services/IFaceRecognition.h"
+#include "utils/FaceIndex.h"
+#include "utils/F256.h"
+#include "utils/RestConnectionPool.h"
+
+#include <list>
 
 //! Intelligent Video Analytics service
 class IVA : public IFaceRecognition
@@ -27,6 +32,18 @@ class IVA : public IFaceRecognition
 public:
 	RTTI_DECL();
 
+	//! Types
+	struct Enrollment
+	{
+		F256::Face			m_Face;
+		std::string			m_FaceImage;
+		std::string			m_PersonId;
+		std::string			m_Name;
+		std::string			m_Gender;
+		std::string			m_DOB;
+	};
+	typedef std::vector<Enrollment>		Enrollments;
+
 	//! Construction
 	IVA();
 
@@ -44,6 +61,10 @@ public:
 	bool SearchForFace( const TiXmlDocument & a_F256,
 		float a_fThreasHold, int a_MaxResults,
 		Delegate<const Json::Value &> a_Callback );
+	//! Search using features already extracted by ClassifyFace(), a known face is found without any round trip.
+	bool SearchForFace( const std::vector<float> & a_Features,
+		float a_fThreshold, int a_MaxResults,
+		Delegate<const Json::Value &> a_Callback );
 	//! Upload a new face along with a name
 	bool AddFace( const TiXmlDocument & a_F256,
 		const std::string & a_FaceImage,
@@ -52,6 +73,18 @@ public:
 		const std::string & a_Gender,
 		const std::string & a_DOB,
 		Delegate<const Json::Value &> a_Callback );
+	//! Upload a new face using features already parsed with F256::Parse()
+	bool AddFace( const Enrollment & a_Enrollment,
+		Delegate<const Json::Value &> a_Callback );
+	//! Upload many faces, at most m_MaxConcurrentEnrollments are in flight at once. The callback
+	//! is invoked once with a summary after every face has been added or has failed.
+	bool AddFaces( const Enrollments & a_Enrollments,
+		Delegate<const Json::Value &> a_Callback );
+
+	const FaceIndex & GetFaceIndex() const
+	{
+		return m_Index;
+	}
 
 private:
 	//! Data
@@ -59,44 +92,146 @@ private:
 	std::string			m_JSessionId;
 	TimerPool::ITimer::SP
 						m_spRetryTimer;
+	TimerPool::ITimer::SP
+						m_spLoginTimer;
+	bool				m_bLocalSearch;			// search the local index before asking the service
+	std::string			m_IndexFile;			// local index file in the instance data path
+	float				m_LocalThreshold;		// cosine similarity a local match needs, the service threshold is on another scale
+	float				m_WatchlistSyncInterval;	// seconds between removing people no longer on the watchlist, 0 to disable
+	unsigned int		m_MaxFacesPerPerson;	// most embeddings we keep for each person
+	float				m_SaveIndexDelay;
+	unsigned int		m_MaxConcurrentEnrollments;
+	unsigned int		m_MaxConnections;		// most requests we have open to the host at once, and connections kept open
+	float				m_RequestTimeout;		// seconds a login, or each step of a request, may take before it's abandoned
+	float				m_IdleTimeout;			// seconds an unused connection to the host is kept open
+	RestConnectionPool	m_Pool;
+	FaceIndex			m_Index;
+	TimerPool::ITimer::SP
+						m_spSaveTimer;
+	TimerPool::ITimer::SP
+						m_spSyncTimer;
+
+	class SessionReq;
+	typedef std::list<SessionReq *>		SessionReqList;
+
+	bool				m_bLoggingIn;
+	unsigned int		m_Session;				// incremented each time we log in
+	unsigned int		m_Relogins;
+	SessionReqList		m_Queued;				// requests waiting for a connection or a session
+	size_t				m_Active;
 
 	void Login();
 	void OnLoginSession( IService::Request * a_pRequest );
+	void OnLoginTimeout();
+	void OnLoginFailed();
+	void Relogin();
+	//! Queue a request to the service. The session headers are added when it is sent, and if the
+	//! session has expired the request is replayed once after we log in again.
+	void SendRequest( const std::string & a_Path, const std::string & a_Method, 
+		const Headers & a_Headers, const std::string & a_Body, Delegate<const Json::Value &> a_Callback );
+	void SendRequest( const std::string & a_Path, const std::string & a_Method, 
+		const Headers & a_Headers, const std::string & a_Body, Delegate<const TiXmlDocument &> a_Callback );
+	void Dispatch();
+	void OnRequestDone( SessionReq * a_pReq, bool a_bAuthFailed );
+	void IndexFace( const std::string & a_PersonId, const std::string & a_Name, const std::vector<float> & a_Features );
+	void SaveIndex();
+	void OnSaveIndex();
+	void SyncWatchlist();
+	void OnWatchlist( const Json::Value & a_Response );
+
+	class SessionReq
+	{
+	public:
+		SessionReq( IVA * a_pService, const std::string & a_Path, const std::string & a_Method, 
+			const Headers & a_Headers, const std::string & a_Body ) :
+			m_Session( 0 ), m_bReplayed( false ), m_pService( a_pService ), 
+			m_Path( a_Path ), m_Method( a_Method ), m_Headers( a_Headers ), m_Body( a_Body )
+		{}
+
+		//! Data
+		Delegate<const Json::Value &>
+							m_JsonCallback;
+		Delegate<const TiXmlDocument &>
+							m_XmlCallback;
+		unsigned int		m_Session;			// session this request was last sent with
+		bool				m_bReplayed;
+
+		void Send();
+		void Deliver();
+		void Fail();
+
+	private:
+		void SendThread();
+		void OnSent();
+
+		//! Data
+		IVA *				m_pService;
+		std::string			m_Path;
+		std::string			m_Method;
+		Headers				m_Headers;
+		std::string			m_Body;
+		std::string			m_URL;
+		RestConnectionPool::Headers
+							m_SendHeaders;		// m_Headers with the session headers, set before SendThread() runs
+		RestConnectionPool::Response
+							m_Response;
+	};
+
+	class SearchReq
+	{
+	public:
+		SearchReq( IVA * a_pService, const std::vector<float> & a_Features, 
+			Delegate<const Json::Value &> a_Callback ) : 
+			m_pService( a_pService ), m_Features( a_Features ), m_Callback( a_Callback )
+		{}
+
+		bool SearchLocal( int a_MaxResults );
+		void SearchService( const std::string & a_Text, float a_fThreshold, int a_MaxResults );
+
+	private:
+		void OnLocalResult();
+		void OnSearchResponse( const Json::Value & a_Response );
+
+		//! Data
+		IVA *				m_pService;
+		std::vector<float>	m_Features;
+		Delegate<const Json::Value &>
+							m_Callback;
+		Json::Value			m_Result;
+	};
+
+	class BatchReq;
 
 	class AddFaceReq
 	{
 	public:
-		AddFaceReq(IVA * a_pService) : m_pService( a_pService )
+		AddFaceReq(IVA * a_pService, BatchReq * a_pBatch = NULL ) : 
+			m_pService( a_pService ), m_pBatch( a_pBatch )
 		{}
 
-		bool Start( const TiXmlDocument & a_F256,
-			const std::string & a_FaceImage,
-			const std::string & a_PersonId,
-			const std::string & a_Name,
-			const std::string & a_Gender,
-			const std::string & a_DOB,
+		bool Start( const Enrollment & a_Enrollment,
 			Delegate<const Json::Value &> a_Callback );
 
+		const std::string & GetPersonId() const
+		{
+			return m_Enrollment.m_PersonId;
+		}
+
 	private:
 		void EnrollUser();
 		void OnEnrollUser( const Json::Value & a_Response );
 		void UploadFiles();
 		void OnUploadFiles( const Json::Value & a_Response );
+		//! Returns true if the step succeeded, otherwise the request is finished and deleted.
+		bool OnStepDone( bool a_bSuccess, const char * a_pStep );
 		void UpdateFeatures();
 		void OnUpdateFeatures( const Json::Value & a_Response );
+		void Done( const Json::Value & a_Response );
 
 		//! Data
 		IVA *				m_pService;
-
-		std::string			m_Features;
-		std::string			m_BBox;
-		std::string			m_Landmarks;
-
-		std::string			m_FaceImage;
-		std::string			m_PersonId;
-		std::string			m_Name;
-		std::string			m_Gender;
-		std::string			m_DOB;
+		BatchReq *			m_pBatch;
+		Enrollment			m_Enrollment;
 		Delegate<const Json::Value &>
 			m_Callback;
 
@@ -104,6 +239,33 @@ private:
 		std::string			m_CID;
 	};
 
+	class BatchReq
+	{
+	public:
+		BatchReq( IVA * a_pService, const Enrollments & a_Enrollments,
+			Delegate<const Json::Value &> a_Callback ) :
+			m_pService( a_pService ), m_Enrollments( a_Enrollments ), m_Callback( a_Callback ),
+			m_Next( 0 ), m_Active( 0 ), m_Added( 0 )
+		{}
+
+		void Start();
+		void OnFaceDone( AddFaceReq * a_pReq, const Json::Value & a_Response );
+
+	private:
+		void StartNext();
+
+		//! Data
+		IVA *				m_pService;
+		Enrollments			m_Enrollments;
+		Delegate<const Json::Value &>
+							m_Callback;
+		size_t				m_Next;
+		size_t				m_Active;
+		size_t				m_Added;
+		Json::Value			m_Failed;
+		Time				m_StartTime;
+	};
+
 };
 
 #endif //SELF_IVA_H
@@ -0,0 +1,174 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#include "F256.h"
+#include "tinyxml/tinyxml.h"
+
+#include <stdlib.h>
+
+static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+//! Parse one decimal number, the service only sends plain fixed point values so we avoid the locale
+//! aware strtod() unless we see something unusual like an exponent.
+static const char * ParseValue( const char * a_pText, float & a_Value )
+{
+	while( *a_pText == ' ' || *a_pText == '\t' || *a_pText == '\n' || *a_pText == '\r' )
+		++a_pText;
+
+	const char * pStart = a_pText;
+	bool bNegative = false;
+	if ( *a_pText == '-' || *a_pText == '+' )
+		bNegative = *a_pText++ == '-';
+
+	unsigned long long mantissa = 0;
+	int digits = 0, decimals = 0;
+	for(;*a_pText >= '0' && *a_pText <= '9';++a_pText, ++digits)
+		mantissa = (mantissa * 10) + (*a_pText - '0');
+	if ( *a_pText == '.' )
+	{
+		for(++a_pText;*a_pText >= '0' && *a_pText <= '9';++a_pText, ++digits, ++decimals)
+			mantissa = (mantissa * 10) + (*a_pText - '0');
+	}
+
+	if ( digits == 0 )
+		return NULL;
+	if ( digits > 18 || *a_pText == 'e' || *a_pText == 'E' )
+	{
+		char * pEnd = NULL;
+		a_Value = (float)strtod( pStart, &pEnd );
+		return pEnd != pStart ? pEnd : NULL;
+	}
+
+	double value = (double)mantissa / POWERS_OF_TEN[ decimals ];
+	a_Value = (float)(bNegative ? -value : value);
+	return a_pText;
+}
+
+bool F256::Parse( const TiXmlDocument & a_Response, Face & a_Face )
+{
+	const TiXmlElement * pResult = a_Response.FirstChildElement( "Results" );
+	if ( pResult == NULL )
+		return false;
+	const TiXmlElement * pStatus = pResult->FirstChildElement( "Status" );
+	if ( pStatus == NULL )
+		return false;
+	const TiXmlElement * pFace = pResult->FirstChildElement( "Face" );
+	if ( pFace == NULL )
+		return false;
+	const TiXmlElement * pF256 = pFace->FirstChildElement( "F256" );
+	if ( pF256 == NULL || pF256->GetText() == NULL )
+		return false;
+
+	a_Face.m_Text = pF256->GetText();
+	if (! ParseFeatures( a_Face.m_Text, a_Face.m_Features ) )
+		return false;
+	if ( pStatus->GetText() != NULL )
+		a_Face.m_Status = pStatus->GetText();
+
+	// bounding box and landmarks are only needed for enrollment, so they are optional here
+	const TiXmlElement * pBBox = pFace->FirstChildElement( "BBox" );
+	if ( pBBox != NULL && pBBox->GetText() != NULL )
+	{
+		const char * pText = pBBox->GetText();
+		for(int i=0;i<4 && pText != NULL;++i)
+			pText = ParseValue( pText, a_Face.m_BBox[i] );
+	}
+
+	const TiXmlElement * pLandMarks = pFace->FirstChildElement( "LandMarks" );
+	if ( pLandMarks != NULL )
+	{
+		int i = 0;
+		for( const TiXmlElement * pMark = pLandMarks->FirstChildElement(); pMark != NULL && i < 10; pMark = pMark->NextSiblingElement() )
+		{
+			const char * pText = pMark->GetText();
+			for(int j=0;j<2 && pText != NULL;++j, ++i)
+			{
+				float value = 0.0f;
+				pText = ParseValue( pText, value );
+				a_Face.m_Landmarks[i] = (int)value;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool F256::ParseFeatures( const char * a_pText, float * a_pFeatures )
+{
+	for(unsigned int i=0;i<DIMENSIONS;++i)
+	{
+		a_pText = ParseValue( a_pText, a_pFeatures[i] );
+		if ( a_pText == NULL )
+			return false;
+	}
+	return true;
+}
+
+bool F256::ParseFeatures( const std::string & a_Text, std::vector<float> & a_Features )
+{
+	a_Features.resize( DIMENSIONS );
+	if (! ParseFeatures( a_Text.c_str(), &a_Features[0] ) )
+	{
+		a_Features.clear();
+		return false;
+	}
+	return true;
+}
+
+void F256::FormatFeatures( const float * a_pFeatures, std::string & a_Text )
+{
+	a_Text.clear();
+	a_Text.reserve( DIMENSIONS * 9 );
+
+	char digits[ 24 ];
+	for(unsigned int i=0;i<DIMENSIONS;++i)
+	{
+		if ( i > 0 )
+			a_Text += ' ';
+
+		double value = a_pFeatures[i];
+		if ( value < 0.0 )
+		{
+			a_Text += '-';
+			value = -value;
+		}
+
+		// fixed point with 4 decimals, written backwards
+		unsigned long long fixed = (unsigned long long)((value * 10000.0) + 0.5);
+		int n = 0;
+		do 
+		{
+			digits[n++] = (char)('0' + (fixed % 10));
+			fixed /= 10;
+			if ( n == 4 )
+				digits[n++] = '.';
+		} while( fixed != 0 || n < 6 );
+
+		while( n > 0 )
+			a_Text += digits[--n];
+	}
+}
+
+std::string F256::FormatFeatures( const std::vector<float> & a_Features )
+{
+	std::string text;
+	if ( a_Features.size() == DIMENSIONS )
+		FormatFeatures( &a_Features[0], text );
+	return text;
+}
+
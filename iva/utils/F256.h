@@ -0,0 +1,70 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#ifndef SELF_F256_H
+#define SELF_F256_H
+
+#include <vector>
+#include <string>
+
+#include "SelfLib.h"			// include last always
+
+class TiXmlDocument;
+
+//! Codec for the F256 face features returned by the IVA feature extraction. The XML is walked once 
+//! and the features are packed into floats, the original text is kept so it can be uploaded as is.
+class F256
+{
+public:
+	//! Constants
+	static const unsigned int	DIMENSIONS = 256;
+
+	//! Types
+	struct Face
+	{
+		Face()
+		{
+			for(int i=0;i<4;++i)
+				m_BBox[i] = 0.0f;
+			for(int i=0;i<10;++i)
+				m_Landmarks[i] = 0;
+		}
+
+		std::vector<float>	m_Features;			// DIMENSIONS packed floats
+		std::string			m_Text;				// features as returned by the service
+		std::string			m_Status;
+		float				m_BBox[4];
+		int					m_Landmarks[10];	// left eye, right eye, nose, mouth left, mouth right as x y pairs
+
+		bool IsValid() const
+		{
+			return m_Features.size() == DIMENSIONS;
+		}
+	};
+
+	//! Parse a getFeature256SingleImage response, returns false if there is no face.
+	static bool Parse( const TiXmlDocument & a_Response, Face & a_Face );
+	//! Parse DIMENSIONS space separated values into a_pFeatures, returns false if there are too few.
+	static bool ParseFeatures( const char * a_pText, float * a_pFeatures );
+	static bool ParseFeatures( const std::string & a_Text, std::vector<float> & a_Features );
+	//! Format features back into text, with the same 4 decimal places the service uses.
+	static void FormatFeatures( const float * a_pFeatures, std::string & a_Text );
+	static std::string FormatFeatures( const std::vector<float> & a_Features );
+};
+
+#endif //SELF_F256_H
@@ -0,0 +1,325 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#include "FaceIndex.h"
+#include "utils/Log.h"
+
+#include <fstream>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FACE_INDEX_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define FACE_INDEX_NEON
+#include <arm_neon.h>
+#endif
+
+const float FaceIndex::REDUNDANT_SIMILARITY = 0.98f;			// closer than this to a known embedding adds nothing
+const unsigned int INDEX_MAGIC = 0x58444946;					// 'FIDX'
+const unsigned int INDEX_VERSION = 1;
+
+static bool SortMatches( const FaceIndex::Match & a_A, const FaceIndex::Match & a_B )
+{
+	return a_A.m_Score > a_B.m_Score;
+}
+
+FaceIndex::FaceIndex()
+{}
+
+size_t FaceIndex::GetSize() const
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_RowPersonIds.size();
+}
+
+size_t FaceIndex::GetPersonCount() const
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_Counts.size();
+}
+
+bool FaceIndex::Add( const std::string & a_PersonId, const std::string & a_Name, 
+	const float * a_pFeatures, size_t a_MaxPerPerson /*= 0*/ )
+{
+	float unit[ DIMENSIONS ];
+	if (! Normalize( a_pFeatures, unit ) )
+		return false;
+
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return AddRow( a_PersonId, a_Name, unit, a_MaxPerPerson );
+}
+
+void FaceIndex::Search( const float * a_pFeatures, float a_Threshold, int a_MaxResults, Matches & a_Matches ) const
+{
+	a_Matches.clear();
+
+	float query[ DIMENSIONS ];
+	if (! Normalize( a_pFeatures, query ) )
+		return;
+
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+
+	// best score for each person, a person may have several embeddings
+	std::map<std::string,float> best;
+	const size_t rows = m_RowPersonIds.size();
+	const float * pRow = rows > 0 ? &m_Matrix[0] : NULL;
+	for(size_t r=0;r<rows;++r, pRow += DIMENSIONS)
+	{
+		float score = DotProduct( query, pRow );
+		if ( score < a_Threshold )
+			continue;
+
+		std::map<std::string,float>::iterator iBest = best.find( m_RowPersonIds[r] );
+		if ( iBest == best.end() )
+			best[ m_RowPersonIds[r] ] = score;
+		else if ( score > iBest->second )
+			iBest->second = score;
+	}
+
+	for( std::map<std::string,float>::const_iterator iBest = best.begin(); iBest != best.end(); ++iBest )
+	{
+		Match match;
+		match.m_PersonId = iBest->first;
+		match.m_Score = iBest->second;
+
+		std::map<std::string,std::string>::const_iterator iName = m_Names.find( iBest->first );
+		if ( iName != m_Names.end() )
+			match.m_Name = iName->second;
+		a_Matches.push_back( match );
+	}
+
+	std::sort( a_Matches.begin(), a_Matches.end(), SortMatches );
+	if ( a_MaxResults > 0 && a_Matches.size() > (size_t)a_MaxResults )
+		a_Matches.resize( a_MaxResults );
+}
+
+bool FaceIndex::Remove( const std::string & a_PersonId )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	if ( m_Counts.find( a_PersonId ) == m_Counts.end() )
+		return false;
+
+	RemoveRows( std::set<std::string>(), a_PersonId );
+	return true;
+}
+
+size_t FaceIndex::Retain( const std::set<std::string> & a_PersonIds )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	size_t people = m_Counts.size();
+	RemoveRows( a_PersonIds, std::string() );
+	return people - m_Counts.size();
+}
+
+void FaceIndex::Clear()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Matrix.clear();
+	m_RowPersonIds.clear();
+	m_Names.clear();
+	m_Counts.clear();
+}
+
+bool FaceIndex::Load( const std::string & a_File )
+{
+	std::ifstream input( a_File.c_str(), std::ios::in | std::ios::binary );
+	if (! input.is_open() )
+		return false;
+
+	unsigned int header[ 3 ];
+	if (! input.read( (char *)header, sizeof(header) ) 
+		|| header[0] != INDEX_MAGIC || header[1] != INDEX_VERSION || header[2] != DIMENSIONS )
+	{
+		Log::Warning( "FaceIndex", "Ignoring incompatible face index %s", a_File.c_str() );
+		return false;
+	}
+
+	input.seekg( 0, std::ios::end );
+	std::streamoff remaining = (std::streamoff)input.tellg() - (std::streamoff)sizeof(header);
+	input.seekg( sizeof(header), std::ios::beg );
+
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Matrix.clear();
+	m_RowPersonIds.clear();
+	m_Names.clear();
+	m_Counts.clear();
+	m_Matrix.reserve( (size_t)(remaining / (DIMENSIONS * sizeof(float))) * DIMENSIONS );
+
+	// rows were de-duplicated when they were added, so they go straight into the matrix. Every length
+	// is checked against what is left of the file before we allocate for it.
+	float unit[ DIMENSIONS ];
+	unsigned int lengths[ 2 ];
+	while( remaining >= (std::streamoff)sizeof(lengths) && input.read( (char *)lengths, sizeof(lengths) ) )
+	{
+		remaining -= sizeof(lengths);
+		std::streamoff rowBytes = (std::streamoff)lengths[0] + (std::streamoff)lengths[1] + (std::streamoff)sizeof(unit);
+		if ( lengths[0] == 0 || rowBytes > remaining )
+		{
+			Log::Warning( "FaceIndex", "Face index %s is corrupt after %u embeddings.", a_File.c_str(), m_RowPersonIds.size() );
+			break;
+		}
+
+		std::string personId( lengths[0], 0 );
+		std::string name( lengths[1], 0 );
+		input.read( &personId[0], lengths[0] );
+		if ( lengths[1] > 0 )
+			input.read( &name[0], lengths[1] );
+		if (! input.read( (char *)unit, sizeof(unit) ) )
+			break;
+		remaining -= rowBytes;
+
+		m_Matrix.insert( m_Matrix.end(), unit, unit + DIMENSIONS );
+		m_RowPersonIds.push_back( personId );
+		if ( name.size() > 0 )
+			m_Names[ personId ] = name;
+		m_Counts[ personId ] += 1;
+	}
+
+	Log::Status( "FaceIndex", "Loaded %u embeddings for %u people from %s", 
+		m_RowPersonIds.size(), m_Counts.size(), a_File.c_str() );
+	return true;
+}
+
+bool FaceIndex::Save( const std::string & a_File ) const
+{
+	std::ofstream output( a_File.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+	if (! output.is_open() )
+	{
+		Log::Error( "FaceIndex", "Failed to save face index to %s", a_File.c_str() );
+		return false;
+	}
+
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+
+	unsigned int header[ 3 ] = { INDEX_MAGIC, INDEX_VERSION, DIMENSIONS };
+	output.write( (const char *)header, sizeof(header) );
+
+	for(size_t r=0;r<m_RowPersonIds.size();++r)
+	{
+		const std::string & personId = m_RowPersonIds[r];
+		std::map<std::string,std::string>::const_iterator iName = m_Names.find( personId );
+		const std::string name( iName != m_Names.end() ? iName->second : std::string() );
+
+		unsigned int lengths[ 2 ] = { (unsigned int)personId.size(), (unsigned int)name.size() };
+		output.write( (const char *)lengths, sizeof(lengths) );
+		output.write( personId.data(), personId.size() );
+		output.write( name.data(), name.size() );
+		output.write( (const char *)&m_Matrix[r * DIMENSIONS], DIMENSIONS * sizeof(float) );
+	}
+
+	return output.good();
+}
+
+bool FaceIndex::AddRow( const std::string & a_PersonId, const std::string & a_Name, 
+	const float * a_pUnit, size_t a_MaxPerPerson )
+{
+	size_t & count = m_Counts[ a_PersonId ];
+	if ( a_MaxPerPerson > 0 && count >= a_MaxPerPerson )
+		return false;
+
+	if ( count > 0 )
+	{
+		const float * pRow = &m_Matrix[0];
+		for(size_t r=0;r<m_RowPersonIds.size();++r, pRow += DIMENSIONS)
+			if ( m_RowPersonIds[r] == a_PersonId && DotProduct( a_pUnit, pRow ) > REDUNDANT_SIMILARITY )
+				return false;
+	}
+
+	m_Matrix.insert( m_Matrix.end(), a_pUnit, a_pUnit + DIMENSIONS );
+	m_RowPersonIds.push_back( a_PersonId );
+	if ( a_Name.size() > 0 )
+		m_Names[ a_PersonId ] = a_Name;
+	count += 1;
+
+	return true;
+}
+
+bool FaceIndex::Normalize( const float * a_pFeatures, float * a_pUnit )
+{
+	float length = sqrtf( DotProduct( a_pFeatures, a_pFeatures ) );
+	if ( length <= 0.0f || length != length )
+		return false;
+
+	float scale = 1.0f / length;
+	for(unsigned int i=0;i<DIMENSIONS;++i)
+		a_pUnit[i] = a_pFeatures[i] * scale;
+	return true;
+}
+
+float FaceIndex::DotProduct( const float * a_pA, const float * a_pB )
+{
+#if defined(FACE_INDEX_SSE)
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	for(unsigned int i=0;i<DIMENSIONS;i += 8)
+	{
+		acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( a_pA + i ), _mm_loadu_ps( a_pB + i ) ) );
+		acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_loadu_ps( a_pA + i + 4 ), _mm_loadu_ps( a_pB + i + 4 ) ) );
+	}
+	float lanes[4];
+	_mm_storeu_ps( lanes, _mm_add_ps( acc0, acc1 ) );
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(FACE_INDEX_NEON)
+	float32x4_t acc0 = vdupq_n_f32( 0.0f );
+	float32x4_t acc1 = vdupq_n_f32( 0.0f );
+	for(unsigned int i=0;i<DIMENSIONS;i += 8)
+	{
+		acc0 = vmlaq_f32( acc0, vld1q_f32( a_pA + i ), vld1q_f32( a_pB + i ) );
+		acc1 = vmlaq_f32( acc1, vld1q_f32( a_pA + i + 4 ), vld1q_f32( a_pB + i + 4 ) );
+	}
+	float lanes[4];
+	vst1q_f32( lanes, vaddq_f32( acc0, acc1 ) );
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+	float sum = 0.0f;
+	for(unsigned int i=0;i<DIMENSIONS;++i)
+		sum += a_pA[i] * a_pB[i];
+	return sum;
+#endif
+}
+
+void FaceIndex::RemoveRows( const std::set<std::string> & a_Keep, const std::string & a_Remove )
+{
+	// with a_Remove set only that person goes, otherwise everyone not in a_Keep goes. Surviving rows 
+	// are compacted in place so the matrix stays contiguous.
+	size_t kept = 0;
+	for(size_t r=0;r<m_RowPersonIds.size();++r)
+	{
+		const std::string & personId = m_RowPersonIds[r];
+		bool bRemove = a_Remove.size() > 0 ? personId == a_Remove : a_Keep.find( personId ) == a_Keep.end();
+		if ( bRemove )
+		{
+			m_Counts.erase( personId );
+			m_Names.erase( personId );
+			continue;
+		}
+
+		if ( kept != r )
+		{
+			memcpy( &m_Matrix[kept * DIMENSIONS], &m_Matrix[r * DIMENSIONS], DIMENSIONS * sizeof(float) );
+			m_RowPersonIds[kept] = personId;
+		}
+		kept += 1;
+	}
+
+	m_RowPersonIds.resize( kept );
+	m_Matrix.resize( kept * DIMENSIONS );
+}
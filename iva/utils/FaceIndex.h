@@ -0,0 +1,96 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#ifndef SELF_FACE_INDEX_H
+#define SELF_FACE_INDEX_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+
+#include <boost/thread.hpp>
+
+#include "SelfLib.h"			// include last always
+
+//! Local copy of the enrolled watchlist embeddings, so faces can be matched without a round trip
+//! to the IVA search service. Embeddings are stored normalized in one contiguous matrix so a search
+//! is a single pass of dot products, on unit vectors ranking by cosine is the same as ranking by L2.
+class FaceIndex
+{
+public:
+	//! Constants
+	static const unsigned int	DIMENSIONS = 256;
+
+	//! Types
+	struct Match
+	{
+		Match() : m_Score( 0.0f )
+		{}
+
+		std::string		m_PersonId;
+		std::string		m_Name;
+		float			m_Score;			// cosine similarity, 1.0 is a perfect match
+	};
+	typedef std::vector<Match>		Matches;
+
+	//! Construction
+	FaceIndex();
+
+	//! Accessors
+	size_t GetSize() const;
+	size_t GetPersonCount() const;
+
+	//! Add an embedding for a person, returns false if the embedding is invalid, already known, or 
+	//! the person already has a_MaxPerPerson embeddings. Pass 0 for no limit.
+	bool Add( const std::string & a_PersonId, const std::string & a_Name, 
+		const float * a_pFeatures, size_t a_MaxPerPerson = 0 );
+	//! Find the people closest to the given embedding, best match first. 
+	void Search( const float * a_pFeatures, float a_Threshold, int a_MaxResults, Matches & a_Matches ) const;
+	//! Remove every embedding for a person, returns false if we had none.
+	bool Remove( const std::string & a_PersonId );
+	//! Remove everyone not in a_PersonIds, returns the number of people removed.
+	size_t Retain( const std::set<std::string> & a_PersonIds );
+	//! Remove everything.
+	void Clear();
+
+	bool Load( const std::string & a_File );
+	bool Save( const std::string & a_File ) const;
+
+private:
+	//! Constants
+	static const float			REDUNDANT_SIMILARITY;
+
+	//! Data
+	mutable boost::mutex		m_Lock;
+	std::vector<float>			m_Matrix;			// one row of DIMENSIONS floats per embedding
+	std::vector<std::string>	m_RowPersonIds;
+	std::map<std::string,std::string>
+								m_Names;
+	std::map<std::string,size_t>
+								m_Counts;
+
+	bool				AddRow( const std::string & a_PersonId, const std::string & a_Name, 
+							const float * a_pUnit, size_t a_MaxPerPerson );
+	void				RemoveRows( const std::set<std::string> & a_Keep, const std::string & a_Remove );
+
+	static bool			Normalize( const float * a_pFeatures, float * a_pUnit );
+	static float		DotProduct( const float * a_pA, const float * a_pB );
+};
+
+#endif //SELF_FACE_INDEX_H
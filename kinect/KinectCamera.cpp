@@ -37,7 +37,11 @@ KinectCamera::KinectCamera() :
 	m_pSensor(NULL),
 	m_bProcessing(false),
 	m_hImageStream(NULL),
-	m_hImageStreamEvent(NULL)
+	m_hImageStreamEvent(NULL),
+	m_bDemandDriven(false),
+	m_fIdleFramesPerSec(1.0f),
+	m_CaptureId(0),
+	m_DeliveryId(0)
 {}
 
 void KinectCamera::Serialize(Json::Value & json)
@@ -46,6 +50,8 @@ void KinectCamera::Serialize(Json::Value & json)
 
 	json["m_Width"] = m_Width;
 	json["m_Height"] = m_Height;
+	json["m_bDemandDriven"] = m_bDemandDriven;
+	json["m_fIdleFramesPerSec"] = m_fIdleFramesPerSec;
 }
 
 void KinectCamera::Deserialize(const Json::Value & json)
@@ -56,6 +62,10 @@ void KinectCamera::Deserialize(const Json::Value & json)
 		m_Width = json["m_Width"].asInt();
 	if (json["m_Height"].isInt())
 		m_Height = json["m_Height"].asInt();
+	if (json["m_bDemandDriven"].isBool())
+		m_bDemandDriven = json["m_bDemandDriven"].asBool();
+	if (json["m_fIdleFramesPerSec"].isNumeric())
+		m_fIdleFramesPerSec = json["m_fIdleFramesPerSec"].asFloat();
 }
 
 bool KinectCamera::OnStart()
@@ -75,7 +85,12 @@ bool KinectCamera::OnStart()
 				&m_hImageStream);
 			if (! FAILED(hr) )
 			{
-				m_spWaitTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(KinectCamera, OnCaptureData, this), (1.0f / m_fFramesPerSec), false, true);
+				m_DeliveryId = DataDelivery::Instance()->Register( "KinectCamera", DataDelivery::LATEST, DataDelivery::PRIORITY_LOW, 1,
+					DELEGATE(KinectCamera, OnSendData, IData *, this) );
+				CaptureScheduler * pScheduler = CaptureScheduler::Instance();
+				m_CaptureId = pScheduler->Register( "KinectCamera", "VideoData", m_fFramesPerSec, 
+					m_bDemandDriven ? m_fIdleFramesPerSec : m_fFramesPerSec, DELEGATE(KinectCamera, OnCaptureRate, float, this) );
+				OnCaptureRate( pScheduler->GetRate( m_CaptureId ) );
 				Log::Status("KinectCamera", "Camera has started");
 			}
 			else
@@ -94,9 +109,19 @@ bool KinectCamera::OnStart()
 
 bool KinectCamera::OnStop()
 {
+	if ( m_CaptureId != 0 )
+	{
+		CaptureScheduler::Instance()->Unregister( m_CaptureId );
+		m_CaptureId = 0;
+	}
 	m_spWaitTimer.reset();
 	while( m_bProcessing )
 		boost::this_thread::yield();
+	if ( m_DeliveryId != 0 )
+	{
+		DataDelivery::Instance()->Unregister( m_DeliveryId );
+		m_DeliveryId = 0;
+	}
 
 	if (m_hImageStreamEvent != NULL)
 	{
@@ -118,9 +143,10 @@ bool KinectCamera::OnStop()
 
 void KinectCamera::OnCaptureData()
 {
-	if (! m_bProcessing )
+	if (! m_bProcessing && CaptureScheduler::Instance()->BeginCapture(m_CaptureId) )
 	{
 		m_bProcessing = true;
+		bool bQueued = false;
 		if (WAIT_OBJECT_0 == WaitForSingleObject(m_hImageStreamEvent, 0))
 		{
 			// Attempt to get the depth frame
@@ -152,8 +178,8 @@ void KinectCamera::OnCaptureData()
 					std::string jpeg;
 					if ( JpegHelpers::EncodeImage( pRGB, m_Width, m_Height, 4, jpeg ) )
 					{
-						ThreadPool::Instance()->InvokeOnMain<IData *>(
-							DELEGATE(KinectCamera, OnSendData, IData *, this), new VideoData(jpeg));
+						DataDelivery::Instance()->Send(m_DeliveryId, new VideoData(jpeg));
+						bQueued = true;
 					}
 
 					delete [] pRGB;
@@ -165,12 +191,21 @@ void KinectCamera::OnCaptureData()
 				m_pSensor->NuiImageStreamReleaseFrame(m_hImageStream, &imageFrame);
 			}
 		}
+		CaptureScheduler::Instance()->EndCapture(m_CaptureId, bQueued);
 		m_bProcessing = false;
 	}
 }
 
+void KinectCamera::OnCaptureRate(float a_fRate)
+{
+	m_spWaitTimer.reset();
+	if (a_fRate > 0.0f && m_pSensor != NULL)
+		m_spWaitTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(KinectCamera, OnCaptureData, this), (1.0f / a_fRate), false, true);
+}
+
 void KinectCamera::OnSendData(IData * a_pData)
 {
+	CaptureScheduler::Instance()->Delivered(m_CaptureId);
 	SendData(a_pData);
 }
 
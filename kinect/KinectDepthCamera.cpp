@@ -40,7 +40,11 @@ KinectDepthCamera::KinectDepthCamera() :
 	m_pSensor(NULL),
 	m_bProcessing(false),
 	m_hDepthStream(NULL),
-	m_hDepthStreamEvent(NULL)
+	m_hDepthStreamEvent(NULL),
+	m_bDemandDriven(false),
+	m_fIdleFramesPerSec(1.0f),
+	m_CaptureId(0),
+	m_DeliveryId(0)
 {}
 
 void KinectDepthCamera::Serialize(Json::Value & json)
@@ -50,6 +54,8 @@ void KinectDepthCamera::Serialize(Json::Value & json)
 	json["m_Width"] = m_Width;
 	json["m_Height"] = m_Height;
 	json["m_bNearMode"] = m_bNearMode;
+	json["m_bDemandDriven"] = m_bDemandDriven;
+	json["m_fIdleFramesPerSec"] = m_fIdleFramesPerSec;
 }
 
 void KinectDepthCamera::Deserialize(const Json::Value & json)
@@ -62,6 +68,10 @@ void KinectDepthCamera::Deserialize(const Json::Value & json)
 		m_Height = json["m_Height"].asInt();
 	if (json["m_bNearMode"].isBool())
 		m_bNearMode = json["m_bNearMode"].asBool();
+	if (json["m_bDemandDriven"].isBool())
+		m_bDemandDriven = json["m_bDemandDriven"].asBool();
+	if (json["m_fIdleFramesPerSec"].isNumeric())
+		m_fIdleFramesPerSec = json["m_fIdleFramesPerSec"].asFloat();
 }
 
 bool KinectDepthCamera::OnStart()
@@ -83,7 +93,12 @@ bool KinectDepthCamera::OnStart()
 			if (!FAILED(hr))
 			{
 				m_pSensor->NuiImageStreamSetImageFrameFlags(m_hDepthStream, m_bNearMode ? NUI_IMAGE_STREAM_FLAG_ENABLE_NEAR_MODE : 0);
-				m_spWaitTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(KinectDepthCamera, OnCaptureData, this), (1.0f / m_fFramesPerSec), false, true);
+				m_DeliveryId = DataDelivery::Instance()->Register( "KinectDepthCamera", DataDelivery::LATEST, DataDelivery::PRIORITY_LOW, 1,
+					DELEGATE(KinectDepthCamera, OnSendData, IData *, this) );
+				CaptureScheduler * pScheduler = CaptureScheduler::Instance();
+				m_CaptureId = pScheduler->Register( "KinectDepthCamera", "DepthVideoData", m_fFramesPerSec, 
+					m_bDemandDriven ? m_fIdleFramesPerSec : m_fFramesPerSec, DELEGATE(KinectDepthCamera, OnCaptureRate, float, this) );
+				OnCaptureRate( pScheduler->GetRate( m_CaptureId ) );
 				Log::Status("KinectDepthCamera", "Camera has started");
 			}
 			else
@@ -102,9 +117,19 @@ bool KinectDepthCamera::OnStart()
 
 bool KinectDepthCamera::OnStop()
 {
+	if ( m_CaptureId != 0 )
+	{
+		CaptureScheduler::Instance()->Unregister( m_CaptureId );
+		m_CaptureId = 0;
+	}
 	m_spWaitTimer.reset();
 	while( m_bProcessing )
 		boost::this_thread::yield();
+	if ( m_DeliveryId != 0 )
+	{
+		DataDelivery::Instance()->Unregister( m_DeliveryId );
+		m_DeliveryId = 0;
+	}
 
 	if (m_hDepthStreamEvent != NULL)
 	{
@@ -126,9 +151,10 @@ bool KinectDepthCamera::OnStop()
 
 void KinectDepthCamera::OnCaptureData()
 {
-	if (! m_bProcessing )
+	if (! m_bProcessing && CaptureScheduler::Instance()->BeginCapture(m_CaptureId) )
 	{
 		m_bProcessing = true;
+		bool bQueued = false;
 		if (WAIT_OBJECT_0 == WaitForSingleObject(m_hDepthStreamEvent, 0))
 		{
 			// Attempt to get the depth frame
@@ -173,8 +199,8 @@ void KinectDepthCamera::OnCaptureData()
 						std::vector<unsigned char> encoded;
 						if ( cv::imencode(".png", encode, encoded) )
 						{
-							ThreadPool::Instance()->InvokeOnMain<IData *>(
-								DELEGATE(KinectDepthCamera, OnSendData, IData *, this), new DepthVideoData(encoded));
+							DataDelivery::Instance()->Send(m_DeliveryId, new DepthVideoData(encoded));
+							bQueued = true;
 
 	#if WRITE_DEPTH_IMAGE
 							FILE * fp = fopen("depth.png", "wb");
@@ -195,12 +221,21 @@ void KinectDepthCamera::OnCaptureData()
 				m_pSensor->NuiImageStreamReleaseFrame(m_hDepthStream, &imageFrame);
 			}
 		}
+		CaptureScheduler::Instance()->EndCapture(m_CaptureId, bQueued);
 		m_bProcessing = false;
 	}
 }
 
+void KinectDepthCamera::OnCaptureRate(float a_fRate)
+{
+	m_spWaitTimer.reset();
+	if (a_fRate > 0.0f && m_pSensor != NULL)
+		m_spWaitTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(KinectDepthCamera, OnCaptureData, this), (1.0f / a_fRate), false, true);
+}
+
 void KinectDepthCamera::OnSendData(IData * a_pData)
 {
+	CaptureScheduler::Instance()->Delivered(m_CaptureId);
 	SendData(a_pData);
 }
 
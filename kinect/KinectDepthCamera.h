@@ -21,6 +21,8 @@
 
 #include "utils/TimerPool.h"
 #include "sensors/DepthCamera.h"
+#include "capture/CaptureScheduler.h"
+#include "capture/DataDelivery.h"
 
 struct INuiSensor;
 
@@ -54,8 +56,13 @@ private:
 	int						m_Width;
 	int						m_Height;
 	bool					m_bNearMode;
+	bool					m_bDemandDriven;		// drop to m_fIdleFramesPerSec when nobody has asked for data
+	float					m_fIdleFramesPerSec;
+	int						m_CaptureId;
+	int						m_DeliveryId;
 
 	void 					OnCaptureData();
+	void					OnCaptureRate( float a_fRate );
 	void					OnSendData( IData * a_pData );
 };
 
@@ -20,8 +20,32 @@
 #include "sensors/AudioData.h"
 #include "SelfInstance.h"
 
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 const float RECONNECT_TIME = 5.0f;
 const unsigned int FRAME_SIZE = 320;			// how many frames to send per web socket frame
+const unsigned int MAX_CATCHUP_FRAMES = 5;		// after a longer stall we resync the frame clock instead of bursting
+
+//! Returns seconds from a clock that never goes backwards, unlike the wall clock
+static double GetMonotonicTime()
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, counter;
+	QueryPerformanceFrequency( &freq );
+	QueryPerformanceCounter( &counter );
+	return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+}
 
 REG_SERIALIZABLE( Telephony );
 REG_OVERRIDE_SERIALIZABLE( ITelephony, Telephony );
@@ -33,18 +57,55 @@ Telephony::Telephony() : ITelephony( "TelephonyV1" ),
 	m_bConnected( false ),
 	m_AudioInFormat( "audio/L16;rate=16000" ), 
 	m_AudioOutFormat( "audio/L16;rate=16000" ),
+	m_GatewayFormat( "audio/L16;rate=16000" ),
 	m_bInCall( false ),
-	m_nSendBytes( FRAME_SIZE * 2 )
+	m_nSendBytes( FRAME_SIZE * 2 ),
+	m_FrameInterval( 0.02 ),
+	m_SendStart( 0.0 ),
+	m_FramesSent( 0 ),
+	m_SendBufferFrames( 50 ),
+	m_JitterMinFrames( 3 ),
+	m_JitterMaxFrames( 15 ),
+	m_bEchoCancellation( true ),
+	m_EchoTailMs( 128 ),
+	m_EchoDelayMs( 0 ),
+	m_EchoMaxDelayMs( 1500 )
 {}
 
 void Telephony::Serialize(Json::Value & json)
 {
 	ITelephony::Serialize(json);
+
+	json["m_SendBufferFrames"] = m_SendBufferFrames;
+	json["m_JitterMinFrames"] = m_JitterMinFrames;
+	json["m_JitterMaxFrames"] = m_JitterMaxFrames;
+	json["m_GatewayFormat"] = m_GatewayFormat;
+	json["m_bEchoCancellation"] = m_bEchoCancellation;
+	json["m_EchoTailMs"] = m_EchoTailMs;
+	json["m_EchoDelayMs"] = m_EchoDelayMs;
+	json["m_EchoMaxDelayMs"] = m_EchoMaxDelayMs;
 }
 
 void Telephony::Deserialize(const Json::Value & json)
 {
 	ITelephony::Deserialize(json);
+
+	if ( json["m_SendBufferFrames"].isNumeric() )
+		m_SendBufferFrames = json["m_SendBufferFrames"].asUInt();
+	if ( json["m_JitterMinFrames"].isNumeric() )
+		m_JitterMinFrames = json["m_JitterMinFrames"].asUInt();
+	if ( json["m_JitterMaxFrames"].isNumeric() )
+		m_JitterMaxFrames = json["m_JitterMaxFrames"].asUInt();
+	if ( json["m_GatewayFormat"].isString() )
+		m_GatewayFormat = json["m_GatewayFormat"].asString();
+	if ( json["m_bEchoCancellation"].isBool() )
+		m_bEchoCancellation = json["m_bEchoCancellation"].asBool();
+	if ( json["m_EchoTailMs"].isNumeric() )
+		m_EchoTailMs = json["m_EchoTailMs"].asUInt();
+	if ( json["m_EchoDelayMs"].isNumeric() )
+		m_EchoDelayMs = json["m_EchoDelayMs"].asUInt();
+	if ( json["m_EchoMaxDelayMs"].isNumeric() )
+		m_EchoMaxDelayMs = json["m_EchoMaxDelayMs"].asUInt();
 }
 
 Telephony::~Telephony()
@@ -57,6 +118,16 @@ bool Telephony::Start()
 	if (! ITelephony::Start() )
 		return false;
 
+	// audio is converted once at the edge, everything between runs at the gateway format
+	if (! m_Gateway.Parse( m_GatewayFormat ) )
+	{
+		Log::Error( "Telephony", "Unsupported gateway audio format: %s", m_GatewayFormat.c_str() );
+		return false;
+	}
+	if (! m_SendConverter.Configure( m_AudioOutFormat, m_GatewayFormat ) 
+		|| ! m_ReceiveConverter.Configure( m_GatewayFormat, m_AudioInFormat ) )
+		return false;
+
 	return true;
 }
 
@@ -189,11 +260,24 @@ bool Telephony::Disconnect()
 }
 
 //! Send binary audio data up to the gateway, the format of the audio must match the format 
-//! specified by GetAudioFormat(), usually audio/L16;rate=16000
+//! specified by GetAudioOutFormat(), usually audio/L16;rate=16000
 void Telephony::SendAudioIn( const std::string & a_Audio )
 {
 	if ( m_spConnection && m_bInCall )
-		m_Outgoing.push_back( a_Audio );
+	{
+		size_t dropped = 0;
+		if (! m_SendConverter.IsPassThrough() )
+		{
+			m_SendConverted.clear();
+			m_SendConverter.Convert( a_Audio, m_SendConverted );
+			dropped = m_Outgoing.Write( m_SendConverted.data(), m_SendConverted.size() );
+		}
+		else
+			dropped = m_Outgoing.Write( a_Audio.data(), a_Audio.size() );
+
+		if ( dropped > 0 )
+			m_Stats.m_SendOverruns += 1;
+	}
 }
 
 //---------------------------------------------
@@ -229,10 +313,15 @@ void Telephony::OnListenMessage( IWebSocket::FrameSP a_spFrame )
 	}
 	else if ( a_spFrame->m_Op == IWebSocket::BINARY_FRAME )
 	{
-		// TODO: echo cancellation..
 //		Log::DebugLow( "Telephony", "Received %u bytes of audio", a_spFrame->m_Data.size() );
 		if ( m_OnAudioOut.IsValid() && a_spFrame->m_Data.size() > 0 )
-			m_OnAudioOut( a_spFrame->m_Data );
+		{
+			// while in a call the frame clock paces received audio through the jitter buffer
+			if ( m_spSendTimer )
+				m_Incoming.Push( a_spFrame->m_Data );
+			else
+				PlayAudioOut( a_spFrame->m_Data );
+		}
 	}
 }
 
@@ -264,55 +353,122 @@ void Telephony::OnListenData( IWebClient::RequestData * a_pData )
 
 void Telephony::StartSendTimer()
 {
-	unsigned int bps, channels, freq;
-	if ( AudioData::ParseAudioFormat( m_AudioOutFormat, freq, bps, channels ) )
+	if ( m_Gateway.IsValid() )
 	{
-		unsigned int nBytesPerSecond = freq * (bps / 8) * channels;
-		m_nSendBytes = FRAME_SIZE * (bps / 8) * channels;
+		unsigned int nBytesPerSecond = m_Gateway.m_Rate * m_Gateway.GetFrameBytes();
+		m_nSendBytes = FRAME_SIZE * m_Gateway.GetFrameBytes();
+		m_FrameInterval = (double)m_nSendBytes / (double)nBytesPerSecond;
+
+		// both directions run at the gateway format, so one frame size serves both
+		m_Outgoing.Reset( m_nSendBytes, m_SendBufferFrames );
+		m_SendFrame.resize( m_nSendBytes );
+		m_Incoming.Reset( m_nSendBytes, m_JitterMinFrames, m_JitterMaxFrames );
+		m_SendConverter.Reset();
+		m_ReceiveConverter.Reset();
+		m_Stats = AudioStats();
+
+		// the received audio is the far-end reference for the audio we send
+		if ( m_bEchoCancellation && m_Gateway.m_Bits == 16 && m_Gateway.m_Channels == 1 )
+			m_Echo.Reset( m_Gateway.m_Rate, m_EchoTailMs, m_EchoDelayMs, m_EchoMaxDelayMs );
+		else
+			m_Echo.Reset( m_Gateway.m_Rate, 0, 0, 0 );
 
-		double sendInterval =  (double)m_nSendBytes / (double)nBytesPerSecond;
+		// the timer only wakes us up, how many frames to send is decided by the monotonic frame clock
+		m_SendStart = GetMonotonicTime();
+		m_FramesSent = 0;
 		m_spSendTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( Telephony, OnSendAudioData, this ), 
-			sendInterval, true, true );
+			m_FrameInterval / 2.0, true, true );
 
 		Log::Status( "Telephony", "Started send timer, Interval: %f, Send Bytes: %u, Bytes Sec: %u", 
-			sendInterval, m_nSendBytes, nBytesPerSecond );
+			m_FrameInterval, m_nSendBytes, nBytesPerSecond );
 	}
 	else
-		Log::Error( "Telephony", "Unsupported audio format: %s", m_AudioOutFormat.c_str() );
+		Log::Error( "Telephony", "Unsupported audio format: %s", m_GatewayFormat.c_str() );
 }
 
 void Telephony::OnSendAudioData()
 {
 	if ( m_spConnection != NULL && m_bInCall )
 	{
-		std::string frame;
-		while( m_Outgoing.size() > 0 && frame.size() < m_nSendBytes )
+		unsigned int due = (unsigned int)((GetMonotonicTime() - m_SendStart) / m_FrameInterval) + 1;
+		if ( due <= m_FramesSent )
+			return;
+
+		unsigned int frames = due - m_FramesSent;
+		if ( frames > 1 )
+			m_Stats.m_LateTicks += 1;
+		if ( frames > MAX_CATCHUP_FRAMES )
 		{
-			std::string & data = m_Outgoing.front();
+			m_FramesSent = due - 1;
+			frames = 1;
+		}
 
-			size_t bytes = data.size();
-			size_t remaining = m_nSendBytes - frame.size();
-			if ( bytes > remaining )
-				bytes = remaining;
+		for(unsigned int i=0;i<frames;++i)
+		{
+			size_t bytes = m_Outgoing.Read( &m_SendFrame[0], m_nSendBytes );
+			if ( bytes < m_nSendBytes )
+			{
+				memset( &m_SendFrame[bytes], 0, m_nSendBytes - bytes );			// fill frame with zeros
+				m_Stats.m_SendUnderruns += 1;
+			}
 
-			frame += std::string( data.c_str(), bytes );
-			if ( bytes == data.size() )
-				m_Outgoing.pop_front();
-			else
-				data.erase( 0, bytes );
-		}
+			if ( m_Echo.IsEnabled() )
+			{
+				double start = GetMonotonicTime();
+				m_Echo.ProcessNearEnd( (short *)&m_SendFrame[0], m_nSendBytes / sizeof(short) );
+
+				double cost = ((GetMonotonicTime() - start) * 1000000.0) * (0.01 / m_FrameInterval);
+				m_Stats.m_EchoCost = m_Stats.m_EchoCost > 0.0 ? (m_Stats.m_EchoCost * 0.95) + (cost * 0.05) : cost;
+				m_Stats.m_DoubleTalkBlocks = m_Echo.GetDoubleTalkBlocks();
+				m_Stats.m_EchoDelayMs = m_Echo.GetDelayMs();
+			}
 
-		if ( frame.size() < m_nSendBytes )
-			frame += std::string( m_nSendBytes - frame.size(), '\0' );			// fill frame with zeros
+//			Log::DebugLow( "Telephony", "Sending %u bytes of audio", m_SendFrame.size() );
+			m_spConnection->SendBinary( m_SendFrame );
+			m_FramesSent += 1;
 
-//		Log::DebugLow( "Telephony", "Sending %u bytes of audio", frame.size() );
-		m_spConnection->SendBinary( frame );
+			// the far-end timeline advances with the frame clock, silence included, so the canceller can
+			// measure the delay through the speaker, microphone and m_Outgoing queue.
+			if ( m_OnAudioOut.IsValid() && m_Incoming.Pop( m_ReceiveFrame ) )
+			{
+				m_Echo.PlayFarEnd( (const short *)m_ReceiveFrame.data(), m_ReceiveFrame.size() / sizeof(short) );
+				PlayAudioOut( m_ReceiveFrame );
+			}
+			else if ( m_Echo.IsEnabled() )
+			{
+				m_ReceiveFrame.assign( m_nSendBytes, 0 );
+				m_Echo.PlayFarEnd( (const short *)m_ReceiveFrame.data(), m_ReceiveFrame.size() / sizeof(short) );
+			}
+		}
+
+		m_Stats.m_ReceiveUnderruns = m_Incoming.GetUnderruns();
+		m_Stats.m_ReceiveOverruns = m_Incoming.GetOverruns();
+		m_Stats.m_ReceiveDepth = (unsigned int)m_Incoming.GetTargetFrames();
 	}
 	else
 	{
-		Log::Status( "Telephony", "Ending send timer." );
+		Log::Status( "Telephony", "Ending send timer, late: %u, send underruns: %u, send overruns: %u, "
+			"receive underruns: %u, receive overruns: %u, jitter depth: %u, echo cost: %.1f us/10ms, "
+			"echo delay: %u ms", m_Stats.m_LateTicks, m_Stats.m_SendUnderruns, m_Stats.m_SendOverruns, 
+			m_Stats.m_ReceiveUnderruns, m_Stats.m_ReceiveOverruns, m_Stats.m_ReceiveDepth, m_Stats.m_EchoCost,
+			m_Stats.m_EchoDelayMs );
 		m_spSendTimer.reset();
+		m_Outgoing.Clear();
+	}
+}
+
+void Telephony::PlayAudioOut( const std::string & a_Audio )
+{
+	if ( m_ReceiveConverter.IsPassThrough() )
+	{
+		m_OnAudioOut( a_Audio );
+		return;
 	}
+
+	m_ReceiveConverted.clear();
+	m_ReceiveConverter.Convert( a_Audio, m_ReceiveConverted );
+	if ( m_ReceiveConverted.size() > 0 )
+		m_OnAudioOut( m_ReceiveConverted );
 }
 
 void Telephony::OnReconnect()
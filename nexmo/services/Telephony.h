@@ -20,6 +20,10 @@
 #define SELF_TELEPHONY_H
 
 #include "utils/IWebClient.h"
+#include "utils/AudioRing.h"
+#include "utils/JitterBuffer.h"
+#include "audio/AudioConverter.h"
+#include "audio/EchoCanceller.h"
 #include "services/ITelephony.h"
 #include "SelfLib.h"			// include last always
 
@@ -32,6 +36,25 @@ public:
 	//! Types
 	typedef Delegate<const Json::Value &>		OnCommand;
 	typedef Delegate<const std::string &>		OnAudioOut;
+
+	//! Counters for the call audio path
+	struct AudioStats
+	{
+		AudioStats() : m_LateTicks( 0 ), m_SendUnderruns( 0 ), m_SendOverruns( 0 ),
+			m_ReceiveUnderruns( 0 ), m_ReceiveOverruns( 0 ), m_ReceiveDepth( 0 ),
+			m_EchoCost( 0.0 ), m_DoubleTalkBlocks( 0 ), m_EchoDelayMs( 0 )
+		{}
+
+		unsigned int	m_LateTicks;			// send ticks that fell behind the frame clock
+		unsigned int	m_SendUnderruns;		// frames padded with silence because no audio was queued
+		unsigned int	m_SendOverruns;			// times queued audio was dropped because the send ring was full
+		unsigned int	m_ReceiveUnderruns;		// times the jitter buffer ran dry
+		unsigned int	m_ReceiveOverruns;		// times received audio was dropped because the jitter buffer was full
+		unsigned int	m_ReceiveDepth;			// current jitter buffer target in frames
+		double			m_EchoCost;				// average microseconds spent cancelling echo per 10 ms of audio
+		unsigned int	m_DoubleTalkBlocks;		// echo canceller blocks where adaptation was frozen
+		unsigned int	m_EchoDelayMs;			// measured delay the far-end reference is aligned by
+	};
 	
 	//! Construction
 	Telephony();
@@ -63,6 +86,8 @@ public:
 	virtual bool Disconnect();
 	virtual void SendAudioIn( const std::string & a_Audio );
 
+	const AudioStats &	GetAudioStats() const;
+
 private:
 	//! Data
 	OnCommand			m_OnCommand;
@@ -72,16 +97,36 @@ private:
 	bool				m_bInCall;
 	std::string			m_AudioInFormat;
 	std::string			m_AudioOutFormat;
+	std::string			m_GatewayFormat;		// format of the audio on the wire in both directions
+	AudioFormat			m_Gateway;
+	AudioConverter		m_SendConverter;		// m_AudioOutFormat to m_GatewayFormat
+	AudioConverter		m_ReceiveConverter;		// m_GatewayFormat to m_AudioInFormat
+	std::string			m_SendConverted;
+	std::string			m_ReceiveConverted;
 	std::string			m_MyNumber;
 	std::string         m_TelephonySelfId;
 
 	TimerPool::ITimer::SP
 						m_spReconnectTimer;
-	std::list<std::string>
-						m_Outgoing;
+	AudioRing			m_Outgoing;				// audio queued by SendAudioIn()
+	JitterBuffer		m_Incoming;				// audio received from the gateway
+	std::string			m_SendFrame;
+	std::string			m_ReceiveFrame;
 	TimerPool::ITimer::SP 
 						m_spSendTimer;
 	size_t				m_nSendBytes;
+	double				m_FrameInterval;		// seconds of audio per frame
+	double				m_SendStart;			// monotonic time the frame clock started
+	unsigned int		m_FramesSent;			// frames sent since m_SendStart
+	unsigned int		m_SendBufferFrames;
+	unsigned int		m_JitterMinFrames;
+	unsigned int		m_JitterMaxFrames;
+	bool				m_bEchoCancellation;
+	unsigned int		m_EchoTailMs;			// longest echo path to cancel
+	unsigned int		m_EchoDelayMs;			// delay between playing audio and hearing it in the microphone to start with
+	unsigned int		m_EchoMaxDelayMs;		// longest delay to search for, this includes the m_Outgoing queue
+	EchoCanceller		m_Echo;
+	AudioStats			m_Stats;
 
 	//! IWebClient callbacks
 	void				OnListenMessage( IWebSocket::FrameSP a_spFrame );
@@ -90,6 +135,7 @@ private:
 
 	void				StartSendTimer();
 	void				OnSendAudioData();
+	void				PlayAudioOut( const std::string & a_Audio );
 
 	void				OnReconnect();
 };
@@ -111,4 +157,9 @@ inline const std::string & Telephony::GetMyNumber() const
 	return m_MyNumber;
 }
 
+inline const Telephony::AudioStats & Telephony::GetAudioStats() const
+{
+	return m_Stats;
+}
+
 #endif //SELF_TELEPHONY_H
\ No newline at end of file
@@ -0,0 +1,139 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "audio/EchoCanceller.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+//! Plays bursts of noise shaped like speech through a simulated echo path, then moves the bulk delay 
+//! the way a deeper send queue would. The canceller has to find each delay, line the reference up
+//! with it and cancel the echo without flagging the echo itself as double-talk.
+class TestEchoCanceller : UnitTest
+{
+public:
+	//! Construction
+	TestEchoCanceller() : UnitTest("TestEchoCanceller"),
+		m_Envelope( 0.0f ),
+		m_BurstLeft( 0 )
+	{}
+
+	static const unsigned int RATE = 16000;
+	static const unsigned int FRAME = 320;			// 20 ms frames, the same as the telephony frame clock
+	static const unsigned int SECONDS = 6;
+
+	virtual void RunTest()
+	{
+		srand( 42 );
+
+		EchoCanceller echo;
+		echo.Reset( RATE, 128, 0, 1000 );
+		Test( echo.IsEnabled() );
+
+		m_Played.assign( RATE * 2, 0 );		// far-end history for the simulated echo path
+		m_Written = 0;
+
+		double erle = RunPhase( echo, 300 );
+		Log::Status( "TestEchoCanceller", "Delay 300 ms, measured %u ms, ERLE %.1f dB, double-talk blocks %u",
+			echo.GetDelayMs(), erle, echo.GetDoubleTalkBlocks() );
+		Test( abs( (int)echo.GetDelayMs() - 300 ) <= 16 );
+		Test( erle > 15.0 );
+
+		unsigned int changes = echo.GetDelayChanges();
+		erle = RunPhase( echo, 480 );
+		Log::Status( "TestEchoCanceller", "Delay 480 ms, measured %u ms, ERLE %.1f dB, double-talk blocks %u",
+			echo.GetDelayMs(), erle, echo.GetDoubleTalkBlocks() );
+		Test( abs( (int)echo.GetDelayMs() - 480 ) <= 16 );
+		Test( echo.GetDelayChanges() > changes );
+		Test( erle > 15.0 );
+
+		// echo at -12 dB must not look like a near-end talker
+		unsigned int blocks = (2 * SECONDS * RATE) / echo.GetBlockSize();
+		Test( echo.GetDoubleTalkBlocks() < blocks / 20 );
+	}
+
+	//! Runs the echo path with the given bulk delay, returns the echo return loss enhancement over the last two seconds.
+	double RunPhase( EchoCanceller & a_Echo, unsigned int a_DelayMs )
+	{
+		const unsigned int delay = (RATE * a_DelayMs) / 1000;
+		const unsigned int frames = (SECONDS * RATE) / FRAME;
+		const unsigned int measureFrom = frames - (2 * RATE) / FRAME;
+
+		std::vector<short> far( FRAME ), near( FRAME );
+		double nearEnergy = 0.0, outEnergy = 0.0;
+		for(unsigned int f=0;f<frames;++f)
+		{
+			for(unsigned int i=0;i<FRAME;++i)
+				far[i] = NextFarSample();
+
+			// the microphone hears the far-end through a short decaying room response plus a little noise
+			for(unsigned int i=0;i<FRAME;++i)
+			{
+				size_t t = m_Written + i;
+				float e = 0.25f * Played( t, delay ) - 0.12f * Played( t, delay + 40 ) + 0.06f * Played( t, delay + 120 );
+				e += (float)((rand() % 21) - 10);
+				near[i] = (short)e;
+				if ( f >= measureFrom )
+					nearEnergy += e * e;
+			}
+
+			// same order as the telephony frame clock, the near-end frame goes out before the far-end plays
+			a_Echo.ProcessNearEnd( &near[0], FRAME );
+			a_Echo.PlayFarEnd( &far[0], FRAME );
+			for(unsigned int i=0;i<FRAME;++i)
+			{
+				m_Played[(m_Written + i) % m_Played.size()] = far[i];
+				if ( f >= measureFrom )
+					outEnergy += (double)near[i] * near[i];
+			}
+			m_Written += FRAME;
+		}
+
+		return 10.0 * log10( nearEnergy / (outEnergy + 1.0) );
+	}
+
+	//! Far-end sample that was played a_Age samples before sample a_Time.
+	float Played( size_t a_Time, unsigned int a_Age )
+	{
+		if ( a_Time < a_Age || a_Time - a_Age >= m_Written )
+			return 0.0f;
+		return m_Played[(a_Time - a_Age) % m_Played.size()];
+	}
+
+	//! Noise in syllable sized bursts with pauses between them.
+	short NextFarSample()
+	{
+		if ( m_BurstLeft == 0 )
+		{
+			bool bTalking = m_Envelope == 0.0f;
+			m_Envelope = bTalking ? 2000.0f + (rand() % 6000) : 0.0f;
+			m_BurstLeft = (RATE / 1000) * (bTalking ? 80 + (rand() % 250) : 40 + (rand() % 200));
+		}
+		m_BurstLeft -= 1;
+		return (short)(m_Envelope * ((rand() / (float)RAND_MAX) * 2.0f - 1.0f));
+	}
+
+	std::vector<short>	m_Played;
+	size_t				m_Written;
+	float				m_Envelope;
+	unsigned int		m_BurstLeft;
+};
+
+TestEchoCanceller TEST_ECHO_CANCELLER;
@@ -0,0 +1,223 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/ThreadPool.h"
+#include "utils/TimerPool.h"
+#include "utils/Config.h"
+#include "services/Telephony.h"
+#include "tests/StandInServer.h"
+
+#include <stdlib.h>
+
+//! Runs a call against a stand-in telephony gateway with audio flowing both ways. The gateway sends 
+//! 20 ms frames with network jitter and bursts, the robot side feeds microphone audio in uneven chunks, 
+//! and the frame clock, ring and jitter buffer have to keep both directions continuous.
+class TestTelephonySoak : UnitTest
+{
+public:
+	//! Construction
+	TestTelephonySoak() : UnitTest("TestTelephonySoak"),
+		m_bHandshake(false),
+		m_bAnswered(false),
+		m_bHungUp(false),
+		m_FramesReceived(0),
+		m_BadFrames(0),
+		m_FramesSent(0),
+		m_fMaxGap(0.0),
+		m_AudioOutBytes(0)
+	{ }
+
+	//! How long the call runs, and the gateway frame size for audio/L16;rate=16000
+	static const int SECONDS = 10;
+	static const int FRAME_BYTES = 640;
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+		TimerPool timers;
+		StandInServer server( boost::bind( &TestTelephonySoak::ServeGateway, this, _1, _2, _3 ) );
+
+		Config config;
+		ServiceConfig creds;
+		creds.m_ServiceId = "TelephonyV1";
+		creds.m_URL = server.GetURL();
+		creds.m_User = "user";
+		creds.m_Password = "password";
+		Test( config.AddServiceConfig( creds ) );
+
+		Telephony telephony;
+		Test( telephony.Start() );
+		Test( telephony.Connect( "TestTelephonySoak", DELEGATE( TestTelephonySoak, OnCommand, const Json::Value &, this ),
+			DELEGATE( TestTelephonySoak, OnAudioOut, const std::string &, this ) ) );
+		Test( WaitFor( m_bHandshake ) );
+		Test( telephony.Answer( "5550100", "5550199" ) );
+		Test( WaitFor( m_bAnswered ) );
+
+		// the microphone delivers audio at 32000 bytes per second, but in chunks of uneven size
+		const double BYTES_PER_SEC = 16000.0 * 2.0;
+		std::string chunk;
+		double fed = 0.0;
+		Time start;
+		while( (Time().GetEpochTime() - start.GetEpochTime()) < SECONDS )
+		{
+			double due = (Time().GetEpochTime() - start.GetEpochTime()) * BYTES_PER_SEC;
+			size_t bytes = (size_t)(1000 + (rand() % 2000)) & ~1;
+			if ( due - fed >= bytes )
+			{
+				chunk.assign( bytes, (char)0 );
+				telephony.SendAudioIn( chunk );
+				fed += bytes;
+			}
+
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 2 ) );
+		}
+		Telephony::AudioStats stats = telephony.GetAudioStats();
+		Test( telephony.HangUp() );
+		Test( WaitFor( m_bHungUp ) );
+		telephony.Disconnect();
+		server.Stop();
+
+		const int expected = (SECONDS * 1000) / 20;
+		Log::Status( "TestTelephonySoak", "Robot sent %d frames (%d expected), max gap %.1f ms, gateway sent %d frames, "
+			"%u bytes played, late ticks %u, send underruns %u, send overruns %u, receive underruns %u, receive overruns %u, "
+			"jitter depth %u", (int)m_FramesReceived, expected, m_fMaxGap * 1000.0, (int)m_FramesSent, (unsigned int)m_AudioOutBytes,
+			stats.m_LateTicks, stats.m_SendUnderruns, stats.m_SendOverruns, stats.m_ReceiveUnderruns, stats.m_ReceiveOverruns,
+			stats.m_ReceiveDepth );
+
+		// the frame clock keeps the send rate, the ring keeps frames whole and nothing is dropped
+		Test( m_BadFrames == 0 );
+		Test( m_FramesReceived > expected * 0.97 && m_FramesReceived < expected * 1.03 );
+		Test( m_fMaxGap < 0.1 );
+		Test( stats.m_SendOverruns == 0 );
+		Test( stats.m_SendUnderruns < (unsigned int)(expected / 20) );
+
+		// received audio all gets played, less what's still buffered, without the jitter buffer overflowing
+		Test( stats.m_ReceiveOverruns == 0 );
+		Test( m_AudioOutBytes + (size_t)(stats.m_ReceiveDepth * 2 + 2) * FRAME_BYTES >= (size_t)m_FramesSent * FRAME_BYTES );
+	}
+
+	bool WaitFor( volatile bool & a_bFlag )
+	{
+		Time start;
+		while(! a_bFlag && (Time().GetEpochTime() - start.GetEpochTime()) < 10.0 )
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+		}
+		return a_bFlag;
+	}
+
+	void OnCommand( const Json::Value & a_Command )
+	{}
+
+	void OnAudioOut( const std::string & a_Audio )
+	{
+		m_AudioOutBytes += a_Audio.size();
+	}
+
+	//! Stand-in gateway
+	void ServeGateway( StandInServer::Socket & a_Socket, boost::asio::streambuf & a_Buffer, const std::string & a_Request )
+	{
+		if (! StandInServer::Upgrade( a_Socket, a_Request ) )
+		{
+			StandInServer::WriteResponse( a_Socket, 404, "{}" );
+			return;
+		}
+
+		std::string frame( FRAME_BYTES, (char)0 );
+		double start = 0.0, release = 0.0, lastFrame = 0.0;
+		for(;;)
+		{
+			double now = Time().GetEpochTime();
+
+			// audio for the robot, every frame is up to 30 ms late and every second the next 5 frames
+			// are held back 100 ms, so they arrive in a burst
+			if ( m_bAnswered && !m_bHungUp )
+			{
+				if ( start == 0.0 )
+					start = release = now;
+				while( release <= now )
+				{
+					StandInServer::WriteFrame( a_Socket, StandInServer::OP_BINARY, frame );
+					m_FramesSent += 1;
+
+					double delay = (m_FramesSent % 50) < 5 ? 0.1 : (rand() % 30) / 1000.0;
+					double due = start + (m_FramesSent * 0.02) + delay;
+					if ( due > release )
+						release = due;
+				}
+			}
+
+			if ( a_Socket.available() == 0 )
+			{
+				if ( StandInServer::IsClosed( a_Socket ) )
+					break;
+				boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+				continue;
+			}
+
+			int op = 0;
+			std::string payload;
+			if (! StandInServer::ReadFrame( a_Socket, op, payload ) || op == StandInServer::OP_CLOSE )
+				break;
+
+			if ( op == StandInServer::OP_BINARY )
+			{
+				if ( payload.size() != FRAME_BYTES )
+					m_BadFrames += 1;
+				if ( lastFrame > 0.0 && (now - lastFrame) > m_fMaxGap )
+					m_fMaxGap = now - lastFrame;
+				lastFrame = now;
+				m_FramesReceived += 1;
+			}
+			else if ( op == StandInServer::OP_TEXT )
+			{
+				Json::Value json;
+				if (! Json::Reader().parse( payload, json ) )
+					continue;
+
+				const std::string & command = json["command"].asString();
+				if ( command == "handshake" )
+				{
+					StandInServer::WriteFrame( a_Socket, StandInServer::OP_TEXT, "{\"command\":\"ack\",\"my_number\":\"5550199\"}" );
+					m_bHandshake = true;
+				}
+				else if ( command == "answer" )
+					m_bAnswered = true;
+				else if ( command == "hang_up" )
+					m_bHungUp = true;
+			}
+		}
+	}
+
+	volatile bool		m_bHandshake;
+	volatile bool		m_bAnswered;
+	volatile bool		m_bHungUp;
+	volatile int		m_FramesReceived;
+	volatile int		m_BadFrames;
+	volatile int		m_FramesSent;
+	double				m_fMaxGap;
+	size_t				m_AudioOutBytes;
+};
+
+TestTelephonySoak TEST_TELEPHONY_SOAK;
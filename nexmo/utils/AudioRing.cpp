@@ -0,0 +1,103 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "AudioRing.h"
+
+#include <string.h>
+
+AudioRing::AudioRing( size_t a_FrameBytes /*= 640*/, size_t a_Frames /*= 50*/ ) :
+	m_FrameBytes( 1 ), m_Head( 0 ), m_Size( 0 )
+{
+	Reset( a_FrameBytes, a_Frames );
+}
+
+void AudioRing::Reset( size_t a_FrameBytes, size_t a_Frames )
+{
+	m_FrameBytes = a_FrameBytes > 0 ? a_FrameBytes : 1;
+	m_Buffer.resize( m_FrameBytes * (a_Frames > 0 ? a_Frames : 1) );
+	Clear();
+}
+
+void AudioRing::Clear()
+{
+	m_Head = 0;
+	m_Size = 0;
+}
+
+size_t AudioRing::Write( const char * a_pData, size_t a_Bytes )
+{
+	const size_t capacity = m_Buffer.size();
+
+	size_t dropped = 0;
+	if ( a_Bytes > capacity )
+	{
+		// only the newest data can fit, everything buffered and the front of the input is lost
+		size_t excess = a_Bytes - capacity;
+		dropped = m_Size + excess;
+		a_pData += excess;
+		a_Bytes = capacity;
+		Clear();
+	}
+	else if ( m_Size + a_Bytes > capacity )
+	{
+		// drop whole frames so the reader stays aligned to frame boundaries
+		size_t excess = m_Size + a_Bytes - capacity;
+		excess = ((excess + m_FrameBytes - 1) / m_FrameBytes) * m_FrameBytes;
+		dropped = Skip( excess );
+	}
+
+	size_t tail = (m_Head + m_Size) % capacity;
+	size_t first = capacity - tail;
+	if ( first > a_Bytes )
+		first = a_Bytes;
+	memcpy( &m_Buffer[tail], a_pData, first );
+	if ( first < a_Bytes )
+		memcpy( &m_Buffer[0], a_pData + first, a_Bytes - first );
+	m_Size += a_Bytes;
+
+	return dropped;
+}
+
+size_t AudioRing::Read( char * a_pDest, size_t a_Bytes )
+{
+	const size_t capacity = m_Buffer.size();
+	if ( a_Bytes > m_Size )
+		a_Bytes = m_Size;
+
+	size_t first = capacity - m_Head;
+	if ( first > a_Bytes )
+		first = a_Bytes;
+	memcpy( a_pDest, &m_Buffer[m_Head], first );
+	if ( first < a_Bytes )
+		memcpy( a_pDest + first, &m_Buffer[0], a_Bytes - first );
+
+	m_Head = (m_Head + a_Bytes) % capacity;
+	m_Size -= a_Bytes;
+
+	return a_Bytes;
+}
+
+size_t AudioRing::Skip( size_t a_Bytes )
+{
+	if ( a_Bytes > m_Size )
+		a_Bytes = m_Size;
+
+	m_Head = (m_Head + a_Bytes) % m_Buffer.size();
+	m_Size -= a_Bytes;
+
+	return a_Bytes;
+}
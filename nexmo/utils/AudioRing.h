@@ -0,0 +1,71 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_AUDIO_RING_H
+#define SELF_AUDIO_RING_H
+
+#include <vector>
+#include <string>
+
+#include "SelfLib.h"			// include last always
+
+//! Fixed capacity byte ring for PCM audio. The capacity is always a whole number of frames, and 
+//! when the ring overflows whole frames are dropped from the front so reads stay frame aligned.
+class AudioRing
+{
+public:
+	//! Construction
+	AudioRing( size_t a_FrameBytes = 640, size_t a_Frames = 50 );
+
+	//! Accessors
+	size_t GetFrameBytes() const
+	{
+		return m_FrameBytes;
+	}
+	size_t GetCapacity() const
+	{
+		return m_Buffer.size();
+	}
+	size_t GetSize() const
+	{
+		return m_Size;
+	}
+	size_t GetFrames() const
+	{
+		return m_Size / m_FrameBytes;
+	}
+
+	//! Resize the ring, this clears any buffered data.
+	void Reset( size_t a_FrameBytes, size_t a_Frames );
+	//! Remove all buffered data.
+	void Clear();
+	//! Append data, returns the number of bytes dropped from the front to make room.
+	size_t Write( const char * a_pData, size_t a_Bytes );
+	//! Read up to a_Bytes into a_pDest, returns the number of bytes read.
+	size_t Read( char * a_pDest, size_t a_Bytes );
+	//! Discard up to a_Bytes from the front, returns the number of bytes discarded.
+	size_t Skip( size_t a_Bytes );
+
+private:
+	//! Data
+	std::vector<char>	m_Buffer;
+	size_t				m_FrameBytes;
+	size_t				m_Head;
+	size_t				m_Size;
+};
+
+#endif //SELF_AUDIO_RING_H
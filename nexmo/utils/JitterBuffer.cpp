@@ -0,0 +1,83 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "JitterBuffer.h"
+
+//! How many frames must play without an underrun before the target depth is reduced
+const unsigned int STABLE_FRAMES = 500;
+
+JitterBuffer::JitterBuffer( size_t a_FrameBytes /*= 640*/, size_t a_MinFrames /*= 2*/, size_t a_MaxFrames /*= 15*/ )
+{
+	Reset( a_FrameBytes, a_MinFrames, a_MaxFrames );
+}
+
+void JitterBuffer::Reset( size_t a_FrameBytes, size_t a_MinFrames, size_t a_MaxFrames )
+{
+	m_MinFrames = a_MinFrames > 0 ? a_MinFrames : 1;
+	m_MaxFrames = a_MaxFrames > m_MinFrames ? a_MaxFrames : m_MinFrames;
+	m_TargetFrames = m_MinFrames;
+	m_bPlaying = false;
+	m_StableFrames = 0;
+	m_Underruns = 0;
+	m_Overruns = 0;
+
+	// leave head room above the max depth for bursts
+	m_Ring.Reset( a_FrameBytes, m_MaxFrames * 2 );
+}
+
+void JitterBuffer::Push( const std::string & a_Data )
+{
+	if ( m_Ring.Write( a_Data.data(), a_Data.size() ) > 0 )
+		m_Overruns += 1;
+}
+
+bool JitterBuffer::Pop( std::string & a_Frame )
+{
+	const size_t frameBytes = m_Ring.GetFrameBytes();
+	if (! m_bPlaying )
+	{
+		if ( m_Ring.GetFrames() < m_TargetFrames )
+			return false;
+		m_bPlaying = true;
+	}
+
+	if ( m_Ring.GetFrames() < 1 )
+	{
+		// ran dry, buffer deeper before playing again
+		m_Underruns += 1;
+		m_bPlaying = false;
+		m_StableFrames = 0;
+		if ( m_TargetFrames < m_MaxFrames )
+			m_TargetFrames += 1;
+		return false;
+	}
+
+	if ( ++m_StableFrames >= STABLE_FRAMES )
+	{
+		m_StableFrames = 0;
+		if ( m_TargetFrames > m_MinFrames )
+			m_TargetFrames -= 1;
+	}
+
+	// drain excess latency a frame at a time once we are well over the target
+	if ( m_Ring.GetFrames() > m_TargetFrames * 2 )
+		m_Ring.Skip( frameBytes );
+
+	a_Frame.resize( frameBytes );
+	m_Ring.Read( &a_Frame[0], frameBytes );
+	return true;
+}
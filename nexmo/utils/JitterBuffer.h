@@ -0,0 +1,71 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_JITTER_BUFFER_H
+#define SELF_JITTER_BUFFER_H
+
+#include "AudioRing.h"
+#include "SelfLib.h"			// include last always
+
+//! Adaptive jitter buffer for received audio. Data arriving in bursts from the network is buffered 
+//! until m_TargetFrames are queued, then released one frame per tick. The target depth grows each 
+//! time the buffer runs dry and shrinks again after a stable period, trading latency for continuity.
+class JitterBuffer
+{
+public:
+	//! Construction
+	JitterBuffer( size_t a_FrameBytes = 640, size_t a_MinFrames = 2, size_t a_MaxFrames = 15 );
+
+	//! Accessors
+	size_t GetTargetFrames() const
+	{
+		return m_TargetFrames;
+	}
+	size_t GetBufferedFrames() const
+	{
+		return m_Ring.GetFrames();
+	}
+	unsigned int GetUnderruns() const
+	{
+		return m_Underruns;
+	}
+	unsigned int GetOverruns() const
+	{
+		return m_Overruns;
+	}
+
+	//! Set the frame size & depth limits, this clears the buffer.
+	void Reset( size_t a_FrameBytes, size_t a_MinFrames, size_t a_MaxFrames );
+	//! Queue received data.
+	void Push( const std::string & a_Data );
+	//! Pop one frame into a_Frame, which is resized to the frame size given to Reset(). Returns false
+	//! if no frame should be played this tick.
+	bool Pop( std::string & a_Frame );
+
+private:
+	//! Data
+	AudioRing			m_Ring;
+	size_t				m_MinFrames;
+	size_t				m_MaxFrames;
+	size_t				m_TargetFrames;
+	bool				m_bPlaying;				// false while priming up to the target depth
+	unsigned int		m_StableFrames;			// frames played since the last underrun or adjustment
+	unsigned int		m_Underruns;
+	unsigned int		m_Overruns;
+};
+
+#endif //SELF_JITTER_BUFFER_H
@@ -33,6 +33,8 @@ void OpenCVCamera::Serialize(Json::Value & json)
 	json["m_CameraDevice"] = m_CameraDevice;
 	json["m_Width"] = m_Width;
 	json["m_Height"] = m_Height;
+	json["m_bDemandDriven"] = m_bDemandDriven;
+	json["m_fIdleFramesPerSec"] = m_fIdleFramesPerSec;
 }
 
 void OpenCVCamera::Deserialize(const Json::Value & json)
@@ -47,6 +49,10 @@ void OpenCVCamera::Deserialize(const Json::Value & json)
 		m_Width = json["m_Width"].asInt();
 	if (json["m_Height"].isInt())
 		m_Height = json["m_Height"].asInt();
+	if (json["m_bDemandDriven"].isBool())
+		m_bDemandDriven = json["m_bDemandDriven"].asBool();
+	if (json["m_fIdleFramesPerSec"].isNumeric())
+		m_fIdleFramesPerSec = json["m_fIdleFramesPerSec"].asFloat();
 }
 
 bool OpenCVCamera::OnStart()
@@ -60,7 +66,12 @@ bool OpenCVCamera::OnStart()
 
 		if ( m_VideoCapture->isOpened() )
 		{
-			m_spWaitTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(OpenCVCamera, OnCaptureImage, this), (1.0f / m_fFramesPerSec), false, true);
+			m_DeliveryId = DataDelivery::Instance()->Register( "OpenCVCamera", DataDelivery::LATEST, DataDelivery::PRIORITY_LOW, 1,
+				DELEGATE(OpenCVCamera, OnSendData, IData *, this) );
+			CaptureScheduler * pScheduler = CaptureScheduler::Instance();
+			m_CaptureId = pScheduler->Register( "OpenCVCamera", "VideoData", m_fFramesPerSec, 
+				m_bDemandDriven ? m_fIdleFramesPerSec : m_fFramesPerSec, DELEGATE(OpenCVCamera, OnCaptureRate, float, this) );
+			OnCaptureRate( pScheduler->GetRate( m_CaptureId ) );
 			Log::Status("OpenCVCamera", "Camera has started");
 		}
 		else
@@ -72,7 +83,17 @@ bool OpenCVCamera::OnStart()
 
 bool OpenCVCamera::OnStop()
 {
+	if ( m_CaptureId != 0 )
+	{
+		CaptureScheduler::Instance()->Unregister( m_CaptureId );
+		m_CaptureId = 0;
+	}
 	m_spWaitTimer.reset();
+	if ( m_DeliveryId != 0 )
+	{
+		DataDelivery::Instance()->Unregister( m_DeliveryId );
+		m_DeliveryId = 0;
+	}
 	if ( m_VideoCapture != NULL )
 	{
 		delete m_VideoCapture;
@@ -86,9 +107,10 @@ bool OpenCVCamera::OnStop()
 void OpenCVCamera::OnCaptureImage()
 {
 	cv::Mat frame;
-	if (m_VideoCapture != NULL && !m_bProcessing)
+	if (m_VideoCapture != NULL && !m_bProcessing && CaptureScheduler::Instance()->BeginCapture(m_CaptureId))
 	{
 		m_bProcessing = true;
+		bool bQueued = false;
 		if (m_VideoCapture->read(frame))
 		{
 			cv::Mat resized;
@@ -98,18 +120,27 @@ void OpenCVCamera::OnCaptureImage()
 			std::vector<unsigned char> jpeg;
 			if (cv::imencode(".jpg", resized.empty() ? frame : resized, jpeg))
 			{
-				ThreadPool::Instance()->InvokeOnMain<IData *>( 
-					DELEGATE( OpenCVCamera, OnSendData, IData *, this), new VideoData(jpeg) );
+				DataDelivery::Instance()->Send( m_DeliveryId, new VideoData(jpeg) );
+				bQueued = true;
 			}
 			resized.release();
 			frame.release();
 		}
+		CaptureScheduler::Instance()->EndCapture(m_CaptureId, bQueued);
 		m_bProcessing = false;
 	}
 }
 
+void OpenCVCamera::OnCaptureRate( float a_fRate )
+{
+	m_spWaitTimer.reset();
+	if ( a_fRate > 0.0f && m_VideoCapture != NULL )
+		m_spWaitTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(OpenCVCamera, OnCaptureImage, this), (1.0f / a_fRate), false, true);
+}
+
 void OpenCVCamera::OnSendData( IData * a_pData )
 {
+	CaptureScheduler::Instance()->Delivered( m_CaptureId );
 	SendData( a_pData );
 }
 
@@ -23,6 +23,8 @@
 #include "utils/ThreadPool.h"
 #include "utils/Time.h"
 #include "sensors/Camera.h"
+#include "capture/CaptureScheduler.h"
+#include "capture/DataDelivery.h"
 
 #include "opencv2/opencv.hpp"
 
@@ -37,7 +39,11 @@ public:
 		m_Width(320),
 		m_Height(240),
 		m_VideoCapture(NULL),
-		m_bProcessing(false)
+		m_bProcessing(false),
+		m_bDemandDriven(false),
+		m_fIdleFramesPerSec(1.0f),
+		m_CaptureId(0),
+		m_DeliveryId(0)
 	{}
 
 	//! ISerializable interface
@@ -63,8 +69,13 @@ private:
 	int						m_CameraDevice;
 	int						m_Width;
 	int						m_Height;
+	bool					m_bDemandDriven;		// drop to m_fIdleFramesPerSec when nobody has asked for video
+	float					m_fIdleFramesPerSec;
+	int						m_CaptureId;
+	int						m_DeliveryId;
 
 	void 					OnCaptureImage();
+	void					OnCaptureRate( float a_fRate );
 	void					OnSendData( IData * a_pData );
 };
 
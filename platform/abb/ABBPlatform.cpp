@@ -127,6 +127,38 @@ bool ABBPlatform::Send(
 	return true;
 }
 
+bool ABBPlatform::SendTrajectory(
+	const std::string & a_Id,
+	size_t a_Index,
+	bool a_bLast,
+	const std::vector<std::string> & a_Joints,
+	const JointTrajectory::PointList & a_Points)
+{
+	Json::Value json;
+	Json::Value & trajectory = json["Trajectory"];
+	trajectory["Id"] = a_Id;
+	trajectory["Index"] = (Json::UInt)a_Index;
+	trajectory["Last"] = a_bLast;
+	for (size_t i = 0; i < a_Joints.size(); ++i)
+		trajectory["Joints"][(Json::ArrayIndex)i] = a_Joints[i];
+	for (size_t p = 0; p < a_Points.size(); ++p)
+	{
+		const JointTrajectory::Point & point = a_Points[p];
+		Json::Value & jpoint = trajectory["Points"][(Json::ArrayIndex)p];
+		jpoint["Time"] = point.m_fTime;
+		for (size_t i = 0; i < point.m_Positions.size(); ++i)
+		{
+			jpoint["Positions"][(Json::ArrayIndex)i] = point.m_Positions[i];
+			jpoint["Velocities"][(Json::ArrayIndex)i] = point.m_Velocities[i];
+			jpoint["Accelerations"][(Json::ArrayIndex)i] = point.m_Accelerations[i];
+		}
+	}
+	Log::Debug("ABBPlatform", "Sending trajectory %s window %u, %u points", a_Id.c_str(), (unsigned int)a_Index, (unsigned int)a_Points.size());
+	m_spWebClient->SendText(Json::FastWriter().write(json));
+
+	return true;
+}
+
 void ABBPlatform::OnFrame(IWebSocket::FrameSP a_spFrame)
 {
 	if (a_spFrame->m_Op == IWebSocket::TEXT_FRAME)
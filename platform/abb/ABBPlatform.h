@@ -24,6 +24,7 @@
 #include "utils/TimerPool.h"
 #include "utils/IWebClient.h"
 #include "SelfInstance.h"
+#include "trajectory/JointTrajectory.h"
 
 
 class ABBPlatform
@@ -38,6 +39,10 @@ public:
 	void    ConnectToRobot();
 	void    OnClientState(IWebClient * a_pClient);
 	bool    Send(const std::string & a_TopicId, float a_Message);
+	//! Send a window of timed points for several joints in one message, the controller replaces
+	//! whatever it still has queued for trajectory a_Id with these points.
+	bool    SendTrajectory(const std::string & a_Id, size_t a_Index, bool a_bLast,
+				const std::vector<std::string> & a_Joints, const JointTrajectory::PointList & a_Points);
 
 	bool IsConnected()
 	{
@@ -26,13 +26,88 @@
 REG_OVERRIDE_SERIALIZABLE(MoveJointGesture, ABBMoveJointGesture);
 RTTI_IMPL(ABBMoveJointGesture, MoveJointGesture);
 
+ABBMoveJointGesture::PositionMap ABBMoveJointGesture::sm_Commanded;
+
+void ABBMoveJointGesture::Serialize(Json::Value & json)
+{
+	MoveJointGesture::Serialize(json);
+	json["m_bStreamTrajectory"] = m_bStreamTrajectory;
+	json["m_fMaxVelocity"] = m_fMaxVelocity;
+	json["m_fMaxAcceleration"] = m_fMaxAcceleration;
+	json["m_fSampleTime"] = m_fSampleTime;
+	json["m_fWindow"] = m_fWindow;
+	json["m_fLookahead"] = m_fLookahead;
+}
+
+void ABBMoveJointGesture::Deserialize(const Json::Value & json)
+{
+	MoveJointGesture::Deserialize(json);
+	if (json.isMember("m_bStreamTrajectory"))
+		m_bStreamTrajectory = json["m_bStreamTrajectory"].asBool();
+	if (json.isMember("m_fMaxVelocity"))
+		m_fMaxVelocity = json["m_fMaxVelocity"].asDouble();
+	if (json.isMember("m_fMaxAcceleration"))
+		m_fMaxAcceleration = json["m_fMaxAcceleration"].asDouble();
+	if (json.isMember("m_fSampleTime"))
+		m_fSampleTime = json["m_fSampleTime"].asDouble();
+	if (json.isMember("m_fWindow"))
+		m_fWindow = json["m_fWindow"].asDouble();
+	if (json.isMember("m_fLookahead"))
+		m_fLookahead = json["m_fLookahead"].asDouble();
+}
+
 bool ABBMoveJointGesture::Execute(GestureDelegate a_Callback, const ParamsMap & a_Params)
 {
 	if (PushRequest(a_Callback, a_Params))
-		ThreadPool::Instance()->InvokeOnThread(VOID_DELEGATE(ABBMoveJointGesture, MoveThread, this));
+		StartMove();
+	return true;
+}
+
+void ABBMoveJointGesture::StartMove()
+{
+	if (m_bStreamTrajectory && StreamMove())
+		return;
+	ThreadPool::Instance()->InvokeOnThread(VOID_DELEGATE(ABBMoveJointGesture, MoveThread, this));
+}
+
+bool ABBMoveJointGesture::StreamMove()
+{
+	// the first move of a joint has no known start, so it goes out the old way
+	std::vector<double> start, target;
+	for (size_t i = 0; i < m_JointNames.size(); ++i)
+	{
+		PositionMap::const_iterator iJoint = sm_Commanded.find(m_JointNames[i]);
+		if (iJoint == sm_Commanded.end())
+			return false;
+		start.push_back(iJoint->second);
+		target.push_back(m_fAngles[i]);
+	}
+
+	JointTrajectory trajectory;
+	trajectory.SetLimits(m_fMaxVelocity, m_fMaxAcceleration);
+	trajectory.SetStart(start);
+	trajectory.AddWaypoint(target);
+	if (!trajectory.Plan(m_fSampleTime) || TimerPool::Instance() == NULL)
+		return false;
+
+	m_GoalId = UniqueID().Get();
+	m_GoalDone = false;
+	for (size_t i = 0; i < m_JointNames.size(); ++i)
+		sm_Commanded[m_JointNames[i]] = m_fAngles[i];
+
+	// the controller doesn't report progress, so the move is done once the trajectory has had time to run
+	m_Streamer.Start(trajectory, m_fWindow, m_fLookahead,
+		DELEGATE(ABBMoveJointGesture, OnWindow, const TrajectoryStreamer::Window &, this));
+	m_spDoneTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(ABBMoveJointGesture, MoveDone, this),
+		(float)trajectory.GetDuration(), true, false);
 	return true;
 }
 
+void ABBMoveJointGesture::OnWindow(const TrajectoryStreamer::Window & a_Window)
+{
+	ABBPlatform::Instance()->SendTrajectory(m_GoalId, a_Window.m_Index, a_Window.m_bLast, m_JointNames, a_Window.m_Points);
+}
+
 void ABBMoveJointGesture::MoveThread()
 {
 	try
@@ -60,6 +135,14 @@ void ABBMoveJointGesture::DoMoveThread()
 
 void ABBMoveJointGesture::MoveDone()
 {
+	if (m_bStreamTrajectory)
+	{
+		m_GoalDone = true;
+		m_Streamer.Stop();
+		// record where the joints were sent, so the next move can be planned from here
+		for (size_t i = 0; i < m_JointNames.size(); ++i)
+			sm_Commanded[m_JointNames[i]] = m_fAngles[i];
+	}
 	if (PopRequest())
-		ThreadPool::Instance()->InvokeOnThread(VOID_DELEGATE(ABBMoveJointGesture, MoveThread, this));
+		StartMove();
 }
@@ -19,7 +19,10 @@
 #ifndef ABB_MOVE_JOINT_GESTURE_H
 #define ABB_MOVE_JOINT_GESTURE_H
 
+#include <map>
+
 #include "gestures/MoveJointGesture.h"
+#include "trajectory/TrajectoryStreamer.h"
 
 //! This is the base class for any gesture that moves a single joint on a robot.
 class ABBMoveJointGesture : public MoveJointGesture
@@ -27,21 +30,49 @@ class ABBMoveJointGesture : public MoveJointGesture
 public:
 	RTTI_DECL();
 
-	ABBMoveJointGesture() : m_GoalDone(false)
+	ABBMoveJointGesture() : 
+		m_bStreamTrajectory(false),
+		m_fMaxVelocity(0.5),
+		m_fMaxAcceleration(1.0),
+		m_fSampleTime(0.1),
+		m_fWindow(1.0),
+		m_fLookahead(0.5),
+		m_GoalDone(false)
 	{}
 
+	//! ISerializable interface
+	virtual void Serialize(Json::Value & json);
+	virtual void Deserialize(const Json::Value & json);
+
 	//! IGesture interface
 	virtual bool Execute(GestureDelegate a_Callback, const ParamsMap & a_Params);
 
 private:
+	//! Types
+	typedef std::map<std::string, double>	PositionMap;
+
 	//! Callbacks
+	void StartMove();
+	bool StreamMove();
+	void OnWindow(const TrajectoryStreamer::Window & a_Window);
 	void MoveThread();
 	void DoMoveThread();
 	void MoveDone();
 
 	//! Data
-	std::string			m_GoalId;
-	volatile bool		m_GoalDone;
+	bool					m_bStreamTrajectory;	// send timed trajectories, the controller must support the Trajectory message
+	double					m_fMaxVelocity;
+	double					m_fMaxAcceleration;
+	double					m_fSampleTime;
+	double					m_fWindow;
+	double					m_fLookahead;
+
+	std::string				m_GoalId;
+	volatile bool			m_GoalDone;
+	TrajectoryStreamer		m_Streamer;
+	TimerPool::ITimer::SP	m_spDoneTimer;
+
+	static PositionMap		sm_Commanded;		// where we last sent each joint, the controller doesn't report it
 };
 
 
@@ -22,6 +22,7 @@
 #include "utils/ThreadPool.h"
 #include "utils/StringUtil.h"
 #include "services/ITextToSpeech.h"
+#include "audio/EchoReference.h"
 #include "SelfInstance.h"
 
 #include <stdlib.h>
@@ -115,8 +116,7 @@ bool LinuxSpeechGesture::Abort()
         Log::Debug("LinuxSpeechGesture", "Abort() invoked.");
 
         PopAllRequests();
-
-        SelfInstance::GetInstance()->GetSensorManager()->ResumeSensorType(AudioData::GetStaticRTTI().GetName() );
+        ResumeMicrophones();
         return true;
     }
 
@@ -127,7 +127,12 @@ void LinuxSpeechGesture::OnSpeechData( Sound * a_pSound )
 {
     if ( a_pSound != NULL )
     {
-        SelfInstance::GetInstance()->GetSensorManager()->PauseSensorType(AudioData::GetStaticRTTI().GetName() );
+        // a microphone cancelling our echo can keep listening, so the user can talk over us
+        if (! EchoReference::Instance()->IsActive() && !m_bPausedMicrophones )
+        {
+            SelfInstance::GetInstance()->GetSensorManager()->PauseSensorType(AudioData::GetStaticRTTI().GetName() );
+            m_bPausedMicrophones = true;
+        }
 		ThreadPool::Instance()->InvokeOnThread<Sound *>( DELEGATE( LinuxSpeechGesture, OnPlaySpeech, Sound *, this), a_pSound );
     }
     else
@@ -141,20 +146,31 @@ void LinuxSpeechGesture::OnPlaySpeech( Sound * a_pSound )
 {
 	std::string tmpFile( Config::Instance()->GetInstanceDataPath() + "tmp.wav" );
 	a_pSound->SaveToFile( tmpFile );
+	EchoReference::Instance()->Play( a_pSound->GetWaveData(), 
+		AudioFormat( a_pSound->GetRate(), a_pSound->GetChannels(), a_pSound->GetBits() ) );
 	delete a_pSound;
 
 	if ( system( StringUtil::Format( "aplay %s", tmpFile.c_str() ).c_str() ) != 0 )
 		Log::Error( "LinuxSpeechGesture", "Failed to play wav file." );
+	EchoReference::Instance()->Stop();
 
 	ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( LinuxSpeechGesture, OnSpeechDone, this ) );
 }
 
 void LinuxSpeechGesture::OnSpeechDone()
 {
-    SelfInstance::GetInstance()->GetSensorManager()->ResumeSensorType(AudioData::GetStaticRTTI().GetName());
+    ResumeMicrophones();
 
     // start the next speech if we have any..
     if ( PopRequest() )
         StartSpeech();
 }
 
+void LinuxSpeechGesture::ResumeMicrophones()
+{
+    if ( m_bPausedMicrophones )
+    {
+        SelfInstance::GetInstance()->GetSensorManager()->ResumeSensorType(AudioData::GetStaticRTTI().GetName());
+        m_bPausedMicrophones = false;
+    }
+}
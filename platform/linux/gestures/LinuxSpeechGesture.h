@@ -31,7 +31,7 @@ public:
     RTTI_DECL();
 
     //! Construction
-    LinuxSpeechGesture() : m_pVoices( NULL )
+    LinuxSpeechGesture() : m_pVoices( NULL ), m_bPausedMicrophones( false )
     {}
 
     //! IGesture interface
@@ -45,8 +45,10 @@ private:
 	void OnSpeechData( Sound * );
 	void OnPlaySpeech( Sound * );
     void OnSpeechDone();
+    void ResumeMicrophones();
 
     Voices *    m_pVoices;
+    bool        m_bPausedMicrophones;       // only when no microphone is cancelling our echo
 };
 
 #endif //SELF_LINUXSPEECHGESTURE_H
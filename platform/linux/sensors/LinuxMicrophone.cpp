@@ -21,6 +21,8 @@
 #include "utils/Log.h"
 #include "utils/TimerPool.h"
 #include "utils/SelfException.h"
+#include "utils/Time.h"
+#include "audio/EchoReference.h"
 
 #include <stdio.h>
 
@@ -30,6 +32,31 @@ REG_OVERRIDE_SERIALIZABLE(Microphone, LinuxMicrophone);
 REG_SERIALIZABLE(LinuxMicrophone);
 RTTI_IMPL(LinuxMicrophone, Microphone);
 
+//! The reference is read this far ahead of when we think the block was captured, so the measured delay
+//! stays positive even when arecord hands us audio later than the block length suggests.
+const double REFERENCE_LEAD = 0.25;
+
+void LinuxMicrophone::Serialize(Json::Value & json)
+{
+	Microphone::Serialize( json );
+
+	json["m_bEchoCancellation"] = m_bEchoCancellation;
+	json["m_EchoTailMs"] = m_EchoTailMs;
+	json["m_EchoMaxDelayMs"] = m_EchoMaxDelayMs;
+}
+
+void LinuxMicrophone::Deserialize(const Json::Value & json)
+{
+	Microphone::Deserialize( json );
+
+	if ( json["m_bEchoCancellation"].isBool() )
+		m_bEchoCancellation = json["m_bEchoCancellation"].asBool();
+	if ( json["m_EchoTailMs"].isNumeric() )
+		m_EchoTailMs = json["m_EchoTailMs"].asUInt();
+	if ( json["m_EchoMaxDelayMs"].isNumeric() )
+		m_EchoMaxDelayMs = json["m_EchoMaxDelayMs"].asUInt();
+}
+
 
 bool LinuxMicrophone::OnStart()
 {
@@ -37,6 +64,15 @@ bool LinuxMicrophone::OnStart()
 	m_StopThread = false;
 	m_ThreadStopped = false;
 
+	// with the speaker output as a reference, speech no longer has to pause us
+	if ( m_bEchoCancellation && m_RecordingBits == 16 )
+	{
+		m_Echo.Reset( m_RecordingHZ, m_EchoTailMs, (unsigned int)(REFERENCE_LEAD * 1000), m_EchoMaxDelayMs );
+		EchoReference::Instance()->Attach( m_RecordingHZ );
+	}
+	else
+		m_Echo.Reset( m_RecordingHZ, 0, 0, 0 );
+
 	ThreadPool::Instance()->InvokeOnThread<void *>(DELEGATE(LinuxMicrophone, ReceiveData, void *, this), NULL);
 
 	return true;
@@ -49,6 +85,8 @@ bool LinuxMicrophone::OnStop()
 	m_StopThread = true;
 	while (!m_ThreadStopped)
 		tthread::this_thread::yield();
+	if ( m_Echo.IsEnabled() )
+		EchoReference::Instance()->Detach();
 	return true;
 }
 
@@ -67,17 +105,21 @@ void LinuxMicrophone::ReceiveData(void * arg)
 				std::string cmd = StringUtil::Format("arecord -f S%u_LE -r %u", m_RecordingBits, m_RecordingHZ);
 				Log::Debug("LinuxMicrophone", "Opening Process: %s", cmd.c_str());
 				m_Stream = popen(cmd.c_str(), "r");
+				m_CaptureTime = 0.0;
 			}
 
-			char buffer[4000];		// 1/8th of a second of audio at 16,000hz
+			short buffer[2048];		// 1/8th of a second of audio at 16,000hz, a whole number of echo canceller blocks
 
 			int read = fread(buffer, sizeof(char), sizeof(buffer) / sizeof(char), m_Stream);
 			if (read < 0)
 				break;
 			if (read > 0)
 			{
+				if ( m_Echo.IsEnabled() )
+					CancelEcho( buffer, read / sizeof(short) );
+
 				ThreadPool::Instance()->InvokeOnMain<AudioData *>(DELEGATE(LinuxMicrophone, SendingData, AudioData *, this),
-					new AudioData(std::string(buffer, read), m_RecordingHZ, 1, m_RecordingBits));
+					new AudioData(std::string((const char *)buffer, read), m_RecordingHZ, 1, m_RecordingBits));
 			}
 			else
 				tthread::this_thread::sleep_for(tthread::chrono::milliseconds(50));
@@ -105,6 +147,25 @@ void LinuxMicrophone::ReceiveData(void * arg)
 	m_ThreadStopped = true;
 }
 
+void LinuxMicrophone::CancelEcho(short * a_pSamples, size_t a_Count)
+{
+	// the capture clock is sample accurate, so only the first block after opening arecord is timed by the wall clock
+	double duration = (double)a_Count / m_RecordingHZ;
+	if ( m_CaptureTime <= 0.0 )
+		m_CaptureTime = Time().GetEpochTime() - duration;
+
+	// both timelines have to advance together, so only take as much reference as we can cancel
+	size_t count = a_Count - (a_Count % m_Echo.GetBlockSize());
+	if ( count > 0 )
+	{
+		m_Reference.resize( count );
+		EchoReference::Instance()->Read( m_CaptureTime - REFERENCE_LEAD, &m_Reference[0], count );
+		m_Echo.PlayFarEnd( &m_Reference[0], count );
+		m_Echo.ProcessNearEnd( a_pSamples, count );
+	}
+	m_CaptureTime += duration;
+}
+
 void LinuxMicrophone::SendingData(AudioData * a_pData)
 {
 	SendData(a_pData);
@@ -19,7 +19,10 @@
 #ifndef LINUX_MICROPHONE_H
 #define LINUX_MICROPHONE_H
 
+#include <vector>
+
 #include "sensors/Microphone.h"
+#include "audio/EchoCanceller.h"
 
 //! This ISensor gets audio data from the Nao microphone input.
 class LinuxMicrophone : public Microphone
@@ -28,9 +31,14 @@ public:
 	RTTI_DECL();
 
 	//! Construction
-	LinuxMicrophone() : m_Stream(NULL), m_StopThread( false ), m_ThreadStopped( false )
+	LinuxMicrophone() : m_Stream(NULL), m_StopThread( false ), m_ThreadStopped( false ),
+		m_bEchoCancellation( true ), m_EchoTailMs( 128 ), m_EchoMaxDelayMs( 1000 ), m_CaptureTime( 0.0 )
 	{}
 
+	//! ISerializable interface
+	virtual void Serialize(Json::Value & json);
+	virtual void Deserialize(const Json::Value & json);
+
 	//! ISensor interface
 	virtual bool OnStart();
 	virtual bool OnStop();
@@ -43,7 +51,15 @@ private:
 	volatile bool		m_StopThread;
 	volatile bool		m_ThreadStopped;
 
+	bool				m_bEchoCancellation;	// cancel our own speech so we can keep listening while talking
+	unsigned int		m_EchoTailMs;
+	unsigned int		m_EchoMaxDelayMs;		// longest delay between aplay and arecord to search for
+	EchoCanceller		m_Echo;
+	std::vector<short>	m_Reference;
+	double				m_CaptureTime;			// epoch time of the next sample out of arecord
+
 	void				ReceiveData( void * );
+	void				CancelEcho( short * a_pSamples, size_t a_Count );
 	void				SendingData( AudioData * a_pData );
 };
 
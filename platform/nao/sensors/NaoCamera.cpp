@@ -38,6 +38,8 @@ RTTI_IMPL(NaoCamera, Camera);
 
 bool NaoCamera::OnStart()
 {
+	m_DeliveryId = DataDelivery::Instance()->Register( "NaoCamera", DataDelivery::LATEST, DataDelivery::PRIORITY_LOW, 1, 
+		DELEGATE( NaoCamera, SendingData, IData *, this ) );
 	Log::Debug("NaoVideo", "Starting up video device");
 
 	m_StopThread = false;
@@ -50,6 +52,8 @@ bool NaoCamera::OnStop()
 	m_StopThread = true;
 	while(! m_ThreadStopped )
 		tthread::this_thread::yield();
+	DataDelivery::Instance()->Unregister( m_DeliveryId );
+	m_DeliveryId = 0;
 	return true;
 }
 
@@ -109,8 +113,7 @@ void NaoCamera::DoStreamingThread(void *arg)
 			std::string encoded;
 			if ( JpegHelpers::EncodeImage( pRGB, width, height, depth, encoded ) )
 			{
-				ThreadPool::Instance()->InvokeOnMain<VideoData *>(
-					DELEGATE( NaoCamera, SendingData, VideoData *, this ), new VideoData(encoded));
+				DataDelivery::Instance()->Send( m_DeliveryId, new VideoData(encoded) );
 			}
 			else
 				Log::Error( "NaoCamera", "Failed to imencode()" );
@@ -127,7 +130,7 @@ void NaoCamera::DoStreamingThread(void *arg)
 #endif
 }
 
-void NaoCamera::SendingData( VideoData * a_pData )
+void NaoCamera::SendingData( IData * a_pData )
 {
 	SendData( a_pData );
 }
@@ -23,6 +23,7 @@
 #include "utils/ThreadPool.h"
 #include "utils/Time.h"
 #include "sensors/Camera.h"
+#include "capture/DataDelivery.h"
 
 //! Nao implementation of the Camera class
 class NaoCamera : public Camera
@@ -30,7 +31,7 @@ class NaoCamera : public Camera
 public:
 	RTTI_DECL();
 
-	NaoCamera() : m_StopThread( false ), m_ClientName( "Self" )
+	NaoCamera() : m_StopThread( false ), m_ClientName( "Self" ), m_DeliveryId( 0 )
 	{}
 
 	//! ISensor interface
@@ -47,10 +48,11 @@ private:
 	volatile bool 			m_StopThread;
 	volatile bool 			m_ThreadStopped;
 	std::string             m_ClientName;
+	int						m_DeliveryId;
 
 	void				    StreamingThread( void * arg );
 	void 				    DoStreamingThread( void * arg );
-	void			        SendingData( VideoData * a_pData );
+	void			        SendingData( IData * a_pData );
 };
 
 #endif
@@ -57,6 +57,8 @@ void NaoDepthCamera::Deserialize(const Json::Value & json)
 
 bool NaoDepthCamera::OnStart()
 {
+    m_DeliveryId = DataDelivery::Instance()->Register( "NaoDepthCamera", DataDelivery::LATEST, DataDelivery::PRIORITY_LOW, 1, 
+        DELEGATE( NaoDepthCamera, SendingData, IData *, this ) );
     Log::Debug("NaoDepthCamera", "Starting up video device");
 
     m_StopThread = false;
@@ -69,6 +71,8 @@ bool NaoDepthCamera::OnStop()
     m_StopThread = true;
     while(! m_ThreadStopped )
         tthread::this_thread::yield();
+    DataDelivery::Instance()->Unregister( m_DeliveryId );
+    m_DeliveryId = 0;
     return true;
 }
 
@@ -133,7 +137,7 @@ void NaoDepthCamera::DoStreamingThread(void *arg)
 
         std::vector<unsigned char> outputVector;
         if ( cv::imencode(".png", imgHeader, outputVector) && m_Paused <= 0 )
-            ThreadPool::Instance()->InvokeOnMain<DepthVideoData *>( DELEGATE( NaoDepthCamera, SendingData, DepthVideoData *, this ), new DepthVideoData(outputVector));
+            DataDelivery::Instance()->Send( m_DeliveryId, new DepthVideoData(outputVector) );
         else
             Log::Error( "NaoDepthCamera", "Failed to imencode()" );
 
@@ -148,7 +152,7 @@ void NaoDepthCamera::DoStreamingThread(void *arg)
 #endif
 }
 
-void NaoDepthCamera::SendingData( DepthVideoData * a_pData )
+void NaoDepthCamera::SendingData( IData * a_pData )
 {
     SendData( a_pData );
 }
@@ -23,6 +23,7 @@
 #include "utils/ThreadPool.h"
 #include "utils/Time.h"
 #include "sensors/DepthCamera.h"
+#include "capture/DataDelivery.h"
 
 //! Nao implementation of the DepthCamera class
 class NaoDepthCamera : public DepthCamera
@@ -33,7 +34,8 @@ public:
     NaoDepthCamera() : m_StopThread( false ),
 		m_ClientName("Self"),
 		m_Width(320),
-		m_Height(240)
+		m_Height(240),
+		m_DeliveryId(0)
     {}
 
 	//! ISerializable interface
@@ -56,10 +58,11 @@ private:
     std::string             m_ClientName;
 	int						m_Width;
 	int						m_Height;
+	int						m_DeliveryId;
 
     void				    StreamingThread( void * arg );
     void 				    DoStreamingThread( void * arg );
-    void			        SendingData( DepthVideoData * a_pData );
+    void			        SendingData( IData * a_pData );
 };
 
 #endif //SELF_NAO3DCAMERA_H
@@ -43,6 +43,8 @@ void NaoGaze::Deserialize(const Json::Value & json)
 
 bool NaoGaze::OnStart()
 {
+    m_DeliveryId = DataDelivery::Instance()->Register( "NaoGaze", DataDelivery::LATEST, DataDelivery::PRIORITY_NORMAL, 1, 
+        DELEGATE( NaoGaze, SendingData, IData *, this ) );
     Log::Status("NaoGaze", "NaoGaze started");
 
     ThreadPool::Instance()->InvokeOnThread<void *>(DELEGATE(NaoGaze, ReceiveData, void *, this), NULL);
@@ -58,6 +60,8 @@ bool NaoGaze::OnStop()
     delete m_pGaze;
     m_pGaze = NULL;
 #endif
+    DataDelivery::Instance()->Unregister( m_DeliveryId );
+    m_DeliveryId = 0;
     return true;
 }
 
@@ -125,13 +129,12 @@ qi::AnyReference NaoGaze::OnPersonStopsLooking(const std::vector <qi::AnyReferen
 
 qi::AnyReference NaoGaze::DoOnRecognized(bool a_IsPersonLooking)
 {
-    ThreadPool::Instance()->InvokeOnMain<GazeData *>(DELEGATE(NaoGaze, SendingData, GazeData * , this),
-                                                      new GazeData( a_IsPersonLooking ));
+    DataDelivery::Instance()->Send( m_DeliveryId, new GazeData( a_IsPersonLooking ) );
 
     return qi::AnyReference();
 }
 
-void NaoGaze::SendingData(GazeData * a_pData)
+void NaoGaze::SendingData(IData * a_pData)
 {
     SendData(a_pData);
 }
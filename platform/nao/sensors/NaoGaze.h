@@ -23,6 +23,7 @@
 #include "NaoPlatform.h"
 #include "sensors/ISensor.h"
 #include "sensors/GazeData.h"
+#include "capture/DataDelivery.h"
 
 #ifndef _WIN32
 #include <alproxies/algazeanalysisproxy.h>
@@ -37,6 +38,7 @@ public:
 #ifndef _WIN32
 		, m_pGaze(NULL), m_Tolerance (0.8f)
 #endif
+		, m_DeliveryId( 0 )
 	{}
 
     //! ISensor interface
@@ -69,10 +71,11 @@ private:
 #endif
 
     float               m_Tolerance;
+    int                 m_DeliveryId;
 
     void                ReceiveData(void *);
     void                DoReceiveData( void * );
-    void                SendingData(GazeData *a_pData);
+    void                SendingData(IData *a_pData);
     qi::AnyReference    DoOnRecognized(bool a_IsPersonLooking);
 };
 
@@ -55,6 +55,8 @@ void NaoLaser::Deserialize(const Json::Value & json)
 
 bool NaoLaser::OnStart()
 {
+    m_DeliveryId = DataDelivery::Instance()->Register( "NaoLaser", DataDelivery::LOSSLESS, DataDelivery::PRIORITY_HIGH, 16, 
+        DELEGATE( NaoLaser, SendLaserData, IData *, this ) );
     try
     {
         ConfigureLasers();
@@ -76,6 +78,8 @@ bool NaoLaser::OnStop()
     Log::Status("NaoLaser", "NaoLaser stopped");
     m_Memory.reset();
     m_spTimer.reset();
+    DataDelivery::Instance()->Unregister( m_DeliveryId );
+    m_DeliveryId = 0;
     return true;
 }
 
@@ -111,15 +115,13 @@ void NaoLaser::DoGetData()
         if (! m_bPaused && val.as<float>() < m_DistanceThreshold)
         {
             Log::Debug("NaoLaser", "Key: %s, val: %.3f", m_LaserSensors[i].c_str(), val.as<float>() );
-            ThreadPool::Instance()->InvokeOnMain( 
-                DELEGATE(NaoLaser, SendLaserData, LaserData *, this),
-                    new LaserData( val.as<float>(), 0, 0 ) );
+            DataDelivery::Instance()->Send( m_DeliveryId, new LaserData( val.as<float>(), 0, 0 ) );
             break;
         }
     }
 }
 
-void NaoLaser::SendLaserData( LaserData * a_pData )
+void NaoLaser::SendLaserData( IData * a_pData )
 {
     ISensor::SendData( a_pData );
 }
@@ -22,6 +22,7 @@
 #include "qi/anyobject.hpp"
 #include "NaoPlatform.h"
 #include "sensors/Laser.h"
+#include "capture/DataDelivery.h"
 
 class NaoLaser : public Laser
 {
@@ -31,7 +32,8 @@ public:
     //! Construction
     NaoLaser() : Laser(),
         m_Interval(2.0),
-        m_bPaused(false)
+        m_bPaused(false),
+        m_DeliveryId(0)
     {}
 
     //! ISerializable interface
@@ -53,10 +55,11 @@ private:
     float                       m_DistanceThreshold;
     TimerPool::ITimer::SP       m_spTimer;
     qi::AnyObject               m_Memory;
+    int                         m_DeliveryId;
     
     void OnGetData();
     void DoGetData();
-    void SendLaserData( LaserData * a_pData );
+    void SendLaserData( IData * a_pData );
     void ConfigureLasers();
 
 };
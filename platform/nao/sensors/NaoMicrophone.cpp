@@ -33,6 +33,8 @@ RTTI_IMPL(NaoMicrophone, Microphone);
 
 bool NaoMicrophone::OnStart()
 {
+	m_DeliveryId = DataDelivery::Instance()->Register( "NaoMicrophone", DataDelivery::LOSSLESS, DataDelivery::PRIORITY_HIGH, 500, 
+		DELEGATE( NaoMicrophone, SendingData, IData *, this ) );
 	Log::Status("NaoAudio", "NaoAudio started");
 	m_StopThread = false;
 	m_ThreadStopped = false;
@@ -48,6 +50,8 @@ bool NaoMicrophone::OnStop()
 	m_StopThread = true;
 	while(! m_ThreadStopped )
 		tthread::this_thread::yield();
+	DataDelivery::Instance()->Unregister( m_DeliveryId );
+	m_DeliveryId = 0;
 	return true;
 }
 
@@ -75,7 +79,7 @@ void NaoMicrophone::ReceiveData(void * arg)
 				break;
 			if (read > 0) 
 			{
-				ThreadPool::Instance()->InvokeOnMain<AudioData *>(DELEGATE(NaoMicrophone, SendingData, AudioData *, this),
+				DataDelivery::Instance()->Send(m_DeliveryId,
 					new AudioData(std::string(buffer, read), m_RecordingHZ, 1, m_RecordingBits));
 			}
 			else
@@ -104,7 +108,7 @@ void NaoMicrophone::ReceiveData(void * arg)
 	m_ThreadStopped = true;
 }
 
-void NaoMicrophone::SendingData(AudioData * a_pData)
+void NaoMicrophone::SendingData(IData * a_pData)
 {
 	SendData(a_pData);
 }
@@ -20,6 +20,7 @@
 #define NAO_MICROPHONE_H
 
 #include "sensors/Microphone.h"
+#include "capture/DataDelivery.h"
 
 //! This ISensor gets audio data from the Nao microphone input.
 class NaoMicrophone : public Microphone
@@ -28,7 +29,7 @@ public:
 	RTTI_DECL();
 
 	//! Construction
-	NaoMicrophone() : m_Stream(NULL), m_StopThread( false ), m_ThreadStopped( false )
+	NaoMicrophone() : m_Stream(NULL), m_StopThread( false ), m_ThreadStopped( false ), m_DeliveryId( 0 )
 	{}
 
 	//! ISensor interface
@@ -42,9 +43,10 @@ private:
 	FILE *				m_Stream;
 	volatile bool		m_StopThread;
 	volatile bool		m_ThreadStopped;
+	int					m_DeliveryId;
 
 	void				ReceiveData( void * );
-	void				SendingData( AudioData * a_pData );
+	void				SendingData( IData * a_pData );
 };
 
 #endif
@@ -51,6 +51,8 @@ void NaoSonar::Deserialize(const Json::Value & json)
 
 bool NaoSonar::OnStart()
 {
+    m_DeliveryId = DataDelivery::Instance()->Register( "NaoSonar", DataDelivery::LATEST, DataDelivery::PRIORITY_HIGH, m_SonarSensors.size(), 
+        DELEGATE( NaoSonar, SendSonarData, IData *, this ) );
     Log::Status("NaoSonar", "NaoSonar started: Sampling from %d sonars every %.2f seconds", m_SonarSensors.size(), m_Interval);
     m_spTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE(NaoSonar, OnGetData, this), m_Interval, false, true );
     return true;
@@ -60,6 +62,8 @@ bool NaoSonar::OnStop()
 {
     Log::Status("NaoSonar", "NaoSonar stopped");
     m_Memory.reset();
+    DataDelivery::Instance()->Unregister( m_DeliveryId );
+    m_DeliveryId = 0;
     return true;
 }
 
@@ -92,14 +96,12 @@ void NaoSonar::DoGetData()
         qi::AnyValue val = m_Memory.call<qi::AnyValue>("getData", m_SonarSensors[i]);
         if (! m_bPaused )
         {
-            ThreadPool::Instance()->InvokeOnMain( 
-                DELEGATE(NaoSonar, SendSonarData, SonarData *, this),
-                new SonarData( val.as<float>() ) );        
+            DataDelivery::Instance()->Send( m_DeliveryId, new SonarData( val.as<float>() ) );
         }
     }
 }
 
-void NaoSonar::SendSonarData( SonarData * a_pData )
+void NaoSonar::SendSonarData( IData * a_pData )
 {
     ISensor::SendData( a_pData );
 }
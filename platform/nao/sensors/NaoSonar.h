@@ -22,6 +22,7 @@
 #include "qi/anyobject.hpp"
 #include "NaoPlatform.h"
 #include "sensors/Sonar.h"
+#include "capture/DataDelivery.h"
 
 class NaoSonar : public Sonar {
 public:
@@ -30,7 +31,8 @@ public:
     //! Construction
     NaoSonar() : Sonar(),
         m_Interval(2.0),
-        m_bPaused(false)
+        m_bPaused(false),
+        m_DeliveryId(0)
     {}
 
     //! ISerializable interface
@@ -51,10 +53,11 @@ private:
     float                       m_Interval;
     TimerPool::ITimer::SP       m_spTimer;
     qi::AnyObject               m_Memory;
+    int                         m_DeliveryId;
     
     void OnGetData();
     void DoGetData();
-    void SendSonarData( SonarData * a_pData );
+    void SendSonarData( IData * a_pData );
 
 };
 
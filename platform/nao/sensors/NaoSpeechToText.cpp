@@ -32,6 +32,8 @@ RTTI_IMPL(NaoSpeechToText, LocalSpeechToText);
 
 bool NaoSpeechToText::OnStart()
 {
+    m_DeliveryId = DataDelivery::Instance()->Register( "NaoSpeechToText", DataDelivery::LOSSLESS, DataDelivery::PRIORITY_NORMAL, 50, 
+        DELEGATE( NaoSpeechToText, SendingData, IData *, this ) );
     Log::Status("NaoSpeechToText", "NaoSpeechToText started");
     m_Paused = 0;
 
@@ -48,6 +50,8 @@ bool NaoSpeechToText::OnStop()
 	delete m_pAsr;
 	m_pAsr = NULL;
 #endif
+    DataDelivery::Instance()->Unregister( m_DeliveryId );
+    m_DeliveryId = 0;
     return true;
 }
 
@@ -113,13 +117,12 @@ qi::AnyReference NaoSpeechToText::DoOnRecognized(const std::vector <qi::AnyRefer
 
 	Log::Debug("NaoSpeechToText", "word: %s, Confidence: %f", word.c_str(), confidence);
 	if(m_Paused <= 0)
-		ThreadPool::Instance()->InvokeOnMain<TextData *>(DELEGATE(NaoSpeechToText, SendingData, TextData * , this),
-													 new TextData(word, confidence ));
+		DataDelivery::Instance()->Send( m_DeliveryId, new TextData(word, confidence ) );
 
 	return qi::AnyReference();
 }
 
-void NaoSpeechToText::SendingData(TextData * a_pData)
+void NaoSpeechToText::SendingData(IData * a_pData)
 {
     SendData(a_pData);
 }
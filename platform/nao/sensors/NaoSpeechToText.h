@@ -22,6 +22,7 @@
 #include "qi/anyobject.hpp"
 #include "NaoPlatform.h"
 #include "sensors/LocalSpeechToText.h"
+#include "capture/DataDelivery.h"
 
 #ifndef _WIN32
 #include <alproxies/alspeechrecognitionproxy.h>
@@ -34,7 +35,7 @@ public:
     RTTI_DECL();
 
     //! Construction
-    NaoSpeechToText()
+    NaoSpeechToText() : m_DeliveryId( 0 )
     {}
 
     //! ISensor interface
@@ -49,6 +50,7 @@ private:
     //! Data
     qi::AnyObject       m_Memory;
     qi::AnyObject       m_Recognized;
+    int                 m_DeliveryId;
 
 #ifndef _WIN32
     AL::ALSpeechRecognitionProxy * m_pAsr;
@@ -56,7 +58,7 @@ private:
 
     void                ReceiveData( void * );
     void                DoReceiveData( void * );
-    void				SendingData( TextData * a_pData );
+    void				SendingData( IData * a_pData );
     qi::AnyReference    DoOnRecognized(const std::vector<qi::AnyReference> & recognizeInfo );
 };
 
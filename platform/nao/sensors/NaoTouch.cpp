@@ -29,6 +29,23 @@ REG_OVERRIDE_SERIALIZABLE( TouchSensor, NaoTouch);
 
 RTTI_IMPL(NaoTouch, TouchSensor);
 
+//! Names ALMemory reports in TouchChanged, compiled up front so the first touch costs the same as the rest
+static const char * TOUCH_SENSORS[] = 
+{
+	"Head", "Head/Touch/Front", "Head/Touch/Middle", "Head/Touch/Rear",
+	"LArm", "LHand/Touch/Back", "LHand/Touch/Left", "LHand/Touch/Right",
+	"RArm", "RHand/Touch/Back", "RHand/Touch/Left", "RHand/Touch/Right",
+	"LFoot", "LFoot/Bumper/Left", "LFoot/Bumper/Right",
+	"RFoot", "RFoot/Bumper/Left", "RFoot/Bumper/Right",
+	"ChestBoard/Button", "Base/Bumper/FrontLeft", "Base/Bumper/FrontRight", "Base/Bumper/Back"
+};
+
+void NaoTouch::Deserialize(const Json::Value & json)
+{
+	TouchSensor::Deserialize(json);
+	CompileTranslations();
+}
+
 bool NaoTouch::OnStart()
 {
 	Log::Debug("NaoTouch", "Starting up touch device");
@@ -111,41 +128,80 @@ qi::AnyReference NaoTouch::OnTouch( const std::vector<qi::AnyReference> & args )
 
 qi::AnyReference NaoTouch::DoOnTouch(const std::vector <qi::AnyReference> & args)
 {
-	for (size_t i = 0; i < args.size(); ++i)
+	TouchList touches;
+	ParseTouch( args, touches );
+
+	std::string touchType;
+	for (size_t i = 0; i < touches.size(); ++i)
+	{
+		if ( Translate( touches[i].first, touches[i].second, touchType ) )
+		{
+			Log::Debug("NaoTouch", "Sending TouchType: %s", touchType.c_str());
+			ThreadPool::Instance()->InvokeOnMain(DELEGATE(NaoTouch, SendData, TouchData * , this),
+												 new TouchData(touchType, touches[i].second ? 1.0f : 0.0f));
+			break;
+		}
+	}
+	return qi::AnyReference();
+}
+
+void NaoTouch::ParseTouch( const std::vector<qi::AnyReference> & a_Args, TouchList & a_Touches )
+{
+	for (size_t i = 0; i < a_Args.size(); ++i)
 	{
-		qi::AnyReference arg = args[i].content();
+		qi::AnyReference arg = a_Args[i].content();
 		qi::AnyReference hit = arg[0].content();
-		std::string eventName = hit[0].content().asString();
-		bool touched = hit[1].content().as<bool>();
+		a_Touches.push_back( std::make_pair( hit[0].content().asString(), hit[1].content().as<bool>() ) );
+	}
+}
+
+void NaoTouch::CompileTranslations()
+{
+	boost::lock_guard<boost::mutex> lock( m_DispatchLock );
+	m_Dispatch.clear();
+	for (size_t i = 0; i < sizeof(TOUCH_SENSORS) / sizeof(TOUCH_SENSORS[0]); ++i)
+		CompileSensor( TOUCH_SENSORS[i] );
+}
+
+bool NaoTouch::Translate( const std::string & a_SensorName, bool a_bTouched, std::string & a_TouchType )
+{
+	boost::lock_guard<boost::mutex> lock( m_DispatchLock );
+
+	DispatchTable::const_iterator iDispatch = m_Dispatch.find( a_SensorName );
+	const Dispatch & dispatch = iDispatch != m_Dispatch.end() ? iDispatch->second : CompileSensor( a_SensorName );
+
+	int translation = dispatch.m_Translation[ a_bTouched ? 1 : 0 ];
+	if ( translation < 0 || translation >= (int)m_TouchTranslations.size() )
+		return false;
+
+	a_TouchType = m_TouchTranslations[translation].m_TouchType;
+	return true;
+}
+
+const NaoTouch::Dispatch & NaoTouch::CompileSensor( const std::string & a_SensorName )
+{
+	// the translations are tested just as they would be per event: the first one with a passing
+	// condition, or with no conditions at all, wins
+	Dispatch & dispatch = m_Dispatch[ a_SensorName ];
+	for (int state = 0; state < 2; ++state)
+	{
 		Json::Value touch;
-		touch["m_SensorName"] = eventName;
-		
-		for (size_t i = 0; i < m_TouchTranslations.size(); ++i)
+		touch["m_SensorName"] = a_SensorName;
+		touch["m_bTouched"] = state != 0;
+
+		for (size_t i = 0; i < m_TouchTranslations.size() && dispatch.m_Translation[state] < 0; ++i)
 		{
-			bool bTouched = true;
-			TouchTranslation &response = m_TouchTranslations[i];
-
-			for (size_t k = 0; k < response.m_Conditions.size(); ++k)
-			{
-				if (response.m_Conditions[k]->Test(touch))
-				{
-					bTouched = true;
-					break;
-				}
-				else
-					bTouched = false;
-			}
-
-			if (bTouched)
-			{
-				Log::Debug("NaoTouch", "Sending TouchType: %s", response.m_TouchType.c_str());
-				ThreadPool::Instance()->InvokeOnMain(DELEGATE(NaoTouch, SendData, TouchData * , this),
-													 new TouchData(response.m_TouchType, touched ? 1.0f : 0.0f));
-				return qi::AnyReference();
-			}
+			TouchTranslation & response = m_TouchTranslations[i];
+
+			bool bMatch = response.m_Conditions.size() == 0;
+			for (size_t k = 0; k < response.m_Conditions.size() && !bMatch; ++k)
+				bMatch = response.m_Conditions[k]->Test(touch);
+			if ( bMatch )
+				dispatch.m_Translation[state] = (int)i;
 		}
 	}
-	return qi::AnyReference();
+
+	return dispatch;
 }
 
 void NaoTouch::OnPause()
@@ -26,14 +26,23 @@
 
 #include "qi/anyobject.hpp"
 
+#include <boost/unordered_map.hpp>
+#include <boost/thread.hpp>
+
 class NaoTouch : public TouchSensor
 {
 public:
 	RTTI_DECL();
 
+	//! Types
+	typedef std::vector< std::pair<std::string,bool> >		TouchList;
+
 	NaoTouch()
 	{}
 
+	//! ISerializable interface
+	virtual void Deserialize(const Json::Value & json);
+
 	//! ISensor interface
 	virtual const char * GetDataType()
 	{
@@ -51,13 +60,34 @@ public:
 	qi::AnyReference OnTouch( const std::vector<qi::AnyReference> & touchInfo );
 	void SendData( TouchData * a_pData );
 
-private:
+	//! Build the lookup from sensor name and touched state to the first matching translation. This is
+	//! done once the translations are loaded, names we have not seen before are added on their first event.
+	void CompileTranslations();
+	//! Find the touch type for a sensor, returns false if no translation matches.
+	bool Translate( const std::string & a_SensorName, bool a_bTouched, std::string & a_TouchType );
+	//! Pull the sensor name and touched state out of the ALMemory TouchChanged arguments.
+	static void ParseTouch( const std::vector<qi::AnyReference> & a_Args, TouchList & a_Touches );
 
+private:
+	//! Types
+	struct Dispatch
+	{
+		Dispatch()
+		{
+			m_Translation[0] = m_Translation[1] = -1;
+		}
 
+		int				m_Translation[2];			// index into m_TouchTranslations for released and touched, -1 if none
+	};
+	typedef boost::unordered_map<std::string,Dispatch>		DispatchTable;
 
 	//! Data
 	qi::AnyObject m_Memory;
 	qi::AnyObject m_TouchSub;
+	boost::mutex m_DispatchLock;
+	DispatchTable m_Dispatch;
+
+	const Dispatch & CompileSensor( const std::string & a_SensorName );
 
 	qi::AnyReference DoOnTouch(const std::vector<qi::AnyReference> & touchInfo );
 	void DoStartTouch();
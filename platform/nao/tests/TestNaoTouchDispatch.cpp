@@ -0,0 +1,155 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+#include "sensors/NaoTouch.h"
+
+#ifndef _WIN32
+
+class TestNaoTouchDispatch : UnitTest
+{
+public:
+	static const int FILLERS = 100;
+	static const int EVENTS = 100000;
+	static const int RUNS = 3;
+
+	//! Construction
+	TestNaoTouchDispatch() : UnitTest("TestNaoTouchDispatch")
+	{}
+
+	virtual void RunTest()
+	{
+		// lots of translations that never match ahead of the ones that do, so a linear search would be slow
+		Json::Value json;
+		for(int i=0;i<FILLERS;++i)
+			AddTranslation( json, StringUtil::Format( "Filler%d", i ), StringUtil::Format( "Nothing/%d", i ) );
+		AddTranslations( json );
+
+		NaoTouch touch;
+		touch.Deserialize( json );
+
+		// synthetic ALMemory TouchChanged arguments parse back to names and states
+		std::vector<qi::AnyValue> values;
+		values.push_back( MakeTouch( "Head/Touch/Front", true ) );
+		values.push_back( MakeTouch( "LFoot/Bumper/Left", false ) );
+		values.push_back( MakeTouch( "Custom/Sensor", true ) );
+		values.push_back( MakeTouch( "RHand/Touch/Back", true ) );
+		std::vector<qi::AnyReference> args;
+		for(size_t i=0;i<values.size();++i)
+			args.push_back( qi::AnyReference::from( values[i] ) );
+
+		NaoTouch::TouchList touches;
+		NaoTouch::ParseTouch( args, touches );
+		Test( touches.size() == 4 );
+		Test( touches.size() == 4 && touches[0].first == "Head/Touch/Front" && touches[0].second );
+		Test( touches.size() == 4 && touches[1].first == "LFoot/Bumper/Left" && !touches[1].second );
+
+		// known sensors come from the compiled table, unknown ones are compiled on first sight
+		std::string type;
+		Test( touch.Translate( "Head/Touch/Front", true, type ) && type == "HeadTouch" );
+		Test( touch.Translate( "Head/Touch/Front", false, type ) && type == "HeadTouch" );
+		Test( touch.Translate( "LFoot/Bumper/Left", false, type ) && type == "LeftBumper" );
+		Test( touch.Translate( "Custom/Sensor", true, type ) && type == "Custom" );
+		Test( touch.Translate( "Custom/Sensor", true, type ) && type == "Custom" );
+		Test(! touch.Translate( "RHand/Touch/Back", true, type ) );
+
+		// the cost of an event, parsing included, must not depend on how many translations there are. 
+		// Compared against the same events without the fillers, the best of a few runs each to ride out 
+		// a busy machine, a linear search would be many times slower
+		Json::Value few;
+		AddTranslations( few );
+		NaoTouch fewTouch;
+		fewTouch.Deserialize( few );
+
+		double perEvent = 0.0, fewPerEvent = 0.0;
+		for(int run=0;run<RUNS;++run)
+		{
+			double manyTime = TimeEvents( touch, args );
+			double fewTime = TimeEvents( fewTouch, args );
+			if ( run == 0 || manyTime < perEvent )
+				perEvent = manyTime;
+			if ( run == 0 || fewTime < fewPerEvent )
+				fewPerEvent = fewTime;
+		}
+		Log::Status( "TestNaoTouchDispatch", "%.2f us per event with %u translations, %.2f us with %u", 
+			perEvent * 1000000.0, json["m_TouchTranslations"].size(), fewPerEvent * 1000000.0, few["m_TouchTranslations"].size() );
+
+		Test( perEvent < fewPerEvent * 2.0 );
+	}
+
+	//! Seconds per event to parse and translate the TouchChanged arguments
+	double TimeEvents( NaoTouch & a_Touch, const std::vector<qi::AnyReference> & a_Args )
+	{
+		int matched = 0;
+		std::string type;
+		NaoTouch::TouchList touches;
+		double start = Time().GetEpochTime();
+		for(int i=0;i<EVENTS;++i)
+		{
+			touches.clear();
+			NaoTouch::ParseTouch( a_Args, touches );
+			const NaoTouch::TouchList::value_type & hit = touches[ i % touches.size() ];
+			if ( a_Touch.Translate( hit.first, hit.second, type ) )
+				matched += 1;
+		}
+		double elapsed = Time().GetEpochTime() - start;
+
+		Test( matched == (EVENTS / 4) * 3 );
+		return elapsed / EVENTS;
+	}
+
+	//! The translations the test events match
+	static void AddTranslations( Json::Value & a_Json )
+	{
+		AddTranslation( a_Json, "HeadTouch", "Head/Touch/Front" );
+		AddTranslation( a_Json, "LeftBumper", "LFoot/Bumper/Left" );
+		AddTranslation( a_Json, "Custom", "Custom/Sensor" );
+	}
+
+	static void AddTranslation( Json::Value & a_Json, const std::string & a_TouchType, const std::string & a_Sensor )
+	{
+		Json::Value condition;
+		condition["Type_"] = "EqualityCondition";
+		condition["m_Parameter"] = "m_SensorName";
+		condition["m_Op"] = "EQ";
+		condition["m_Value"] = a_Sensor;
+
+		Json::Value translation;
+		translation["m_TouchType"] = a_TouchType;
+		translation["m_Conditions"].append( condition );
+		a_Json["m_TouchTranslations"].append( translation );
+	}
+
+	//! One TouchChanged argument as ALMemory sends it, [[name, touched]]
+	static qi::AnyValue MakeTouch( const std::string & a_Sensor, bool a_bTouched )
+	{
+		std::vector<qi::AnyValue> hit;
+		hit.push_back( qi::AnyValue::from( a_Sensor ) );
+		hit.push_back( qi::AnyValue::from( a_bTouched ) );
+
+		std::vector<qi::AnyValue> arg;
+		arg.push_back( qi::AnyValue::from( hit ) );
+		return qi::AnyValue::from( arg );
+	}
+};
+
+TestNaoTouchDispatch TEST_NAO_TOUCH_DISPATCH;
+
+#endif
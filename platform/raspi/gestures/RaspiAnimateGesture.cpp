@@ -22,7 +22,7 @@
 #include "blackboard/BlackBoard.h"
 #include "blackboard/Status.h"
 
-#ifndef _WIN32
+#ifdef RASPI_HARDWARE
 #include "wiringPi.h"
 #endif
 
@@ -58,7 +58,7 @@ void RaspiAnimateGesture::AnimateThread( Request * a_pReq )
 
 void RaspiAnimateGesture::DoAnimateThread(RaspiAnimateGesture::Request * a_pReq)
 {
-#ifndef _WIN32
+#ifdef RASPI_HARDWARE
 	Log::Debug( "RaspiAnimateGesture", "Gesture %s is running.", m_GestureId.c_str() );
 	if ( !m_bWiredPi )
 	{
@@ -16,6 +16,7 @@
 */
 
 
+
 #pragma warning(disable:4244)
 
 #include "RaspiMoveJointGesture.h"
@@ -23,91 +24,137 @@
 #include "utils/ThreadPool.h"
 #include "blackboard/BlackBoard.h"
 #include "blackboard/Status.h"
+#include "servo/ServoController.h"
+#include "servo/HardwarePwmDriver.h"
+#include "servo/PCA9685Driver.h"
 
-#ifndef _WIN32
-#include "wiringPi.h"
-#include "softPwm.h"
-#endif
+#include <math.h>
 
 REG_OVERRIDE_SERIALIZABLE( MoveJointGesture, RaspiMoveJointGesture );
 REG_SERIALIZABLE(RaspiMoveJointGesture);
 RTTI_IMPL( RaspiMoveJointGesture, MoveJointGesture );
 
-int RaspiMoveJointGesture::m_CurrentPWMArmState = 0;
+void RaspiMoveJointGesture::Serialize(Json::Value & json)
+{
+	MoveJointGesture::Serialize(json);
+	json["m_Driver"] = m_Driver;
+	json["m_I2CAddress"] = m_I2CAddress;
+	SerializeVector( "m_PwmPins", m_PwmPins, json );
+	SerializeVector( "m_Channels", m_Channels, json );
+	json["m_fMinAngle"] = m_fMinAngle;
+	json["m_fMaxAngle"] = m_fMaxAngle;
+	json["m_fMinPulse"] = m_fMinPulse;
+	json["m_fMaxPulse"] = m_fMaxPulse;
+	json["m_fMaxVelocity"] = m_fMaxVelocity;
+	json["m_fMaxAcceleration"] = m_fMaxAcceleration;
+}
+
+void RaspiMoveJointGesture::Deserialize(const Json::Value & json)
+{
+	MoveJointGesture::Deserialize(json);
+	if ( json.isMember("m_Driver") )
+		m_Driver = json["m_Driver"].asString();
+	if ( json.isMember("m_I2CAddress") )
+		m_I2CAddress = json["m_I2CAddress"].asInt();
+	if ( json.isMember("m_PwmPins") )
+		DeserializeVector( "m_PwmPins", json, m_PwmPins );
+	if ( json.isMember("m_Channels") )
+		DeserializeVector( "m_Channels", json, m_Channels );
+	if ( json.isMember("m_fMinAngle") )
+		m_fMinAngle = json["m_fMinAngle"].asDouble();
+	if ( json.isMember("m_fMaxAngle") )
+		m_fMaxAngle = json["m_fMaxAngle"].asDouble();
+	if ( json.isMember("m_fMinPulse") )
+		m_fMinPulse = json["m_fMinPulse"].asDouble();
+	if ( json.isMember("m_fMaxPulse") )
+		m_fMaxPulse = json["m_fMaxPulse"].asDouble();
+	if ( json.isMember("m_fMaxVelocity") )
+		m_fMaxVelocity = json["m_fMaxVelocity"].asDouble();
+	if ( json.isMember("m_fMaxAcceleration") )
+		m_fMaxAcceleration = json["m_fMaxAcceleration"].asDouble();
+}
 
 bool RaspiMoveJointGesture::Execute( GestureDelegate a_Callback, const ParamsMap & a_Params )
 {
-    if ( PushRequest( a_Callback, a_Params ) )
-        ThreadPool::Instance()->InvokeOnThread(  DELEGATE( RaspiMoveJointGesture, MoveJointThread, Request *, this ), ActiveRequest() );
-    return true;
+	if ( PushRequest( a_Callback, a_Params ) )
+		StartMove();
+	return true;
 }
 
 bool RaspiMoveJointGesture::Abort()
 {
-    return false;
+	// the servos stop where they are, OnMoveDone finishes the request
+	if ( m_MotionId != 0 )
+		return ServoController::Instance()->Cancel( m_MotionId );
+	return false;
 }
 
-void RaspiMoveJointGesture::MoveJointThread( Request * a_pReq )
+void RaspiMoveJointGesture::StartMove()
 {
-    try {
-        if ( !m_bWiredPi )
-        {
-            m_bWiredPi = true;
-#ifndef _WIN32
-			wiringPiSetup();
-            softPwmCreate(m_PinNumber, 0, 50);
-#endif
-        }
-        MoveArm();
-    }
-    catch( const std::exception & ex )
-    {
-        Log::Error( "RaspiMoveJointGesture", "Caught Exception: %s", ex.what() );
-    }
-
-    // now invoke the main thread to notify them the move is completed..
-    ThreadPool::Instance()->InvokeOnMain( DELEGATE(RaspiMoveJointGesture, MoveJointDone, Request *, this ), a_pReq );
+	// the controller is shared by every joint gesture, the first one to run opens the driver
+	ServoController * pController = ServoController::Instance();
+	if (! pController->IsStarted() )
+		pController->Start( CreateDriver() );
+
+	std::vector<int> channels;
+	std::vector<double> targets;
+	for(size_t i=0;i<m_JointNames.size() && i<m_fAngles.size();++i)
+	{
+		if ( i >= m_Channels.size() )
+		{
+			Log::Warning( "RaspiMoveJointGesture", "No channel for joint %s", m_JointNames[i].c_str() );
+			continue;
+		}
+		channels.push_back( m_Channels[i] );
+		targets.push_back( GetPulse( m_fAngles[i] ) );
+	}
+
+	// the limits are in degrees, the controller works in microseconds of pulse
+	double scale = fabs( (m_fMaxPulse - m_fMinPulse) / (m_fMaxAngle - m_fMinAngle) );
+	Log::Debug( "RaspiMoveJointGesture", "Moving %u joints of %s", (unsigned int)channels.size(), m_GestureId.c_str() );
+	m_MotionId = pController->Move( channels, targets, m_fMaxVelocity * scale, m_fMaxAcceleration * scale,
+		DELEGATE( RaspiMoveJointGesture, OnMoveDone, bool, this ) );
+	if ( m_MotionId == 0 )
+	{
+		Log::Error( "RaspiMoveJointGesture", "Failed to start move for %s", m_GestureId.c_str() );
+		ActiveRequest()->m_bError = true;
+		ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE(RaspiMoveJointGesture, MoveJointDone, this ) );
+	}
+}
+
+void RaspiMoveJointGesture::OnMoveDone( bool a_bFinished )
+{
+	if (! a_bFinished )
+		Log::Debug( "RaspiMoveJointGesture", "Move of %s was stopped.", m_GestureId.c_str() );
+
+	// this runs on the TimerPool thread, the request queue is only touched on main in MoveJointDone()
+	ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE(RaspiMoveJointGesture, MoveJointDone, this ) );
 }
 
-void RaspiMoveJointGesture::MoveArm()
+IServoDriver::SP RaspiMoveJointGesture::CreateDriver()
 {
-#ifndef _WIN32
-	if(PWMValue() > m_CurrentPWMArmState) //move arm upward
-    {
-        Log::Debug("RaspiMoveJointGesture", "Current Raspi Arm State %d and Moving Raspi Arm Upward to %d", m_CurrentPWMArmState, PWMValue() );
-        for(int i = m_CurrentPWMArmState ; i <= PWMValue(); i++)
-        {
-            softPwmWrite (m_PinNumber, i);
-            delay(10);
-            m_CurrentPWMArmState = PWMValue();
-        }
-        wiringPiSetup();
-    }
-    if(PWMValue() < m_CurrentPWMArmState) //move arm downward
-    {
-        Log::Debug("RaspiMoveJointGesture", "Current Raspi Arm State %d and Moving Raspi Arm Downward to %d", m_CurrentPWMArmState, PWMValue() );
-        for(int i = m_CurrentPWMArmState; i >= PWMValue() ; i--)
-        {
-            softPwmWrite (m_PinNumber, i);
-            delay(10);
-            m_CurrentPWMArmState = PWMValue();
-        }
-        wiringPiSetup();
-    }
-#endif
+	if ( m_Driver == "pca9685" )
+		return IServoDriver::SP( new PCA9685Driver( IRegisterBus::SP( new I2CRegisterBus( m_I2CAddress ) ) ) );
+	if ( m_Driver == "sim" )
+		return IServoDriver::SP( new PCA9685Driver( IRegisterBus::SP( new SimRegisterBus() ) ) );
+	return IServoDriver::SP( new HardwarePwmDriver( m_PwmPins ) );
 }
 
-int RaspiMoveJointGesture::PWMValue()
+double RaspiMoveJointGesture::GetPulse( double a_fAngle ) const
 {
-    return (  ( abs( (int)m_fAngles.front()) % 360   )/360.0 ) * 100;
+	double range = m_fMaxAngle - m_fMinAngle;
+	double t = range != 0.0 ? (a_fAngle - m_fMinAngle) / range : 0.0;
+	if ( t < 0.0 ) t = 0.0;
+	if ( t > 1.0 ) t = 1.0;
+	return m_fMinPulse + (t * (m_fMaxPulse - m_fMinPulse));
 }
 
-void RaspiMoveJointGesture::MoveJointDone( Request * a_pReq )
+void RaspiMoveJointGesture::MoveJointDone()
 {
-    Status::SP spStatus(new Status());
-    SelfInstance::GetInstance()->GetBlackBoard()->AddThing(spStatus);
-    if ( PopRequest() )    // pop the request, if true is returned then start the next request..
-    {
-        ThreadPool::Instance()->InvokeOnThread(DELEGATE(RaspiMoveJointGesture, MoveJointThread, Request * , this), ActiveRequest());
-    }
+	m_MotionId = 0;
+
+	Status::SP spStatus(new Status());
+	SelfInstance::GetInstance()->GetBlackBoard()->AddThing(spStatus);
+	if ( PopRequest() )    // pop the request, if true is returned then start the next request..
+		StartMove();
 }
@@ -16,34 +16,64 @@
 */
 
 
+
 #ifndef SELF_MoveArmJointGesture_H
 #define SELF_MoveArmJointGesture_H
 
 #include "gestures/MoveJointGesture.h"
+#include "servo/IServoDriver.h"
 
-//! This is the class for waving arm joints for RaspberryPI
+//! This is the class for moving servo joints on a RaspberryPI. The pulses are timed by the Pi's PWM
+//! hardware or a PCA9685 board, and ServoController ramps every joint from one timer.
 class RaspiMoveJointGesture : public MoveJointGesture
 {
 public:
 	RTTI_DECL();
+
+	//! ISerializable interface
+	virtual void Serialize(Json::Value & json);
+	virtual void Deserialize(const Json::Value & json);
+
 	//! IGesture interface
 	virtual bool Execute( GestureDelegate a_Callback, const ParamsMap & a_Params );
 	virtual bool Abort();
+
 	//! Construction
-	RaspiMoveJointGesture() : m_PinNumber( 7 ), m_bWiredPi( false ), m_ArmLowPoint(0), m_ArmHighPoint(40)
-	{}
+	RaspiMoveJointGesture() : 
+		m_Driver( "pwm" ), 
+		m_I2CAddress( 0x40 ), 
+		m_fMinAngle( 0.0 ), 
+		m_fMaxAngle( 180.0 ), 
+		m_fMinPulse( 500.0 ), 
+		m_fMaxPulse( 2500.0 ), 
+		m_fMaxVelocity( 180.0 ), 
+		m_fMaxAcceleration( 720.0 ),
+		m_MotionId( 0 )
+	{
+		m_PwmPins.push_back( 1 );
+		m_Channels.push_back( 0 );
+	}
+
 private:
 	//! Data
-	bool m_bWiredPi;
-	int m_PinNumber;
-	int m_ArmLowPoint;
-	int m_ArmHighPoint;
-	static int m_CurrentPWMArmState;
+	std::string				m_Driver;				// pwm or pca9685
+	int						m_I2CAddress;			// of the PCA9685
+	std::vector<int>		m_PwmPins;				// wiringPi pins for the pwm driver channels
+	std::vector<int>		m_Channels;				// driver channel for each joint name
+	double					m_fMinAngle;			// degrees at m_fMinPulse
+	double					m_fMaxAngle;			// degrees at m_fMaxPulse
+	double					m_fMinPulse;			// microseconds
+	double					m_fMaxPulse;
+	double					m_fMaxVelocity;			// degrees per second
+	double					m_fMaxAcceleration;		// degrees per second squared
+	unsigned int			m_MotionId;
 
 	//! Callbacks
-	void MoveJointThread( Request * a_pReq );
-	void MoveJointDone( Request * a_pReq );
-	void MoveArm();
-	int PWMValue();
+	void StartMove();
+	void OnMoveDone( bool a_bFinished );
+	void MoveJointDone();
+
+	IServoDriver::SP CreateDriver();
+	double GetPulse( double a_fAngle ) const;
 };
 #endif
@@ -0,0 +1,71 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "HardwarePwmDriver.h"
+#include "utils/Log.h"
+
+#ifdef RASPI_HARDWARE
+#include "wiringPi.h"
+#endif
+
+namespace {
+
+	// 19.2 MHz / 192 = 100 kHz, 2000 counts gives a 20 ms frame of 10 us steps
+	const int PWM_CLOCK = 192;
+	const int PWM_RANGE = 2000;
+	const double PWM_STEP = 10.0;
+}
+
+bool HardwarePwmDriver::Open()
+{
+#ifdef RASPI_HARDWARE
+	if ( wiringPiSetup() < 0 )
+	{
+		Log::Error( "HardwarePwmDriver", "wiringPiSetup() failed." );
+		return false;
+	}
+	for(size_t i=0;i<m_Pins.size();++i)
+		pinMode( m_Pins[i], PWM_OUTPUT );
+
+	// mark-space mode, balanced mode would spread the pulse across the frame
+	pwmSetMode( PWM_MODE_MS );
+	pwmSetClock( PWM_CLOCK );
+	pwmSetRange( PWM_RANGE );
+	return true;
+#else
+	Log::Error( "HardwarePwmDriver", "Built without RASPI_HARDWARE, use the sim driver." );
+	return false;
+#endif
+}
+
+bool HardwarePwmDriver::SetPulse( int a_Channel, double a_fMicroseconds )
+{
+	if ( a_Channel < 0 || a_Channel >= GetChannels() )
+		return false;
+
+	int value = (int)((a_fMicroseconds / PWM_STEP) + 0.5);
+	if ( value < 0 ) value = 0;
+	if ( value > PWM_RANGE ) value = PWM_RANGE;
+#ifdef RASPI_HARDWARE
+	pwmWrite( m_Pins[a_Channel], value );
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,50 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef RASPI_HARDWARE_PWM_DRIVER_H
+#define RASPI_HARDWARE_PWM_DRIVER_H
+
+#include <vector>
+
+#include "IServoDriver.h"
+
+//! Servo pulses from the Pi's own PWM peripheral, which times them in hardware with no CPU cost. 
+//! There are only two PWM channels, on wiringPi pins 1 or 26 for PWM0 and 23 or 24 for PWM1, and 
+//! the clock is shared, so both run at the same 50 Hz frame with 10 us resolution.
+class HardwarePwmDriver : public IServoDriver
+{
+public:
+	//! Construction
+	HardwarePwmDriver( const std::vector<int> & a_Pins ) : m_Pins( a_Pins )
+	{}
+
+	//! IServoDriver interface
+	virtual bool Open();
+	virtual int GetChannels() const
+	{
+		return (int)m_Pins.size();
+	}
+	virtual bool SetPulse( int a_Channel, double a_fMicroseconds );
+
+private:
+	//! Data
+	std::vector<int>	m_Pins;			// wiringPi pin for each channel
+};
+
+#endif // RASPI_HARDWARE_PWM_DRIVER_H
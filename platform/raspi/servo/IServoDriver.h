@@ -0,0 +1,43 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef RASPI_ISERVO_DRIVER_H
+#define RASPI_ISERVO_DRIVER_H
+
+#include <boost/shared_ptr.hpp>
+
+//! Interface to whatever generates the servo pulses. Channels are numbered from 0, and pulse widths
+//! are in microseconds at the driver's frame rate, typically 50 Hz with 500 - 2500 us pulses.
+class IServoDriver
+{
+public:
+	//! Types
+	typedef boost::shared_ptr<IServoDriver>		SP;
+
+	virtual ~IServoDriver()
+	{}
+
+	//! Set up the hardware, called once before any pulses are set.
+	virtual bool Open() = 0;
+	virtual int GetChannels() const = 0;
+	//! Set the pulse width for a channel, 0 turns the output off so the servo goes limp.
+	virtual bool SetPulse( int a_Channel, double a_fMicroseconds ) = 0;
+};
+
+#endif // RASPI_ISERVO_DRIVER_H
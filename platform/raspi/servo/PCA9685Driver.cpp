@@ -0,0 +1,82 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "PCA9685Driver.h"
+#include "utils/Log.h"
+
+#include <boost/thread.hpp>
+#include <math.h>
+
+namespace {
+
+	const int SLEEP = 0x10;
+	const int AUTO_INCREMENT = 0x20;
+	const int RESTART = 0x80;
+	const int TOTEM_POLE = 0x04;
+	const int FULL_OFF = 0x10;
+}
+
+bool PCA9685Driver::Open()
+{
+	if (! m_spBus || ! m_spBus->Open() )
+		return false;
+
+	int prescale = (int)floor( (m_fOscillator / (4096.0 * m_fFrequency)) - 0.5 );
+	if ( prescale < 3 ) prescale = 3;
+	if ( prescale > 255 ) prescale = 255;
+	m_fFrequency = m_fOscillator / (4096.0 * (prescale + 1));
+
+	// the prescaler can only be set while the oscillator sleeps, and it needs 500us to restart
+	int mode = m_spBus->Read( MODE1 );
+	if ( mode < 0 )
+	{
+		Log::Error( "PCA9685Driver", "Failed to read MODE1." );
+		return false;
+	}
+	mode &= ~RESTART;
+	m_spBus->Write( MODE1, mode | SLEEP );
+	m_spBus->Write( PRESCALE, prescale );
+	m_spBus->Write( MODE2, TOTEM_POLE );
+	m_spBus->Write( MODE1, (mode & ~SLEEP) | AUTO_INCREMENT );
+	boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+	m_spBus->Write( MODE1, (mode & ~SLEEP) | AUTO_INCREMENT | RESTART );
+
+	Log::Status( "PCA9685Driver", "Opened, prescale %d, %.2f Hz", prescale, m_fFrequency );
+	return true;
+}
+
+bool PCA9685Driver::SetPulse( int a_Channel, double a_fMicroseconds )
+{
+	if ( a_Channel < 0 || a_Channel >= GetChannels() )
+		return false;
+
+	// every channel turns on at tick 0, the pulse ends at the off tick
+	int reg = LED0_ON_L + (4 * a_Channel);
+	int off = (int)floor( (a_fMicroseconds * m_fFrequency * 4096.0 / 1000000.0) + 0.5 );
+	if ( off <= 0 )
+	{
+		return m_spBus->Write( reg, 0 ) && m_spBus->Write( reg + 1, 0 )
+			&& m_spBus->Write( reg + 2, 0 ) && m_spBus->Write( reg + 3, FULL_OFF );
+	}
+	if ( off > 4095 )
+		off = 4095;
+
+	return m_spBus->Write( reg, 0 ) && m_spBus->Write( reg + 1, 0 )
+		&& m_spBus->Write( reg + 2, off & 0xff ) && m_spBus->Write( reg + 3, off >> 8 );
+}
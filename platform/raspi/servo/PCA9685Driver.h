@@ -0,0 +1,66 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef RASPI_PCA9685_DRIVER_H
+#define RASPI_PCA9685_DRIVER_H
+
+#include "IServoDriver.h"
+#include "RegisterBus.h"
+
+//! 16 channel, 12 bit PWM chip on I2C, each pulse is timed by the chip so the Pi only writes when a 
+//! servo needs to move.
+class PCA9685Driver : public IServoDriver
+{
+public:
+	//! Types
+	enum Registers
+	{
+		MODE1 = 0x00,
+		MODE2 = 0x01,
+		LED0_ON_L = 0x06,
+		PRESCALE = 0xfe
+	};
+
+	//! Construction
+	PCA9685Driver( IRegisterBus::SP a_spBus, double a_fFrequency = 50.0, double a_fOscillator = 25000000.0 ) :
+		m_spBus( a_spBus ), m_fFrequency( a_fFrequency ), m_fOscillator( a_fOscillator )
+	{}
+
+	//! IServoDriver interface
+	virtual bool Open();
+	virtual int GetChannels() const
+	{
+		return 16;
+	}
+	virtual bool SetPulse( int a_Channel, double a_fMicroseconds );
+
+	//! The actual frame rate, after rounding to the chip's prescaler.
+	double GetFrequency() const
+	{
+		return m_fFrequency;
+	}
+
+private:
+	//! Data
+	IRegisterBus::SP	m_spBus;
+	double				m_fFrequency;
+	double				m_fOscillator;
+};
+
+#endif // RASPI_PCA9685_DRIVER_H
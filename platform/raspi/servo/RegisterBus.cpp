@@ -0,0 +1,79 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "RegisterBus.h"
+#include "utils/Log.h"
+
+#ifdef RASPI_HARDWARE
+#include "wiringPiI2C.h"
+#include <unistd.h>
+#endif
+
+I2CRegisterBus::~I2CRegisterBus()
+{
+#ifdef RASPI_HARDWARE
+	if ( m_FD >= 0 )
+		close( m_FD );
+#endif
+}
+
+bool I2CRegisterBus::Open()
+{
+#ifdef RASPI_HARDWARE
+	if ( m_FD < 0 )
+		m_FD = wiringPiI2CSetup( m_Address );
+	if ( m_FD < 0 )
+		Log::Error( "I2CRegisterBus", "Failed to open I2C device 0x%02x", m_Address );
+#endif
+	return m_FD >= 0;
+}
+
+bool I2CRegisterBus::Write( int a_Register, int a_Value )
+{
+#ifdef RASPI_HARDWARE
+	if ( m_FD >= 0 )
+		return wiringPiI2CWriteReg8( m_FD, a_Register, a_Value ) >= 0;
+#endif
+	return false;
+}
+
+int I2CRegisterBus::Read( int a_Register )
+{
+#ifdef RASPI_HARDWARE
+	if ( m_FD >= 0 )
+		return wiringPiI2CReadReg8( m_FD, a_Register );
+#endif
+	return -1;
+}
+
+bool SimRegisterBus::Write( int a_Register, int a_Value )
+{
+	if ( a_Register < 0 || a_Register >= (int)m_Registers.size() )
+		return false;
+	m_Registers[a_Register] = a_Value & 0xff;
+	m_Writes += 1;
+	return true;
+}
+
+int SimRegisterBus::Read( int a_Register )
+{
+	if ( a_Register < 0 || a_Register >= (int)m_Registers.size() )
+		return -1;
+	return m_Registers[a_Register];
+}
@@ -0,0 +1,86 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef RASPI_REGISTER_BUS_H
+#define RASPI_REGISTER_BUS_H
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+//! Byte wide register access to a device, so drivers for chips like the PCA9685 can run against 
+//! a simulated device on a machine without the bus.
+class IRegisterBus
+{
+public:
+	//! Types
+	typedef boost::shared_ptr<IRegisterBus>		SP;
+
+	virtual ~IRegisterBus()
+	{}
+
+	virtual bool Open() = 0;
+	virtual bool Write( int a_Register, int a_Value ) = 0;
+	//! Returns the register value, or -1 on error.
+	virtual int Read( int a_Register ) = 0;
+};
+
+//! A device on the Pi's I2C bus through wiringPi.
+class I2CRegisterBus : public IRegisterBus
+{
+public:
+	I2CRegisterBus( int a_Address ) : m_Address( a_Address ), m_FD( -1 )
+	{}
+	~I2CRegisterBus();
+
+	//! IRegisterBus interface
+	virtual bool Open();
+	virtual bool Write( int a_Register, int a_Value );
+	virtual int Read( int a_Register );
+
+private:
+	int			m_Address;
+	int			m_FD;
+};
+
+//! 256 plain registers that remember what was written, and count the writes.
+class SimRegisterBus : public IRegisterBus
+{
+public:
+	SimRegisterBus() : m_Registers( 256, 0 ), m_Writes( 0 )
+	{}
+
+	//! IRegisterBus interface
+	virtual bool Open()
+	{
+		return true;
+	}
+	virtual bool Write( int a_Register, int a_Value );
+	virtual int Read( int a_Register );
+
+	size_t GetWrites() const
+	{
+		return m_Writes;
+	}
+
+private:
+	std::vector<int>	m_Registers;
+	size_t				m_Writes;
+};
+
+#endif // RASPI_REGISTER_BUS_H
@@ -0,0 +1,239 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "ServoController.h"
+#include "utils/Time.h"
+#include "utils/Log.h"
+
+#include <math.h>
+
+namespace {
+
+	// smaller than any servo can resolve, so holding still costs no bus traffic
+	const double MIN_PULSE_CHANGE = 0.5;
+}
+
+ServoController * ServoController::Instance()
+{
+	static ServoController sInstance;
+	return &sInstance;
+}
+
+ServoController::ServoController() : m_fSampleTime( 0.02 ), m_NextId( 1 ), m_Writes( 0 )
+{}
+
+ServoController::~ServoController()
+{
+	Stop();
+}
+
+bool ServoController::Start( IServoDriver::SP a_spDriver, float a_fRate /*= 50.0f*/ )
+{
+	Stop();
+	if (! a_spDriver || ! a_spDriver->Open() )
+	{
+		Log::Error( "ServoController", "Failed to open servo driver." );
+		return false;
+	}
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		m_spDriver = a_spDriver;
+		m_fSampleTime = a_fRate > 0.0f ? 1.0 / a_fRate : 0.02;
+	}
+
+	// ticks run off the main thread, a slow bus write shouldn't hold up everything else
+	TimerPool * pTP = TimerPool::Instance();
+	if ( pTP != NULL )
+		m_spTimer = pTP->StartTimer( VOID_DELEGATE( ServoController, OnTimer, this ), (float)m_fSampleTime, false, true );
+	return true;
+}
+
+void ServoController::Stop()
+{
+	m_spTimer.reset();
+
+	MotionList stopped;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		stopped.swap( m_Motions );
+		m_spDriver.reset();
+	}
+	for( MotionList::iterator iMotion = stopped.begin(); iMotion != stopped.end(); ++iMotion )
+		if ( iMotion->m_Callback.IsValid() )
+			iMotion->m_Callback( false );
+}
+
+unsigned int ServoController::Move( const std::vector<int> & a_Channels, const std::vector<double> & a_Targets,
+	double a_fMaxVelocity, double a_fMaxAcceleration, DoneCallback a_Callback )
+{
+	if ( a_Channels.size() == 0 || a_Channels.size() != a_Targets.size() )
+		return 0;
+
+	MotionList preempted;
+	unsigned int id = 0;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		if (! m_spDriver )
+			return 0;
+
+		Motion motion;
+		motion.m_Channels = a_Channels;
+		motion.m_Owned.assign( a_Channels.size(), true );
+		motion.m_Callback = a_Callback;
+
+		// servos don't report where they are, so start from what we last wrote. A channel we have 
+		// never driven jumps straight to its target
+		std::vector<double> start;
+		for(size_t i=0;i<a_Channels.size();++i)
+		{
+			if ( a_Channels[i] < 0 || a_Channels[i] >= m_spDriver->GetChannels() )
+				return 0;
+			PulseMap::const_iterator iPulse = m_Pulses.find( a_Channels[i] );
+			start.push_back( iPulse != m_Pulses.end() ? iPulse->second : a_Targets[i] );
+		}
+		motion.m_Trajectory.SetLimits( a_fMaxVelocity, a_fMaxAcceleration );
+		motion.m_Trajectory.SetStart( start );
+		motion.m_Trajectory.AddWaypoint( a_Targets );
+		if (! motion.m_Trajectory.Plan( m_fSampleTime ) )
+			return 0;
+
+		// take the channels from any motion already driving them
+		for( MotionList::iterator iMotion = m_Motions.begin(); iMotion != m_Motions.end(); )
+		{
+			bool bOwned = false;
+			for(size_t i=0;i<iMotion->m_Channels.size();++i)
+			{
+				for(size_t k=0;k<a_Channels.size();++k)
+					if ( iMotion->m_Channels[i] == a_Channels[k] )
+						iMotion->m_Owned[i] = false;
+				bOwned |= iMotion->m_Owned[i];
+			}
+
+			if (! bOwned )
+				preempted.splice( preempted.end(), m_Motions, iMotion++ );
+			else
+				++iMotion;
+		}
+
+		id = m_NextId++;
+		if ( m_NextId == 0 )
+			m_NextId = 1;
+		motion.m_Id = id;
+		m_Motions.push_back( motion );
+	}
+
+	for( MotionList::iterator iMotion = preempted.begin(); iMotion != preempted.end(); ++iMotion )
+		if ( iMotion->m_Callback.IsValid() )
+			iMotion->m_Callback( false );
+	return id;
+}
+
+bool ServoController::Cancel( unsigned int a_MotionId )
+{
+	MotionList cancelled;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		for( MotionList::iterator iMotion = m_Motions.begin(); iMotion != m_Motions.end(); ++iMotion )
+		{
+			if ( iMotion->m_Id == a_MotionId )
+			{
+				cancelled.splice( cancelled.end(), m_Motions, iMotion );
+				break;
+			}
+		}
+	}
+	if ( cancelled.size() == 0 )
+		return false;
+
+	if ( cancelled.front().m_Callback.IsValid() )
+		cancelled.front().m_Callback( false );
+	return true;
+}
+
+bool ServoController::GetPulse( int a_Channel, double & a_fPulse )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	PulseMap::const_iterator iPulse = m_Pulses.find( a_Channel );
+	if ( iPulse == m_Pulses.end() )
+		return false;
+	a_fPulse = iPulse->second;
+	return true;
+}
+
+void ServoController::SetPulse( int a_Channel, double a_fPulse )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Pulses[ a_Channel ] = a_fPulse;
+}
+
+size_t ServoController::GetActiveMotions()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_Motions.size();
+}
+
+void ServoController::OnTimer()
+{
+	Update( Time().GetEpochTime() );
+}
+
+void ServoController::Update( double a_fNow )
+{
+	MotionList done;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		if (! m_spDriver )
+			return;
+
+		JointTrajectory::Point point;
+		for( MotionList::iterator iMotion = m_Motions.begin(); iMotion != m_Motions.end(); )
+		{
+			Motion & motion = *iMotion;
+			if ( motion.m_fStart < 0.0 )
+				motion.m_fStart = a_fNow;
+
+			double elapsed = a_fNow - motion.m_fStart;
+			motion.m_Trajectory.GetPoint( elapsed, point );
+			for(size_t i=0;i<motion.m_Channels.size();++i)
+				if ( motion.m_Owned[i] )
+					WritePulse( motion.m_Channels[i], point.m_Positions[i] );
+
+			if ( elapsed >= motion.m_Trajectory.GetDuration() )
+				done.splice( done.end(), m_Motions, iMotion++ );
+			else
+				++iMotion;
+		}
+	}
+
+	for( MotionList::iterator iMotion = done.begin(); iMotion != done.end(); ++iMotion )
+		if ( iMotion->m_Callback.IsValid() )
+			iMotion->m_Callback( true );
+}
+
+void ServoController::WritePulse( int a_Channel, double a_fPulse )
+{
+	PulseMap::iterator iPulse = m_Pulses.find( a_Channel );
+	if ( iPulse != m_Pulses.end() && fabs( iPulse->second - a_fPulse ) < MIN_PULSE_CHANGE )
+		return;
+
+	if ( m_spDriver->SetPulse( a_Channel, a_fPulse ) )
+		m_Writes += 1;
+	m_Pulses[ a_Channel ] = a_fPulse;
+}
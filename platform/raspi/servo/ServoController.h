@@ -0,0 +1,108 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef RASPI_SERVO_CONTROLLER_H
+#define RASPI_SERVO_CONTROLLER_H
+
+#include <map>
+#include <list>
+#include <boost/thread.hpp>
+
+#include "IServoDriver.h"
+#include "trajectory/JointTrajectory.h"
+#include "utils/TimerPool.h"
+#include "utils/Delegate.h"
+
+//! Moves servos along planned profiles from a single timer. Any number of motions can run at once,
+//! each over its own set of channels, and every tick writes only the channels whose pulse changed.
+//! Starting a motion on a channel takes that channel away from whatever motion had it.
+class ServoController
+{
+public:
+	//! Types
+	typedef Delegate<bool>		DoneCallback;			// true if the motion finished, false if it was stopped
+
+	static ServoController * Instance();
+
+	//! Construction
+	ServoController();
+	~ServoController();
+
+	bool IsStarted() const
+	{
+		return m_spDriver.get() != NULL;
+	}
+
+	//! Open the driver and update it a_fRate times a second, the driver's frame rate is plenty.
+	bool Start( IServoDriver::SP a_spDriver, float a_fRate = 50.0f );
+	void Stop();
+
+	//! Move a_Channels to the a_Targets pulse widths together, limiting each one to a_fMaxVelocity in
+	//! microseconds per second and a_fMaxAcceleration in microseconds per second squared. Returns 
+	//! the motion ID, or 0 if it could not be started.
+	unsigned int Move( const std::vector<int> & a_Channels, const std::vector<double> & a_Targets,
+		double a_fMaxVelocity, double a_fMaxAcceleration, DoneCallback a_Callback );
+	//! Stop a motion where it is, its callback is invoked with false.
+	bool Cancel( unsigned int a_MotionId );
+	//! The last pulse width written to a channel, false if it was never set.
+	bool GetPulse( int a_Channel, double & a_fPulse );
+	//! Channels with a pulse the next motion can start from, used when nothing has been written yet.
+	void SetPulse( int a_Channel, double a_fPulse );
+
+	//! Write every motion's position at a_fNow, called by the timer.
+	void Update( double a_fNow );
+
+	size_t GetActiveMotions();
+	size_t GetWrites() const
+	{
+		return m_Writes;
+	}
+
+private:
+	//! Types
+	struct Motion
+	{
+		Motion() : m_Id( 0 ), m_fStart( -1.0 )
+		{}
+
+		unsigned int		m_Id;
+		std::vector<int>	m_Channels;
+		std::vector<bool>	m_Owned;		// false once another motion took the channel
+		JointTrajectory		m_Trajectory;
+		double				m_fStart;		// set on the first update
+		DoneCallback		m_Callback;
+	};
+	typedef std::list<Motion>		MotionList;
+	typedef std::map<int,double>	PulseMap;
+
+	//! Data
+	boost::mutex			m_Lock;
+	IServoDriver::SP		m_spDriver;
+	TimerPool::ITimer::SP	m_spTimer;
+	double					m_fSampleTime;
+	MotionList				m_Motions;
+	PulseMap				m_Pulses;
+	unsigned int			m_NextId;
+	size_t					m_Writes;
+
+	void OnTimer();
+	void WritePulse( int a_Channel, double a_fPulse );
+};
+
+#endif // RASPI_SERVO_CONTROLLER_H
@@ -0,0 +1,153 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+
+#include "servo/ServoController.h"
+#include "servo/PCA9685Driver.h"
+
+#include <math.h>
+
+class TestServoController : UnitTest
+{
+public:
+	//! Construction
+	TestServoController() : UnitTest("TestServoController"), m_Finished( 0 ), m_Stopped( 0 )
+	{}
+
+	virtual void RunTest()
+	{
+		SimRegisterBus * pBus = new SimRegisterBus();
+		boost::shared_ptr<PCA9685Driver> spDriver( new PCA9685Driver( IRegisterBus::SP( pBus ) ) );
+
+		// 25 MHz / (4096 * 50 Hz) rounds to a prescale of 121, the chip is left awake with auto increment
+		ServoController controller;
+		Test( controller.Start( spDriver ) );
+		Test( pBus->Read( PCA9685Driver::PRESCALE ) == 121 );
+		Test( (pBus->Read( PCA9685Driver::MODE1 ) & 0x10) == 0 );
+		Test( (pBus->Read( PCA9685Driver::MODE1 ) & 0x20) != 0 );
+		Test( fabs( spDriver->GetFrequency() - 50.0 ) < 0.5 );
+
+		// channels never driven jump to their target at once
+		std::vector<int> channels;
+		channels.push_back( 0 );
+		channels.push_back( 5 );
+		std::vector<double> targets( 2, 1500.0 );
+		Test( controller.Move( channels, targets, 1000.0, 4000.0, DELEGATE( TestServoController, OnDone, bool, this ) ) != 0 );
+		controller.Update( 0.0 );
+		Test( m_Finished == 1 );
+		Test( GetTicks( pBus, 0 ) == GetTicks( pBus, 5 ) );
+		Test( abs( GetTicks( pBus, 0 ) - 307 ) <= 1 );
+
+		// both joints ramp together at the limits, the shorter move stretched to match
+		targets[0] = 2500.0;
+		targets[1] = 1000.0;
+		Test( controller.Move( channels, targets, 1000.0, 4000.0, DELEGATE( TestServoController, OnDone, bool, this ) ) != 0 );
+
+		double time = 0.0, last0 = 1500.0, last5 = 1500.0;
+		bool bTogether = true;
+		while( controller.GetActiveMotions() > 0 && time < 10.0 )
+		{
+			controller.Update( time );
+			double pulse0 = 0.0, pulse5 = 0.0;
+			controller.GetPulse( 0, pulse0 );
+			controller.GetPulse( 5, pulse5 );
+			Test( fabs( pulse0 - last0 ) <= 1000.0 * 0.02 * 1.01 + 0.5 );
+			bTogether &= fabs( (pulse0 - 1500.0) / 1000.0 + (pulse5 - 1500.0) / 500.0 ) < 0.01;
+			last0 = pulse0;
+			last5 = pulse5;
+			time += 0.02;
+		}
+		Test( bTogether );
+		Test( m_Finished == 2 );
+		Test( time > 1.0 && time < 2.0 );
+		Test( abs( GetTicks( pBus, 0 ) - 512 ) <= 1 );
+		Test( abs( GetTicks( pBus, 5 ) - 205 ) <= 1 );
+
+		// holding still costs no bus traffic
+		size_t writes = pBus->GetWrites();
+		for(int i=0;i<50;++i)
+			controller.Update( time + i );
+		Test( pBus->GetWrites() == writes );
+
+		// a second motion takes one channel, the first keeps the other and a cancel stops it
+		std::vector<int> one( 1, 5 );
+		targets[0] = 1500.0;
+		targets[1] = 1500.0;
+		unsigned int first = controller.Move( channels, targets, 1000.0, 4000.0, DELEGATE( TestServoController, OnDone, bool, this ) );
+		unsigned int second = controller.Move( one, std::vector<double>( 1, 2000.0 ), 1000.0, 4000.0, DELEGATE( TestServoController, OnDone, bool, this ) );
+		Test( controller.GetActiveMotions() == 2 );
+		Test( controller.Cancel( first ) );
+		Test( m_Stopped == 1 );
+		Test(! controller.Cancel( first ) );
+		while( controller.GetActiveMotions() > 0 && time < 100.0 )
+		{
+			controller.Update( time );
+			time += 0.02;
+		}
+		Test( m_Finished == 3 );
+		Test( abs( GetTicks( pBus, 5 ) - 410 ) <= 1 );
+		Test( second != first );
+
+		// a bad channel is refused
+		Test( controller.Move( std::vector<int>( 1, 16 ), std::vector<double>( 1, 1500.0 ), 1000.0, 4000.0, DELEGATE( TestServoController, OnDone, bool, this ) ) == 0 );
+
+		// cost of a tick with all 16 channels moving
+		std::vector<int> all;
+		for(int i=0;i<16;++i)
+			all.push_back( i );
+		controller.Move( all, std::vector<double>( 16, 500.0 ), 1000.0, 4000.0, DelegateNone() );
+		const int COUNT = 100;
+		double start = Time().GetEpochTime();
+		for(int i=0;i<COUNT;++i)
+			controller.Update( time + (i * 0.02) );
+		double elapsed = Time().GetEpochTime() - start;
+		Log::Status( "TestServoController", "%.1f us per update of 16 channels, %u register writes", 
+			(elapsed * 1000000.0) / COUNT, (unsigned int)pBus->GetWrites() );
+
+		controller.Stop();
+		Test(! controller.IsStarted() );
+	}
+
+	void OnDone( bool a_bFinished )
+	{
+		if ( a_bFinished )
+			m_Finished += 1;
+		else
+			m_Stopped += 1;
+	}
+
+	static ServoController::DoneCallback DelegateNone()
+	{
+		return ServoController::DoneCallback();
+	}
+
+	static int GetTicks( SimRegisterBus * a_pBus, int a_Channel )
+	{
+		int reg = PCA9685Driver::LED0_ON_L + (4 * a_Channel);
+		return a_pBus->Read( reg + 2 ) | (a_pBus->Read( reg + 3 ) << 8);
+	}
+
+	int		m_Finished;
+	int		m_Stopped;
+};
+
+TestServoController TEST_SERVO_CONTROLLER;
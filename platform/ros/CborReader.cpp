@@ -0,0 +1,334 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "CborReader.h"
+
+#include <string.h>
+#include <math.h>
+
+namespace {
+
+	const int MAX_DEPTH = 64;
+
+	const char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string EncodeBase64( const unsigned char * a_pData, size_t a_Size )
+	{
+		std::string encoded;
+		encoded.reserve( ((a_Size + 2) / 3) * 4 );
+		for(size_t i=0;i<a_Size;i += 3)
+		{
+			unsigned int n = a_pData[i] << 16;
+			if ( i + 1 < a_Size ) n |= a_pData[i + 1] << 8;
+			if ( i + 2 < a_Size ) n |= a_pData[i + 2];
+
+			encoded += BASE64[ (n >> 18) & 0x3f ];
+			encoded += BASE64[ (n >> 12) & 0x3f ];
+			encoded += i + 1 < a_Size ? BASE64[ (n >> 6) & 0x3f ] : '=';
+			encoded += i + 2 < a_Size ? BASE64[ n & 0x3f ] : '=';
+		}
+		return encoded;
+	}
+
+	double HalfToDouble( unsigned int a_Half )
+	{
+		int exponent = (a_Half >> 10) & 0x1f;
+		int mantissa = a_Half & 0x3ff;
+		double value;
+		if ( exponent == 0 )
+			value = ldexp( (double)mantissa, -24 );
+		else if ( exponent != 31 )
+			value = ldexp( (double)(mantissa + 1024), exponent - 25 );
+		else
+			value = mantissa == 0 ? HUGE_VAL : 0.0;
+		return (a_Half & 0x8000) ? -value : value;
+	}
+
+	//! Load an unsigned value of a_Bytes bytes, big or little endian
+	unsigned long long Load( const unsigned char * a_pData, int a_Bytes, bool a_bLittleEndian )
+	{
+		unsigned long long value = 0;
+		for(int i=0;i<a_Bytes;++i)
+			value = (value << 8) | a_pData[ a_bLittleEndian ? a_Bytes - 1 - i : i ];
+		return value;
+	}
+
+	//! Integers get the same types Json::Reader gives them, so decoded messages compare equal
+	Json::Value MakeUnsigned( unsigned long long a_Value )
+	{
+		if ( a_Value <= 2147483647ULL )
+			return Json::Value( (Json::Int)a_Value );
+		if ( a_Value <= 0xffffffffULL )
+			return Json::Value( (Json::UInt)a_Value );
+		return Json::Value( (double)a_Value );
+	}
+
+	Json::Value MakeSigned( long long a_Value )
+	{
+		if ( a_Value >= -2147483647LL - 1 && a_Value <= 2147483647LL )
+			return Json::Value( (Json::Int)a_Value );
+		return Json::Value( (double)a_Value );
+	}
+}
+
+bool CborReader::Parse( const void * a_pData, size_t a_Size, Json::Value & a_Root )
+{
+	CborReader reader( (const unsigned char *)a_pData, a_Size );
+	return reader.ReadItem( a_Root, 0 );
+}
+
+bool CborReader::ReadHeader( int & a_Major, int & a_Info, unsigned long long & a_Argument )
+{
+	if ( m_pData >= m_pEnd )
+		return false;
+
+	unsigned char initial = *m_pData++;
+	a_Major = initial >> 5;
+	a_Info = initial & 0x1f;
+
+	if ( a_Info < 24 )
+		a_Argument = a_Info;
+	else if ( a_Info <= 27 )
+	{
+		int bytes = 1 << (a_Info - 24);
+		if ( m_pEnd - m_pData < bytes )
+			return false;
+		a_Argument = Load( m_pData, bytes, false );
+		m_pData += bytes;
+	}
+	else if ( a_Info == 31 )
+		a_Argument = 0;					// indefinite length, or the break code
+	else
+		return false;
+
+	return true;
+}
+
+bool CborReader::ReadString( int a_Major, int a_Info, unsigned long long a_Length, std::string & a_String )
+{
+	if ( a_Info != 31 )
+	{
+		if ( (unsigned long long)(m_pEnd - m_pData) < a_Length )
+			return false;
+		if ( a_Major == 2 )
+			a_String = EncodeBase64( m_pData, (size_t)a_Length );
+		else
+			a_String.assign( (const char *)m_pData, (size_t)a_Length );
+		m_pData += a_Length;
+		return true;
+	}
+
+	// indefinite length, a list of definite length chunks up to the break code
+	std::string bytes;
+	for(;;)
+	{
+		if ( m_pData >= m_pEnd )
+			return false;
+		if ( *m_pData == 0xff )
+		{
+			m_pData++;
+			break;
+		}
+
+		int major, info;
+		unsigned long long length;
+		if (! ReadHeader( major, info, length ) || major != a_Major || info == 31 
+			|| (unsigned long long)(m_pEnd - m_pData) < length )
+			return false;
+		bytes.append( (const char *)m_pData, (size_t)length );
+		m_pData += length;
+	}
+
+	if ( a_Major == 2 )
+		a_String = EncodeBase64( (const unsigned char *)bytes.data(), bytes.size() );
+	else
+		a_String.swap( bytes );
+	return true;
+}
+
+bool CborReader::ReadTypedArray( int a_Tag, Json::Value & a_Value )
+{
+	int major, info;
+	unsigned long long length;
+	if (! ReadHeader( major, info, length ) || major != 2 || info == 31 
+		|| (unsigned long long)(m_pEnd - m_pData) < length )
+		return false;
+
+	// tag bits are 010 f s e ll, float, signed, little endian and the size
+	bool bFloat = (a_Tag & 0x10) != 0;
+	bool bSigned = (a_Tag & 0x08) != 0;
+	bool bLittleEndian = (a_Tag & 0x04) != 0;
+	int size = bFloat ? (2 << (a_Tag & 0x3)) : (1 << (a_Tag & 0x3));
+	if ( bFloat && size > 8 )
+		return false;
+	if ( length % size != 0 )
+		return false;
+
+	// uint8 arrays are base64 encoded in rosbridge JSON, so keep that here
+	if (! bFloat && size == 1 && !bSigned )
+	{
+		a_Value = EncodeBase64( m_pData, (size_t)length );
+		m_pData += length;
+		return true;
+	}
+
+	size_t count = (size_t)(length / size);
+	a_Value = Json::Value( Json::arrayValue );
+	if ( count > 0 )
+		a_Value.resize( (Json::UInt)count );
+
+	for(size_t i=0;i<count;++i, m_pData += size)
+	{
+		unsigned long long bits = Load( m_pData, size, bLittleEndian );
+		if ( bFloat )
+		{
+			if ( size == 2 )
+				a_Value[(Json::UInt)i] = HalfToDouble( (unsigned int)bits );
+			else if ( size == 4 )
+			{
+				unsigned int word = (unsigned int)bits;
+				float f;
+				memcpy( &f, &word, sizeof(f) );
+				a_Value[(Json::UInt)i] = (double)f;
+			}
+			else
+			{
+				double d;
+				memcpy( &d, &bits, sizeof(d) );
+				a_Value[(Json::UInt)i] = d;
+			}
+		}
+		else if ( bSigned )
+		{
+			// sign extend from the element size
+			int shift = 64 - (size * 8);
+			a_Value[(Json::UInt)i] = MakeSigned( ((long long)(bits << shift)) >> shift );
+		}
+		else
+			a_Value[(Json::UInt)i] = MakeUnsigned( bits );
+	}
+
+	return true;
+}
+
+bool CborReader::ReadItem( Json::Value & a_Value, int a_Depth )
+{
+	if ( a_Depth > MAX_DEPTH )
+		return false;
+
+	int major, info;
+	unsigned long long argument;
+	if (! ReadHeader( major, info, argument ) )
+		return false;
+
+	switch( major )
+	{
+	case 0:
+		a_Value = MakeUnsigned( argument );
+		return true;
+	case 1:
+		if ( argument > 0x7fffffffffffffffULL )
+			a_Value = -1.0 - (double)argument;
+		else
+			a_Value = MakeSigned( -1 - (long long)argument );
+		return true;
+	case 2:
+	case 3:
+		{
+			std::string value;
+			if (! ReadString( major, info, argument, value ) )
+				return false;
+			a_Value = Json::Value( value );
+			return true;
+		}
+	case 4:
+		{
+			a_Value = Json::Value( Json::arrayValue );
+			for(Json::UInt i=0;info == 31 || i < argument;++i)
+			{
+				if ( info == 31 && m_pData < m_pEnd && *m_pData == 0xff )
+				{
+					m_pData++;
+					break;
+				}
+				if (! ReadItem( a_Value[i], a_Depth + 1 ) )
+					return false;
+			}
+			return true;
+		}
+	case 5:
+		{
+			a_Value = Json::Value( Json::objectValue );
+			for(unsigned long long i=0;info == 31 || i < argument;++i)
+			{
+				if ( info == 31 && m_pData < m_pEnd && *m_pData == 0xff )
+				{
+					m_pData++;
+					break;
+				}
+
+				Json::Value key;
+				if (! ReadItem( key, a_Depth + 1 ) )
+					return false;
+				std::string name( key.isString() ? key.asString() : Json::FastWriter().write( key ) );
+				if (! ReadItem( a_Value[name], a_Depth + 1 ) )
+					return false;
+			}
+			return true;
+		}
+	case 6:
+		if ( argument >= 64 && argument <= 87 && argument != 76 )
+			return ReadTypedArray( (int)argument, a_Value );
+		// other tags don't change how the value is presented
+		return ReadItem( a_Value, a_Depth + 1 );
+	case 7:
+		switch( info )
+		{
+		case 20: a_Value = false; return true;
+		case 21: a_Value = true; return true;
+		case 22:
+		case 23: a_Value = Json::Value(); return true;
+		case 25: a_Value = HalfToDouble( (unsigned int)argument ); return true;
+		case 26:
+			{
+				unsigned int word = (unsigned int)argument;
+				float f;
+				memcpy( &f, &word, sizeof(f) );
+				a_Value = (double)f;
+				return true;
+			}
+		case 27:
+			{
+				double d;
+				memcpy( &d, &argument, sizeof(d) );
+				a_Value = d;
+				return true;
+			}
+		}
+		if ( info < 24 || info == 24 )
+		{
+			// unassigned simple values
+			a_Value = Json::Value();
+			return true;
+		}
+		return false;
+	}
+
+	return false;
+}
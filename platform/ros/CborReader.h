@@ -0,0 +1,58 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_CBORREADER_H
+#define SELF_CBORREADER_H
+
+#include <string>
+
+#include "jsoncpp/json/json.h"
+
+//! Decodes CBOR (RFC 7049) into the same Json::Value a rosbridge JSON message would produce, so
+//! subscribers don't care which encoding a topic was subscribed with. Byte strings become base64
+//! strings like rosbridge uses for uint8[] in JSON, typed arrays (RFC 8746) become number arrays.
+//! Every value is still copied into the Json::Value tree, the saving over JSON is in not having to
+//! parse numbers out of text and in the smaller frames.
+class CborReader
+{
+public:
+	//! Decode one CBOR item, returns false if the data is truncated or not valid CBOR.
+	static bool Parse( const void * a_pData, size_t a_Size, Json::Value & a_Root );
+	static bool Parse( const std::string & a_Data, Json::Value & a_Root )
+	{
+		return Parse( a_Data.data(), a_Data.size(), a_Root );
+	}
+
+private:
+	//! Construction
+	CborReader( const unsigned char * a_pData, size_t a_Size ) : 
+		m_pData( a_pData ), m_pEnd( a_pData + a_Size )
+	{}
+
+	//! Data
+	const unsigned char *	m_pData;
+	const unsigned char *	m_pEnd;
+
+	bool ReadItem( Json::Value & a_Value, int a_Depth );
+	bool ReadHeader( int & a_Major, int & a_Info, unsigned long long & a_Argument );
+	bool ReadString( int a_Major, int a_Info, unsigned long long a_Length, std::string & a_String );
+	bool ReadTypedArray( int a_Tag, Json::Value & a_Value );
+};
+
+#endif
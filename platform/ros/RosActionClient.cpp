@@ -0,0 +1,278 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "RosActionClient.h"
+#include "RosPlatform.h"
+#include "utils/Time.h"
+#include "utils/Log.h"
+
+RosActionClient::GoalState RosActionClient::Goal::GetState() const
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_State;
+}
+
+bool RosActionClient::Goal::IsDone() const
+{
+	return IsTerminal( GetState() );
+}
+
+Json::Value RosActionClient::Goal::GetResult() const
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_Result;
+}
+
+void RosActionClient::Goal::OnDone( DoneCallback a_Callback )
+{
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		if (! IsTerminal( m_State ) )
+		{
+			m_DoneCallbacks.push_back( a_Callback );
+			return;
+		}
+	}
+
+	a_Callback( this );
+}
+
+void RosActionClient::Goal::OnFeedback( FeedbackCallback a_Callback )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_FeedbackCallbacks.push_back( a_Callback );
+}
+
+bool RosActionClient::Goal::Wait( float a_fTimeout )
+{
+	boost::unique_lock<boost::mutex> lock( m_Lock );
+	boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds( (long)(a_fTimeout * 1000.0f) );
+	while(! IsTerminal( m_State ) )
+	{
+		if (! m_DoneCondition.timed_wait( lock, deadline ) )
+			return IsTerminal( m_State );
+	}
+	return true;
+}
+
+bool RosActionClient::Goal::SetState( GoalState a_State, const Json::Value & a_Result )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	if ( IsTerminal( m_State ) )
+		return false;
+
+	m_State = a_State;
+	if (! a_Result.isNull() )
+		m_Result = a_Result;
+	if (! IsTerminal( m_State ) )
+		return false;
+
+	m_DoneCondition.notify_all();
+	return true;
+}
+
+void RosActionClient::Goal::SendDone()
+{
+	std::vector<DoneCallback> callbacks;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		callbacks.swap( m_DoneCallbacks );
+		m_FeedbackCallbacks.clear();
+	}
+
+	for(size_t i=0;i<callbacks.size();++i)
+		callbacks[i]( this );
+}
+
+void RosActionClient::Goal::SendFeedback( const Json::Value & a_Feedback )
+{
+	std::vector<FeedbackCallback> callbacks;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		callbacks = m_FeedbackCallbacks;
+	}
+
+	for(size_t i=0;i<callbacks.size();++i)
+		callbacks[i]( a_Feedback );
+}
+
+//--------------------------------------
+
+RosActionClient::RosActionClient( const std::string & a_GoalTopic, const std::string & a_GoalType,
+	const std::string & a_StatusTopic /*= "/goal_status"*/ ) :
+	m_GoalTopic( a_GoalTopic ),
+	m_GoalType( a_GoalType ),
+	m_StatusTopic( a_StatusTopic )
+{
+	RosPlatform::Instance()->Subscribe( m_StatusTopic, "actionlib_msgs/GoalStatusArray",
+		DELEGATE( RosActionClient, OnStatus, const Json::Value &, this ) );
+
+	TimerPool * pTP = TimerPool::Instance();
+	if ( pTP != NULL )
+		m_spTimeoutTimer = pTP->StartTimer( VOID_DELEGATE( RosActionClient, CheckTimeouts, this ), 0.5f, true, true );
+}
+
+RosActionClient::~RosActionClient()
+{
+	m_spTimeoutTimer.reset();
+
+	RosPlatform * pPlatform = RosPlatform::Instance();
+	pPlatform->Unsubscribe( m_StatusTopic, this );
+	if ( m_FeedbackTopic.size() > 0 )
+		pPlatform->Unsubscribe( m_FeedbackTopic, this );
+	if ( m_ResultTopic.size() > 0 )
+		pPlatform->Unsubscribe( m_ResultTopic, this );
+
+	// whoever is waiting on these is going away with us, so no callbacks
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	for( GoalMap::iterator iGoal = m_Goals.begin(); iGoal != m_Goals.end(); ++iGoal )
+		iGoal->second->SetState( LOST, Json::Value() );
+	m_Goals.clear();
+}
+
+void RosActionClient::SetCancelTopic( const std::string & a_Topic )
+{
+	m_CancelTopic = a_Topic;
+}
+
+void RosActionClient::SetFeedbackTopic( const std::string & a_Topic, const std::string & a_Type )
+{
+	m_FeedbackTopic = a_Topic;
+	RosPlatform::Instance()->Subscribe( m_FeedbackTopic, a_Type, 
+		DELEGATE( RosActionClient, OnFeedback, const Json::Value &, this ) );
+}
+
+void RosActionClient::SetResultTopic( const std::string & a_Topic, const std::string & a_Type )
+{
+	m_ResultTopic = a_Topic;
+	RosPlatform::Instance()->Subscribe( m_ResultTopic, a_Type, 
+		DELEGATE( RosActionClient, OnResult, const Json::Value &, this ) );
+}
+
+RosActionClient::GoalSP RosActionClient::SendGoal( const std::string & a_GoalId, const Json::Value & a_Goal, 
+	float a_fTimeout /*= 30.0f*/ )
+{
+	GoalSP spGoal( new Goal( a_GoalId ) );
+	spGoal->m_fDeadline = Time().GetEpochTime() + a_fTimeout;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		m_Goals[ a_GoalId ] = spGoal;
+	}
+
+	RosPlatform::Instance()->Publish( m_GoalTopic, m_GoalType, a_Goal );
+	return spGoal;
+}
+
+void RosActionClient::Cancel( const GoalSP & a_spGoal )
+{
+	if ( m_CancelTopic.size() > 0 )
+	{
+		// the goal finishes when the server reports it preempted or recalled
+		Json::Value json;
+		json["stamp"]["secs"] = 0;
+		json["stamp"]["nsecs"] = 0;
+		json["id"] = a_spGoal->GetId();
+		RosPlatform::Instance()->Publish( m_CancelTopic, "actionlib_msgs/GoalID", json );
+	}
+	else if ( FindGoal( a_spGoal->GetId(), true ) )
+	{
+		if ( a_spGoal->SetState( RECALLED, Json::Value() ) )
+			a_spGoal->SendDone();
+	}
+}
+
+size_t RosActionClient::GetActiveGoals()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_Goals.size();
+}
+
+void RosActionClient::OnStatus( const Json::Value & a_Message )
+{
+	// {"msg": {"status_list": [{"status": 0, "text": "...", "goal_id": {"stamp": {...}, "id": "..."}}]}}
+	const Json::Value & statusList = a_Message["msg"]["status_list"];
+	for( Json::ValueConstIterator iStatus = statusList.begin(); iStatus != statusList.end(); ++iStatus )
+	{
+		const Json::Value & status = *iStatus;
+		GoalState state = (GoalState)status["status"].asInt();
+
+		// with a result topic the goal is done when the result arrives
+		bool bDone = Goal::IsTerminal( state ) && m_ResultTopic.size() == 0;
+		GoalSP spGoal = FindGoal( status["goal_id"]["id"].asString(), bDone );
+		if (! spGoal )
+			continue;
+		if ( spGoal->SetState( bDone ? state : (Goal::IsTerminal( state ) ? ACTIVE : state), status ) )
+			spGoal->SendDone();
+	}
+}
+
+void RosActionClient::OnFeedback( const Json::Value & a_Message )
+{
+	const Json::Value & msg = a_Message["msg"];
+	GoalSP spGoal = FindGoal( msg["status"]["goal_id"]["id"].asString(), false );
+	if ( spGoal )
+		spGoal->SendFeedback( msg["feedback"] );
+}
+
+void RosActionClient::OnResult( const Json::Value & a_Message )
+{
+	const Json::Value & msg = a_Message["msg"];
+	GoalSP spGoal = FindGoal( msg["status"]["goal_id"]["id"].asString(), true );
+	if ( spGoal && spGoal->SetState( (GoalState)msg["status"]["status"].asInt(), msg["result"] ) )
+		spGoal->SendDone();
+}
+
+RosActionClient::GoalSP RosActionClient::FindGoal( const std::string & a_GoalId, bool a_bRemove )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	GoalMap::iterator iGoal = m_Goals.find( a_GoalId );
+	if ( iGoal == m_Goals.end() )
+		return GoalSP();
+
+	GoalSP spGoal = iGoal->second;
+	if ( a_bRemove )
+		m_Goals.erase( iGoal );
+	return spGoal;
+}
+
+void RosActionClient::CheckTimeouts()
+{
+	std::vector<GoalSP> expired;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		double now = Time().GetEpochTime();
+		for( GoalMap::iterator iGoal = m_Goals.begin(); iGoal != m_Goals.end(); )
+		{
+			if ( iGoal->second->m_fDeadline <= now )
+			{
+				expired.push_back( iGoal->second );
+				m_Goals.erase( iGoal++ );
+			}
+			else
+				++iGoal;
+		}
+	}
+
+	for(size_t i=0;i<expired.size();++i)
+	{
+		Log::Warning( "RosActionClient", "Goal %s on %s timed out", expired[i]->GetId().c_str(), m_GoalTopic.c_str() );
+		if ( expired[i]->SetState( LOST, Json::Value() ) )
+			expired[i]->SendDone();
+	}
+}
@@ -0,0 +1,147 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_ROSACTIONCLIENT_H
+#define SELF_ROSACTIONCLIENT_H
+
+#include <map>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "utils/TimerPool.h"
+#include "utils/Delegate.h"
+#include "jsoncpp/json/json.h"
+
+//! Sends goals to a ROS action server through RosPlatform and tracks them from the status topic,
+//! so callers get a callback when a goal finishes instead of holding a thread to wait for it.
+class RosActionClient
+{
+public:
+	//! Types
+	//! actionlib_msgs/GoalStatus
+	enum GoalState
+	{
+		PENDING = 0,
+		ACTIVE = 1,
+		PREEMPTED = 2,
+		SUCCEEDED = 3,
+		ABORTED = 4,
+		REJECTED = 5,
+		PREEMPTING = 6,
+		RECALLING = 7,
+		RECALLED = 8,
+		LOST = 9				// we stopped waiting, the server never finished the goal
+	};
+
+	//! The future for one goal, callbacks are made on the thread that received the status.
+	class Goal
+	{
+	public:
+		typedef Delegate<Goal *>					DoneCallback;
+		typedef Delegate<const Json::Value &>		FeedbackCallback;
+
+		Goal( const std::string & a_Id ) : m_Id( a_Id ), m_State( PENDING ), m_fDeadline( 0.0 )
+		{}
+
+		const std::string & GetId() const
+		{
+			return m_Id;
+		}
+		GoalState GetState() const;
+		bool IsDone() const;
+		//! The result message if there is a result topic, otherwise the last status of the goal.
+		Json::Value GetResult() const;
+
+		//! Call a_Callback once the goal is done, right away if it already is.
+		void OnDone( DoneCallback a_Callback );
+		void OnFeedback( FeedbackCallback a_Callback );
+		//! Block until the goal is done, returns false on timeout.
+		bool Wait( float a_fTimeout );
+
+		static bool IsTerminal( GoalState a_State )
+		{
+			return a_State == PREEMPTED || a_State == SUCCEEDED || a_State == ABORTED 
+				|| a_State == REJECTED || a_State == RECALLED || a_State == LOST;
+		}
+
+	private:
+		friend class RosActionClient;
+
+		//! Data
+		mutable boost::mutex			m_Lock;
+		boost::condition_variable		m_DoneCondition;
+		std::string						m_Id;
+		GoalState						m_State;
+		Json::Value						m_Result;
+		double							m_fDeadline;
+		std::vector<DoneCallback>		m_DoneCallbacks;
+		std::vector<FeedbackCallback>	m_FeedbackCallbacks;
+
+		//! Returns true if this made the goal done, the caller then invokes the done callbacks
+		bool SetState( GoalState a_State, const Json::Value & a_Result );
+		void SendDone();
+		void SendFeedback( const Json::Value & a_Feedback );
+	};
+	typedef boost::shared_ptr<Goal>		GoalSP;
+
+	//! Construction
+	RosActionClient( const std::string & a_GoalTopic, const std::string & a_GoalType,
+		const std::string & a_StatusTopic = "/goal_status" );
+	~RosActionClient();
+
+	//! Optional topics of a full actionlib server, without a cancel topic a cancelled goal is
+	//! just no longer tracked.
+	void SetCancelTopic( const std::string & a_Topic );
+	void SetFeedbackTopic( const std::string & a_Topic, const std::string & a_Type );
+	void SetResultTopic( const std::string & a_Topic, const std::string & a_Type );
+
+	//! Publish a goal, a_GoalId is the id the server reports the goal's status with. If the goal
+	//! isn't done after a_fTimeout seconds it finishes as LOST.
+	GoalSP SendGoal( const std::string & a_GoalId, const Json::Value & a_Goal, float a_fTimeout = 30.0f );
+	void Cancel( const GoalSP & a_spGoal );
+	//! Number of goals still in flight
+	size_t GetActiveGoals();
+
+	//! Topic handlers
+	void OnStatus( const Json::Value & a_Message );
+	void OnFeedback( const Json::Value & a_Message );
+	void OnResult( const Json::Value & a_Message );
+
+private:
+	//! Types
+	typedef std::map<std::string,GoalSP>	GoalMap;
+
+	//! Data
+	std::string				m_GoalTopic;
+	std::string				m_GoalType;
+	std::string				m_StatusTopic;
+	std::string				m_CancelTopic;
+	std::string				m_FeedbackTopic;
+	std::string				m_ResultTopic;
+	boost::mutex			m_Lock;
+	GoalMap					m_Goals;
+	TimerPool::ITimer::SP	m_spTimeoutTimer;
+
+	GoalSP FindGoal( const std::string & a_GoalId, bool a_bRemove );
+	void CheckTimeouts();
+};
+
+#endif
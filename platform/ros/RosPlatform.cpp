@@ -17,7 +17,9 @@
 
 
 #include "RosPlatform.h"
+#include "CborReader.h"
 #include "utils/StringUtil.h"
+#include "utils/Time.h"
 
 RosPlatform * RosPlatform::sm_pInstance = NULL;
 
@@ -32,16 +34,21 @@ RosPlatform * RosPlatform::Instance()
 }
 
 RosPlatform::RosPlatform( const std::string & a_URL /*= ""*/ )
-    : m_URL(a_URL), m_fReconnectInterval(5.0f), m_bActive(false), m_Counter(0)
+    : m_URL(a_URL), m_fReconnectInterval(5.0f), m_fReleaseDelay(10.0f), m_bActive(false), m_Counter(0), 
+    m_spTopics(new TopicMap()), m_SubCounter(0)
 {
     Log::Debug("RosPlatform", "Instantiating Ros Platform");
     sm_pInstance = this;
 
-    SelfInstance * pInstance = SelfInstance::GetInstance();
-    if ( pInstance == NULL )
-        m_URL = "ws://192.168.1.89:9090";
-    else
-        m_URL = pInstance->GetLocalConfig().m_RobotUrl;
+    // a url passed in wins over the robot url from the config
+    if ( m_URL.size() == 0 )
+    {
+        SelfInstance * pInstance = SelfInstance::GetInstance();
+        if ( pInstance == NULL )
+            m_URL = "ws://192.168.1.89:9090";
+        else
+            m_URL = pInstance->GetLocalConfig().m_RobotUrl;
+    }
 
     StringUtil::Replace(m_URL, "https://", "ws://", true );
     StringUtil::Replace(m_URL, "http://", "ws://", true );
@@ -52,6 +59,8 @@ RosPlatform::RosPlatform( const std::string & a_URL /*= ""*/ )
     {
         m_spReconnectTimer = pTP->StartTimer(
                 VOID_DELEGATE( RosPlatform, ConnectToRobot, this ), m_fReconnectInterval, true, true );
+        m_spReleaseTimer = pTP->StartTimer(
+                VOID_DELEGATE( RosPlatform, ReleaseTopics, this ), m_fReleaseDelay * 0.5f, true, true );
     }
 
     // go ahead and try to connect now..
@@ -66,6 +75,7 @@ RosPlatform::~RosPlatform()
         m_spWebClient->Shutdown();
 
     m_spReconnectTimer.reset();
+    m_spReleaseTimer.reset();
 }
 
 void RosPlatform::ConnectToRobot()
@@ -84,7 +94,15 @@ void RosPlatform::ConnectToRobot()
 		{
 			Log::Error("RosPlatform", "Send() return false.");
 			m_bActive = false;
+			return;
 		}
+
+		// a new connection to rosbridge has none of our subscriptions or advertisements
+		m_Advertisements.clear();
+
+		boost::lock_guard<boost::mutex> lock(m_SubscriptionLock);
+		for (TopicMap::const_iterator iTopic = m_spTopics->begin(); iTopic != m_spTopics->end(); ++iTopic)
+			SendSubscribe(*iTopic->second);
 	}
 }
 
@@ -120,8 +138,10 @@ bool RosPlatform::Publish(
     json["id"] = publishId;
     json["topic"] = a_TopicId;
     json["msg"] = a_Data;
-    Log::Debug("RosPlatform", "Sending Publish: %s", Json::FastWriter().write( json ).c_str());
-    m_spWebClient->SendText( Json::FastWriter().write( json ) );
+
+    std::string text( Json::FastWriter().write( json ) );
+    Log::DebugLow("RosPlatform", "Sending Publish: %s", text.c_str());
+    m_spWebClient->SendText( text );
 
     return true;
 }
@@ -148,95 +168,214 @@ bool RosPlatform::Subscribe(
         const std::string & a_Message,
         Delegate<const Json::Value &> a_Callback)
 {
+	return Subscribe( a_Path, a_Message, a_Callback, SubscribeOptions() );
+}
+
+bool RosPlatform::Subscribe(
+        const std::string & a_Path,
+        const std::string & a_Message,
+        Delegate<const Json::Value &> a_Callback,
+        const SubscribeOptions & a_Options)
+{
+	SubscribeOptions options( a_Options );
+	if ( options.m_Compression != "none" && options.m_Compression != "cbor" )
+	{
+		// png arrives as an image holding the JSON text, that costs more to decode than it saves here
+		Log::Warning("RosPlatform", "Unsupported compression %s for %s, using none", options.m_Compression.c_str(), a_Path.c_str());
+		options.m_Compression = "none";
+	}
+
 	boost::lock_guard<boost::mutex> lock(m_SubscriptionLock);
-	Subscription sub;
-	sub.m_Handler = a_Callback;
-	sub.m_TopicId = a_Path;
-	sub.m_SubId = UniqueID().Get();
-  
-	Json::Value json;
-    json["op"] = "subscribe";
-    json["id"] = sub.m_SubId;
-    json["type"] = a_Message;
-    json["topic"] = a_Path;
-    json["compression"] = "none";
-    json["throttle_rate"] = 0;
 
-    m_spWebClient->SendText( Json::FastWriter().write( json ) );
-	m_SubscriptionMap.insert(SubscriptionMap::value_type(a_Path, sub));
+	TopicSP spTopic;
+	TopicMap::const_iterator iTopic = m_spTopics->find(a_Path);
+	if (iTopic != m_spTopics->end())
+	{
+		// already subscribed with rosbridge, or still waiting to be released
+		spTopic = iTopic->second;
+		if (spTopic->m_Type != a_Message || spTopic->m_Options.m_Compression != options.m_Compression)
+			Log::Warning("RosPlatform", "%s is already subscribed as %s", a_Path.c_str(), spTopic->m_Type.c_str());
+	}
+	else
+	{
+		spTopic.reset(new Topic());
+		spTopic->m_Name = a_Path;
+		spTopic->m_Type = a_Message;
+		spTopic->m_SubId = StringUtil::Format("subscribe: %s: %u", a_Path.c_str(), m_SubCounter++);
+		spTopic->m_Options = options;
+		spTopic->m_spSubscribers.reset(new SubscriberList());
+
+		boost::shared_ptr<TopicMap> spTopics(new TopicMap(*m_spTopics));
+		(*spTopics)[a_Path] = spTopic;
+		boost::atomic_store(&m_spTopics, TopicMapSP(spTopics));
+
+		SendSubscribe(*spTopic);
+	}
+
+	boost::shared_ptr<SubscriberList> spSubscribers(new SubscriberList(*spTopic->m_spSubscribers));
+	spSubscribers->push_back(SubscriberSP(new Subscriber(a_Callback)));
+	boost::atomic_store(&spTopic->m_spSubscribers, SubscriberListSP(spSubscribers));
+	spTopic->m_ReleaseTime = 0.0;
 
 	return true;
 }
 
 bool RosPlatform::Unsubscribe( const std::string & a_Path, void * a_pObject  )
 {
-	boost::lock_guard<boost::mutex> lock(m_SubscriptionLock);
-	SubscriptionMap::iterator iSub = m_SubscriptionMap.find(a_Path);
-	while (iSub == m_SubscriptionMap.end())
+	SubscriberSP spRemoved;
 	{
-		if (iSub->first != a_Path)
-			break;
-		if (iSub->second.m_Handler.IsObject(a_pObject))
+		boost::lock_guard<boost::mutex> lock(m_SubscriptionLock);
+		TopicMap::const_iterator iTopic = m_spTopics->find(a_Path);
+		if (iTopic == m_spTopics->end())
+			return false;
+
+		TopicSP spTopic = iTopic->second;
+		boost::shared_ptr<SubscriberList> spSubscribers(new SubscriberList(*spTopic->m_spSubscribers));
+		for (SubscriberList::iterator iSub = spSubscribers->begin(); iSub != spSubscribers->end(); ++iSub)
 		{
-			Json::Value json;
-			json["op"] = "unsubscribe";
-			json["id"] = iSub->second.m_SubId;
-			json["topic"] = iSub->second.m_TopicId;
-
-			m_spWebClient->SendText(Json::FastWriter().write(json));
-			m_SubscriptionMap.erase(iSub);
-			return true;
+			if ((*iSub)->m_Handler.IsObject(a_pObject))
+			{
+				spRemoved = *iSub;
+				spSubscribers->erase(iSub);
+				break;
+			}
 		}
+		if (! spRemoved )
+			return false;
+
+		boost::atomic_store(&spTopic->m_spSubscribers, SubscriberListSP(spSubscribers));
+
+		// keep the rosbridge subscription for a while, the next gesture usually subscribes again
+		if (spSubscribers->size() == 0)
+			spTopic->m_ReleaseTime = Time().GetEpochTime() + m_fReleaseDelay;
+	}
+
+	// wait out dispatches already calling this handler, except the one calling us
+	boost::thread::id self = boost::this_thread::get_id();
+	boost::unique_lock<boost::mutex> lock(spRemoved->m_Lock);
+	spRemoved->m_bActive = false;
+	while (spRemoved->IsCalled(self))
+		spRemoved->m_Idle.wait(lock);
+
+    return true;
+}
+
+void RosPlatform::SendSubscribe(const Topic & a_Topic)
+{
+	Json::Value json;
+    json["op"] = "subscribe";
+    json["id"] = a_Topic.m_SubId;
+    json["type"] = a_Topic.m_Type;
+    json["topic"] = a_Topic.m_Name;
+    json["compression"] = a_Topic.m_Options.m_Compression;
+    json["throttle_rate"] = a_Topic.m_Options.m_ThrottleRate;
+    if ( a_Topic.m_Options.m_QueueLength > 0 )
+        json["queue_length"] = a_Topic.m_Options.m_QueueLength;
+
+    m_spWebClient->SendText( Json::FastWriter().write( json ) );
+}
+
+void RosPlatform::SendUnsubscribe(const Topic & a_Topic)
+{
+	Json::Value json;
+	json["op"] = "unsubscribe";
+	json["id"] = a_Topic.m_SubId;
+	json["topic"] = a_Topic.m_Name;
+
+	m_spWebClient->SendText(Json::FastWriter().write(json));
+}
 
-		++iSub;
+void RosPlatform::ReleaseTopics()
+{
+	boost::lock_guard<boost::mutex> lock(m_SubscriptionLock);
+
+	double now = Time().GetEpochTime();
+	boost::shared_ptr<TopicMap> spTopics;
+	for (TopicMap::const_iterator iTopic = m_spTopics->begin(); iTopic != m_spTopics->end(); ++iTopic)
+	{
+		const Topic & topic = *iTopic->second;
+		if (topic.m_spSubscribers->size() > 0 || topic.m_ReleaseTime > now)
+			continue;
+
+		Log::Debug("RosPlatform", "Unsubscribing from %s", topic.m_Name.c_str());
+		SendUnsubscribe(topic);
+
+		if (! spTopics )
+			spTopics.reset(new TopicMap(*m_spTopics));
+		spTopics->erase(iTopic->first);
 	}
 
-    return false;
+	if ( spTopics )
+		boost::atomic_store(&m_spTopics, TopicMapSP(spTopics));
 }
 
 void RosPlatform::OnFrame(IWebSocket::FrameSP a_spFrame)
 {
+	Json::Value root;
 	if (a_spFrame->m_Op == IWebSocket::TEXT_FRAME)
 	{
-		Log::Debug("RosPlatform", "Received text frame: %s", a_spFrame->m_Data.c_str());
-
-		Json::Value root;
 		Json::Reader reader( Json::Features::strictMode() );
-		if (reader.parse(a_spFrame->m_Data, root))
+		if (! reader.parse(a_spFrame->m_Data, root, false) )
 		{
-			if (root.isMember("topic"))
-			{
-				// {"topic": "/goal_status", "msg" : {"header": {"stamp": {"secs": 1467044592, "nsecs" : 175644067}, "frame_id" : "TrajectoryManager", "seq" : 298}, "status_list" : [{"status": 0, "text" : "Joint trajectory received at follower.", "goal_id" : {"stamp": {"secs": 0, "nsecs" : 0}, "id" : "b2ba1b51-6ae9-4550-ad3b-86f01979a17b"}}]}, "op" : "publish"}
-				const std::string & topic = root["topic"].asString();
-
-				boost::lock_guard<boost::mutex> lock(m_SubscriptionLock);
-				SubscriptionMap::iterator iSub = m_SubscriptionMap.find(topic);
-				if (iSub != m_SubscriptionMap.end())
-				{
-					while (iSub != m_SubscriptionMap.end())
-					{
-						if (iSub->first != topic)
-							break;
-
-						// invoke the handler
-						(*iSub).second.m_Handler(root);
-						++iSub;
-					}
-				}
-				else
-				{
-					Log::Warning("RosPlatform", "Unhandled topic %s", topic.c_str());
-				}
-			}
+			Log::Error("RosPlatform", "Failed to parse json: %s", a_spFrame->m_Data.c_str());
+			return;
 		}
-		else
+	}
+	else if (a_spFrame->m_Op == IWebSocket::BINARY_FRAME)
+	{
+		// topics subscribed with cbor compression arrive as binary frames
+		if (! CborReader::Parse(a_spFrame->m_Data, root) )
 		{
-			Log::Error("RosPLatform", "Failed to parse json: %s", a_spFrame->m_Data.c_str());
+			Log::Error("RosPlatform", "Failed to parse cbor frame of %u bytes", (unsigned int)a_spFrame->m_Data.size());
+			return;
 		}
 	}
 	else
 	{
 		Log::Debug("RosPlatform", "Unhanded web frame %d", (int)a_spFrame->m_Op);
+		return;
 	}
+
+	Dispatch(root);
 }
 
+void RosPlatform::Dispatch(const Json::Value & a_Message)
+{
+	if (! a_Message.isMember("topic") )
+		return;
+
+	// {"topic": "/goal_status", "msg" : {"header": {"stamp": {"secs": 1467044592, "nsecs" : 175644067}, "frame_id" : "TrajectoryManager", "seq" : 298}, "status_list" : [{"status": 0, "text" : "Joint trajectory received at follower.", "goal_id" : {"stamp": {"secs": 0, "nsecs" : 0}, "id" : "b2ba1b51-6ae9-4550-ad3b-86f01979a17b"}}]}, "op" : "publish"}
+	const std::string & topic = a_Message["topic"].asString();
+
+	// no lock is held while the handlers run, so they are free to subscribe, unsubscribe or take their time
+	TopicMapSP spTopics = boost::atomic_load(&m_spTopics);
+	TopicMap::const_iterator iTopic = spTopics->find(topic);
+	if (iTopic == spTopics->end())
+	{
+		Log::Warning("RosPlatform", "Unhandled topic %s", topic.c_str());
+		return;
+	}
+
+	SubscriberListSP spSubscribers = boost::atomic_load(&iTopic->second->m_spSubscribers);
+	boost::thread::id self = boost::this_thread::get_id();
+	for (SubscriberList::const_iterator iSub = spSubscribers->begin(); iSub != spSubscribers->end(); ++iSub)
+	{
+		Subscriber & sub = **iSub;
+
+		// the handler is copied out and called without the lock, Unsubscribe waits on m_Callers instead
+		MessageHandler handler;
+		{
+			boost::lock_guard<boost::mutex> lock(sub.m_Lock);
+			if (! sub.m_bActive )
+				continue;
+			handler = sub.m_Handler;
+			sub.m_Callers.push_back(self);
+		}
+
+		handler(a_Message);
+
+		boost::lock_guard<boost::mutex> lock(sub.m_Lock);
+		sub.m_Callers.erase(std::find(sub.m_Callers.begin(), sub.m_Callers.end(), self));
+		sub.m_Idle.notify_all();
+	}
+}
@@ -20,6 +20,7 @@
 #define SELF_ROSPLATFORM_H
 
 #include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "utils/TimerPool.h"
 #include "utils/IWebClient.h"
@@ -29,6 +30,19 @@
 class RosPlatform
 {
 public:
+    //! Types
+    //! How rosbridge should deliver a topic, see the rosbridge subscribe op.
+    struct SubscribeOptions
+    {
+        SubscribeOptions( const std::string & a_Compression = "none", int a_ThrottleRate = 0, int a_QueueLength = 0 ) :
+            m_Compression( a_Compression ), m_ThrottleRate( a_ThrottleRate ), m_QueueLength( a_QueueLength )
+        {}
+
+        std::string     m_Compression;      // none or cbor, cbor messages arrive as binary frames
+        int             m_ThrottleRate;     // minimum milliseconds between messages, 0 for every message
+        int             m_QueueLength;      // messages rosbridge may queue while throttling
+    };
+
     static RosPlatform * Instance();
 
     //! Construction
@@ -40,6 +54,8 @@ public:
     bool    Publish(const std::string & a_TopicId, const std::string & a_Message, const Json::Value & a_Data);
     void    Advertise( const std::string & a_TopicId, const std::string & a_Message);
     bool	Subscribe(const std::string & a_Path, const std::string & a_Message, Delegate<const Json::Value &> a_Callback);
+    bool	Subscribe(const std::string & a_Path, const std::string & a_Message, Delegate<const Json::Value &> a_Callback,
+                const SubscribeOptions & a_Options);
     bool    Unsubscribe( const std::string & a_Path, void * a_pObject );
 
     bool IsConnected()
@@ -47,32 +63,76 @@ public:
         return m_bActive;
     }
 
+	//! Callbacks
+	void	OnFrame(IWebSocket::FrameSP a_spFrame);
+
 private:
 
     //! Types
     typedef Delegate<const Json::Value &>			MessageHandler;
-	struct Subscription
+	struct Subscriber
 	{
-		MessageHandler	m_Handler;
-		std::string		m_TopicId;
-		std::string		m_SubId;
+		Subscriber( const MessageHandler & a_Handler ) : m_Handler( a_Handler ), m_bActive( true )
+		{}
+
+		MessageHandler					m_Handler;
+		bool							m_bActive;
+		std::vector<boost::thread::id>	m_Callers;		// threads running a copy of the handler right now
+		boost::mutex					m_Lock;			// only held to read or change the members above
+		boost::condition_variable		m_Idle;			// signaled each time a call returns
+
+		//! True if a thread other than a_Self is running the handler
+		bool IsCalled( const boost::thread::id & a_Self ) const
+		{
+			for (size_t i = 0; i < m_Callers.size(); ++i)
+				if (m_Callers[i] != a_Self)
+					return true;
+			return false;
+		}
+	};
+	typedef boost::shared_ptr<Subscriber>				SubscriberSP;
+	typedef std::vector<SubscriberSP>					SubscriberList;
+	typedef boost::shared_ptr<const SubscriberList>		SubscriberListSP;
+
+	//! One rosbridge subscription, shared by everyone subscribed to the topic. The subscriber list
+	//! is replaced rather than modified, so OnFrame can dispatch from a snapshot without a lock.
+	struct Topic
+	{
+		Topic() : m_ReleaseTime( 0.0 )
+		{}
+
+		std::string			m_Name;
+		std::string			m_Type;
+		std::string			m_SubId;
+		SubscribeOptions	m_Options;
+		SubscriberListSP	m_spSubscribers;
+		double				m_ReleaseTime;		// when the rosbridge subscription is dropped if nobody subscribes again
 	};
-	typedef std::multimap<std::string, Subscription>		SubscriptionMap;
+	typedef boost::shared_ptr<Topic>					TopicSP;
+	typedef std::map<std::string, TopicSP>				TopicMap;
+	typedef boost::shared_ptr<const TopicMap>			TopicMapSP;
 	
     TimerPool::ITimer::SP                       m_spReconnectTimer;
+    TimerPool::ITimer::SP                       m_spReleaseTimer;
     IWebClient::SP	                            m_spWebClient;
     std::vector<std::string>                    m_IdMap;
     std::vector<std::string>                    m_Advertisements;
     float			                            m_fReconnectInterval;
+    float			                            m_fReleaseDelay;
     std::string                                 m_URL;
     bool			                            m_bActive;
     int                                         m_Counter;
-	SubscriptionMap								m_SubscriptionMap;
+	TopicMapSP									m_spTopics;			// replaced under m_SubscriptionLock
+	unsigned int								m_SubCounter;		// keeps each rosbridge subscription id unique
 	boost::mutex								m_SubscriptionLock;
 
+	void SendSubscribe(const Topic & a_Topic);
+	void SendUnsubscribe(const Topic & a_Topic);
+	//! Drop the rosbridge subscriptions that nobody has used for m_fReleaseDelay
+	void ReleaseTopics();
     void HandleSubscribe(const Json::Value & a_Message);
     void HandlePublish(const Json::Value & a_Message);
-	void OnFrame(IWebSocket::FrameSP a_spFrame);
+	void Dispatch(const Json::Value & a_Message);
 
     static RosPlatform * sm_pInstance;
 
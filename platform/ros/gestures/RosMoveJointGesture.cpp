@@ -16,106 +16,239 @@
 */
 
 
+
 #include "RosPlatform.h"
 #include "RosMoveJointGesture.h"
 #include "utils/ThreadPool.h"
+#include "utils/StringUtil.h"
 #include "SelfInstance.h"
 
-#include <boost/thread.hpp>
-
 REG_OVERRIDE_SERIALIZABLE(MoveJointGesture, RosMoveJointGesture);
 RTTI_IMPL(RosMoveJointGesture, MoveJointGesture);
 
 const float TIMEOUT = 30.0f;
 
+RosMoveJointGesture::PositionMap RosMoveJointGesture::sm_Commanded;
+
+RosMoveJointGesture::~RosMoveJointGesture()
+{
+	m_Streamer.Stop();
+	if ( m_spClient && RosPlatform::Instance() != NULL )
+		RosPlatform::Instance()->Unsubscribe( "/joint_states", this );
+}
+
+void RosMoveJointGesture::Serialize(Json::Value & json)
+{
+	MoveJointGesture::Serialize(json);
+	json["m_fMaxVelocity"] = m_fMaxVelocity;
+	json["m_fMaxAcceleration"] = m_fMaxAcceleration;
+	json["m_fSampleTime"] = m_fSampleTime;
+	json["m_fWindow"] = m_fWindow;
+	json["m_fLookahead"] = m_fLookahead;
+}
+
+void RosMoveJointGesture::Deserialize(const Json::Value & json)
+{
+	MoveJointGesture::Deserialize(json);
+	if ( json.isMember("m_fMaxVelocity") )
+		m_fMaxVelocity = json["m_fMaxVelocity"].asDouble();
+	if ( json.isMember("m_fMaxAcceleration") )
+		m_fMaxAcceleration = json["m_fMaxAcceleration"].asDouble();
+	if ( json.isMember("m_fSampleTime") )
+		m_fSampleTime = json["m_fSampleTime"].asDouble();
+	if ( json.isMember("m_fWindow") )
+		m_fWindow = json["m_fWindow"].asDouble();
+	if ( json.isMember("m_fLookahead") )
+		m_fLookahead = json["m_fLookahead"].asDouble();
+}
+
 bool RosMoveJointGesture::Execute(GestureDelegate a_Callback, const ParamsMap & a_Params)
 {
+    if (! m_spClient )
+	{
+        m_spClient.reset( new RosActionClient( "/joint_refs", "r2_msgs/LabeledJointTrajectory", "/goal_status" ) );
+		RosPlatform::Instance()->Subscribe( "/joint_states", "sensor_msgs/JointState",
+			DELEGATE( RosMoveJointGesture, OnJointStates, const Json::Value &, this ), 
+			RosPlatform::SubscribeOptions( "none", 100 ) );
+	}
+
     if ( PushRequest( a_Callback, a_Params ) )
-        ThreadPool::Instance()->InvokeOnThread(VOID_DELEGATE(RosMoveJointGesture, MoveThread, this));
+        StartMove();
     return true;
 }
 
-void RosMoveJointGesture::MoveThread()
+bool RosMoveJointGesture::Abort()
 {
-    try {
-        DoMoveThread();
-    }
-    catch( const std::exception & ex )
-    {
-        Log::Error( "RosMoveJointGesture", "Caught Exception: %s", ex.what() );
-		ActiveRequest()->m_bError = true;
-    }
+    // the trajectory follower has no cancel topic, so we stop streaming and stop waiting for it
+	m_Streamer.Stop();
+	FinishMove();
+	for(size_t i=0;i<m_Goals.size();++i)
+		m_spClient->Cancel( m_Goals[i] );
+    return true;
+}
 
-	// now invoke the main thread to notify them the move is completed..
-	ThreadPool::Instance()->InvokeOnMain(VOID_DELEGATE(RosMoveJointGesture, MoveDone, this));
+void RosMoveJointGesture::StartMove()
+{
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		m_GoalId = UniqueID().Get();
+		m_LastGoalId.clear();
+		m_bMoving = true;
+	}
+
+	TrajectoryStreamer::Window window;
+	window.m_bLast = true;
+
+	std::vector<double> start;
+	if ( GetStart( start ) )
+	{
+		std::vector<double> target;
+		for (size_t i = 0; i < m_JointNames.size(); i++)
+			target.push_back( m_fAngles[i] );
+
+		JointTrajectory trajectory;
+		trajectory.SetLimits( m_fMaxVelocity, m_fMaxAcceleration );
+		trajectory.SetStart( start );
+		trajectory.AddWaypoint( target );
+		if ( trajectory.Plan( m_fSampleTime ) )
+		{
+			for (size_t i = 0; i < m_JointNames.size(); i++)
+				sm_Commanded[ m_JointNames[i] ] = m_fAngles[i];
+			m_Streamer.Start( trajectory, m_fWindow, m_fLookahead, 
+				DELEGATE( RosMoveJointGesture, OnWindow, const TrajectoryStreamer::Window &, this ) );
+			return;
+		}
+	}
+
+	// we don't know where the joints are, so let the follower take them straight to the target
+	JointTrajectory::Point point;
+	for (size_t i = 0; i < m_JointNames.size(); i++)
+	{
+		point.m_Positions.push_back( m_fAngles[i] );
+		point.m_Velocities.push_back( 0.0 );
+		point.m_Accelerations.push_back( 0.0 );
+		sm_Commanded[ m_JointNames[i] ] = m_fAngles[i];
+	}
+	window.m_Points.push_back( point );
+	OnWindow( window );
 }
 
-void RosMoveJointGesture::DoMoveThread()
+bool RosMoveJointGesture::GetStart( std::vector<double> & a_Start )
 {
-	RosPlatform::Instance()->Subscribe("/goal_status", "actionlib_msgs/GoalStatusArray",
-		DELEGATE(RosMoveJointGesture, OnGoalStatus, const Json::Value &, this));
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+
+	a_Start.clear();
+	for (size_t i = 0; i < m_JointNames.size(); i++)
+	{
+		PositionMap::const_iterator iJoint = m_JointStates.find( m_JointNames[i] );
+		if ( iJoint == m_JointStates.end() )
+		{
+			iJoint = sm_Commanded.find( m_JointNames[i] );
+			if ( iJoint == sm_Commanded.end() )
+				return false;
+		}
+		a_Start.push_back( iJoint->second );
+	}
+	return true;
+}
 
-	m_GoalId = UniqueID().Get();
-	m_GoalDone = false;
+void RosMoveJointGesture::OnWindow( const TrajectoryStreamer::Window & a_Window )
+{
+	std::string goalId;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		if (! m_bMoving )
+			return;
+		goalId = StringUtil::Format( "%s:%u", m_GoalId.c_str(), (unsigned int)a_Window.m_Index );
+		if ( a_Window.m_bLast )
+			m_LastGoalId = goalId;
+	}
 
     Json::Value json;
     json["originator"] = "c5console";
-    json["header"]["seq"] = 0;
-    json["header"]["frame_id"] = m_GoalId;
+    json["header"]["seq"] = (Json::UInt)a_Window.m_Index;
+    json["header"]["frame_id"] = goalId;
     json["header"]["stamp"]["secs"] = 0;
     json["header"]["stamp"]["nsecs"] = 0;
 	for (size_t i = 0; i < m_JointNames.size(); i++)
-	{
 		json["joint_names"][i] = m_JointNames[i];
-		json["points"][0]["positions"][i] = m_fAngles[i];
-		json["points"][0]["velocities"][i] = 0;
-		json["points"][0]["accelerations"][i] = 0;
-	}
-    json["points"][0]["time_from_start"]["secs"] = 0;
-    json["points"][0]["time_from_start"]["nsecs"] = 0;
-    Log::Debug("RosMoveJointGesture", "Sending Command: %s", Json::FastWriter().write( json ).c_str() );
-    RosPlatform::Instance()->Publish("/joint_refs", "r2_msgs/LabeledJointTrajectory", json); 
 
-	m_spWaitTimer = TimerPool::Instance()->StartTimer(VOID_DELEGATE(RosMoveJointGesture, OnTimeout, this), TIMEOUT, true, false);
-	while (!m_GoalDone) 
-		boost::this_thread::sleep(boost::posix_time::milliseconds(100));
-	m_spWaitTimer.reset();
+	// each goal replaces the last one on the follower, so it carries the whole window plus the lookahead
+	double duration = 0.0;
+	for (size_t p = 0; p < a_Window.m_Points.size(); p++)
+	{
+		const JointTrajectory::Point & point = a_Window.m_Points[p];
+		Json::Value & jpoint = json["points"][(Json::ArrayIndex)p];
+		for (size_t i = 0; i < point.m_Positions.size(); i++)
+		{
+			jpoint["positions"][(Json::ArrayIndex)i] = point.m_Positions[i];
+			jpoint["velocities"][(Json::ArrayIndex)i] = point.m_Velocities[i];
+			jpoint["accelerations"][(Json::ArrayIndex)i] = point.m_Accelerations[i];
+		}
+
+		int secs = (int)point.m_fTime;
+		jpoint["time_from_start"]["secs"] = secs;
+		jpoint["time_from_start"]["nsecs"] = (int)((point.m_fTime - secs) * 1000000000.0);
+		duration = point.m_fTime;
+	}
+    Log::Debug("RosMoveJointGesture", "Sending window %u of %s, %u points", 
+		(unsigned int)a_Window.m_Index, m_GoalId.c_str(), (unsigned int)a_Window.m_Points.size() );
 
-	RosPlatform::Instance()->Unsubscribe("/goal_status", this );
+	// nothing waits for the move, OnGoalDone is called when /goal_status reports it done or it times out
+	RosActionClient::GoalSP spGoal = m_spClient->SendGoal( goalId, json, TIMEOUT + (float)duration );
+	m_Goals.push_back( spGoal );
+	spGoal->OnDone( DELEGATE( RosMoveJointGesture, OnGoalDone, RosActionClient::Goal *, this ) );
 }
 
-void RosMoveJointGesture::OnGoalStatus(const Json::Value & a_response)
+void RosMoveJointGesture::OnGoalDone( RosActionClient::Goal * a_pGoal )
 {
-	//Log::Status("RosMoveJointGesture", "Goal Status: %s", a_response.toStyledString().c_str());
-	if (a_response.isMember("msg"))
+	RosActionClient::GoalState state = a_pGoal->GetState();
+	const std::string & goalId = a_pGoal->GetId();
+
 	{
-		const Json::Value & msg = a_response["msg"];
-		if (msg.isMember("status_list"))
-		{
-			const Json::Value & status_list = msg["status_list"];
-			for (size_t i = 0; i < status_list.size(); ++i)
-			{
-				const Json::Value & status = status_list[i];
-				if (!status.isMember("goal_id"))
-					continue;
-				if (status["goal_id"]["id"].asString() != m_GoalId)
-					continue;
-				int result = status["status"].asInt();
-				Log::Status("RosMoveJointGresture", "Joint %s status %d", m_GestureId.c_str(), result);
-				if (result >= 3)
-					m_GoalDone = true;
-			}
-		}
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		if (! m_bMoving || goalId.compare( 0, m_GoalId.size(), m_GoalId ) != 0 )
+			return;		// from a move that is already over
+		// the follower reports each window replaced by the next one as ABORTED or PREEMPTED, 
+		// so only the last window ends the move and decides if it succeeded
+		if ( goalId != m_LastGoalId )
+			return;
 	}
+
+	Log::Status("RosMoveJointGesture", "Joint %s status %d", m_GestureId.c_str(), (int)state);
+	if ( state != RosActionClient::SUCCEEDED )
+		ActiveRequest()->m_bError = true;
+	FinishMove();
 }
 
-void RosMoveJointGesture::MoveDone()
+void RosMoveJointGesture::OnJointStates( const Json::Value & a_Message )
 {
-    if ( PopRequest() )
-        ThreadPool::Instance()->InvokeOnThread(VOID_DELEGATE(RosMoveJointGesture, MoveThread, this));
+	// the handler gets the whole rosbridge publish, the JointState itself is under msg
+	const Json::Value & names = a_Message["msg"]["name"];
+	const Json::Value & positions = a_Message["msg"]["position"];
+
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	for(Json::ArrayIndex i=0;i<names.size() && i<positions.size();++i)
+		m_JointStates[ names[i].asString() ] = positions[i].asDouble();
 }
 
-void RosMoveJointGesture::OnTimeout()
+void RosMoveJointGesture::FinishMove()
 {
-	m_GoalDone = true;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		if (! m_bMoving )
+			return;
+		m_bMoving = false;
+	}
+
+	// now invoke the main thread to notify them the move is completed..
+	ThreadPool::Instance()->InvokeOnMain(VOID_DELEGATE(RosMoveJointGesture, MoveDone, this));
+}
+
+void RosMoveJointGesture::MoveDone()
+{
+	m_Streamer.Stop();
+	m_Goals.clear();
+    if ( PopRequest() )
+        StartMove();
 }
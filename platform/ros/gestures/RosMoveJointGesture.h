@@ -16,10 +16,15 @@
 */
 
 
+
 #ifndef ROS_MOVE_JOINT_GESTURE_H
 #define ROS_MOVE_JOINT_GESTURE_H
 
+#include <map>
+
 #include "gestures/MoveJointGesture.h"
+#include "RosActionClient.h"
+#include "trajectory/TrajectoryStreamer.h"
 
 //! This is the base class for any gesture that moves a single joint on a robot.
 class RosMoveJointGesture : public MoveJointGesture
@@ -27,26 +32,58 @@ class RosMoveJointGesture : public MoveJointGesture
 public:
     RTTI_DECL( );
 
-	RosMoveJointGesture() : m_GoalDone(false)
+	RosMoveJointGesture() : 
+		m_fMaxVelocity( 0.5 ), 
+		m_fMaxAcceleration( 1.0 ), 
+		m_fSampleTime( 0.1 ), 
+		m_fWindow( 1.0 ), 
+		m_fLookahead( 0.5 ),
+		m_bMoving( false )
 	{}
+	~RosMoveJointGesture();
+
+	//! ISerializable interface
+	virtual void Serialize(Json::Value & json);
+	virtual void Deserialize(const Json::Value & json);
 
     //! IGesture interface
     virtual bool Execute( GestureDelegate a_Callback, const ParamsMap & a_Params );
+    virtual bool Abort();
+
+	//! Where a move of our joints would start, the latest /joint_states or else where we last sent them.
+	//! Returns false if neither is known for every joint.
+	bool GetStart( std::vector<double> & a_Start );
 
 private:
+	//! Types
+	typedef std::map<std::string,double>		PositionMap;
+
     //! Callbacks
-    void MoveThread();
-    void DoMoveThread();
+    void StartMove();
+	void OnWindow( const TrajectoryStreamer::Window & a_Window );
+	void OnGoalDone( RosActionClient::Goal * a_pGoal );
+	void OnJointStates( const Json::Value & a_Message );
+	void FinishMove();
     void MoveDone();
-	void OnTimeout();
 
-	TimerPool::ITimer::SP       m_spWaitTimer;
+	//! Data
+	double								m_fMaxVelocity;			// radians per second
+	double								m_fMaxAcceleration;		// radians per second squared
+	double								m_fSampleTime;			// seconds between trajectory points
+	double								m_fWindow;				// seconds of trajectory sent in each goal
+	double								m_fLookahead;			// seconds each goal runs past the next window
+
+	boost::shared_ptr<RosActionClient>	m_spClient;
+	std::vector<RosActionClient::GoalSP>	m_Goals;			// goals sent for the current move
+	TrajectoryStreamer					m_Streamer;
 
-	void OnGoalStatus(const Json::Value & a_Response);
+	boost::mutex						m_Lock;
+	bool								m_bMoving;
+	std::string							m_GoalId;
+	std::string							m_LastGoalId;			// the goal that ends the move, once the last window is sent
+	PositionMap							m_JointStates;			// latest positions from /joint_states
 
-	//! Data
-	std::string			m_GoalId;
-	volatile bool		m_GoalDone;
+	static PositionMap					sm_Commanded;			// where we last sent each joint
 };
 
 
@@ -0,0 +1,138 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+
+#include "trajectory/JointTrajectory.h"
+#include "trajectory/TrajectoryStreamer.h"
+
+#include <math.h>
+
+class TestJointTrajectory : UnitTest
+{
+public:
+	//! Construction
+	TestJointTrajectory() : UnitTest("TestJointTrajectory")
+	{}
+
+	virtual void RunTest()
+	{
+		const double MAX_VEL = 0.5, MAX_ACC = 1.0, SAMPLE = 0.05;
+
+		// one joint moving far enough to cruise, one short move, both should arrive together at rest
+		std::vector<double> start( 2, 0.0 ), via( 2 ), target( 2 );
+		via[0] = 1.0; via[1] = 0.1;
+		target[0] = 2.0; target[1] = -0.2;
+
+		JointTrajectory trajectory;
+		trajectory.SetLimits( MAX_VEL, MAX_ACC );
+		trajectory.SetStart( start );
+		trajectory.AddWaypoint( via );
+		trajectory.AddWaypoint( target );
+		Test( trajectory.Plan( SAMPLE ) );
+
+		const JointTrajectory::PointList & points = trajectory.GetPoints();
+		Test( points.size() > 10 );
+		Test( fabs( points.back().m_fTime - trajectory.GetDuration() ) < 1e-9 );
+		Test( fabs( points.back().m_Positions[0] - 2.0 ) < 1e-9 );
+		Test( fabs( points.back().m_Positions[1] + 0.2 ) < 1e-9 );
+		Test( fabs( points.back().m_Velocities[0] ) < 1e-9 );
+
+		// the limits hold, and the path is smooth, no jumps between samples or at the via point
+		double lastTime = 0.0;
+		std::vector<double> last( start );
+		for(size_t i=0;i<points.size();++i)
+		{
+			const JointTrajectory::Point & point = points[i];
+			Test( point.m_fTime > lastTime );
+			for(size_t j=0;j<2;++j)
+			{
+				Test( fabs( point.m_Velocities[j] ) <= MAX_VEL * 1.01 );
+				Test( fabs( point.m_Accelerations[j] ) <= MAX_ACC * 1.01 );
+				Test( fabs( point.m_Positions[j] - last[j] ) <= MAX_VEL * (point.m_fTime - lastTime) * 1.01 );
+			}
+			last = point.m_Positions;
+			lastTime = point.m_fTime;
+		}
+
+		// joint 0 keeps going through the via point rather than stopping on it
+		for(size_t i=0;i<points.size();++i)
+		{
+			if ( fabs( points[i].m_Positions[0] - 1.0 ) < 0.05 )
+				Test( fabs( points[i].m_Velocities[0] ) > 0.1 );
+		}
+
+		// a requested time longer than the limits need is kept
+		JointTrajectory slow;
+		slow.SetLimits( MAX_VEL, MAX_ACC );
+		slow.SetStart( start );
+		slow.AddWaypoint( via, 10.0 );
+		Test( slow.Plan( SAMPLE ) );
+		Test( fabs( slow.GetDuration() - 10.0 ) < 1e-9 );
+
+		// mismatched joints are refused
+		JointTrajectory bad;
+		bad.SetStart( start );
+		bad.AddWaypoint( std::vector<double>( 3, 1.0 ) );
+		Test(! bad.Plan( SAMPLE ) );
+
+		// windows rebase times to their start and together cover every point once
+		const double WINDOW = 1.0;
+		size_t covered = 0;
+		for(double from = 0.0; from < trajectory.GetDuration(); from += WINDOW)
+		{
+			JointTrajectory::PointList window;
+			trajectory.GetWindow( from, from + WINDOW, window );
+			for(size_t i=0;i<window.size();++i)
+				Test( window[i].m_fTime > 0.0 && window[i].m_fTime <= WINDOW + 1e-9 );
+			covered += window.size();
+		}
+		Test( covered == points.size() );
+
+		// the streamer sends the first window at once, with the lookahead included
+		TrajectoryStreamer streamer;
+		m_Windows.clear();
+		Test( streamer.Start( trajectory, WINDOW, 0.5, DELEGATE( TestJointTrajectory, OnWindow, const TrajectoryStreamer::Window &, this ) ) );
+		Test( m_Windows.size() == 1 );
+		Test( m_Windows[0].m_Index == 0 && !m_Windows[0].m_bLast );
+		Test( m_Windows[0].m_Points.back().m_fTime > WINDOW );
+		streamer.Stop();
+		Test(! streamer.IsStreaming() );
+
+		// planning cost, so we know it is fine to do on the main thread for each move
+		const int COUNT = 1000;
+		double begin = Time().GetEpochTime();
+		for(int i=0;i<COUNT;++i)
+			trajectory.Plan( SAMPLE );
+		double elapsed = Time().GetEpochTime() - begin;
+		Log::Status( "TestJointTrajectory", "%u points per window, %.1f us per plan of %u points", 
+			(unsigned int)m_Windows[0].m_Points.size(), (elapsed * 1000000.0) / COUNT, (unsigned int)points.size() );
+	}
+
+	void OnWindow( const TrajectoryStreamer::Window & a_Window )
+	{
+		m_Windows.push_back( a_Window );
+	}
+
+	std::vector<TrajectoryStreamer::Window>	m_Windows;
+};
+
+TestJointTrajectory TEST_JOINT_TRAJECTORY;
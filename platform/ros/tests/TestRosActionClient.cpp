@@ -0,0 +1,120 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+
+#include "RosPlatform.h"
+#include "RosActionClient.h"
+
+#ifndef _WIN32
+
+class TestRosActionClient : UnitTest
+{
+public:
+	//! Construction
+	TestRosActionClient() : UnitTest("TestRosActionClient"), m_DoneCount( 0 )
+	{}
+
+	int m_DoneCount;
+
+	virtual void RunTest()
+	{
+		// nothing answers on this url, this test stands in for rosbridge by feeding the client
+		// the status messages the server would publish
+		RosPlatform platform( "ws://127.0.0.1:9" );
+		RosActionClient client( "/joint_refs", "r2_msgs/LabeledJointTrajectory", "/goal_status" );
+
+		RosActionClient::GoalSP spGoal = client.SendGoal( "goal_a", Json::Value() );
+		spGoal->OnDone( DELEGATE( TestRosActionClient, OnDone, RosActionClient::Goal *, this ) );
+		Test(! spGoal->IsDone() );
+		client.OnStatus( MakeStatus( "goal_a", RosActionClient::ACTIVE ) );
+		Test( spGoal->GetState() == RosActionClient::ACTIVE );
+		client.OnStatus( MakeStatus( "goal_a", RosActionClient::SUCCEEDED ) );
+		Test( spGoal->GetState() == RosActionClient::SUCCEEDED );
+		Test( spGoal->Wait( 0.0f ) );
+		Test( m_DoneCount == 1 );
+		Test( client.GetActiveGoals() == 0 );
+
+		// later status for a finished goal, or for goals that aren't ours, change nothing
+		client.OnStatus( MakeStatus( "goal_a", RosActionClient::ABORTED ) );
+		client.OnStatus( MakeStatus( "someone_else", RosActionClient::SUCCEEDED ) );
+		Test( spGoal->GetState() == RosActionClient::SUCCEEDED && m_DoneCount == 1 );
+
+		// a callback added after the goal is done is called right away
+		spGoal->OnDone( DELEGATE( TestRosActionClient, OnDone, RosActionClient::Goal *, this ) );
+		Test( m_DoneCount == 2 );
+
+		// without a cancel topic a cancelled goal is just no longer tracked
+		RosActionClient::GoalSP spCancel = client.SendGoal( "goal_b", Json::Value() );
+		client.Cancel( spCancel );
+		Test( spCancel->GetState() == RosActionClient::RECALLED );
+		Test( spCancel->Wait( 0.0f ) );
+		Test( client.GetActiveGoals() == 0 );
+
+		// many goals in flight at once, completed by status arrays like the trajectory follower sends
+		const int COUNT = 2000;
+		const int BATCH = 50;
+		m_DoneCount = 0;
+		std::vector<RosActionClient::GoalSP> goals;
+		double start = Time().GetEpochTime();
+		for(int i=0;i<COUNT;++i)
+		{
+			goals.push_back( client.SendGoal( StringUtil::Format( "goal_%d", i ), Json::Value() ) );
+			goals.back()->OnDone( DELEGATE( TestRosActionClient, OnDone, RosActionClient::Goal *, this ) );
+		}
+		for(int i=0;i<COUNT;i += BATCH)
+		{
+			Json::Value status;
+			for(int k=0;k<BATCH;++k)
+			{
+				Json::Value & entry = status["msg"]["status_list"][k];
+				entry["goal_id"]["id"] = StringUtil::Format( "goal_%d", i + k );
+				entry["status"] = (int)RosActionClient::SUCCEEDED;
+			}
+			client.OnStatus( status );
+		}
+		double elapsed = Time().GetEpochTime() - start;
+
+		Test( m_DoneCount == COUNT );
+		Test( client.GetActiveGoals() == 0 );
+		Log::Status( "TestRosActionClient", "%d concurrent goals completed in %.3f seconds, %.0f goals/s", 
+			COUNT, elapsed, COUNT / (elapsed > 0.0 ? elapsed : 1e-6) );
+	}
+
+	Json::Value MakeStatus( const std::string & a_GoalId, RosActionClient::GoalState a_State )
+	{
+		Json::Value json;
+		json["topic"] = "/goal_status";
+		json["msg"]["status_list"][0]["goal_id"]["id"] = a_GoalId;
+		json["msg"]["status_list"][0]["status"] = (int)a_State;
+		return json;
+	}
+
+	void OnDone( RosActionClient::Goal * a_pGoal )
+	{
+		m_DoneCount += 1;
+	}
+};
+
+TestRosActionClient TEST_ROS_ACTION_CLIENT;
+
+#endif
@@ -0,0 +1,287 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "tests/StandInServer.h"
+
+#include "CborReader.h"
+#include "RosPlatform.h"
+
+#include <string.h>
+#include <math.h>
+
+class TestRosCbor : UnitTest
+{
+public:
+	//! Construction
+	TestRosCbor() : UnitTest("TestRosCbor"),
+		m_Publishes(0),
+		m_JsonCount(0),
+		m_CborCount(0)
+	{}
+
+	virtual void RunTest()
+	{
+		// the small items, checked against bytes from RFC 7049 appendix A
+		Test( Decode( "\x00", 1 ) == Json::Value( 0 ) );
+		Test( Decode( "\x18\x64", 2 ) == Json::Value( 100 ) );
+		Test( Decode( "\x39\x03\xe7", 3 ) == Json::Value( -1000 ) );
+		Test( Decode( "\xf9\x3c\x00", 3 ) == Json::Value( 1.0 ) );
+		Test( Decode( "\xfb\x3f\xf1\x99\x99\x99\x99\x99\x9a", 9 ) == Json::Value( 1.1 ) );
+		Test( Decode( "\xf5", 1 ) == Json::Value( true ) );
+		Test( Decode( "\xf6", 1 ).isNull() );
+		Test( Decode( "\x64\x49\x45\x54\x46", 5 ) == Json::Value( "IETF" ) );
+		Test( Decode( "\x43\x01\x02\x03", 4 ) == Json::Value( "AQID" ) );
+		Test( Decode( "\x9f\x01\x82\x02\x03\xff", 6 ).size() == 2 );
+		Test( Decode( "\xbf\x61\x61\x01\xff", 5 )["a"] == Json::Value( 1 ) );
+
+		// little endian float64 typed array
+		std::string typed( "\xd8\x56\x50", 3 );
+		double values[2] = { 0.5, -2.25 };
+		typed.append( (const char *)values, sizeof(values) );
+		Json::Value array = Decode( typed.data(), typed.size() );
+		Test( array.size() == 2 && array[0] == Json::Value( 0.5 ) && array[1] == Json::Value( -2.25 ) );
+
+		// truncated or broken frames are rejected rather than read past the end
+		Json::Value value;
+		Test(! CborReader::Parse( "\x19\x01", 2, value ) );
+		Test(! CborReader::Parse( "\x65\x49\x45", 3, value ) );
+		Test(! CborReader::Parse( "\x9f\x01", 2, value ) );
+		Test(! CborReader::Parse( "", 0, value ) );
+
+		// a stand-in rosbridge publishes the same joint_states on a JSON and a cbor subscription
+		ThreadPool pool(1);
+		const int PUBLISHES = 20;
+		m_Publishes = PUBLISHES;
+		m_JsonMessage = MakeJointStates( "/joint_states", 40 );
+		m_CborMessage = MakeJointStates( "/joint_states_cbor", 40 );
+		m_Text = Json::FastWriter().write( m_JsonMessage );
+		Encode( m_CborMessage, m_Cbor );
+		Test( m_Cbor.size() < m_Text.size() );
+
+		StandInServer rosbridge( boost::bind( &TestRosCbor::ServeRosbridge, this, _1, _2, _3 ) );
+		std::string url( rosbridge.GetURL() );
+		StringUtil::Replace( url, "http://", "ws://", true );
+		{
+			RosPlatform platform( url );
+			Test( platform.Subscribe( "/joint_states", "sensor_msgs/JointState", 
+				DELEGATE( TestRosCbor, OnJson, const Json::Value &, this ) ) );
+			Test( platform.Subscribe( "/joint_states_cbor", "sensor_msgs/JointState", 
+				DELEGATE( TestRosCbor, OnCbor, const Json::Value &, this ), RosPlatform::SubscribeOptions( "cbor" ) ) );
+
+			double start = Time().GetEpochTime();
+			while( (m_JsonCount < PUBLISHES || m_CborCount < PUBLISHES) && Time().GetEpochTime() - start < 5.0 )
+			{
+				ThreadPool::Instance()->ProcessMainThread();
+				boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+			}
+			Test( m_JsonCount == PUBLISHES && m_CborCount == PUBLISHES );
+			Test( m_JsonReceived["msg"] == m_JsonMessage["msg"] );
+			Test( m_CborReceived["msg"] == m_JsonReceived["msg"] );
+
+			// the same frames the stand-in sent, fed through OnFrame so dispatch is timed along with the decode
+			IWebSocket::FrameSP spText( new IWebSocket::Frame() );
+			spText->m_Op = IWebSocket::TEXT_FRAME;
+			spText->m_Data = m_Text;
+			IWebSocket::FrameSP spCbor( new IWebSocket::Frame() );
+			spCbor->m_Op = IWebSocket::BINARY_FRAME;
+			spCbor->m_Data = m_Cbor;
+
+			const int COUNT = 2000;
+			start = Time().GetEpochTime();
+			for(int i=0;i<COUNT;++i)
+				platform.OnFrame( spCbor );
+			double cborTime = Time().GetEpochTime() - start;
+
+			start = Time().GetEpochTime();
+			for(int i=0;i<COUNT;++i)
+				platform.OnFrame( spText );
+			double jsonTime = Time().GetEpochTime() - start;
+
+			Log::Status( "TestRosCbor", "%d joint_states through OnFrame: cbor %u bytes %.0f msg/s, json %u bytes %.0f msg/s", COUNT,
+				(unsigned int)m_Cbor.size(), COUNT / (cborTime > 0.0 ? cborTime : 1e-6),
+				(unsigned int)m_Text.size(), COUNT / (jsonTime > 0.0 ? jsonTime : 1e-6) );
+			Test( m_JsonCount == PUBLISHES + COUNT && m_CborCount == PUBLISHES + COUNT );
+			Test( cborTime * 1.5 < jsonTime );
+
+			platform.Unsubscribe( "/joint_states", this );
+			platform.Unsubscribe( "/joint_states_cbor", this );
+		}
+		rosbridge.Stop();
+	}
+
+	void OnJson( const Json::Value & a_Message )
+	{
+		m_JsonReceived = a_Message;
+		m_JsonCount += 1;
+	}
+
+	void OnCbor( const Json::Value & a_Message )
+	{
+		m_CborReceived = a_Message;
+		m_CborCount += 1;
+	}
+
+	//! Answers each subscribe op with m_Publishes messages in the compression it asked for
+	void ServeRosbridge( StandInServer::Socket & a_Socket, boost::asio::streambuf & a_Buffer, const std::string & a_Request )
+	{
+		if (! StandInServer::Upgrade( a_Socket, a_Request ) )
+		{
+			StandInServer::WriteResponse( a_Socket, 400, "{}" );
+			return;
+		}
+
+		int op = 0;
+		std::string payload;
+		while( StandInServer::ReadFrame( a_Socket, op, payload ) && op != StandInServer::OP_CLOSE )
+		{
+			Json::Value json;
+			if ( op != StandInServer::OP_TEXT || !Json::Reader().parse( payload, json ) || json["op"].asString() != "subscribe" )
+				continue;
+
+			bool bCbor = json["compression"].asString() == "cbor";
+			for(int i=0;i<m_Publishes;++i)
+			{
+				if ( bCbor )
+					StandInServer::WriteFrame( a_Socket, StandInServer::OP_BINARY, m_Cbor );
+				else
+					StandInServer::WriteFrame( a_Socket, StandInServer::OP_TEXT, m_Text );
+			}
+		}
+	}
+
+	Json::Value Decode( const char * a_pData, size_t a_Size )
+	{
+		Json::Value value;
+		Test( CborReader::Parse( a_pData, a_Size, value ) );
+		return value;
+	}
+
+	Json::Value MakeJointStates( const std::string & a_Topic, int a_Joints )
+	{
+		Json::Value message;
+		message["op"] = "publish";
+		message["topic"] = a_Topic;
+		message["msg"]["header"]["seq"] = 1024;
+		message["msg"]["header"]["stamp"]["secs"] = 1467044592;
+		message["msg"]["header"]["stamp"]["nsecs"] = 175644067;
+		message["msg"]["header"]["frame_id"] = "";
+		for(int i=0;i<a_Joints;++i)
+		{
+			// encoder readings, so full precision like a real robot sends
+			message["msg"]["name"][i] = StringUtil::Format( "joint_%d", i );
+			message["msg"]["position"][i] = sin( 0.37 * i );
+			message["msg"]["velocity"][i] = cos( 0.11 * i ) / 3.0;
+			message["msg"]["effort"][i] = 0.01 * i / 7.0;
+		}
+		return message;
+	}
+
+	//! Just enough of an encoder to stand in for rosbridge, number arrays go out as typed arrays
+	void EncodeHeader( int a_Major, unsigned int a_Argument, std::string & a_Output )
+	{
+		unsigned char major = (unsigned char)(a_Major << 5);
+		if ( a_Argument < 24 )
+			a_Output += (char)(major | a_Argument);
+		else if ( a_Argument < 0x100 )
+		{
+			a_Output += (char)(major | 24);
+			a_Output += (char)a_Argument;
+		}
+		else if ( a_Argument < 0x10000 )
+		{
+			a_Output += (char)(major | 25);
+			a_Output += (char)(a_Argument >> 8);
+			a_Output += (char)a_Argument;
+		}
+		else
+		{
+			a_Output += (char)(major | 26);
+			for(int shift=24;shift>=0;shift -= 8)
+				a_Output += (char)(a_Argument >> shift);
+		}
+	}
+
+	void Encode( const Json::Value & a_Value, std::string & a_Output )
+	{
+		if ( a_Value.isArray() && a_Value.size() > 0 && a_Value[0].type() == Json::realValue )
+		{
+			EncodeHeader( 6, 86, a_Output );
+			EncodeHeader( 2, a_Value.size() * sizeof(double), a_Output );
+			for(Json::UInt i=0;i<a_Value.size();++i)
+			{
+				double d = a_Value[i].asDouble();
+				a_Output.append( (const char *)&d, sizeof(d) );
+			}
+		}
+		else if ( a_Value.isArray() )
+		{
+			EncodeHeader( 4, a_Value.size(), a_Output );
+			for(Json::UInt i=0;i<a_Value.size();++i)
+				Encode( a_Value[i], a_Output );
+		}
+		else if ( a_Value.isObject() )
+		{
+			EncodeHeader( 5, a_Value.size(), a_Output );
+			for( Json::ValueConstIterator iMember = a_Value.begin(); iMember != a_Value.end(); ++iMember )
+			{
+				Encode( Json::Value( iMember.key().asString() ), a_Output );
+				Encode( *iMember, a_Output );
+			}
+		}
+		else if ( a_Value.isString() )
+		{
+			EncodeHeader( 3, a_Value.asString().size(), a_Output );
+			a_Output += a_Value.asString();
+		}
+		else if ( a_Value.type() == Json::realValue )
+		{
+			double d = a_Value.asDouble();
+			unsigned long long bits;
+			memcpy( &bits, &d, sizeof(bits) );
+			a_Output += (char)0xfb;
+			for(int shift=56;shift>=0;shift -= 8)
+				a_Output += (char)(bits >> shift);
+		}
+		else if ( a_Value.isIntegral() && a_Value.asInt() < 0 )
+			EncodeHeader( 1, (unsigned int)(-1 - a_Value.asInt()), a_Output );
+		else if ( a_Value.isIntegral() )
+			EncodeHeader( 0, a_Value.asUInt(), a_Output );
+		else if ( a_Value.isBool() )
+			a_Output += (char)(a_Value.asBool() ? 0xf5 : 0xf4);
+		else
+			a_Output += (char)0xf6;
+	}
+
+	int				m_Publishes;
+	Json::Value		m_JsonMessage;
+	Json::Value		m_CborMessage;
+	std::string		m_Text;
+	std::string		m_Cbor;
+	volatile int	m_JsonCount;
+	volatile int	m_CborCount;
+	Json::Value		m_JsonReceived;
+	Json::Value		m_CborReceived;
+};
+
+TestRosCbor TEST_ROS_CBOR;
@@ -0,0 +1,107 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/ThreadPool.h"
+
+#include "RosPlatform.h"
+#include "gestures/RosMoveJointGesture.h"
+
+#ifndef _WIN32
+
+class TestRosMoveJointGesture : UnitTest
+{
+public:
+	//! Construction
+	TestRosMoveJointGesture() : UnitTest("TestRosMoveJointGesture"), m_bDone( false )
+	{}
+
+	bool m_bDone;
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+		// nothing answers on this url, the test feeds the platform the frames rosbridge would send
+		RosPlatform platform( "ws://127.0.0.1:9" );
+
+		// joints no other test moves, the commanded positions are shared by every gesture
+		Json::Value json;
+		json["m_JointNames"][0] = "test_gesture_joint_a";
+		json["m_JointNames"][1] = "test_gesture_joint_b";
+		json["m_fAngles"][0] = 1.0;
+		json["m_fAngles"][1] = -1.0;
+
+		RosMoveJointGesture gesture;
+		gesture.Deserialize( json );
+
+		std::vector<double> start;
+		Test(! gesture.GetStart( start ) );
+
+		// with no idea where the joints are the move goes straight to the target, which is all we know
+		ParamsMap params;
+		Test( gesture.Execute( DELEGATE( TestRosMoveJointGesture, OnGesture, IGesture *, this ), params ) );
+		Test( gesture.GetStart( start ) && start.size() == 2 );
+		Test( start.size() == 2 && start[0] == 1.0 && start[1] == -1.0 );
+
+		// a joint_states publish as rosbridge sends it, the measured positions are where the next move starts
+		platform.OnFrame( MakeJointStates( 0.25, -0.5 ) );
+		Test( gesture.GetStart( start ) && start.size() == 2 );
+		Test( start.size() == 2 && start[0] == 0.25 && start[1] == -0.5 );
+
+		gesture.Abort();
+		ThreadPool::Instance()->ProcessMainThread();
+	}
+
+	//! A /joint_states frame with other joints around ours, like the robot reports them
+	static IWebSocket::FrameSP MakeJointStates( double a_fA, double a_fB )
+	{
+		Json::Value json;
+		json["op"] = "publish";
+		json["topic"] = "/joint_states";
+		Json::Value & msg = json["msg"];
+		msg["header"]["seq"] = 1;
+		msg["header"]["frame_id"] = "";
+		msg["header"]["stamp"]["secs"] = 0;
+		msg["header"]["stamp"]["nsecs"] = 0;
+		msg["name"][0] = "other_joint";
+		msg["name"][1] = "test_gesture_joint_b";
+		msg["name"][2] = "test_gesture_joint_a";
+		msg["position"][0] = 3.0;
+		msg["position"][1] = a_fB;
+		msg["position"][2] = a_fA;
+		for(Json::ArrayIndex i=0;i<3;++i)
+		{
+			msg["velocity"][i] = 0.0;
+			msg["effort"][i] = 0.0;
+		}
+
+		IWebSocket::FrameSP spFrame( new IWebSocket::Frame() );
+		spFrame->m_Op = IWebSocket::TEXT_FRAME;
+		spFrame->m_Data = Json::FastWriter().write( json );
+		return spFrame;
+	}
+
+	void OnGesture( IGesture * a_pGesture )
+	{
+		m_bDone = true;
+	}
+};
+
+TestRosMoveJointGesture TEST_ROS_MOVE_JOINT_GESTURE;
+
+#endif
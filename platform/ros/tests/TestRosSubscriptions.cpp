@@ -0,0 +1,153 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+
+#include "RosPlatform.h"
+
+#ifndef _WIN32
+
+class TestRosSubscriptions : UnitTest
+{
+public:
+	//! Construction
+	TestRosSubscriptions() : UnitTest("TestRosSubscriptions")
+	{}
+
+	//! One subscriber, counts the messages it gets and can unsubscribe or stall from inside its handler
+	struct Listener
+	{
+		Listener( const std::string & a_Topic ) : m_Topic( a_Topic ), m_Count( 0 ), m_bInside( false ),
+			m_bUnsubscribeSelf( false ), m_bUnsubscribed( false ), m_fStall( 0.0f )
+		{}
+
+		std::string		m_Topic;
+		volatile int	m_Count;
+		volatile bool	m_bInside;
+		bool			m_bUnsubscribeSelf;
+		bool			m_bUnsubscribed;
+		volatile float	m_fStall;
+
+		bool Subscribe()
+		{
+			return RosPlatform::Instance()->Subscribe( m_Topic, "std_msgs/String",
+				DELEGATE( Listener, OnMessage, const Json::Value &, this ) );
+		}
+
+		void OnMessage( const Json::Value & a_Message )
+		{
+			m_bInside = true;
+			m_Count += 1;
+			float stall = m_fStall;		// only the first call stalls
+			m_fStall = 0.0f;
+			if ( stall > 0.0f )
+				boost::this_thread::sleep( boost::posix_time::milliseconds( (int)(stall * 1000) ) );
+			if ( m_bUnsubscribeSelf )
+				m_bUnsubscribed = RosPlatform::Instance()->Unsubscribe( m_Topic, this );
+			m_bInside = false;
+		}
+	};
+
+	virtual void RunTest()
+	{
+		// nothing answers on this url, the test feeds the platform the frames rosbridge would send
+		RosPlatform platform( "ws://127.0.0.1:9" );
+
+		// Unsubscribe used to never find the subscriber, so it kept getting every message
+		Listener a( "/topic_a" );
+		Test( a.Subscribe() );
+		Publish( platform, "/topic_a" );
+		Test( a.m_Count == 1 );
+		Test( platform.Unsubscribe( "/topic_a", &a ) );
+		Publish( platform, "/topic_a" );
+		Test( a.m_Count == 1 );
+		Test(! platform.Unsubscribe( "/topic_a", &a ) );
+		Test(! platform.Unsubscribe( "/no_such_topic", &a ) );
+
+		// only the object passed to Unsubscribe is removed from a shared topic
+		Listener b( "/topic_b" ), c( "/topic_b" );
+		Test( b.Subscribe() && c.Subscribe() );
+		Publish( platform, "/topic_b" );
+		Test( platform.Unsubscribe( "/topic_b", &b ) );
+		Publish( platform, "/topic_b" );
+		Test( b.m_Count == 1 && c.m_Count == 2 );
+
+		// a topic that is waiting to be released is picked up again by the next subscriber
+		Test( platform.Unsubscribe( "/topic_b", &c ) );
+		Test( b.Subscribe() );
+		Publish( platform, "/topic_b" );
+		Test( b.m_Count == 2 && c.m_Count == 2 );
+		Test( platform.Unsubscribe( "/topic_b", &b ) );
+
+		// a handler can unsubscribe itself without deadlocking, and isn't called again
+		Listener d( "/topic_d" );
+		d.m_bUnsubscribeSelf = true;
+		Test( d.Subscribe() );
+		Publish( platform, "/topic_d" );
+		Test( d.m_bUnsubscribed && d.m_Count == 1 );
+		Publish( platform, "/topic_d" );
+		Test( d.m_Count == 1 );
+
+		// Unsubscribe from another thread waits for a call in progress, then nothing more is delivered
+		Listener e( "/topic_e" );
+		e.m_fStall = 0.3f;
+		Test( e.Subscribe() );
+		boost::thread dispatch( boost::bind( &TestRosSubscriptions::Publish, this, boost::ref( platform ), "/topic_e" ) );
+		while(! e.m_bInside )
+			boost::this_thread::yield();
+		Test( platform.Unsubscribe( "/topic_e", &e ) );
+		Test(! e.m_bInside && e.m_Count == 1 );
+		dispatch.join();
+		Publish( platform, "/topic_e" );
+		Test( e.m_Count == 1 );
+
+		// no lock is held while a handler runs, a stalled call doesn't hold up the next message or other subscribers
+		Listener f( "/topic_f" ), g( "/topic_f" );
+		f.m_fStall = 0.3f;
+		Test( f.Subscribe() && g.Subscribe() );
+		boost::thread stalled( boost::bind( &TestRosSubscriptions::Publish, this, boost::ref( platform ), "/topic_f" ) );
+		while(! f.m_bInside )
+			boost::this_thread::yield();
+		double start = Time().GetEpochTime();
+		Publish( platform, "/topic_f" );
+		Test( platform.Unsubscribe( "/topic_f", &g ) );
+		Test( (Time().GetEpochTime() - start) < 0.2 );
+		Test( f.m_Count == 2 );
+		stalled.join();
+		Test( f.m_Count == 2 && g.m_Count == 1 );
+		Test( platform.Unsubscribe( "/topic_f", &f ) );
+	}
+
+	void Publish( RosPlatform & a_Platform, const std::string & a_Topic )
+	{
+		Json::Value json;
+		json["op"] = "publish";
+		json["topic"] = a_Topic;
+		json["msg"]["data"] = "hello";
+
+		IWebSocket::FrameSP spFrame( new IWebSocket::Frame() );
+		spFrame->m_Op = IWebSocket::TEXT_FRAME;
+		spFrame->m_Data = Json::FastWriter().write( json );
+		a_Platform.OnFrame( spFrame );
+	}
+};
+
+TestRosSubscriptions TEST_ROS_SUBSCRIPTIONS;
+
+#endif
@@ -31,6 +31,7 @@ void RemoteCameraAgent::Serialize(Json::Value & json)
     IAgent::Serialize(json);
     json["m_fPersonInterval"] = m_fPersonInterval;
     json["m_bSaySomething"] = m_bSaySomething;
+    json["m_fActiveTime"] = m_fActiveTime;
 }
 
 void RemoteCameraAgent::Deserialize(const Json::Value & json)
@@ -40,6 +41,8 @@ void RemoteCameraAgent::Deserialize(const Json::Value & json)
         m_fPersonInterval = json["m_fPersonInterval"].asFloat();
     if (json.isMember("m_bSaySomething"))
         m_bSaySomething = json["m_bSaySomething"].asBool();
+    if (json.isMember("m_fActiveTime"))
+        m_fActiveTime = json["m_fActiveTime"].asFloat();
 }
 
 bool RemoteCameraAgent::OnStart()
@@ -56,6 +59,7 @@ bool RemoteCameraAgent::OnStart()
 
 bool RemoteCameraAgent::OnStop()
 {
+    CaptureScheduler::Instance()->Release("VideoData", this);
 
     return true;
 }
@@ -63,6 +67,7 @@ bool RemoteCameraAgent::OnStop()
 void RemoteCameraAgent::OnCameraIntent(const ThingEvent & a_ThingEvent)
 {
     CameraIntent::SP spCameraIntent = DynamicCast<CameraIntent>( a_ThingEvent.GetIThing() );
+    CaptureScheduler::Instance()->Demand("VideoData", this, 0.0f, m_fActiveTime);
     PTZCamera * camera = SelfInstance::GetInstance()->FindService<PTZCamera>();
     camera->SetCameraCoordinates(spCameraIntent->GetTarget(), DELEGATE(RemoteCameraAgent, OnCameraMovement, const std::string & , this));
 }
@@ -75,6 +80,8 @@ void RemoteCameraAgent::OnCameraMovement(const std::string & a_Response)
 void RemoteCameraAgent::OnPerson(const ThingEvent & a_ThingEvent)
 {
     Person::SP spPerson = DynamicCast<Person>( a_ThingEvent.GetIThing() );
+    // somebody is in view, keep demand driven cameras at full rate while they are around
+    CaptureScheduler::Instance()->Demand("VideoData", this, 0.0f, m_fActiveTime);
     if (m_bSaySomething) {
         Goal::SP spGoal(new Goal("RemoteCamera"));
         SelfInstance::GetInstance()->GetBlackBoard()->AddThing(spGoal);
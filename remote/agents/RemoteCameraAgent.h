@@ -29,6 +29,7 @@
 #include "blackboard/Goal.h"
 #include "services/PTZCamera.h"
 #include "utils/TimerPool.h"
+#include "capture/CaptureScheduler.h"
 
 class RemoteCameraAgent : public IAgent
 {
@@ -37,7 +38,7 @@ public:
     RTTI_DECL();
 
     //! Constructor
-    RemoteCameraAgent(): m_fPersonInterval(30.0f), m_bSaySomething(false) {}
+    RemoteCameraAgent(): m_fPersonInterval(30.0f), m_bSaySomething(false), m_fActiveTime(30.0f) {}
 
     //! ISerializable interface
     virtual void Serialize(Json::Value &json);
@@ -57,6 +58,7 @@ private:
 
     float   m_fPersonInterval;
     bool    m_bSaySomething;
+    float   m_fActiveTime;      // seconds of full rate video we ask for after a person or camera intent
     TimerPool::ITimer::SP   m_spWaitTimer;
 };
 
@@ -30,10 +30,30 @@ REG_OVERRIDE_SERIALIZABLE(SpeechGesture, RemoteSpeechGesture);
 REG_SERIALIZABLE(RemoteSpeechGesture);
 RTTI_IMPL( RemoteSpeechGesture, SpeechGesture );
 
+void RemoteSpeechGesture::Serialize(Json::Value & json)
+{
+	SpeechGesture::Serialize( json );
+
+	json["m_AudioFormat"] = m_AudioFormat;
+}
+
+void RemoteSpeechGesture::Deserialize(const Json::Value & json)
+{
+	SpeechGesture::Deserialize( json );
+
+	if ( json["m_AudioFormat"].isString() )
+		m_AudioFormat = json["m_AudioFormat"].asString();
+}
+
 bool RemoteSpeechGesture::Start()
 {
 	if (! SpeechGesture::Start() )
 		return false;
+	if (! m_PublishFormat.Parse( m_AudioFormat ) )
+	{
+		Log::Error( "RemoteSpeechGesture", "Unsupported audio format %s", m_AudioFormat.c_str() );
+		return false;
+	}
 
 	ITextToSpeech * pTTS = SelfInstance::GetInstance()->FindService<ITextToSpeech>();
 	if ( pTTS == NULL )
@@ -43,7 +63,7 @@ bool RemoteSpeechGesture::Start()
 	}
 
 	ITopics * pTopics = SelfInstance::GetInstance()->GetTopics();
-	pTopics->RegisterTopic( "audio-out", "audio/L16;rate=22050" );
+	pTopics->RegisterTopic( "audio-out", m_PublishFormat.ToString() );
 	
 	pTTS->GetVoices( DELEGATE( RemoteSpeechGesture, OnVoices, Voices *, this ) );
 	return true;
@@ -127,8 +147,22 @@ void RemoteSpeechGesture::OnSpeechData( Sound * a_Data )
 {
 	if ( a_Data != NULL )
 	{
-		ITopics * pTopics = SelfInstance::GetInstance()->GetTopics();
-		pTopics->Publish( "audio-out", a_Data->GetWaveData(), false, true );
+		// publish in the format we registered, whatever the voice was synthesized at
+		AudioFormat format( a_Data->GetRate(), a_Data->GetChannels(), a_Data->GetBits() );
+		bool bReady = true;
+		if ( format != m_Converter.GetInputFormat() || m_PublishFormat != m_Converter.GetOutputFormat() )
+			bReady = m_Converter.Configure( format, m_PublishFormat );
+		else
+			m_Converter.Reset();
+
+		if ( bReady )
+		{
+			std::string wave;
+			m_Converter.Convert( a_Data->GetWaveData(), wave );
+
+			ITopics * pTopics = SelfInstance::GetInstance()->GetTopics();
+			pTopics->Publish( "audio-out", wave, false, true );
+		}
 		delete a_Data;
 	}
 
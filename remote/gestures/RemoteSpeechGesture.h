@@ -20,6 +20,7 @@
 #define REMOTE_SPEECH_GESTURE_H
 
 #include "gestures/SpeechGesture.h"
+#include "audio/AudioConverter.h"
 
 class Sound;
 struct Voices;
@@ -31,9 +32,13 @@ public:
 	RTTI_DECL();
 
 	//! Construction
-	RemoteSpeechGesture() : m_pVoices( NULL )
+	RemoteSpeechGesture() : m_pVoices( NULL ), m_AudioFormat( "audio/L16;rate=22050" )
 	{}
 
+	//! ISerializable interface
+	virtual void Serialize(Json::Value & json);
+	virtual void Deserialize(const Json::Value & json);
+
 	//! IGesture interface
 	virtual bool Start();
 	virtual bool Stop();
@@ -49,6 +54,9 @@ private:
 
 	//! Data
 	Voices *					m_pVoices;			
+	std::string					m_AudioFormat;		// format published on the audio-out topic
+	AudioFormat					m_PublishFormat;
+	AudioConverter				m_Converter;		// converts from the TTS format to m_PublishFormat
 };
 
 
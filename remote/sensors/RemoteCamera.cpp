@@ -22,6 +22,7 @@
 
 #include "RemoteCamera.h"
 #include "SelfInstance.h"
+#include "utils/Time.h"
 
 REG_SERIALIZABLE(RemoteCamera);
 RTTI_IMPL(RemoteCamera, ISensor);
@@ -33,6 +34,9 @@ void RemoteCamera::Serialize(Json::Value & json)
 	json["m_ServiceId"] = m_ServiceId;
 	json["m_Width"] = m_Width;
 	json["m_Height"] = m_Height;
+	json["m_bStream"] = m_bStream;
+	json["m_bDemandDriven"] = m_bDemandDriven;
+	json["m_fIdleFramesPerSec"] = m_fIdleFramesPerSec;
 }
 
 void RemoteCamera::Deserialize(const Json::Value & json)
@@ -45,10 +49,19 @@ void RemoteCamera::Deserialize(const Json::Value & json)
 		m_Width = json["m_Width"].asInt();
 	if (json["m_Height"].isInt())
 		m_Height = json["m_Height"].asInt();
+	if (json["m_bStream"].isBool())
+		m_bStream = json["m_bStream"].asBool();
+	if (json["m_bDemandDriven"].isBool())
+		m_bDemandDriven = json["m_bDemandDriven"].asBool();
+	if (json["m_fIdleFramesPerSec"].isNumeric())
+		m_fIdleFramesPerSec = json["m_fIdleFramesPerSec"].asFloat();
 }
 
 bool RemoteCamera::OnStart()
 {
+	m_DeliveryId = DataDelivery::Instance()->Register( "RemoteCamera", DataDelivery::LATEST, DataDelivery::PRIORITY_LOW, 1,
+		DELEGATE( RemoteCamera, OnSendData, IData *, this ) );
+
 	SelfInstance * pInstance = SelfInstance::GetInstance();
 	if ( pInstance != NULL )
 	{
@@ -59,54 +72,98 @@ bool RemoteCamera::OnStart()
 		m_pCameraService = pInstance->FindService<PTZCamera>( m_ServiceId );
 		if (m_pCameraService != NULL)
 		{
-			ThreadPool::Instance()->InvokeOnThread<void *>(DELEGATE(RemoteCamera, StreamingThread, void *, this), NULL);
+			CaptureScheduler * pScheduler = CaptureScheduler::Instance();
+			m_CaptureId = pScheduler->Register( "RemoteCamera", "VideoData", m_fFramesPerSec, 
+				m_bDemandDriven ? m_fIdleFramesPerSec : m_fFramesPerSec, DELEGATE( RemoteCamera, OnCaptureRate, float, this ) );
+			pScheduler->SetPaused( m_CaptureId, m_Paused > 0 );
+			m_fCaptureRate = pScheduler->GetRate( m_CaptureId );
+
+			m_bStreaming = m_bStream && m_pCameraService->GetStreamURL( m_Width, m_Height, m_fFramesPerSec ).size() > 0;
+			if ( m_bStreaming )
+				StartStream();
+			else
+				StartPolling();
 		}
 	}
 
     return true;
 }
 
-void RemoteCamera::StreamingThread(void * args)
+void RemoteCamera::StartPolling()
 {
+	// set before the thread runs, so an OnStop right after this still waits for it
+	m_StopThread = false;
 	m_ThreadStopped = false;
+	ThreadPool::Instance()->InvokeOnThread<void *>(DELEGATE(RemoteCamera, StreamingThread, void *, this), NULL);
+}
 
+void RemoteCamera::StreamingThread(void * args)
+{
 	while (!m_StopThread)
 	{
-		if (m_Paused <= 0)
+		float rate = m_fCaptureRate;
+		if (m_Paused <= 0 && rate > 0.0f)
 		{
 			m_pCameraService->GetImage(DELEGATE(RemoteCamera, OnGetImage, const std::string &, this));
-			tthread::this_thread::sleep_for(tthread::chrono::milliseconds((int)(1000 / m_fFramesPerSec)));
+			tthread::this_thread::sleep_for(tthread::chrono::milliseconds((int)(1000 / rate)));
+		}
+		else
+		{
+			// nothing to capture, wait for a resume or a new rate without spinning a core
+			tthread::this_thread::sleep_for(tthread::chrono::milliseconds(100));
 		}
 	}
 
 	m_ThreadStopped = true;
 }
 
+void RemoteCamera::StartStream()
+{
+	// the rate is passed to the camera so it only encodes what we are going to use
+	m_Stream.Stop();
+	if ( m_fCaptureRate > 0.0f && !m_Stream.Start( m_pCameraService->GetStreamURL( m_Width, m_Height, m_fCaptureRate ), 
+		m_pCameraService->GetAuthorization(), DELEGATE( RemoteCamera, OnStreamFrame, const std::string &, this ) ) )
+	{
+		// e.g. an https stream, which MjpegStream can't read, so get the images one at a time instead
+		Log::Warning( "RemoteCamera", "Failed to start the stream from %s, falling back to polling", m_ServiceId.c_str() );
+		m_bStreaming = false;
+		StartPolling();
+	}
+}
+
 bool RemoteCamera::OnStop()
 {
+	if ( m_CaptureId != 0 )
+	{
+		CaptureScheduler::Instance()->Unregister( m_CaptureId );
+		m_CaptureId = 0;
+	}
+	m_bStreaming = false;
+	m_Stream.Stop();
 	m_StopThread = true;
 	while (!m_ThreadStopped)
 		tthread::this_thread::yield();
+	DataDelivery::Instance()->Unregister( m_DeliveryId );
+	m_DeliveryId = 0;
 	return true;
 }
 
 void RemoteCamera::OnPause()
 {
-    m_Paused++;
+    if ( m_Paused++ == 0 && m_CaptureId != 0 )
+        CaptureScheduler::Instance()->SetPaused( m_CaptureId, true );
 }
 
 void RemoteCamera::OnResume()
 {
-    m_Paused--;
+    if ( --m_Paused == 0 && m_CaptureId != 0 )
+        CaptureScheduler::Instance()->SetPaused( m_CaptureId, false );
 }
 
 void RemoteCamera::OnGetImage( const std::string & a_Image )
 {
 	if (a_Image.size() > 0)
-	{
-		ThreadPool::Instance()->InvokeOnMain<VideoData *>(DELEGATE(RemoteCamera, OnSendData, VideoData *, this),
-			new VideoData((const unsigned char *)a_Image.c_str(), a_Image.size()));
-	}
+		SendFrame( a_Image );
 	else
 	{
 		Log::Error("RemoteCamera", "Could not connect to Remote Camera - exiting camera...");
@@ -114,13 +171,69 @@ void RemoteCamera::OnGetImage( const std::string & a_Image )
 	}
 }
 
+void RemoteCamera::OnStreamFrame( const std::string & a_Frame )
+{
+	float rate = m_fCaptureRate;
+	if ( m_Paused > 0 || rate <= 0.0f || a_Frame.size() == 0 )
+		return;
+
+	// the camera may send faster than we asked for, and the main thread may fall behind. Extra frames 
+	// are skipped here and the delivery queue only keeps the newest one, so a slow subscriber sees a 
+	// lower rate rather than old frames
+	double now = Time().GetEpochTime();
+	if ( (now - m_fLastFrame) < (0.9 / rate) )
+	{
+		m_Skipped += 1;
+		return;
+	}
+	m_fLastFrame = now;
+
+	SendFrame( a_Frame );
+}
+
+void RemoteCamera::SendFrame( const std::string & a_Frame )
+{
+	// the camera does the capture and encoding, so our duty cycle is the copy handed to the main thread
+	CaptureScheduler * pScheduler = CaptureScheduler::Instance();
+	if (! pScheduler->BeginCapture( m_CaptureId ) )
+	{
+		m_Skipped += 1;
+		return;
+	}
+
+	bool bQueued = DataDelivery::Instance()->Send( m_DeliveryId, 
+		new VideoData( (const unsigned char *)a_Frame.data(), a_Frame.size() ) );
+	pScheduler->EndCapture( m_CaptureId, bQueued );
+}
+
+void RemoteCamera::OnCaptureRate( float a_fRate )
+{
+	m_fCaptureRate = a_fRate;
+	if ( m_bStreaming )
+		StartStream();
+}
+
 void RemoteCamera::OnRemoteVideo( const ITopics::Payload & a_Payload )
 {
-	OnSendData( new VideoData( (unsigned char *)a_Payload.m_Data.c_str(), a_Payload.m_Data.size() ) );
+	SendFrame( a_Payload.m_Data );
 }
 
-void RemoteCamera::OnSendData( VideoData * a_pData )
+void RemoteCamera::OnSendData( IData * a_pData )
 {
+	m_Delivered += 1;
+	CaptureScheduler::Instance()->Delivered( m_CaptureId );
+
+	double now = Time().GetEpochTime();
+	if ( m_bStreaming && now - m_fLastReport >= 10.0 )
+	{
+		m_fLastReport = now;
+		MjpegStream::Stats stats = m_Stream.GetStats();
+		DataDelivery::Stats delivery;
+		DataDelivery::Instance()->GetStats( m_DeliveryId, delivery );
+		Log::Debug( "RemoteCamera", "Stream at %.1f fps, %u frames delivered, %u skipped, %u dropped, %u connects", 
+			stats.m_fFramesPerSec, (unsigned int)m_Delivered, (unsigned int)m_Skipped, (unsigned int)delivery.m_Dropped, 
+			(unsigned int)stats.m_Connects );
+	}
+
 	SendData( a_pData );
 }
-
@@ -27,6 +27,9 @@
 #include "utils/TimerPool.h"
 #include "services/PTZCamera.h"
 #include "sensors/VideoData.h"
+#include "utils/MjpegStream.h"
+#include "capture/CaptureScheduler.h"
+#include "capture/DataDelivery.h"
 
 class RemoteCamera : public Camera
 {
@@ -34,7 +37,9 @@ public:
     RTTI_DECL();
 
     //! Construction
-    RemoteCamera() : m_pCameraService( NULL ), m_Width( 320 ), m_Height( 240 ), m_StopThread(false), m_ThreadStopped(true)
+    RemoteCamera() : m_pCameraService( NULL ), m_Width( 320 ), m_Height( 240 ), m_bStream( true ), m_bDemandDriven( false ), 
+		m_fIdleFramesPerSec( 1.0f ), m_StopThread(false), m_ThreadStopped(true), m_CaptureId( 0 ), m_fCaptureRate( 0.0f ), 
+		m_bStreaming( false ), m_DeliveryId( 0 ), m_fLastFrame( 0.0 ), m_fLastReport( 0.0 ), m_Delivered( 0 ), m_Skipped( 0 )
     {}
 
 	//! ISerializable interface
@@ -53,16 +58,34 @@ private:
 	std::string				m_ServiceId;
 	int						m_Width;
 	int						m_Height;
+	bool					m_bStream;				// read the camera's MJPEG stream rather than a GET per frame
+	bool					m_bDemandDriven;		// drop to m_fIdleFramesPerSec when nobody has asked for video
+	float					m_fIdleFramesPerSec;
 	bool					m_StopThread;
 	bool					m_ThreadStopped;
 	PTZCamera *				m_pCameraService;
+	int						m_CaptureId;
+	volatile float			m_fCaptureRate;			// rate from the CaptureScheduler, 0 while nothing should be captured
+	bool					m_bStreaming;
+
+	MjpegStream				m_Stream;
+	int						m_DeliveryId;
+	double					m_fLastFrame;
+	double					m_fLastReport;
+	size_t					m_Delivered;
+	size_t					m_Skipped;				// frames the camera sent faster than we asked for, or while the last was queued
 
 	void					StreamingThread(void * args);
+	void					StartStream();
+	void					StartPolling();
+	void					SendFrame( const std::string & a_Frame );
 
 	//! Callbacks
 	void                    OnGetImage(const std::string & a_Image);
+	void					OnStreamFrame( const std::string & a_Frame );
+	void					OnCaptureRate( float a_fRate );
 	void					OnRemoteVideo( const ITopics::Payload & a_Payload );
-	void					OnSendData( VideoData * a_pData );
+	void					OnSendData( IData * a_pData );
 };
 
 #endif //SELF_REMOTECAMERA_H
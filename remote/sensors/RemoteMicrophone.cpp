@@ -25,13 +25,35 @@ REG_OVERRIDE_SERIALIZABLE(Microphone, RemoteMicrophone);
 REG_SERIALIZABLE( RemoteMicrophone );
 RTTI_IMPL(RemoteMicrophone, Microphone);
 
+void RemoteMicrophone::Serialize(Json::Value & json)
+{
+	Microphone::Serialize( json );
+
+	json["m_RemoteFormat"] = m_RemoteFormat;
+}
+
+void RemoteMicrophone::Deserialize(const Json::Value & json)
+{
+	Microphone::Deserialize( json );
+
+	if ( json["m_RemoteFormat"].isString() )
+		m_RemoteFormat = json["m_RemoteFormat"].asString();
+}
+
 bool RemoteMicrophone::OnStart()
 {
+	// convert once here, so subscribers always get audio in the format we advertise
+	AudioFormat recording( m_RecordingHZ, m_RecordingChannels, m_RecordingBits );
+	if (! m_Converter.Configure( m_RemoteFormat, recording.ToString() ) )
+		return false;
+	m_PayloadType = m_RemoteFormat;
+	m_bPayloadSupported = true;
+
 	SelfInstance * pInstance = SelfInstance::GetInstance();
 	if (pInstance != NULL)
 	{
 		ITopics * pTopics = pInstance->GetTopics();
-		pTopics->RegisterTopic("audio-input", "audio/L16;rate=16000");
+		pTopics->RegisterTopic("audio-input", m_RemoteFormat);
 		pTopics->Subscribe("audio-input", DELEGATE(RemoteMicrophone, OnRemoteAudio, const ITopics::Payload &, this));
 	}
 
@@ -62,7 +84,24 @@ void RemoteMicrophone::OnResume()
 
 void RemoteMicrophone::OnRemoteAudio( const ITopics::Payload & a_Payload )
 {
-	if (m_Paused <= 0 )
-		SendData( new AudioData( a_Payload.m_Data, 16000, 1, 16 ) );
+	// a publisher may send another format than the topic was registered with, no type means m_RemoteFormat
+	const std::string & type = a_Payload.m_Type.size() > 0 ? a_Payload.m_Type : m_RemoteFormat;
+	if ( type != m_PayloadType )
+	{
+		m_PayloadType = type;
+
+		AudioFormat format;
+		m_bPayloadSupported = format.Parse( type ) && m_Converter.Configure( format, m_Converter.GetOutputFormat() );
+		if (! m_bPayloadSupported )
+			Log::Warning( "RemoteMicrophone", "Dropping remote audio in unsupported format %s", type.c_str() );
+	}
+
+	if (m_Paused <= 0 && m_bPayloadSupported )
+	{
+		std::string converted;
+		m_Converter.Convert( a_Payload.m_Data, converted );
+		if ( converted.size() > 0 )
+			SendData( new AudioData( converted, m_RecordingHZ, m_RecordingChannels, m_RecordingBits ) );
+	}
 }
 
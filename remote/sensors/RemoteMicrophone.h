@@ -21,6 +21,7 @@
 
 #include "topics/ITopics.h"
 #include "sensors/Microphone.h"
+#include "audio/AudioConverter.h"
 
 class RemoteMicrophone : public Microphone
 {
@@ -28,9 +29,13 @@ public:
 	RTTI_DECL();
 
 	//! Construction
-	RemoteMicrophone()
+	RemoteMicrophone() : m_RemoteFormat( "audio/L16;rate=16000" ), m_bPayloadSupported( false )
 	{}
 
+	//! ISerializable interface
+	virtual void Serialize(Json::Value & json);
+	virtual void Deserialize(const Json::Value & json);
+
 	//! ISensor interface
 	virtual bool OnStart();
 	virtual bool OnStop();
@@ -39,6 +44,13 @@ public:
 
 	//! Callbacks
 	void OnRemoteAudio(const ITopics::Payload & a_Payload);
+
+private:
+	//! Data
+	std::string			m_RemoteFormat;			// format of the audio published to our topic
+	AudioConverter		m_Converter;			// converts from m_PayloadType to our recording format
+	std::string			m_PayloadType;			// format m_Converter is configured for
+	bool				m_bPayloadSupported;	// false if m_PayloadType can't be converted
 };
 
 #endif
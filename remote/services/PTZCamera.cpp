@@ -26,12 +26,37 @@
 REG_SERIALIZABLE(PTZCamera);
 RTTI_IMPL(PTZCamera, IService);
 
-PTZCamera::PTZCamera() : IService("PTZCamera")
+namespace {
+
+    std::string EncodeBase64(const std::string & a_Data)
+    {
+        static const char * CHARS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        std::string encoded;
+        for (size_t i = 0; i < a_Data.size(); i += 3)
+        {
+            unsigned int bits = ((unsigned char)a_Data[i]) << 16;
+            if (i + 1 < a_Data.size()) bits |= ((unsigned char)a_Data[i + 1]) << 8;
+            if (i + 2 < a_Data.size()) bits |= (unsigned char)a_Data[i + 2];
+
+            encoded += CHARS[(bits >> 18) & 0x3f];
+            encoded += CHARS[(bits >> 12) & 0x3f];
+            encoded += i + 1 < a_Data.size() ? CHARS[(bits >> 6) & 0x3f] : '=';
+            encoded += i + 2 < a_Data.size() ? CHARS[bits & 0x3f] : '=';
+        }
+        return encoded;
+    }
+}
+
+PTZCamera::PTZCamera() : IService("PTZCamera"), m_StreamPath("/axis-cgi/mjpg/video.cgi"), m_bStreamParams(true)
 {}
 
 void PTZCamera::Serialize(Json::Value & json)
 {
     IService::Serialize(json);
+
+    json["m_StreamPath"] = m_StreamPath;
+    json["m_bStreamParams"] = m_bStreamParams;
 }
 
 
@@ -39,6 +64,10 @@ void PTZCamera::Deserialize(const Json::Value & json)
 {
     IService::Deserialize(json);
 
+    if (json["m_StreamPath"].isString())
+        m_StreamPath = json["m_StreamPath"].asString();
+    if (json["m_bStreamParams"].isBool())
+        m_bStreamParams = json["m_bStreamParams"].asBool();
 }
 
 bool PTZCamera::Start()
@@ -65,4 +94,23 @@ IService::Request * PTZCamera::SetCameraCoordinates(const std::string & a_Direct
    return new RequestData(this, parameters, "GET", NULL_HEADERS, EMPTY_STRING, a_Callback);
 }
 
+std::string PTZCamera::GetStreamURL(int a_Width, int a_Height, float a_fFramesPerSec)
+{
+    if (m_pConfig == NULL)
+        return EMPTY_STRING;
+
+    std::string url(m_pConfig->m_URL + m_StreamPath);
+    if (m_bStreamParams)
+    {
+        url += url.find('?') == std::string::npos ? "?" : "&";
+        url += StringUtil::Format("resolution=%dx%d&fps=%d", a_Width, a_Height, (int)(a_fFramesPerSec + 0.5f));
+    }
+    return url;
+}
 
+std::string PTZCamera::GetAuthorization()
+{
+    if (m_pConfig == NULL || m_pConfig->m_User.size() == 0)
+        return EMPTY_STRING;
+    return "Basic " + EncodeBase64(m_pConfig->m_User + ":" + m_pConfig->m_Password);
+}
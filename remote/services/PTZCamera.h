@@ -46,8 +46,15 @@ public:
     IService::Request * GetImage(GetImageObject a_Callback);
     IService::Request * SetCameraCoordinates(const std::string & a_Direction, GetImageObject a_Callback);
 
-private:
+    //! URL of the camera's MJPEG stream, asking for the given size and rate if m_bStreamParams is set.
+    std::string GetStreamURL(int a_Width, int a_Height, float a_fFramesPerSec);
+    //! Value for the Authorization header of the stream, empty if the service has no user.
+    std::string GetAuthorization();
 
+private:
+    //! Data
+    std::string     m_StreamPath;
+    bool            m_bStreamParams;        // add the Axis resolution and fps parameters to the stream URL
 
 };
 
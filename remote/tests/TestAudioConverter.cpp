@@ -0,0 +1,110 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "audio/AudioConverter.h"
+
+#include <math.h>
+
+class TestAudioConverter : UnitTest
+{
+public:
+	//! Construction
+	TestAudioConverter() : UnitTest("TestAudioConverter")
+	{ }
+
+	virtual void RunTest()
+	{
+		AudioFormat format;
+		Test( format.Parse( "audio/L16;rate=22050" ) );
+		Test( format.m_Rate == 22050 && format.m_Channels == 1 && format.m_Bits == 16 );
+		Test( format.ToString() == "audio/L16;rate=22050" );
+		Test(! AudioFormat( 16000, 1, 24 ).IsValid() );
+
+		// same format in and out passes the audio through untouched
+		AudioConverter converter;
+		Test( converter.Configure( "audio/L16;rate=16000", "audio/L16;rate=16000" ) );
+		Test( converter.IsPassThrough() );
+		std::string tone( MakeTone( 1000.0, 16000, 1, 16000 ) ), output;
+		converter.Convert( tone, output );
+		Test( output == tone );
+
+		// TTS audio down to the microphone rate, pushed through in odd sized blocks
+		Test( converter.Configure( AudioFormat( 22050, 1, 16 ), AudioFormat( 16000, 1, 16 ) ) );
+		CheckTone( converter, 1000.0, 22050, 1, 16000, 1, 333 );
+		// and back up again
+		Test( converter.Configure( AudioFormat( 16000, 1, 16 ), AudioFormat( 22050, 1, 16 ) ) );
+		CheckTone( converter, 1000.0, 16000, 1, 22050, 1, 640 );
+		// stereo to mono and mono to stereo
+		Test( converter.Configure( AudioFormat( 44100, 2, 16 ), AudioFormat( 16000, 1, 16 ) ) );
+		CheckTone( converter, 3000.0, 44100, 2, 16000, 1, 1001 );
+		Test( converter.Configure( AudioFormat( 16000, 1, 16 ), AudioFormat( 16000, 2, 16 ) ) );
+		CheckTone( converter, 3000.0, 16000, 1, 16000, 2, 640 );
+
+		// content above the output nyquist must not alias down into the passband
+		Test( converter.Configure( AudioFormat( 22050, 1, 16 ), AudioFormat( 16000, 1, 16 ) ) );
+		output.clear();
+		converter.Convert( MakeTone( 10000.0, 22050, 1, 22050 ), output );
+		Test( GetRMS( output, 1, 0, 100 ) < 10.0 );
+	}
+
+	std::string MakeTone( double a_Frequency, unsigned int a_Rate, unsigned int a_Channels, unsigned int a_Frames )
+	{
+		std::string tone;
+		for(unsigned int i=0;i<a_Frames;++i)
+		{
+			short s = (short)(10000.0 * sin( 2.0 * 3.14159265358979 * a_Frequency * i / a_Rate ));
+			for(unsigned int c=0;c<a_Channels;++c)
+				tone.append( (const char *)&s, sizeof(s) );
+		}
+		return tone;
+	}
+
+	double GetRMS( const std::string & a_Audio, unsigned int a_Channels, unsigned int a_Channel, size_t a_Skip )
+	{
+		const short * pSamples = (const short *)a_Audio.data();
+		size_t frames = a_Audio.size() / (sizeof(short) * a_Channels);
+
+		double sum = 0.0;
+		for(size_t i=a_Skip;i<frames;++i)
+			sum += (double)pSamples[(i * a_Channels) + a_Channel] * pSamples[(i * a_Channels) + a_Channel];
+		return frames > a_Skip ? sqrt( sum / (frames - a_Skip) ) : 0.0;
+	}
+
+	void CheckTone( AudioConverter & a_Converter, double a_Frequency, unsigned int a_InRate, unsigned int a_InChannels,
+		unsigned int a_OutRate, unsigned int a_OutChannels, size_t a_BlockFrames )
+	{
+		std::string input( MakeTone( a_Frequency, a_InRate, a_InChannels, a_InRate ) ), output;
+		size_t block = a_BlockFrames * a_InChannels * sizeof(short);
+		for(size_t i=0;i<input.size();i += block)
+			a_Converter.Convert( input.data() + i, input.size() - i < block ? input.size() - i : block, output );
+
+		// we only hold back the filter delay, and the tone keeps its level in every channel
+		size_t frames = output.size() / (sizeof(short) * a_OutChannels);
+		Test( frames <= a_OutRate && frames > a_OutRate - 100 );
+		for(unsigned int c=0;c<a_OutChannels;++c)
+		{
+			double rms = GetRMS( output, a_OutChannels, c, 100 );
+			Log::Debug( "TestAudioConverter", "%u -> %u, channel %u, rms %f", a_InRate, a_OutRate, c, rms );
+			Test( fabs( rms - 7071.0 ) < 100.0 );
+		}
+	}
+};
+
+TestAudioConverter TEST_AUDIO_CONVERTER;
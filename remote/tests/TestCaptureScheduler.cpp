@@ -0,0 +1,127 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "capture/CaptureScheduler.h"
+
+#include <boost/thread.hpp>
+
+class TestCaptureScheduler : UnitTest
+{
+public:
+	//! Construction
+	TestCaptureScheduler() : UnitTest("TestCaptureScheduler"),
+		m_fRate(-1.0f),
+		m_Changes(0)
+	{ }
+
+	virtual void RunTest()
+	{
+		CaptureScheduler scheduler;
+		scheduler.SetReportInterval( 0.0 );
+
+		// nobody has asked for video yet, so we start at the idle rate
+		int id = scheduler.Register( "TestCamera", "VideoData", 30.0f, 2.0f, DELEGATE( TestCaptureScheduler, OnRate, float, this ) );
+		Test( scheduler.GetRate( id ) == 2.0f );
+		Test( m_Changes == 0 );
+
+		// the highest demand wins, capped at what the sensor can do, a rate of 0 asks for the most
+		int consumer1 = 0, consumer2 = 0;
+		scheduler.Demand( "VideoData", &consumer1, 10.0f );
+		Test( m_fRate == 10.0f && m_Changes == 1 );
+		scheduler.Demand( "TestCamera", &consumer2, 60.0f, 5.0 );
+		Test( m_fRate == 30.0f && m_Changes == 2 );
+		scheduler.Demand( "OtherCamera", &consumer2, 0.0f );
+		Test( m_fRate == 30.0f && m_Changes == 2 );
+
+		// the timed demand runs out, the other stays until released, then we drop back to idle
+		scheduler.Update( Time().GetEpochTime() + 6.0 );
+		Test( m_fRate == 10.0f && m_Changes == 3 );
+		scheduler.Demand( "VideoData", &consumer1, 0.0f );
+		Test( m_fRate == 30.0f && m_Changes == 4 );
+		scheduler.Release( "VideoData", &consumer1 );
+		Test( m_fRate == 2.0f && m_Changes == 5 );
+
+		// paused sensors capture nothing whatever is asked of them
+		scheduler.Demand( "VideoData", &consumer1, 15.0f );
+		scheduler.SetPaused( id, true );
+		Test( m_fRate == 0.0f && scheduler.GetRate( id ) == 0.0f );
+		scheduler.SetPaused( id, false );
+		Test( m_fRate == 15.0f );
+
+		// a capture is skipped while the last frame is still waiting for the main thread
+		Test( scheduler.BeginCapture( id ) );
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 20 ) );
+		scheduler.EndCapture( id, true );
+		Test(! scheduler.BeginCapture( id ) );
+		scheduler.Delivered( id );
+		Test( scheduler.BeginCapture( id ) );
+		scheduler.EndCapture( id, false );
+
+		// the main thread may deliver a frame before the capture that queued it has ended
+		Test( scheduler.BeginCapture( id ) );
+		scheduler.Delivered( id );
+		scheduler.EndCapture( id, true );
+		Test( scheduler.BeginCapture( id ) );
+		scheduler.EndCapture( id, false );
+
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 80 ) );
+		CaptureScheduler::Stats stats;
+		Test( scheduler.GetStats( id, stats ) );
+		Test( stats.m_Name == "TestCamera" && stats.m_Captured == 2 && stats.m_Skipped == 1 );
+		Test( stats.m_fDutyCycle > 0.05f && stats.m_fDutyCycle < 0.5f );
+		Log::Status( "TestCaptureScheduler", "Duty cycle %.1f%%, %.1f fps", stats.m_fDutyCycle * 100.0f, stats.m_fFramesPerSec );
+
+		// demands made on the scheduler of another plugin arrive on the capture-demand topic
+		scheduler.Release( "VideoData", &consumer1 );
+		Test( m_fRate == 2.0f );
+		Test( scheduler.GetRate( id ) == 2.0f );
+		scheduler.OnSharedDemand( MakeDemand( "{\"origin\":\"other\",\"consumer\":\"0x1\",\"target\":\"VideoData\",\"rate\":20,\"duration\":0}" ) );
+		Test( m_fRate == 20.0f );
+		scheduler.OnSharedDemand( MakeDemand( "{\"origin\":\"another\",\"consumer\":\"0x1\",\"target\":\"TestCamera\",\"rate\":5,\"duration\":5}" ) );
+		Test( m_fRate == 20.0f );
+		scheduler.OnSharedDemand( MakeDemand( "{\"origin\":\"other\",\"consumer\":\"0x1\",\"target\":\"VideoData\",\"release\":true}" ) );
+		Test( m_fRate == 5.0f );
+		scheduler.OnSharedDemand( MakeDemand( "not json" ) );
+		scheduler.Update( Time().GetEpochTime() + 6.0 );
+		Test( m_fRate == 2.0f );
+
+		scheduler.Unregister( id );
+		Test(! scheduler.GetStats( id, stats ) );
+		Test( scheduler.GetRate( id ) == 0.0f );
+	}
+
+	ITopics::Payload MakeDemand( const std::string & a_Data )
+	{
+		ITopics::Payload payload;
+		payload.m_Data = a_Data;
+		return payload;
+	}
+
+	void OnRate( float a_fRate )
+	{
+		m_fRate = a_fRate;
+		m_Changes += 1;
+	}
+
+	float		m_fRate;
+	int			m_Changes;
+};
+
+TestCaptureScheduler TEST_CAPTURE_SCHEDULER;
@@ -0,0 +1,179 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/ThreadPool.h"
+#include "sensors/VideoData.h"
+#include "sensors/AudioData.h"
+#include "capture/DataDelivery.h"
+
+#include <boost/thread.hpp>
+#include <map>
+#include <deque>
+
+class TestDataDelivery : UnitTest
+{
+public:
+	//! Construction
+	TestDataDelivery() : UnitTest("TestDataDelivery"),
+		m_Video(0),
+		m_Audio(0),
+		m_Sequence(0),
+		m_VideoDelivered(0),
+		m_LateAudio(0),
+		m_fMaxAudioLatency(0.0),
+		m_bProducing(false)
+	{ }
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+
+		DataDelivery delivery;
+		int video = delivery.Register( "TestVideo", DataDelivery::LATEST, DataDelivery::PRIORITY_LOW, 2, 
+			DELEGATE( TestDataDelivery, OnVideo, IData *, this ) );
+		int audio = delivery.Register( "TestAudio", DataDelivery::LOSSLESS, DataDelivery::PRIORITY_HIGH, 500, 
+			DELEGATE( TestDataDelivery, OnAudio, IData *, this ) );
+
+		// a camera floods us as fast as it can while a microphone sends 10ms of audio every 10ms, and
+		// each frame costs the main thread 5ms. The video queue has to stay at 2 frames however far 
+		// behind we fall, and the audio has to arrive complete without waiting behind the video.
+		const int AUDIO_CHUNKS = 200;
+		m_bProducing = true;
+		boost::thread videoThread( boost::bind( &TestDataDelivery::ProduceVideo, this, &delivery, video ) );
+		boost::thread audioThread( boost::bind( &TestDataDelivery::ProduceAudio, this, &delivery, audio, AUDIO_CHUNKS ) );
+
+		size_t maxQueued = 0;
+		Time start;
+		while( m_Audio < AUDIO_CHUNKS && (Time().GetEpochTime() - start.GetEpochTime()) < 30.0 )
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			maxQueued = std::max( maxQueued, delivery.GetQueued() );
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+		}
+		m_bProducing = false;
+		videoThread.join();
+		audioThread.join();
+
+		DataDelivery::Stats videoStats, audioStats;
+		Test( delivery.GetStats( video, videoStats ) );
+		Test( delivery.GetStats( audio, audioStats ) );
+		Log::Status( "TestDataDelivery", "Video %u delivered, %u dropped, peak %u. Audio %u delivered, %u dropped, peak %u, max latency %.1f ms. Max queued %u.",
+			(unsigned int)videoStats.m_Delivered, (unsigned int)videoStats.m_Dropped, (unsigned int)videoStats.m_Peak,
+			(unsigned int)audioStats.m_Delivered, (unsigned int)audioStats.m_Dropped, (unsigned int)audioStats.m_Peak,
+			m_fMaxAudioLatency * 1000.0, (unsigned int)maxQueued );
+
+		// audio only ever waits for the one frame already being sent, it's never passed by a frame queued 
+		// after it and no chunk is still queued when the next arrives, so at most the 2 frames and 1 chunk 
+		// are queued at once. The latency depends on the scheduler, so it's only logged.
+		Test( m_Audio == AUDIO_CHUNKS );
+		Test( audioStats.m_Dropped == 0 );
+		Test( m_LateAudio == 0 );
+		Test( audioStats.m_Peak <= 1 );
+		Test( videoStats.m_Peak <= 2 );
+		Test( videoStats.m_Dropped > videoStats.m_Delivered );
+		Test( maxQueued <= 3 );
+
+		// anything left behind is freed with its queue
+		delivery.Send( video, new VideoData( std::vector<unsigned char>( 16 ) ) );
+		Test( delivery.GetQueued() > 0 );
+		delivery.Unregister( video );
+		Test(! delivery.Send( video, new VideoData( std::vector<unsigned char>( 16 ) ) ) );
+		delivery.Unregister( audio );
+		Test( delivery.GetQueued() == 0 );
+		ThreadPool::Instance()->ProcessMainThread();
+	}
+
+	void ProduceVideo( DataDelivery * a_pDelivery, int a_Id )
+	{
+		std::vector<unsigned char> frame( 64 * 1024, 0x80 );
+		while( m_bProducing )
+		{
+			{
+				// the sequence is taken with the send, so it's the order the items were queued in
+				boost::lock_guard<boost::mutex> lock( m_SentLock );
+				VideoData * pVideo = new VideoData( frame );
+				m_VideoSent[ pVideo ] = ++m_Sequence;
+				a_pDelivery->Send( a_Id, pVideo );
+			}
+			boost::this_thread::yield();
+		}
+	}
+
+	void ProduceAudio( DataDelivery * a_pDelivery, int a_Id, int a_Chunks )
+	{
+		std::string chunk( 320, 0 );
+		for(int i=0;i<a_Chunks && m_bProducing;++i)
+		{
+			{
+				boost::lock_guard<boost::mutex> lock( m_SentLock );
+				m_AudioSent.push_back( std::make_pair( ++m_Sequence, Time().GetEpochTime() ) );
+				a_pDelivery->Send( a_Id, new AudioData( chunk, 16000, 1, 16 ) );
+			}
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) );
+		}
+	}
+
+	void OnVideo( IData * a_pData )
+	{
+		{
+			// dropped frames are freed, so a later frame may reuse the address, it overwrites the entry
+			boost::lock_guard<boost::mutex> lock( m_SentLock );
+			std::map<IData *,unsigned int>::iterator iSent = m_VideoSent.find( a_pData );
+			if ( iSent != m_VideoSent.end() )
+			{
+				m_VideoDelivered = std::max( m_VideoDelivered, iSent->second );
+				m_VideoSent.erase( iSent );
+			}
+		}
+		m_Video += 1;
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+		delete a_pData;
+	}
+
+	void OnAudio( IData * a_pData )
+	{
+		double sent = 0.0;
+		{
+			boost::lock_guard<boost::mutex> lock( m_SentLock );
+			if ( m_AudioSent.front().first < m_VideoDelivered )
+				m_LateAudio += 1;
+			sent = m_AudioSent.front().second;
+			m_AudioSent.pop_front();
+		}
+		m_fMaxAudioLatency = std::max( m_fMaxAudioLatency, Time().GetEpochTime() - sent );
+		m_Audio += 1;
+		delete a_pData;
+	}
+
+	volatile int			m_Video;
+	volatile int			m_Audio;
+	unsigned int			m_Sequence;				// order items were queued in, across both sources
+	unsigned int			m_VideoDelivered;		// latest sequence of a frame that's been delivered
+	int						m_LateAudio;			// chunks delivered after a frame queued later
+	double					m_fMaxAudioLatency;
+	volatile bool			m_bProducing;
+	boost::mutex			m_SentLock;
+	std::map<IData *,unsigned int>
+							m_VideoSent;
+	std::deque< std::pair<unsigned int,double> >
+							m_AudioSent;
+};
+
+TestDataDelivery TEST_DATA_DELIVERY;
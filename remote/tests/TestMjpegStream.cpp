@@ -0,0 +1,165 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+#include "utils/MjpegParser.h"
+#include "utils/MjpegStream.h"
+#include "tests/StandInServer.h"
+
+#include <string.h>
+
+class TestMjpegStream : UnitTest
+{
+public:
+	//! Construction
+	TestMjpegStream() : UnitTest("TestMjpegStream"),
+		m_Frames(0),
+		m_fLatency(0.0),
+		m_fMaxLatency(0.0),
+		m_bBadFrame(false),
+		m_FPS(0),
+		m_Count(0),
+		m_Size(0)
+	{ }
+
+	virtual void RunTest()
+	{
+		// parts with and without a length, fed one byte at a time, give back the same frames
+		std::string body = "--myboundary\r\nContent-Type: image/jpeg\r\nContent-Length: 5\r\n\r\nframe\r\n"
+			"--myboundary\r\nContent-Type: image/jpeg\r\n\r\nno length\r\n--myboundary\r\n\r\n\xff\xd8\r\n\xff\xd9\r\n"
+			"--myboundary--\r\n";
+		MjpegParser parser;
+		Test( parser.SetContentType( "multipart/x-mixed-replace; boundary=\"myboundary\"" ) );
+		bool bOK = true;
+		for(size_t i=0;i<body.size() && bOK;++i)
+			bOK = parser.Feed( body.data() + i, 1, DELEGATE( TestMjpegStream, OnParsed, const std::string &, this ) );
+		Test(! bOK );		// the closing boundary ends the stream
+		Test( m_Parsed.size() == 3 );
+		Test( m_Parsed.size() == 3 && m_Parsed[0] == "frame" && m_Parsed[1] == "no length" && m_Parsed[2] == "\xff\xd8\r\n\xff\xd9" );
+
+		// no boundary in the header, it comes from the body
+		MjpegParser guess;
+		m_Parsed.clear();
+		Test(! guess.SetContentType( "multipart/x-mixed-replace" ) );
+		Test( guess.Feed( body.data(), 120, DELEGATE( TestMjpegStream, OnParsed, const std::string &, this ) ) );
+		Test( m_Parsed.size() == 1 && m_Parsed[0] == "frame" );
+
+		// a stand-in camera on loopback, streaming 20 KB frames at 30 fps for two seconds
+		const int FPS = 30, SECONDS = 2, FRAME_SIZE = 20 * 1024;
+		m_FPS = FPS;
+		m_Count = FPS * SECONDS;
+		m_Size = FRAME_SIZE;
+		StandInServer camera( boost::bind( &TestMjpegStream::ServeStream, this, _1, _2, _3 ) );
+
+		MjpegStream stream;
+		stream.SetTimeouts( 0.2f, 5.0f );
+		Test( stream.Start( camera.GetURL() + StringUtil::Format( "/axis-cgi/mjpg/video.cgi?fps=%d", FPS ), 
+			"Basic dXNlcjpwYXNz", DELEGATE( TestMjpegStream, OnFrame, const std::string &, this ) ) );
+
+		double start = Time().GetEpochTime();
+		while( m_Frames < FPS * SECONDS && Time().GetEpochTime() - start < SECONDS * 3 )
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ) );
+		double elapsed = Time().GetEpochTime() - start;
+		MjpegStream::Stats stats = stream.GetStats();
+		stream.Stop();
+		camera.Stop();
+
+		Test( m_Frames == FPS * SECONDS );
+		Test(! m_bBadFrame );
+		Test( m_Request.find( "Authorization: Basic dXNlcjpwYXNz\r\n" ) != std::string::npos );
+		Test( stats.m_Connects == 1 );
+		Test( stats.m_fFramesPerSec > FPS * 0.8 );
+		Test( m_fLatency / m_Frames < 0.05 );
+		Log::Status( "TestMjpegStream", "%d frames in %.2f s, %.1f fps measured, latency %.2f ms mean, %.2f ms max", 
+			(int)m_Frames, elapsed, stats.m_fFramesPerSec, (m_fLatency * 1000.0) / m_Frames, m_fMaxLatency * 1000.0 );
+	}
+
+	void OnParsed( const std::string & a_Frame )
+	{
+		m_Parsed.push_back( a_Frame );
+	}
+
+	void OnFrame( const std::string & a_Frame )
+	{
+		// each frame starts with the time the server sent it
+		double sent = 0.0;
+		if ( a_Frame.size() < sizeof(sent) + 2 || (unsigned char)a_Frame[0] != 0xff || (unsigned char)a_Frame[1] != 0xd8 )
+		{
+			m_bBadFrame = true;
+			return;
+		}
+		memcpy( &sent, a_Frame.data() + 2, sizeof(sent) );
+		double latency = Time().GetEpochTime() - sent;
+		m_fLatency += latency;
+		if ( latency > m_fMaxLatency )
+			m_fMaxLatency = latency;
+		m_Frames += 1;
+	}
+
+	void ServeStream( StandInServer::Socket & a_Socket, boost::asio::streambuf & a_Buffer, const std::string & a_Request )
+	{
+		m_Request = a_Request;
+		try {
+			std::string head( "HTTP/1.0 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=myboundary\r\n\r\n" );
+			boost::asio::write( a_Socket, boost::asio::buffer( head ) );
+
+			std::string frame( m_Size, 'x' );
+			frame[0] = (char)0xff;
+			frame[1] = (char)0xd8;
+			double next = Time().GetEpochTime();
+			for(int i=0;i<m_Count;++i)
+			{
+				double now = Time().GetEpochTime();
+				if ( next > now )
+					boost::this_thread::sleep( boost::posix_time::microseconds( (long)((next - now) * 1000000.0) ) );
+				next += 1.0 / m_FPS;
+
+				// every other part leaves out the length, so both ways of finding the end are timed. Those
+				// parts can't be cut until the next boundary arrives, which adds a frame time to their latency
+				now = Time().GetEpochTime();
+				memcpy( &frame[2], &now, sizeof(now) );
+				std::string part( "--myboundary\r\nContent-Type: image/jpeg\r\n" );
+				if ( (i % 2) == 0 )
+					part += StringUtil::Format( "Content-Length: %d\r\n", m_Size );
+				part += "\r\n" + frame + "\r\n";
+				boost::asio::write( a_Socket, boost::asio::buffer( part ) );
+			}
+			boost::asio::write( a_Socket, boost::asio::buffer( std::string( "--myboundary--\r\n" ) ) );
+		}
+		catch( const std::exception & e )
+		{
+			Log::Error( "TestMjpegStream", "Stand-in camera failed: %s", e.what() );
+		}
+	}
+
+	std::vector<std::string>	m_Parsed;
+	std::string					m_Request;
+	volatile int				m_Frames;
+	double						m_fLatency;
+	double						m_fMaxLatency;
+	bool						m_bBadFrame;
+	int							m_FPS;
+	int							m_Count;
+	int							m_Size;
+};
+
+TestMjpegStream TEST_MJPEG_STREAM;
@@ -29,10 +29,12 @@ class TestRemoteMicrophone : UnitTest
 public:
 	//! Construction
 	TestRemoteMicrophone() : UnitTest("TestRemoteMicrophone"),
-		m_Counter(0)
+		m_Counter(0),
+		m_LastBytes(0)
 	{ }
 
 	int     m_Counter;
+	size_t	m_LastBytes;
 
 	virtual void RunTest()
 	{
@@ -56,6 +58,23 @@ public:
 		mic.OnRemoteAudio(payload);
 		Spin(m_Counter, 1);
 
+		// audio published at another rate than the topic is converted to ours, 100ms at 8kHz is 
+		// about twice the bytes at 16kHz, less what the filter holds back
+		ITopics::Payload narrow;
+		narrow.m_Type = "audio/L16;rate=8000";
+		narrow.m_Data.resize(1600);
+		mic.OnRemoteAudio(narrow);
+		Spin(m_Counter, 2);
+		Test(m_LastBytes > narrow.m_Data.size() && m_LastBytes <= narrow.m_Data.size() * 2);
+
+		// and audio we can't convert is dropped
+		ITopics::Payload compressed;
+		compressed.m_Type = "audio/ogg;codecs=opus";
+		compressed.m_Data = payload.m_Data;
+		mic.OnRemoteAudio(compressed);
+		ThreadPool::Instance()->ProcessMainThread();
+		Test(m_Counter == 2);
+
 		Test(mic.Unsubscribe(this));
 	}
 
@@ -65,6 +84,7 @@ public:
 		Test(pAudio != NULL);
 		Test(pAudio->GetWaveData().size() > 0);
 		Test(pAudio->GetFrequency() > 0);
+		m_LastBytes = pAudio->GetWaveData().size();
 
 		Sound sound;
 		sound.InitializeSound(pAudio->GetFrequency(), pAudio->GetChannels(), pAudio->GetBPS(), pAudio->GetWaveData());
@@ -0,0 +1,140 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "MjpegParser.h"
+#include "utils/HttpConnection.h"
+#include "utils/StringUtil.h"
+
+#include <stdlib.h>
+
+bool MjpegParser::SetContentType( const std::string & a_ContentType )
+{
+	size_t start = HttpConnection::ToLower( a_ContentType ).find( "boundary=" );
+	if ( start == std::string::npos )
+		return false;
+
+	std::string boundary( a_ContentType.substr( start + 9 ) );
+	size_t end = boundary.find( ';' );
+	if ( end != std::string::npos )
+		boundary = boundary.substr( 0, end );
+	boundary = StringUtil::Trim( boundary, " \t\"" );
+	if ( boundary.size() == 0 )
+		return false;
+
+	SetBoundary( boundary );
+	return true;
+}
+
+void MjpegParser::SetBoundary( const std::string & a_Boundary )
+{
+	// some cameras put the dashes in the header as well
+	m_Boundary = a_Boundary.compare( 0, 2, "--" ) == 0 ? a_Boundary : "--" + a_Boundary;
+}
+
+void MjpegParser::Reset()
+{
+	m_Buffer.clear();
+	m_State = BOUNDARY;
+	m_ContentLength = -1;
+}
+
+bool MjpegParser::Feed( const char * a_pData, size_t a_Bytes, FrameCallback a_Callback )
+{
+	// a boundary in the middle of a frame can't be in the bytes already searched
+	size_t scan = m_Buffer.size() > m_Boundary.size() + 2 ? m_Buffer.size() - (m_Boundary.size() + 2) : 0;
+	m_Buffer.append( a_pData, a_Bytes );
+
+	size_t pos = 0;
+	for(;;)
+	{
+		if ( m_State == BOUNDARY )
+		{
+			size_t eol = m_Buffer.find( "\r\n", pos );
+			if ( eol == std::string::npos )
+				break;
+
+			std::string line( m_Buffer, pos, eol - pos );
+			pos = eol + 2;
+			if ( m_Boundary.size() == 0 && line.compare( 0, 2, "--" ) == 0 )
+				m_Boundary = line;
+			if ( m_Boundary.size() > 0 && line.compare( 0, m_Boundary.size(), m_Boundary ) == 0 )
+			{
+				if ( line.compare( m_Boundary.size(), 2, "--" ) == 0 )
+					return false;			// the closing boundary, the camera ended the stream
+				m_State = HEADERS;
+				m_ContentLength = -1;
+			}
+		}
+		else if ( m_State == HEADERS )
+		{
+			size_t eol = m_Buffer.find( "\r\n", pos );
+			if ( eol == std::string::npos )
+				break;
+
+			std::string line( m_Buffer, pos, eol - pos );
+			pos = eol + 2;
+			if ( line.size() == 0 )
+			{
+				m_State = BODY;
+				continue;
+			}
+
+			size_t colon = line.find( ':' );
+			if ( colon != std::string::npos && HttpConnection::ToLower( line.substr( 0, colon ) ) == "content-length" )
+				m_ContentLength = atol( line.c_str() + colon + 1 );
+		}
+		else
+		{
+			size_t end = std::string::npos, next = std::string::npos;
+			if ( m_ContentLength >= 0 )
+			{
+				if ( m_Buffer.size() - pos >= (size_t)m_ContentLength )
+					end = next = pos + m_ContentLength;
+			}
+			else
+			{
+				// the part ends with the CRLF in front of the next boundary
+				size_t boundary = m_Buffer.find( "\r\n" + m_Boundary, pos > scan ? pos : scan );
+				if ( boundary != std::string::npos )
+				{
+					end = boundary;
+					next = boundary + 2;
+				}
+			}
+
+			if ( end == std::string::npos )
+			{
+				if ( m_Buffer.size() - pos > m_MaxFrameSize )
+					return false;
+				break;
+			}
+
+			m_Frames += 1;
+			if ( a_Callback.IsValid() )
+				a_Callback( m_Buffer.substr( pos, end - pos ) );
+			pos = next;
+			m_State = BOUNDARY;
+		}
+	}
+
+	m_Buffer.erase( 0, pos );
+	if ( m_State != BODY && m_Buffer.size() > 64 * 1024 )
+		return false;			// no line is ever this long, we aren't reading a multipart stream
+	return true;
+}
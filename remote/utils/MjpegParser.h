@@ -0,0 +1,72 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_MJPEG_PARSER_H
+#define SELF_MJPEG_PARSER_H
+
+#include <string>
+
+#include "utils/Delegate.h"
+
+//! Splits a multipart/x-mixed-replace body into frames as the bytes arrive. Parts with a 
+//! Content-Length are cut by length, parts without one are cut at the next boundary.
+class MjpegParser
+{
+public:
+	//! Types
+	typedef Delegate<const std::string &>		FrameCallback;
+
+	//! Construction
+	MjpegParser() : m_State( BOUNDARY ), m_ContentLength( -1 ), m_Frames( 0 ), m_MaxFrameSize( 8 * 1024 * 1024 )
+	{}
+
+	//! Get the boundary from the Content-Type header of the response, returns false if it has none, 
+	//! in which case the boundary is taken from the first line of the body that starts with --.
+	bool SetContentType( const std::string & a_ContentType );
+	void SetBoundary( const std::string & a_Boundary );
+	void Reset();
+
+	//! Feed the next bytes of the body, a_Callback is invoked with each complete frame. Returns false 
+	//! if the stream is broken and the connection should be dropped.
+	bool Feed( const char * a_pData, size_t a_Bytes, FrameCallback a_Callback );
+
+	size_t GetFrames() const
+	{
+		return m_Frames;
+	}
+
+private:
+	//! Types
+	enum State
+	{
+		BOUNDARY,			// looking for the boundary line
+		HEADERS,			// reading the part headers
+		BODY				// reading the frame
+	};
+
+	//! Data
+	std::string			m_Boundary;			// including the leading --
+	std::string			m_Buffer;
+	State				m_State;
+	long				m_ContentLength;	// of the current part, -1 if not given
+	size_t				m_Frames;
+	size_t				m_MaxFrameSize;
+};
+
+#endif // SELF_MJPEG_PARSER_H
@@ -0,0 +1,306 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "MjpegStream.h"
+#include "utils/HttpConnection.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+
+#include <boost/bind.hpp>
+
+namespace {
+
+	boost::posix_time::milliseconds Seconds( float a_fSeconds )
+	{
+		return boost::posix_time::milliseconds( (long)(a_fSeconds * 1000.0f) );
+	}
+
+	const size_t MAX_RESPONSE_HEAD = 16 * 1024;
+}
+
+MjpegStream::MjpegStream() : 
+	m_pService( NULL ), 
+	m_pResolver( NULL ), 
+	m_pSocket( NULL ), 
+	m_pRetryTimer( NULL ), 
+	m_pReadTimer( NULL ), 
+	m_pThread( NULL ),
+	m_fRetryInterval( 2.0f ),
+	m_fReadTimeout( 10.0f ),
+	m_bConnected( false ),
+	m_bHeaders( false ),
+	m_fRateStart( 0.0 ),
+	m_RateFrames( 0 )
+{}
+
+MjpegStream::~MjpegStream()
+{
+	Stop();
+}
+
+bool MjpegStream::Start( const std::string & a_URL, const std::string & a_Authorization, FrameCallback a_Callback )
+{
+	if ( m_pService != NULL )
+		return false;
+
+	HttpConnection::URL url;
+	if (! url.Parse( a_URL ) || url.m_bSecure )
+	{
+		Log::Error( "MjpegStream", "Only http streams are supported: %s", a_URL.c_str() );
+		return false;
+	}
+	m_Host = url.m_Host;
+	m_Port = url.m_Port;
+
+	// HTTP/1.0 so the server never chunks the stream
+	m_Request = StringUtil::Format( "GET %s HTTP/1.0\r\nHost: %s\r\nAccept: multipart/x-mixed-replace, image/jpeg\r\n",
+		url.m_Path.c_str(), url.m_Authority.c_str() );
+	if ( a_Authorization.size() > 0 )
+		m_Request += "Authorization: " + a_Authorization + "\r\n";
+	m_Request += "\r\n";
+
+	m_URL = a_URL;
+	m_Callback = a_Callback;
+	m_Stats = Stats();
+	m_fRateStart = Time().GetEpochTime();
+	m_RateFrames = 0;
+
+	m_pService = new boost::asio::io_service();
+	m_pResolver = new boost::asio::ip::tcp::resolver( *m_pService );
+	m_pSocket = new boost::asio::ip::tcp::socket( *m_pService );
+	m_pRetryTimer = new boost::asio::deadline_timer( *m_pService );
+	m_pReadTimer = new boost::asio::deadline_timer( *m_pService );
+
+	m_pService->post( boost::bind( &MjpegStream::Connect, this ) );
+	m_pThread = new boost::thread( boost::bind( &MjpegStream::StreamThread, this ) );
+	return true;
+}
+
+void MjpegStream::Stop()
+{
+	if ( m_pService == NULL )
+		return;
+
+	m_pService->stop();
+	if ( m_pThread != NULL )
+	{
+		m_pThread->join();
+		delete m_pThread;
+		m_pThread = NULL;
+	}
+
+	delete m_pReadTimer;
+	m_pReadTimer = NULL;
+	delete m_pRetryTimer;
+	m_pRetryTimer = NULL;
+	delete m_pSocket;
+	m_pSocket = NULL;
+	delete m_pResolver;
+	m_pResolver = NULL;
+	delete m_pService;
+	m_pService = NULL;
+
+	m_bConnected = false;
+	m_Callback = FrameCallback();
+}
+
+MjpegStream::Stats MjpegStream::GetStats()
+{
+	boost::lock_guard<boost::mutex> lock( m_StatsLock );
+	return m_Stats;
+}
+
+void MjpegStream::StreamThread()
+{
+	boost::asio::io_service::work work( *m_pService );
+	m_pService->run();
+}
+
+void MjpegStream::Connect()
+{
+	m_bHeaders = false;
+	m_Response.clear();
+	m_Parser.Reset();
+
+	boost::asio::ip::tcp::resolver::query q( m_Host, m_Port );
+	m_pResolver->async_resolve( q, boost::bind( &MjpegStream::OnResolve, this, 
+		boost::asio::placeholders::error, boost::asio::placeholders::iterator ) );
+}
+
+void MjpegStream::OnResolve( const boost::system::error_code & a_Error, boost::asio::ip::tcp::resolver::iterator a_Endpoints )
+{
+	if ( a_Error )
+		Retry( a_Error.message() );
+	else
+		boost::asio::async_connect( *m_pSocket, a_Endpoints, boost::bind( &MjpegStream::OnConnect, this, boost::asio::placeholders::error ) );
+}
+
+void MjpegStream::OnConnect( const boost::system::error_code & a_Error )
+{
+	if ( a_Error )
+	{
+		Retry( a_Error.message() );
+		return;
+	}
+
+	boost::system::error_code error;
+	m_pSocket->set_option( boost::asio::ip::tcp::no_delay( true ), error );
+	boost::asio::async_write( *m_pSocket, boost::asio::buffer( m_Request ), 
+		boost::bind( &MjpegStream::OnWrite, this, boost::asio::placeholders::error ) );
+}
+
+void MjpegStream::OnWrite( const boost::system::error_code & a_Error )
+{
+	if ( a_Error )
+		Retry( a_Error.message() );
+	else
+		Read();
+}
+
+void MjpegStream::Read()
+{
+	// a camera that stops sending without closing would otherwise leave us waiting forever
+	m_pReadTimer->expires_from_now( Seconds( m_fReadTimeout ) );
+	m_pReadTimer->async_wait( boost::bind( &MjpegStream::OnReadTimeout, this, boost::asio::placeholders::error ) );
+
+	m_pSocket->async_read_some( boost::asio::buffer( m_Buffer, sizeof(m_Buffer) ), 
+		boost::bind( &MjpegStream::OnRead, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred ) );
+}
+
+void MjpegStream::OnReadTimeout( const boost::system::error_code & a_Error )
+{
+	if ( a_Error == boost::asio::error::operation_aborted )
+		return;
+
+	Log::Warning( "MjpegStream", "No data from %s for %.1f seconds.", m_URL.c_str(), m_fReadTimeout );
+	boost::system::error_code error;
+	m_pSocket->close( error );
+}
+
+void MjpegStream::OnRead( const boost::system::error_code & a_Error, size_t a_Bytes )
+{
+	if ( a_Error )
+	{
+		Retry( a_Error.message() );
+		return;
+	}
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_StatsLock );
+		m_Stats.m_Bytes += a_Bytes;
+	}
+
+	bool bOK = true;
+	if (! m_bHeaders )
+	{
+		m_Response.append( m_Buffer, a_Bytes );
+
+		size_t used = 0;
+		if (! ParseHeaders( used ) )
+			return;
+		if ( m_bHeaders )
+			bOK = m_Parser.Feed( m_Response.data() + used, m_Response.size() - used, 
+				DELEGATE( MjpegStream, OnFrame, const std::string &, this ) );
+	}
+	else
+		bOK = m_Parser.Feed( m_Buffer, a_Bytes, DELEGATE( MjpegStream, OnFrame, const std::string &, this ) );
+
+	if (! bOK )
+		Retry( "stream ended" );
+	else
+		Read();
+}
+
+bool MjpegStream::ParseHeaders( size_t & a_Used )
+{
+	size_t end = m_Response.find( "\r\n\r\n" );
+	if ( end == std::string::npos )
+	{
+		if ( m_Response.size() > MAX_RESPONSE_HEAD )
+		{
+			Retry( "response head too large" );
+			return false;
+		}
+		return true;
+	}
+
+	HttpConnection::Response response;
+	response.ParseHead( m_Response.substr( 0, end + 4 ) );
+	if ( response.m_StatusCode != 200 )
+	{
+		Retry( StringUtil::Format( "HTTP status %d", response.m_StatusCode ) );
+		return false;
+	}
+
+	std::string contentType( response.GetHeader( "content-type" ) );
+	if ( contentType.size() > 0 && !m_Parser.SetContentType( contentType ) )
+		Log::Warning( "MjpegStream", "No boundary in %s, using the first one in the stream.", contentType.c_str() );
+
+	a_Used = end + 4;
+	m_bHeaders = true;
+	m_bConnected = true;
+	{
+		boost::lock_guard<boost::mutex> lock( m_StatsLock );
+		m_Stats.m_Connects += 1;
+	}
+	Log::Status( "MjpegStream", "Streaming from %s", m_URL.c_str() );
+	return true;
+}
+
+void MjpegStream::Retry( const std::string & a_Reason )
+{
+	if ( m_bConnected )
+		Log::Warning( "MjpegStream", "Lost stream from %s: %s", m_URL.c_str(), a_Reason.c_str() );
+	else
+		Log::Warning( "MjpegStream", "Failed to open %s: %s", m_URL.c_str(), a_Reason.c_str() );
+	m_bConnected = false;
+
+	boost::system::error_code error;
+	m_pReadTimer->cancel( error );
+	m_pSocket->close( error );
+
+	m_pRetryTimer->expires_from_now( Seconds( m_fRetryInterval ) );
+	m_pRetryTimer->async_wait( boost::bind( &MjpegStream::OnRetry, this, boost::asio::placeholders::error ) );
+}
+
+void MjpegStream::OnRetry( const boost::system::error_code & a_Error )
+{
+	if (! a_Error )
+		Connect();
+}
+
+void MjpegStream::OnFrame( const std::string & a_Frame )
+{
+	double now = Time().GetEpochTime();
+	{
+		boost::lock_guard<boost::mutex> lock( m_StatsLock );
+		m_Stats.m_Frames += 1;
+		m_RateFrames += 1;
+		if ( now - m_fRateStart >= 1.0 )
+		{
+			m_Stats.m_fFramesPerSec = m_RateFrames / (now - m_fRateStart);
+			m_fRateStart = now;
+			m_RateFrames = 0;
+		}
+	}
+
+	if ( m_Callback.IsValid() )
+		m_Callback( a_Frame );
+}
@@ -0,0 +1,119 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_MJPEG_STREAM_H
+#define SELF_MJPEG_STREAM_H
+
+#include <string>
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+#include "MjpegParser.h"
+#include "utils/Delegate.h"
+
+//! Reads a multipart MJPEG stream, such as Axis mjpg/video.cgi, over one HTTP connection that stays
+//! open, instead of a request per frame. Frames are passed to the callback on the stream's own 
+//! thread as soon as each one is complete. The connection is retried if it drops or goes quiet.
+class MjpegStream
+{
+public:
+	//! Types
+	typedef Delegate<const std::string &>		FrameCallback;
+
+	struct Stats
+	{
+		Stats() : m_Frames( 0 ), m_Bytes( 0 ), m_Connects( 0 ), m_fFramesPerSec( 0.0 )
+		{}
+
+		size_t		m_Frames;
+		size_t		m_Bytes;
+		size_t		m_Connects;
+		double		m_fFramesPerSec;		// measured over the last second or so
+	};
+
+	//! Construction
+	MjpegStream();
+	~MjpegStream();
+
+	//! Connect to a_URL, which must be http, and keep the stream open until Stop(). a_Authorization 
+	//! is sent as the Authorization header if not empty.
+	bool Start( const std::string & a_URL, const std::string & a_Authorization, FrameCallback a_Callback );
+	void Stop();
+
+	bool IsConnected() const
+	{
+		return m_bConnected;
+	}
+	Stats GetStats();
+
+	//! How long to wait before reconnecting, and how long the stream may go without data.
+	void SetTimeouts( float a_fRetryInterval, float a_fReadTimeout )
+	{
+		m_fRetryInterval = a_fRetryInterval;
+		m_fReadTimeout = a_fReadTimeout;
+	}
+
+private:
+	//! Data
+	boost::asio::io_service *	m_pService;
+	boost::asio::ip::tcp::resolver *
+								m_pResolver;
+	boost::asio::ip::tcp::socket *
+								m_pSocket;
+	boost::asio::deadline_timer *
+								m_pRetryTimer;
+	boost::asio::deadline_timer *
+								m_pReadTimer;
+	boost::thread *				m_pThread;
+
+	std::string					m_URL;
+	std::string					m_Host;
+	std::string					m_Port;
+	std::string					m_Request;
+	FrameCallback				m_Callback;
+	float						m_fRetryInterval;
+	float						m_fReadTimeout;
+	volatile bool				m_bConnected;
+
+	bool						m_bHeaders;			// true once the response headers are read
+	std::string					m_Response;
+	MjpegParser					m_Parser;
+	char						m_Buffer[ 16 * 1024 ];
+
+	boost::mutex				m_StatsLock;
+	Stats						m_Stats;
+	double						m_fRateStart;
+	size_t						m_RateFrames;
+
+	void Connect();
+	void OnResolve( const boost::system::error_code & a_Error, boost::asio::ip::tcp::resolver::iterator a_Endpoints );
+	void OnConnect( const boost::system::error_code & a_Error );
+	void OnWrite( const boost::system::error_code & a_Error );
+	void Read();
+	void OnRead( const boost::system::error_code & a_Error, size_t a_Bytes );
+	void OnReadTimeout( const boost::system::error_code & a_Error );
+	bool ParseHeaders( size_t & a_Used );
+	void Retry( const std::string & a_Reason );
+	void OnRetry( const boost::system::error_code & a_Error );
+	void OnFrame( const std::string & a_Frame );
+	void StreamThread();
+};
+
+#endif // SELF_MJPEG_STREAM_H
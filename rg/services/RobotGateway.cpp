@@ -4,14 +4,78 @@
 #include "blackboard/BlackBoard.h"
 #include "blackboard/Health.h"
 #include "utils/StringUtil.h"
+#include "utils/JsonHelpers.h"
 #include "utils/URL.h"
+#include "utils/Time.h"
 #include "topics/TopicManager.h"
 
 #include "RobotAuthenticate.h"
 #include "RobotMail.h"
 
+#include <fstream>
+
+#ifdef RG_ENABLE_GZIP
+#include <zlib.h>
+#include <string.h>
+#endif
+
 const double UPDATE_CONFIG_INTERVAL	= 300.0;
 
+//! Append a JSON quoted & escaped string to the output.
+static void AppendJsonString( std::string & a_Out, const std::string & a_Value )
+{
+	static const char HEX[] = "0123456789abcdef";
+
+	a_Out += '"';
+	for(size_t i=0;i<a_Value.size();++i)
+	{
+		unsigned char c = (unsigned char)a_Value[i];
+		switch( c )
+		{
+		case '"':	a_Out += "\\\""; break;
+		case '\\':	a_Out += "\\\\"; break;
+		case '\n':	a_Out += "\\n"; break;
+		case '\r':	a_Out += "\\r"; break;
+		case '\t':	a_Out += "\\t"; break;
+		default:
+			if ( c < 0x20 )
+			{
+				a_Out += "\\u00";
+				a_Out += HEX[c >> 4];
+				a_Out += HEX[c & 0xf];
+			}
+			else
+				a_Out += (char)c;
+			break;
+		}
+	}
+	a_Out += '"';
+}
+
+#ifdef RG_ENABLE_GZIP
+//! Compress the provided data into a gzip stream, returns false on failure.
+static bool GzipData( const std::string & a_Input, std::string & a_Output )
+{
+	z_stream zs;
+	memset( &zs, 0, sizeof(zs) );
+	// 15 window bits + 16 selects the gzip wrapper instead of zlib
+	if ( deflateInit2( &zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+		return false;
+
+	a_Output.resize( deflateBound( &zs, (uLong)a_Input.size() ) );
+	zs.next_in = (Bytef *)a_Input.data();
+	zs.avail_in = (uInt)a_Input.size();
+	zs.next_out = (Bytef *)&a_Output[0];
+	zs.avail_out = (uInt)a_Output.size();
+
+	int result = deflate( &zs, Z_FINISH );
+	a_Output.resize( zs.total_out );
+	deflateEnd( &zs );
+
+	return result == Z_STREAM_END;
+}
+#endif
+
 REG_SERIALIZABLE(RobotGateway);
 REG_OVERRIDE_SERIALIZABLE(IGateway,RobotGateway);
 RTTI_IMPL(RobotGateway, IGateway);
@@ -22,8 +86,27 @@ RobotGateway::RobotGateway() : IGateway( "RobotGatewayV1" ),
 	m_PersistLogInterval( 60.0 ), 
 	m_PersistLogLevel( LL_DEBUG_LOW ), 
 	m_ConfigsFetched( false ),
-	m_ParentFetched( false ),
-	m_HeartBeatInterval( 15.0f )
+	m_BootstrapTimeout( 0.0f ),
+	m_SnapshotFile( "RobotGateway.json" ),
+	m_bRefetchConfig( false ),
+	m_HeartBeatInterval( 15.0f ),
+	m_PersistLogBufferSize( 2000 ),
+	m_PersistLogBatchSize( 500 ),
+	m_bCompressLogs( true ),
+	m_PersistLogHead( 0 ),
+	m_PersistLogCount( 0 ),
+	m_DroppedLogs( 0 ),
+	m_bPersistFlushQueued( false ),
+	m_bPersistTimerQueued( false ),
+	m_bPersistInFlight( false ),
+	m_OldestLogTime( 0 ),
+	m_NewestLogTime( 0 ),
+	m_TelemetryEndpoint( "/v1/telemetry" ),
+	m_TelemetryRetryInterval( 300.0f ),
+	m_TelemetryAckTimeout( 30.0f ),
+	m_HttpRequests( 0 ),
+	m_ChannelMessages( 0 ),
+	m_StatsTime( 0 )
 {}
 
 RobotGateway::~RobotGateway()
@@ -35,9 +118,17 @@ void RobotGateway::Serialize(Json::Value & json)
 
 	json["m_bApplyRemoteConfigs"] = m_bApplyRemoteConfigs;
 	json["m_bApplyParentHost"] = m_bApplyParentHost;
+	json["m_BootstrapTimeout"] = m_BootstrapTimeout;
+	json["m_SnapshotFile"] = m_SnapshotFile;
 	json["m_PersistLogInterval"] = m_PersistLogInterval;
 	json["m_PersistLogLevel"] = (int)m_PersistLogLevel;
 	json["m_HeartBeatInterval"] = m_HeartBeatInterval;
+	json["m_PersistLogBufferSize"] = (Json::UInt)m_PersistLogBufferSize;
+	json["m_PersistLogBatchSize"] = (Json::UInt)m_PersistLogBatchSize;
+	json["m_bCompressLogs"] = m_bCompressLogs;
+	json["m_TelemetryEndpoint"] = m_TelemetryEndpoint;
+	json["m_TelemetryRetryInterval"] = m_TelemetryRetryInterval;
+	json["m_TelemetryAckTimeout"] = m_TelemetryAckTimeout;
 	SerializeVector( "m_PersistLogFilter", m_PersistLogFilter, json );
 }
 
@@ -49,13 +140,34 @@ void RobotGateway::Deserialize(const Json::Value & json)
 		m_bApplyRemoteConfigs = json["m_bApplyRemoteConfigs"].asBool();
 	if (json["m_bApplyParentHost"].isBool() )
 		m_bApplyParentHost = json["m_bApplyParentHost"].asBool();
+	if (json["m_BootstrapTimeout"].isNumeric() )
+		m_BootstrapTimeout = json["m_BootstrapTimeout"].asFloat();
+	if (json["m_SnapshotFile"].isString() )
+		m_SnapshotFile = json["m_SnapshotFile"].asString();
 	DeserializeVector( "m_PersistLogFilter", json, m_PersistLogFilter );
 	if (json["m_PersistLogInterval"].isDouble() )
 		m_PersistLogInterval = json["m_PersistLogInterval"].asDouble();
-	if (json["m_PersistLogInterval"].isInt() )
+	if (json["m_PersistLogLevel"].isInt() )
 		m_PersistLogLevel = (LogLevel)json["m_PersistLogLevel"].asInt();
-	if (json["m_PersistLogInterval"].isDouble() )
+	if (json["m_HeartBeatInterval"].isNumeric() )
 		m_HeartBeatInterval = json["m_HeartBeatInterval"].asFloat();
+	if (json["m_PersistLogBufferSize"].isNumeric() )
+		m_PersistLogBufferSize = json["m_PersistLogBufferSize"].asUInt();
+	if (json["m_PersistLogBatchSize"].isNumeric() )
+		m_PersistLogBatchSize = json["m_PersistLogBatchSize"].asUInt();
+	if (json["m_bCompressLogs"].isBool() )
+		m_bCompressLogs = json["m_bCompressLogs"].asBool();
+	if (json["m_TelemetryEndpoint"].isString() )
+		m_TelemetryEndpoint = json["m_TelemetryEndpoint"].asString();
+	if (json["m_TelemetryRetryInterval"].isNumeric() )
+		m_TelemetryRetryInterval = json["m_TelemetryRetryInterval"].asFloat();
+	if (json["m_TelemetryAckTimeout"].isNumeric() )
+		m_TelemetryAckTimeout = json["m_TelemetryAckTimeout"].asFloat();
+
+	if ( m_PersistLogBufferSize < 1 )
+		m_PersistLogBufferSize = 1;
+	if ( m_PersistLogBatchSize > m_PersistLogBufferSize )
+		m_PersistLogBatchSize = m_PersistLogBufferSize;
 }
 
 bool RobotGateway::Start()
@@ -97,15 +209,37 @@ bool RobotGateway::Start()
 
 	Log::RegisterReactor( this );
 
+	// start from the last known configuration, any changes are applied when the gateway responds
+	bool bHaveSnapshot = LoadSnapshot();
+
 	Log::Status("RobotGateway", "Registering embodiment");
 	RegisterEmbodiment(DELEGATE(RobotGateway, OnRegisteredEmbodiment, const Json::Value &, this));
-
-	while (!m_ConfigsFetched || !m_ParentFetched)
+	GetOrganization( DELEGATE(RobotGateway, OnOrganization, const Json::Value &,this) );
+	GetOrgAdminList( DELEGATE(RobotGateway, OnOrgAdminList, const Json::Value &, this) );
+	if ( m_bApplyParentHost && m_Snapshot["parentId"].isString() )
+		GetParent( m_Snapshot["parentId"].asString(), DELEGATE(RobotGateway, OnParent, const Json::Value &,this) );
+	UpdateConfig();
+
+	// without a snapshot the other services may have no credentials yet, they are applied as soon as
+	// the listing arrives. Only wait for it if configured to, and never longer than m_BootstrapTimeout.
+	if (! bHaveSnapshot && m_BootstrapTimeout > 0.0f )
 	{
-		ThreadPool::Instance()->ProcessMainThread();
-		boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+		Time start;
+		while (! m_ConfigsFetched && (Time().GetEpochTime() - start.GetEpochTime()) < m_BootstrapTimeout )
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+		}
+
+		if (! m_ConfigsFetched )
+			Log::Warning( "RobotGateway", "Timed out waiting for service configuration, continuing startup." );
 	}
 
+	m_StatsTime = Time().GetEpochTime();
+	m_Telemetry.SetRetryInterval( m_TelemetryRetryInterval );
+	m_Telemetry.SetAckTimeout( m_TelemetryAckTimeout );
+	ConnectTelemetry();
+
 	//Start heartbeat timer pool
 	TimerPool * pPool = TimerPool::Instance();
 	if ( pPool != NULL )
@@ -118,8 +252,15 @@ bool RobotGateway::Start()
 
 bool RobotGateway::Stop()
 {
+	m_Telemetry.Close();
 	m_spConfigTimer.reset();
 	m_spPersistLogTimer.reset();
+	m_spHeartbeatTimer.reset();
+	{
+		boost::lock_guard<boost::mutex> lock( m_PersistLogLock );
+		m_bPersistTimerQueued = false;
+	}
+	m_spConfigClient.reset();
 
 	Log::RemoveReactor( this, false );
 
@@ -145,27 +286,49 @@ void RobotGateway::Process(const LogRecord & a_Record)
 
 		if (! bFiltered )
 		{
-			Json::Value json;
-			json["time"] = a_Record.m_Time;
-
-			double epochTime = (double)a_Record.m_TimeEpoch;
-			json["timeEpoch"] = epochTime;
-			if (epochTime > m_NewestLogTime || m_NewestLogTime == 0)
-				m_NewestLogTime = epochTime;
-			if (epochTime < m_OldestLogTime || m_OldestLogTime == 0)
-				m_OldestLogTime = epochTime;
-
-			json["level"] = Log::LevelText( a_Record.m_Level );
-			json["subsystem"] = a_Record.m_SubSystem;
-			json["message"] = a_Record.m_Message;
-
-			m_PersistLogs.push_back( json.toStyledString() );
-
-			if (! m_spPersistLogTimer )
+			bool bStartTimer = false;
+			bool bFlush = false;
 			{
-				m_spPersistLogTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( RobotGateway, OnPersistLogs, this ), 
-					m_PersistLogInterval, true, false );
+				boost::lock_guard<boost::mutex> lock( m_PersistLogLock );
+				if ( m_PersistLogs.size() != m_PersistLogBufferSize )
+				{
+					m_PersistLogs.resize( m_PersistLogBufferSize );
+					m_PersistLogHead = m_PersistLogCount = 0;
+				}
+
+				// when full, overwrite the oldest record rather than growing without bound
+				size_t index = (m_PersistLogHead + m_PersistLogCount) % m_PersistLogs.size();
+				if ( m_PersistLogCount == m_PersistLogs.size() )
+				{
+					m_PersistLogHead = (m_PersistLogHead + 1) % m_PersistLogs.size();
+					m_DroppedLogs += 1;
+				}
+				else
+					m_PersistLogCount += 1;
+
+				LogEntry & entry = m_PersistLogs[index];
+				entry.m_Time = a_Record.m_Time;
+				entry.m_TimeEpoch = (double)a_Record.m_TimeEpoch;
+				entry.m_Level = a_Record.m_Level;
+				entry.m_SubSystem = a_Record.m_SubSystem;
+				entry.m_Message = a_Record.m_Message;
+
+				if (entry.m_TimeEpoch > m_NewestLogTime || m_NewestLogTime == 0)
+					m_NewestLogTime = entry.m_TimeEpoch;
+				if (entry.m_TimeEpoch < m_OldestLogTime || m_OldestLogTime == 0)
+					m_OldestLogTime = entry.m_TimeEpoch;
+
+				if ( m_PersistLogCount >= m_PersistLogBatchSize && !m_bPersistInFlight && !m_bPersistFlushQueued )
+					bFlush = m_bPersistFlushQueued = true;
+				else if (! m_bPersistTimerQueued )
+					bStartTimer = m_bPersistTimerQueued = true;
 			}
+
+			// this can run on any thread, m_spPersistLogTimer is only ever touched on main
+			if ( bFlush )
+				ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( RobotGateway, OnPersistLogs, this ) );
+			else if ( bStartTimer )
+				ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( RobotGateway, StartPersistLogTimer, this ) );
 		}
 	}
 }
@@ -210,14 +373,42 @@ void RobotGateway::SendBacktrace( const std::string & a_BT )
 	Json::Value upload;
 	upload["backtraceData"] = a_BT;
 
+	if ( m_Telemetry.Send( "backtrace", upload ) )
+	{
+		m_ChannelMessages += 1;
+		return;
+	}
+
+	m_HttpRequests += 1;
 	new RequestJson( this, "/v1/persistence/persistBacktrace", "POST", NULL_HEADERS, Json::FastWriter().write( upload ),
 		DELEGATE( RobotGateway, OnBacktracePersisted, const Json::Value &, this ) );
 }
 
 void RobotGateway::Heartbeat()
 {
-	new RequestJson(this, "/v1/embodiments/heartbeat", "GET", NULL_HEADERS, EMPTY_STRING,
-	                DELEGATE( RobotGateway, OnHeartbeat, const Json::Value &, this ) );
+	// piggyback our health on the heartbeat when the telemetry channel is up
+	Json::Value health;
+	{
+		boost::lock_guard<boost::mutex> lock( m_PersistLogLock );
+		health["logsQueued"] = (Json::UInt)m_PersistLogCount;
+		health["logsDropped"] = m_DroppedLogs;
+	}
+	health["configPending"] = m_spConfigClient ? true : false;
+
+	// a log batch the gateway never acknowledged is failed here, so it's kept and sent again
+	m_Telemetry.Update( Time().GetEpochTime() );
+
+	if ( m_Telemetry.Send( "heartbeat", health ) )
+		m_ChannelMessages += 1;
+	else
+	{
+		m_HttpRequests += 1;
+		new RequestJson(this, "/v1/embodiments/heartbeat", "GET", NULL_HEADERS, EMPTY_STRING,
+						DELEGATE( RobotGateway, OnHeartbeat, const Json::Value &, this ) );
+		ConnectTelemetry();
+	}
+
+	ReportRequestRate();
 }
 
 void RobotGateway::GetOrganization( Delegate<const Json::Value &> a_Callback )
@@ -272,8 +463,10 @@ void RobotGateway::OnRegisteredEmbodiment(const Json::Value & a_Response)
 		if ( a_Response["embodimentName"].isString() )
 			m_EmbodimentName = a_Response["embodimentName"].asString();
 
+		bool bCredentialsChanged = false;
 		if ( a_Response["embodimentToken"].isString() )
 		{
+			bCredentialsChanged |= m_EmbodimentToken != a_Response["embodimentToken"].asString();
 			m_EmbodimentToken = a_Response["embodimentToken"].asString();
 			m_Headers["Authorization"] = "Bearer " + m_EmbodimentToken;
 
@@ -288,6 +481,7 @@ void RobotGateway::OnRegisteredEmbodiment(const Json::Value & a_Response)
 
 		if ( a_Response["_id"].isString() )
 		{
+			bCredentialsChanged |= m_EmbodimentId != a_Response["_id"].asString();
 			m_EmbodimentId = a_Response["_id"].asString();
 			m_Headers["_id"] = m_EmbodimentId;
 			if ( pInstance != NULL )
@@ -298,15 +492,18 @@ void RobotGateway::OnRegisteredEmbodiment(const Json::Value & a_Response)
 		else
 			Log::Error( "RobotGateway", "_id field is missing." );
 
-		GetOrganization( DELEGATE(RobotGateway, OnOrganization, const Json::Value &,this) );
-		GetOrgAdminList( DELEGATE(RobotGateway, OnOrgAdminList, const Json::Value &, this) );
-		UpdateConfig();
+		// the service listing was requested in parallel with the old credentials, fetch again with the new ones
+		if ( bCredentialsChanged )
+		{
+			if ( m_spConfigClient )
+				m_bRefetchConfig = true;
+			else
+				FetchServiceListing();
+		}
 	}
 	else
 	{
 		Log::Error("RobotGateway", "Error in gateway response: %s.", a_Response.toStyledString().c_str());
-		m_ConfigsFetched = true;
-		m_ParentFetched = true;
 	}
 }
 
@@ -318,7 +515,96 @@ void RobotGateway::UpdateConfig()
 			UPDATE_CONFIG_INTERVAL, true, true );
 	}
 
-	GetServices(DELEGATE(RobotGateway, OnConfigured, ServiceList*, this));
+	// while the telemetry channel is up, the gateway notifies us of configuration changes
+	if (! m_spConfigClient && !m_Telemetry.IsConnected() )
+		FetchServiceListing();
+}
+
+void RobotGateway::FetchServiceListing()
+{
+	if ( m_pConfig == NULL )
+		return;
+
+	// a steady state poll is answered with a 304 when the listing hasn't changed
+	Headers headers( m_Headers );
+	if ( m_ConfigETag.size() > 0 )
+		headers["If-None-Match"] = m_ConfigETag;
+
+	m_HttpRequests += 1;
+	m_ConfigResponse = IWebClient::RequestData();
+	m_spConfigClient = IWebClient::Request( m_pConfig->m_URL + "/v1/services/getServiceListing", headers, "GET", EMPTY_STRING,
+		DELEGATE(RobotGateway, OnServiceListing, IWebClient::RequestData *, this),
+		DELEGATE(RobotGateway, OnServiceListingState, IWebClient *, this) );
+}
+
+void RobotGateway::OnServiceListing(IWebClient::RequestData * a_pResponse)
+{
+	m_ConfigResponse = *a_pResponse;
+}
+
+void RobotGateway::OnServiceListingState(IWebClient * a_pClient)
+{
+	if ( a_pClient->GetState() != IWebClient::CLOSED && a_pClient->GetState() != IWebClient::DISCONNECTED )
+		return;
+
+	IWebClient::SP spKeepAlive( m_spConfigClient );
+	m_spConfigClient.reset();
+
+	if ( m_ConfigResponse.m_StatusCode == 304 )
+	{
+		Log::Debug( "RobotGateway", "Service listing not modified." );
+		m_ConfigsFetched = true;
+	}
+	else if ( m_ConfigResponse.m_StatusCode == 200 )
+	{
+		std::string etag;
+		for( IWebClient::Headers::const_iterator iHeader = m_ConfigResponse.m_Headers.begin(); 
+			iHeader != m_ConfigResponse.m_Headers.end(); ++iHeader )
+		{
+			if ( StringUtil::Compare( iHeader->first, "ETag", true ) == 0 )
+				etag = iHeader->second;
+		}
+
+		Json::Value json;
+		if ( Json::Reader().parse( m_ConfigResponse.m_Content, json ) )
+		{
+			// servers without ETag support still send the same body when nothing changed
+			std::string hash( JsonHelpers::Hash( json ) );
+			if ( hash != m_ConfigHash )
+			{
+				m_ConfigETag = etag;
+				m_ConfigHash = hash;
+
+				ServiceList * pServiceList = new ServiceList();
+				pServiceList->Deserialize( json );
+				OnConfigured( pServiceList );
+			}
+			else
+			{
+				Log::Debug( "RobotGateway", "Service listing unchanged." );
+				if ( etag != m_ConfigETag )
+				{
+					m_ConfigETag = etag;
+					m_Snapshot["etag"] = etag;
+					SaveSnapshot();
+				}
+				m_ConfigsFetched = true;
+			}
+		}
+		else
+			OnConfigured( NULL );
+	}
+	else
+	{
+		Log::Error( "RobotGateway", "Service listing failed, status %u", m_ConfigResponse.m_StatusCode );
+		OnConfigured( NULL );
+	}
+
+	if ( m_bRefetchConfig )
+	{
+		m_bRefetchConfig = false;
+		FetchServiceListing();
+	}
 }
 
 void RobotGateway::OnOrganization(const Json::Value & a_Response)
@@ -332,24 +618,19 @@ void RobotGateway::OnOrganization(const Json::Value & a_Response)
 			if ( a_Response["parent"].isString() )
 			{
 				const std::string & parentId = a_Response["parent"].asString();
-				if ( parentId.size() > 0 )
+				// the parent is requested at startup if we already knew it, only ask again if it's changed
+				if ( parentId.size() > 0 && parentId != m_Snapshot["parentId"].asString() )
+				{
+					m_Snapshot["parentId"] = parentId;
 					GetParent( parentId, DELEGATE(RobotGateway, OnParent, const Json::Value &,this) );
+				}
 			}
 			else
-			{
 				Log::Error( "RobotGateway", "No parent found in response: %s", a_Response.toStyledString().c_str() );
-				m_ParentFetched = true;
-			}
-
-		}
-		else
-		{
-			m_ParentFetched = true;
 		}
 	}
 	else
 	{
-		m_ParentFetched = true;
 		Log::Error( "RobotGateway", "Failed to get organization" );
 	}
 }
@@ -359,31 +640,34 @@ void RobotGateway::OnParent(const Json::Value & a_Response)
 	if( !a_Response.isNull() )
 	{
 		Log::Status( "RobotGateway", "OnParent: %s", a_Response.toStyledString().c_str() );
-		if ( a_Response["parentIp"].isString() && a_Response["parentName"].isString() )
-		{
-			std::string parentName( a_Response["parentName"].asString() );
-			if ( parentName != m_EmbodimentName )
-			{
-				URL url( a_Response["parentIp"].asString() );
-				std::string parentHost( url.GetURL() );
+		ApplyParent( a_Response );
 
-				SelfInstance * pInstance = SelfInstance::GetInstance();
-				if ( pInstance != NULL )
-					pInstance->GetTopicManager()->SetParentHost( parentHost );
-			}
-			else
-			{
-				SelfInstance * pInstance = SelfInstance::GetInstance();
-				if ( pInstance != NULL )
-					pInstance->GetTopicManager()->SetParentHost( EMPTY_STRING );
-			}
-		}
+		m_Snapshot["parent"] = a_Response;
+		SaveSnapshot();
 	}
 	else
 	{
 		Log::Error( "RobotGateway", "Failed to get parent" );
 	}
-	m_ParentFetched = true;
+}
+
+void RobotGateway::ApplyParent(const Json::Value & a_Parent)
+{
+	if ( a_Parent["parentIp"].isString() && a_Parent["parentName"].isString() )
+	{
+		SelfInstance * pInstance = SelfInstance::GetInstance();
+		if ( pInstance == NULL )
+			return;
+
+		std::string parentName( a_Parent["parentName"].asString() );
+		if ( parentName != m_EmbodimentName )
+		{
+			URL url( a_Parent["parentIp"].asString() );
+			pInstance->GetTopicManager()->SetParentHost( url.GetURL() );
+		}
+		else
+			pInstance->GetTopicManager()->SetParentHost( EMPTY_STRING );
+	}
 }
 
 void RobotGateway::OnOrgAdminList(const Json::Value & a_Response)
@@ -406,66 +690,265 @@ void RobotGateway::OnConfigured(ServiceList* a_pServiceList)
 	{
 		Log::Status( "RobotGateway", "Received %u services from gateway.", a_pServiceList->m_Services.size() );
 		if (m_bApplyRemoteConfigs)
-		{
-			for (size_t i = 0; i < a_pServiceList->m_Services.size(); ++i)
-			{
-				Service & service = a_pServiceList->m_Services[i];
+			ApplyServices( *a_pServiceList );
 
-				ServiceConfig creds;
-				creds.m_ServiceId = service.m_ServiceName;
-				creds.m_URL = service.m_Endpoint;
-				creds.m_User = service.m_Username;
-				creds.m_Password = service.m_Password;
-
-				for (std::vector<ServiceAttributes>::const_iterator it = service.m_ServiceAttributes.begin();
-					it != service.m_ServiceAttributes.end(); ++it)
-				{
-					creds.m_CustomMap[(*it).m_Key] = (*it).m_Value;
-				}
-
-				if (Config::Instance()->AddServiceConfig(creds, true))
-					Log::Status("RobotGateway", "Applied credentials for %s.", creds.m_ServiceId.c_str());
-			}
+		// only the hash of each service is kept, the credentials themselves are stored by Config
+		Json::Value & services = m_Snapshot["services"] = Json::Value( Json::objectValue );
+		for( std::map<std::string,std::string>::const_iterator iHash = m_ServiceHashes.begin(); 
+			iHash != m_ServiceHashes.end(); ++iHash )
+		{
+			services[ iHash->first ] = iHash->second;
 		}
-		m_ConfigsFetched = true;
+		m_Snapshot["etag"] = m_ConfigETag;
+		m_Snapshot["hash"] = m_ConfigHash;
+		SaveSnapshot();
+
+		delete a_pServiceList;
 	}
 	else
 	{
 		Log::Error( "RobotGateway", "Failed to grab services from gateway, proceeding with previous configuration." );
-		m_ConfigsFetched = true;
 
 		// post health object to the blackboard..
 		SelfInstance * pInstance = SelfInstance::GetInstance();
 		if ( pInstance != NULL )
 			pInstance->GetBlackBoard()->AddThing( Health::SP( new Health("Configuration", "RobotGatewayDown", true, true ) ) );
 	}
+	m_ConfigsFetched = true;
+}
+
+void RobotGateway::ApplyServices(ServiceList & a_ServiceList)
+{
+	for (size_t i = 0; i < a_ServiceList.m_Services.size(); ++i)
+	{
+		Service & service = a_ServiceList.m_Services[i];
+
+		// skip services whose credentials are identical to what was last applied
+		Json::Value json;
+		service.Serialize( json );
+		std::string hash( JsonHelpers::Hash( json ) );
+		if ( m_ServiceHashes[ service.m_ServiceName ] == hash )
+			continue;
+		m_ServiceHashes[ service.m_ServiceName ] = hash;
+
+		ServiceConfig creds;
+		creds.m_ServiceId = service.m_ServiceName;
+		creds.m_URL = service.m_Endpoint;
+		creds.m_User = service.m_Username;
+		creds.m_Password = service.m_Password;
+
+		for (std::vector<ServiceAttributes>::const_iterator it = service.m_ServiceAttributes.begin();
+			it != service.m_ServiceAttributes.end(); ++it)
+		{
+			creds.m_CustomMap[(*it).m_Key] = (*it).m_Value;
+		}
+
+		if (Config::Instance()->AddServiceConfig(creds, true))
+			Log::Status("RobotGateway", "Applied credentials for %s.", creds.m_ServiceId.c_str());
+	}
+}
+
+bool RobotGateway::LoadSnapshot()
+{
+	m_Snapshot = Json::Value();
+	if ( m_SnapshotFile.size() == 0 )
+		return false;
+
+	std::ifstream input( (Config::Instance()->GetInstanceDataPath() + m_SnapshotFile).c_str() );
+	if (! input.is_open() )
+		return false;
+
+	Json::Reader reader;
+	if (! reader.parse( input, m_Snapshot ) || !m_Snapshot.isObject() )
+	{
+		Log::Warning( "RobotGateway", "Failed to parse configuration snapshot %s", m_SnapshotFile.c_str() );
+		m_Snapshot = Json::Value();
+		return false;
+	}
+
+	m_ConfigETag = m_Snapshot["etag"].asString();
+	m_ConfigHash = m_Snapshot["hash"].asString();
+
+	// the credentials of a service are only skipped on the next listing if Config still has them
+	bool bServicesConfigured = m_Snapshot["services"].isObject() && m_Snapshot["services"].size() > 0;
+	const Json::Value & services = m_Snapshot["services"];
+	for( Json::ValueConstIterator iService = services.begin(); iService != services.end(); ++iService )
+	{
+		if (! (*iService).isString() )
+		{
+			// older snapshots held the full service listing, scrub the credentials from disk
+			Log::Warning( "RobotGateway", "Removing credentials from configuration snapshot %s", m_SnapshotFile.c_str() );
+			m_Snapshot.removeMember( "services" );
+			m_ConfigETag.clear();
+			m_ConfigHash.clear();
+			m_ServiceHashes.clear();
+			SaveSnapshot();
+			bServicesConfigured = false;
+			break;
+		}
+
+		const std::string serviceId( iService.key().asString() );
+		if ( Config::Instance()->FindServiceConfig( serviceId ) != NULL )
+			m_ServiceHashes[ serviceId ] = (*iService).asString();
+		else
+			bServicesConfigured = false;
+	}
+	if (! bServicesConfigured )
+	{
+		// force the listing to be applied again, some credentials are missing
+		m_ConfigETag.clear();
+		m_ConfigHash.clear();
+	}
+
+	if ( m_bApplyParentHost && m_Snapshot["parent"].isObject() )
+		ApplyParent( m_Snapshot["parent"] );
+
+	Log::Status( "RobotGateway", "Started from configuration snapshot %s", m_SnapshotFile.c_str() );
+	return bServicesConfigured;
+}
+
+void RobotGateway::SaveSnapshot()
+{
+	if ( m_SnapshotFile.size() == 0 )
+		return;
+
+	std::ofstream output( (Config::Instance()->GetInstanceDataPath() + m_SnapshotFile).c_str() );
+	if ( output.is_open() )
+		output << Json::FastWriter().write( m_Snapshot );
+	else
+		Log::Warning( "RobotGateway", "Failed to write configuration snapshot %s", m_SnapshotFile.c_str() );
+}
+
+void RobotGateway::StartPersistLogTimer()
+{
+	if (! m_spPersistLogTimer && TimerPool::Instance() != NULL )
+	{
+		m_spPersistLogTimer = TimerPool::Instance()->StartTimer( VOID_DELEGATE( RobotGateway, OnPersistLogs, this ), 
+			m_PersistLogInterval, true, false );
+	}
 }
 
 void RobotGateway::OnPersistLogs()
 {
 	m_spPersistLogTimer.reset();
 
-	Json::Value json;
-	json["macId"] = m_MacId;
-	json["orgId"] = m_OrganizationId;
-	json["groupId"] = m_GroupId;
-	json["startTime"] = m_OldestLogTime;
-	json["endTime"] = m_NewestLogTime;
+	boost::unique_lock<boost::mutex> lock( m_PersistLogLock );
+	m_bPersistFlushQueued = false;
+	m_bPersistTimerQueued = false;
+	if ( m_bPersistInFlight )
+		return;				// previous batch hasn't completed, keep buffering
+	if ( m_PendingLogBody.size() == 0 && m_PersistLogCount > 0 )
+	{
+		// serialize the whole batch in a single pass, each log is sent as a compact JSON string
+		std::string body;
+		body.reserve( 256 + m_PersistLogCount * 192 );
+		body += "{\"macId\":";
+		AppendJsonString( body, m_MacId );
+		body += ",\"orgId\":";
+		AppendJsonString( body, m_OrganizationId );
+		body += ",\"groupId\":";
+		AppendJsonString( body, m_GroupId );
+		body += StringUtil::Format( ",\"startTime\":%.0f,\"endTime\":%.0f,\"dropped\":%u,\"logs\":[",
+			m_OldestLogTime, m_NewestLogTime, m_DroppedLogs );
+
+		std::string log;
+		for(size_t i=0;i<m_PersistLogCount;++i)
+		{
+			const LogEntry & entry = m_PersistLogs[ (m_PersistLogHead + i) % m_PersistLogs.size() ];
+
+			log = "{\"time\":";
+			AppendJsonString( log, entry.m_Time );
+			log += StringUtil::Format( ",\"timeEpoch\":%.0f,\"level\":", entry.m_TimeEpoch );
+			AppendJsonString( log, Log::LevelText( entry.m_Level ) );
+			log += ",\"subsystem\":";
+			AppendJsonString( log, entry.m_SubSystem );
+			log += ",\"message\":";
+			AppendJsonString( log, entry.m_Message );
+			log += '}';
+
+			if ( i > 0 )
+				body += ',';
+			AppendJsonString( body, log );
+		}
+		body += "]}";
+
+		m_PendingLogBody.swap( body );
+		m_PersistLogHead = m_PersistLogCount = 0;
+		m_DroppedLogs = 0;
+		m_OldestLogTime = 0;
+		m_NewestLogTime = 0;
+	}
+
+	if ( m_PendingLogBody.size() > 0 )
+	{
+		m_bPersistInFlight = true;
+		lock.unlock();
+
+		SendLogBatch();
+	}
+}
+
+void RobotGateway::SendLogBatch()
+{
+	Headers headers;
+	headers["Content-Type"] = "application/json";
+
+#ifdef RG_ENABLE_GZIP
+	if ( m_bCompressLogs )
+	{
+		std::string compressed;
+		if ( GzipData( m_PendingLogBody, compressed ) )
+		{
+			if ( m_Telemetry.SendLogs( compressed, true, DELEGATE( RobotGateway, OnLogsAcknowledged, bool, this ) ) )
+			{
+				m_ChannelMessages += 1;
+				return;
+			}
+
+			headers["Content-Encoding"] = "gzip";
+			m_HttpRequests += 1;
+			new RequestJson( this, "/v1/persistence/persistLog", "POST", headers, compressed,
+				DELEGATE( RobotGateway, OnLogsPersisted, const Json::Value &, this ) );
+			return;
+		}
+	}
+#endif
 
-	size_t i = 0;
-	for( std::list<std::string>::iterator iLog = m_PersistLogs.begin(); iLog != m_PersistLogs.end(); ++iLog )
-		json["logs"][i++] = *iLog;
-	new RequestJson( this, "/v1/persistence/persistLog", "POST", NULL_HEADERS, json.toStyledString(),
-	                 DELEGATE( RobotGateway, OnLogsPersisted, const Json::Value &, this ) );
+	if ( m_Telemetry.SendLogs( m_PendingLogBody, false, DELEGATE( RobotGateway, OnLogsAcknowledged, bool, this ) ) )
+	{
+		m_ChannelMessages += 1;
+		return;
+	}
 
-	m_PersistLogs.clear();
-	m_OldestLogTime = 0;
-	m_NewestLogTime = 0;
+	m_HttpRequests += 1;
+	new RequestJson( this, "/v1/persistence/persistLog", "POST", headers, m_PendingLogBody,
+		DELEGATE( RobotGateway, OnLogsPersisted, const Json::Value &, this ) );
 }
 
 void RobotGateway::OnLogsPersisted(const Json::Value & a_Response)
 {
-//	Log::Debug( "RobotGateway", "OnLogsPersisted: %s", a_Response.toStyledString().c_str() );
+	bool bStartTimer = false;
+	{
+		boost::lock_guard<boost::mutex> lock( m_PersistLogLock );
+		m_bPersistInFlight = false;
+
+		// on failure keep the pending batch, it will be resent on the next interval while new records 
+		// continue to collect in the ring buffer.
+		if (! a_Response.isNull() )
+			m_PendingLogBody.clear();
+
+		if ( (m_PendingLogBody.size() > 0 || m_PersistLogCount > 0) && !m_bPersistTimerQueued )
+			bStartTimer = m_bPersistTimerQueued = true;
+	}
+
+	if ( bStartTimer )
+		StartPersistLogTimer();
+}
+
+void RobotGateway::OnLogsAcknowledged( bool a_bPersisted )
+{
+	// the batch is only dropped once the gateway has acknowledged it
+	OnLogsPersisted( a_bPersisted ? Json::Value( true ) : Json::Value() );
 }
 
 void RobotGateway::OnBacktracePersisted(const Json::Value & a_Response)
@@ -478,3 +961,48 @@ void RobotGateway::OnHeartbeat(const Json::Value & response)
 	//Log::Debug( "RobotGateway", "OnHeartbeat: %s", response.toStyledString().c_str() );
 }
 
+void RobotGateway::ConnectTelemetry()
+{
+	if ( m_TelemetryEndpoint.size() == 0 || m_pConfig == NULL )
+		return;
+
+	m_Telemetry.Connect( m_pConfig->m_URL + m_TelemetryEndpoint, m_Headers, 
+		DELEGATE( RobotGateway, OnTelemetry, const Json::Value &, this ) );
+}
+
+void RobotGateway::OnTelemetry( const Json::Value & a_Message )
+{
+	const std::string & op = a_Message["op"].asString();
+	if ( op == "connected" )
+	{
+		// we may have missed change notifications while disconnected
+		if (! m_spConfigClient )
+			FetchServiceListing();
+	}
+	else if ( op == "closed" )
+		Log::Status( "RobotGateway", "Telemetry channel closed, falling back to HTTP." );
+	else if ( op == "configChanged" )
+	{
+		if ( m_spConfigClient )
+			m_bRefetchConfig = true;
+		else
+			FetchServiceListing();
+	}
+	else if ( op == "error" )
+		Log::Error( "RobotGateway", "Telemetry error: %s", a_Message["data"].toStyledString().c_str() );
+}
+
+void RobotGateway::ReportRequestRate()
+{
+	double now = Time().GetEpochTime();
+	double elapsed = now - m_StatsTime;
+	if ( elapsed >= 60.0 )
+	{
+		Log::DebugLow( "RobotGateway", "Gateway traffic per minute: %.1f HTTP requests, %.1f telemetry messages.",
+			(m_HttpRequests * 60.0) / elapsed, (m_ChannelMessages * 60.0) / elapsed );
+
+		m_HttpRequests = 0;
+		m_ChannelMessages = 0;
+		m_StatsTime = now;
+	}
+}
@@ -2,9 +2,13 @@
 #ifndef SELF_ROBOT_GATEWAY_H
 #define SELF_ROBOT_GATEWAY_H
 
+#include <boost/thread.hpp>
+
 #include "blackboard/ThingEvent.h"
 #include "services/IGateway.h"
+#include "utils/IWebClient.h"
 #include "utils/TimerPool.h"
+#include "utils/TelemetryChannel.h"
 
 //! This service wraps the RobotGateway BlueMix application. Depending on the configuration,
 //! some of these calls may go directly to BlueMix.
@@ -75,33 +79,85 @@ private:
 	bool				m_bApplyRemoteConfigs;
 	bool				m_bApplyParentHost;
 	bool 				m_ConfigsFetched;
-	bool 				m_ParentFetched;
+	float				m_BootstrapTimeout;				// how long to wait for services on the first boot without a snapshot, 0 to not wait
+	std::string			m_SnapshotFile;					// ETag, service hashes and parent from the gateway, credentials are kept by Config
+	Json::Value			m_Snapshot;
+	IWebClient::SP		m_spConfigClient;				// outstanding service listing request
+	IWebClient::RequestData
+						m_ConfigResponse;
+	bool				m_bRefetchConfig;				// fetch the listing again once the outstanding request completes
+	std::string			m_ConfigETag;					// ETag of the last service listing applied
+	std::string			m_ConfigHash;					// hash of the last service listing body applied
+	std::map<std::string,std::string>
+						m_ServiceHashes;				// hash of the credentials last applied for each service
+
+	//! A single log record waiting to be shipped to the gateway
+	struct LogEntry
+	{
+		std::string			m_Time;
+		double				m_TimeEpoch;
+		LogLevel			m_Level;
+		std::string			m_SubSystem;
+		std::string			m_Message;
+	};
 
 	double				m_PersistLogInterval;			// how often to upload persisted logs
 	float				m_HeartBeatInterval;
 	LogLevel			m_PersistLogLevel;				// what level to persist
 	std::vector<std::string>
 						m_PersistLogFilter;				// array of sub-system to persist to the gateway
-	std::list<std::string>
-						m_PersistLogs;					// list of items to persist to the gatewaY
+	size_t				m_PersistLogBufferSize;			// max number of records held, oldest are dropped when full
+	size_t				m_PersistLogBatchSize;			// flush early once this many records are queued
+	bool				m_bCompressLogs;				// gzip log batches before upload
+	boost::mutex		m_PersistLogLock;
+	std::vector<LogEntry>
+						m_PersistLogs;					// ring buffer of items to persist to the gateway
+	size_t				m_PersistLogHead;				// index of the oldest record in the ring
+	size_t				m_PersistLogCount;				// number of records in the ring
+	unsigned int		m_DroppedLogs;					// records dropped because the ring was full
+	bool				m_bPersistFlushQueued;
+	bool				m_bPersistTimerQueued;			// m_spPersistLogTimer is running or being started on main
+	bool				m_bPersistInFlight;				// true while a persistLog request is outstanding
+	std::string			m_PendingLogBody;				// last batch that failed to upload, resent before new records
 	double              m_OldestLogTime;
 	double              m_NewestLogTime;
 	TimerPool::ITimer::SP
 						m_spPersistLogTimer;			// timer for persisting logs to the back-end
 	TimerPool::ITimer::SP
 						m_spHeartbeatTimer;				// Timer to hit robot gateway's heartbeat endpoint
+	std::string			m_TelemetryEndpoint;			// web socket endpoint for heartbeats, logs & notifications, empty to disable
+	float				m_TelemetryRetryInterval;		// how long to wait before reconnecting the telemetry channel
+	float				m_TelemetryAckTimeout;			// how long to wait for the gateway to acknowledge a log batch
+	TelemetryChannel	m_Telemetry;
+	unsigned int		m_HttpRequests;					// requests made since m_StatsTime
+	unsigned int		m_ChannelMessages;				// telemetry messages sent since m_StatsTime
+	double				m_StatsTime;
+
+	bool LoadSnapshot();
+	void SaveSnapshot();
+	void ApplyServices(ServiceList & a_ServiceList);
+	void ApplyParent(const Json::Value & a_Parent);
 
 	//! Callbacks
 	void UpdateConfig();
+	void FetchServiceListing();
+	void OnServiceListing(IWebClient::RequestData * a_pResponse);
+	void OnServiceListingState(IWebClient * a_pClient);
 	void OnConfigured(ServiceList* a_pServiceList);
 	void OnOrganization(const Json::Value & a_Response);
 	void OnOrgAdminList(const Json::Value & a_Response);
 	void OnParent(const Json::Value & a_Response);
 	void OnRegisteredEmbodiment(const Json::Value & a_Response);
+	void StartPersistLogTimer();
 	void OnPersistLogs();
+	void SendLogBatch();
 	void OnLogsPersisted(const Json::Value & a_Response);
 	void OnBacktracePersisted(const Json::Value & a_Response);
 	void OnHeartbeat(const Json::Value & response);
+	void OnLogsAcknowledged(bool a_bPersisted);
+	void ConnectTelemetry();
+	void OnTelemetry(const Json::Value & a_Message);
+	void ReportRequestRate();
 
 	friend class RobotMail;
 };
@@ -0,0 +1,316 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "utils/TimerPool.h"
+#include "utils/Config.h"
+#include "utils/TelemetryChannel.h"
+#include "services/RobotGateway.h"
+#include "tests/StandInServer.h"
+
+//! Runs the robot gateway and its telemetry channel against a stand-in gateway. Plain HTTP requests get an 
+//! empty JSON body, the service listing is never modified, and a web socket upgrade becomes the telemetry channel.
+class TestTelemetryChannel : UnitTest
+{
+public:
+	//! Construction
+	TestTelemetryChannel() : UnitTest("TestTelemetryChannel"),
+		m_HttpRequests(0),
+		m_HttpHeartbeats(0),
+		m_HttpLogBatches(0),
+		m_Listings(0),
+		m_Channels(0),
+		m_Messages(0),
+		m_Heartbeats(0),
+		m_LogBatches(0),
+		m_bNotifyConfig(false),
+		m_bAckLogs(true),
+		m_bDropOnLogs(false),
+		m_bConnected(false),
+		m_bClosed(false),
+		m_ConfigChanged(0),
+		m_Acks(0),
+		m_Fails(0)
+	{ }
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+		TimerPool timers;
+
+		StandInServer server( boost::bind( &TestTelemetryChannel::ServeGateway, this, _1, _2, _3 ) );
+		std::string url( server.GetURL() );
+
+		Config config;
+		ServiceConfig creds;
+		creds.m_ServiceId = "RobotGatewayV1";
+		creds.m_URL = url;
+		Test( config.AddServiceConfig( creds ) );
+
+		// one minute of the gateway's own traffic, 4 heartbeats at 15 seconds and a log batch, first over HTTP
+		const int HEARTBEATS = 4;
+		int httpBefore = 0, connectionsBefore = 0, messagesBefore = 0;
+		RunGateway( server, false, HEARTBEATS, httpBefore, connectionsBefore, messagesBefore );
+		Test( m_HttpHeartbeats == HEARTBEATS && m_HttpLogBatches == 1 );
+		Test( httpBefore == HEARTBEATS + 1 && connectionsBefore == httpBefore );
+		Test( messagesBefore == 0 );
+
+		// the same minute once the gateway has its telemetry channel up
+		int httpAfter = 0, connectionsAfter = 0, messagesAfter = 0;
+		RunGateway( server, true, HEARTBEATS, httpAfter, connectionsAfter, messagesAfter );
+		Test( m_Heartbeats == HEARTBEATS && m_LogBatches == 1 && m_HttpLogBatches == 1 );
+		Test( httpAfter == 0 && connectionsAfter == 0 );
+		Test( messagesAfter == HEARTBEATS + 1 );
+		Log::Status( "TestTelemetryChannel", "Gateway traffic per robot per minute, before: %d HTTP requests on %d connections, "
+			"after: %d messages on the open channel, %d HTTP requests.", httpBefore, connectionsBefore, messagesAfter, httpAfter );
+
+		// the channel on its own, the stand-in asks for a config refresh on the first heartbeat
+		m_HttpRequests = m_Heartbeats = m_LogBatches = 0;
+		m_bNotifyConfig = true;
+		int connections = server.GetConnections();
+
+		TelemetryChannel channel;
+		channel.SetRetryInterval( 0.0f );
+		channel.SetAckTimeout( 1.0f );
+		channel.Connect( url + "/v1/telemetry", IWebClient::Headers(), 
+			DELEGATE( TestTelemetryChannel, OnTelemetry, const Json::Value &, this ) );
+		Test( WaitFlag( m_bConnected ) );
+
+		for(int i=0;i<HEARTBEATS;++i)
+		{
+			Json::Value health;
+			health["logsQueued"] = i;
+			Test( channel.Send( "heartbeat", health ) );
+		}
+		Test( channel.SendLogs( "{\"logs\":[\"one\"]}", false, DELEGATE( TestTelemetryChannel, OnLogs, bool, this ) ) );
+		Test(! channel.SendLogs( "{\"logs\":[\"two\"]}", false, DELEGATE( TestTelemetryChannel, OnLogs, bool, this ) ) );
+		Test( Wait( m_Acks, 1 ) );
+		Test( Wait( m_ConfigChanged, 1 ) );
+		Test( m_Heartbeats == HEARTBEATS && m_LogBatches == 1 );
+		Test( channel.GetMessagesSent() == HEARTBEATS + 1 );
+		Test( server.GetConnections() - connections == 1 );
+		Test( m_HttpRequests == 0 );
+
+		// a batch that isn't acknowledged in time is failed, and logs then go over HTTP on this connection
+		m_bAckLogs = false;
+		Test( channel.SendLogs( "{\"logs\":[\"three\"]}", false, DELEGATE( TestTelemetryChannel, OnLogs, bool, this ) ) );
+		channel.Update( Time().GetEpochTime() );
+		Test( m_Fails == 0 && channel.IsLogsPending() );
+		channel.Update( Time().GetEpochTime() + 2.0 );
+		Test( m_Fails == 1 && !channel.IsLogsPending() );
+		Test(! channel.CanSendLogs() && channel.IsConnected() );
+
+		// a batch in flight when the socket drops is never reported persisted
+		channel.Close();
+		m_bConnected = false;
+		m_bAckLogs = true;
+		m_bDropOnLogs = true;
+		channel.Connect( url + "/v1/telemetry", IWebClient::Headers(), 
+			DELEGATE( TestTelemetryChannel, OnTelemetry, const Json::Value &, this ) );
+		Test( WaitFlag( m_bConnected ) );
+		Test( channel.CanSendLogs() );
+		Test( channel.SendLogs( "{\"logs\":[\"four\"]}", false, DELEGATE( TestTelemetryChannel, OnLogs, bool, this ) ) );
+		Test( Wait( m_Fails, 2 ) );
+		Test( WaitFlag( m_bClosed ) );
+		Test( m_Acks == 1 );
+		Test(! channel.IsConnected() );
+
+		channel.Close();
+		server.Stop();
+	}
+
+	//! Run a minute of heartbeats and a log batch through a RobotGateway, returns the HTTP requests and 
+	//! connections the stand-in saw, and the telemetry messages it received.
+	void RunGateway( StandInServer & a_Server, bool a_bChannel, int a_Heartbeats, int & a_HttpRequests, 
+		int & a_Connections, int & a_Messages )
+	{
+		Json::Value json;
+		json["m_TelemetryEndpoint"] = a_bChannel ? "/v1/telemetry" : "";
+		json["m_PersistLogInterval"] = 0.05;
+		json["m_bCompressLogs"] = false;
+
+		RobotGateway gateway;
+		gateway.Deserialize( json );
+		// there's no SelfInstance to give us a bearer token, so only the IService part of Start() is run,
+		// which is what picks up the stand-in URL
+		Test( gateway.IGateway::Start() );
+
+		if ( a_bChannel )
+		{
+			// the first heartbeat goes over HTTP and opens the channel, the listing is checked once it's up
+			int httpHeartbeats = m_HttpHeartbeats, channels = m_Channels, listings = m_Listings;
+			gateway.Heartbeat();
+			Test( Wait( m_HttpHeartbeats, httpHeartbeats + 1 ) );
+			Test( Wait( m_Channels, channels + 1 ) );
+			Test( Wait( m_Listings, listings + 1 ) );
+		}
+
+		volatile int & heartbeats = a_bChannel ? m_Heartbeats : m_HttpHeartbeats;
+		volatile int & batches = a_bChannel ? m_LogBatches : m_HttpLogBatches;
+		int expectedHeartbeats = heartbeats + a_Heartbeats;
+		int expectedBatches = batches + 1;
+		int http = m_HttpRequests;
+		int connections = a_Server.GetConnections();
+		int messages = m_Messages;
+
+		for(int i=0;i<a_Heartbeats;++i)
+			gateway.Heartbeat();
+		Test( Wait( heartbeats, expectedHeartbeats ) );
+
+		LogRecord record;
+		record.m_Time = "00:00:00";
+		record.m_TimeEpoch = (time_t)Time().GetEpochTime();
+		record.m_Level = LL_STATUS;
+		record.m_SubSystem = "TestTelemetryChannel";
+		record.m_Message = "Gateway log line";
+		gateway.Process( record );
+		Test( Wait( batches, expectedBatches ) );
+
+		a_HttpRequests = m_HttpRequests - http;
+		a_Connections = a_Server.GetConnections() - connections;
+		a_Messages = m_Messages - messages;
+
+		gateway.Stop();
+	}
+
+	bool Wait( volatile int & a_Value, int a_Target )
+	{
+		Time start;
+		while( a_Value < a_Target && (Time().GetEpochTime() - start.GetEpochTime()) < 10.0 )
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+		}
+		return a_Value >= a_Target;
+	}
+
+	bool WaitFlag( volatile bool & a_bFlag )
+	{
+		Time start;
+		while(! a_bFlag && (Time().GetEpochTime() - start.GetEpochTime()) < 10.0 )
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+		}
+		return a_bFlag;
+	}
+
+	void OnTelemetry( const Json::Value & a_Message )
+	{
+		const std::string & op = a_Message["op"].asString();
+		if ( op == "connected" )
+			m_bConnected = true;
+		else if ( op == "closed" )
+			m_bClosed = true;
+		else if ( op == "configChanged" )
+			m_ConfigChanged += 1;
+	}
+
+	void OnLogs( bool a_bPersisted )
+	{
+		if ( a_bPersisted )
+			m_Acks += 1;
+		else
+			m_Fails += 1;
+	}
+
+	//! Stand-in gateway, connections are served on threads of their own
+	void ServeGateway( StandInServer::Socket & a_Socket, boost::asio::streambuf & a_Buffer, const std::string & a_Request )
+	{
+		if (! StandInServer::Upgrade( a_Socket, a_Request ) )
+		{
+			StandInServer::ReadBody( a_Socket, a_Buffer, a_Request );
+			{
+				boost::lock_guard<boost::mutex> lock( m_Lock );
+				m_HttpRequests += 1;
+				if ( a_Request.find( "/v1/embodiments/heartbeat" ) != std::string::npos )
+					m_HttpHeartbeats += 1;
+				else if ( a_Request.find( "/v1/persistence/persistLog" ) != std::string::npos )
+					m_HttpLogBatches += 1;
+			}
+
+			if ( a_Request.find( "/v1/services/getServiceListing" ) != std::string::npos )
+			{
+				StandInServer::WriteResponse( a_Socket, 304, EMPTY_STRING );
+				m_Listings += 1;
+			}
+			else
+				StandInServer::WriteResponse( a_Socket, 200, "{}" );
+			return;
+		}
+
+		m_Channels += 1;
+		for(;;)
+		{
+			int op = 0;
+			std::string payload;
+			if (! StandInServer::ReadFrame( a_Socket, op, payload ) || op == StandInServer::OP_CLOSE )
+				break;
+			if ( op != StandInServer::OP_TEXT )
+				continue;
+
+			m_Messages += 1;
+			Json::Value json;
+			if (! Json::Reader().parse( payload, json ) )
+				continue;
+
+			const std::string & type = json["op"].asString();
+			if ( type == "heartbeat" )
+			{
+				m_Heartbeats += 1;
+				if ( m_Heartbeats == 1 && m_bNotifyConfig )
+					StandInServer::WriteFrame( a_Socket, StandInServer::OP_TEXT, "{\"op\":\"configChanged\"}" );
+			}
+			else if ( type == "logs" )
+			{
+				m_LogBatches += 1;
+				if ( m_bDropOnLogs )
+					break;
+				if ( m_bAckLogs )
+				{
+					StandInServer::WriteFrame( a_Socket, StandInServer::OP_TEXT, 
+						StringUtil::Format( "{\"op\":\"logsAck\",\"id\":%u}", json["id"].asUInt() ) );
+				}
+			}
+		}
+		a_Socket.close();
+	}
+
+	boost::mutex		m_Lock;
+	volatile int		m_HttpRequests;
+	volatile int		m_HttpHeartbeats;
+	volatile int		m_HttpLogBatches;
+	volatile int		m_Listings;
+	volatile int		m_Channels;
+	volatile int		m_Messages;
+	volatile int		m_Heartbeats;
+	volatile int		m_LogBatches;
+	volatile bool		m_bNotifyConfig;
+	volatile bool		m_bAckLogs;
+	volatile bool		m_bDropOnLogs;
+	volatile bool		m_bConnected;
+	volatile bool		m_bClosed;
+	volatile int		m_ConfigChanged;
+	volatile int		m_Acks;
+	volatile int		m_Fails;
+};
+
+TestTelemetryChannel TEST_TELEMETRY_CHANNEL;
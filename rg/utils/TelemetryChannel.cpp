@@ -0,0 +1,197 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "TelemetryChannel.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+
+TelemetryChannel::TelemetryChannel() : 
+	m_bConnected( false ),
+	m_RetryInterval( 300.0f ),
+	m_RetryTime( 0.0 ),
+	m_AckTimeout( 30.0f ),
+	m_bAckTimedOut( false ),
+	m_NextLogsId( 1 ),
+	m_LogsId( 0 ),
+	m_LogsSent( 0.0 ),
+	m_MessagesSent( 0 )
+{}
+
+TelemetryChannel::~TelemetryChannel()
+{
+	m_LogsCallback.Reset();
+	Close();
+}
+
+void TelemetryChannel::Connect( const std::string & a_URL, const IWebClient::Headers & a_Headers, NotifyCallback a_Callback )
+{
+	if ( m_spClient && m_spClient->GetState() != IWebClient::CLOSED 
+		&& m_spClient->GetState() != IWebClient::DISCONNECTED )
+		return;		// already connected or connecting
+	if ( Time().GetEpochTime() < m_RetryTime )
+		return;
+
+	std::string url( a_URL );
+	StringUtil::Replace(url, "https://", "wss://", true );
+	StringUtil::Replace(url, "http://", "ws://", true );
+
+	m_Callback = a_Callback;
+	m_spClient = IWebClient::Create( url );
+	m_spClient->SetHeaders( a_Headers );
+	m_spClient->SetStateReceiver( DELEGATE( TelemetryChannel, OnState, IWebClient *, this ) );
+	m_spClient->SetFrameReceiver( DELEGATE( TelemetryChannel, OnFrame, IWebSocket::FrameSP, this ) );
+
+	// don't retry until the interval has passed, whether or not this attempt succeeds
+	m_RetryTime = Time().GetEpochTime() + m_RetryInterval;
+	if (! m_spClient->Send() )
+		Log::Warning( "TelemetryChannel", "Failed to connect telemetry channel to %s", url.c_str() );
+}
+
+void TelemetryChannel::Close()
+{
+	if ( m_spClient )
+	{
+		// callbacks are not made for a channel we close ourselves
+		IWebClient::SP spClient( m_spClient );
+		m_spClient.reset();
+		spClient->Close();
+	}
+	m_bConnected = false;
+	m_Callback.Reset();
+	CompleteLogs( false );
+}
+
+bool TelemetryChannel::Send( const std::string & a_Op, const Json::Value & a_Data )
+{
+	if (! m_bConnected )
+		return false;
+
+	Json::Value json;
+	json["op"] = a_Op;
+	json["data"] = a_Data;
+	m_spClient->SendText( Json::FastWriter().write( json ) );
+	m_MessagesSent += 1;
+
+	return true;
+}
+
+bool TelemetryChannel::SendLogs( const std::string & a_Body, bool a_bCompressed, LogsCallback a_Callback )
+{
+	if (! CanSendLogs() || m_LogsId != 0 )
+		return false;
+
+	m_LogsId = m_NextLogsId++;
+	if ( m_NextLogsId == 0 )
+		m_NextLogsId = 1;
+	m_LogsSent = Time().GetEpochTime();
+	m_LogsCallback = a_Callback;
+
+	if ( a_bCompressed )
+	{
+		// the binary frame that follows the header is the gzip'd batch
+		m_spClient->SendText( StringUtil::Format( "{\"op\":\"logs\",\"id\":%u,\"encoding\":\"gzip\"}", m_LogsId ) );
+		m_spClient->SendBinary( a_Body );
+	}
+	else
+		m_spClient->SendText( StringUtil::Format( "{\"op\":\"logs\",\"id\":%u,\"data\":", m_LogsId ) + a_Body + "}" );
+	m_MessagesSent += 1;
+
+	return true;
+}
+
+void TelemetryChannel::Update( double a_Now )
+{
+	if ( m_LogsId != 0 && (a_Now - m_LogsSent) > m_AckTimeout )
+	{
+		Log::Warning( "TelemetryChannel", "Log batch %u was not acknowledged, sending logs over HTTP.", m_LogsId );
+		m_bAckTimedOut = true;
+		CompleteLogs( false );
+	}
+}
+
+void TelemetryChannel::CompleteLogs( bool a_bPersisted )
+{
+	if ( m_LogsId == 0 )
+		return;
+
+	m_LogsId = 0;
+	LogsCallback callback( m_LogsCallback );
+	m_LogsCallback.Reset();
+	if ( callback.IsValid() )
+		callback( a_bPersisted );
+}
+
+void TelemetryChannel::Notify( const std::string & a_Op )
+{
+	if ( m_Callback.IsValid() )
+	{
+		Json::Value json;
+		json["op"] = a_Op;
+		m_Callback( json );
+	}
+}
+
+void TelemetryChannel::OnState( IWebClient * a_pClient )
+{
+	if ( a_pClient != m_spClient.get() )
+		return;
+
+	if ( a_pClient->GetState() == IWebClient::CONNECTED )
+	{
+		Log::Status( "TelemetryChannel", "Telemetry channel connected." );
+		m_bConnected = true;
+		m_bAckTimedOut = false;
+		Notify( "connected" );
+	}
+	else if ( a_pClient->GetState() == IWebClient::CLOSED || a_pClient->GetState() == IWebClient::DISCONNECTED )
+	{
+		bool bWasConnected = m_bConnected;
+		m_bConnected = false;
+
+		// a batch that wasn't acknowledged may not have arrived, it's kept and sent again
+		CompleteLogs( false );
+		if ( bWasConnected )
+		{
+			Log::Status( "TelemetryChannel", "Telemetry channel closed." );
+			Notify( "closed" );
+		}
+	}
+}
+
+void TelemetryChannel::OnFrame( IWebSocket::FrameSP a_spFrame )
+{
+	if ( a_spFrame->m_Op != IWebSocket::TEXT_FRAME )
+		return;
+
+	Json::Value json;
+	if (! Json::Reader().parse( a_spFrame->m_Data, json ) || !json.isObject() )
+	{
+		Log::Error( "TelemetryChannel", "Failed to parse telemetry frame." );
+		return;
+	}
+
+	if ( json["op"].asString() == "logsAck" )
+	{
+		if ( m_LogsId != 0 && json["id"].isNumeric() && json["id"].asUInt() == m_LogsId )
+			CompleteLogs( true );
+	}
+	else if ( m_Callback.IsValid() )
+		m_Callback( json );
+}
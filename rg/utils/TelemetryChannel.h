@@ -0,0 +1,108 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_TELEMETRYCHANNEL_H
+#define SELF_TELEMETRYCHANNEL_H
+
+#include <string>
+
+#include "utils/IWebClient.h"
+#include "utils/Delegate.h"
+
+#include "SelfLib.h"
+
+//! One persistent web socket to the gateway that carries heartbeats, health, log batches, backtraces 
+//! and configuration change notifications. Messages are JSON objects of the form {"op":...,"data":...}.
+//! A log batch only counts as persisted once the gateway answers with {"op":"logsAck","id":...}.
+class TelemetryChannel
+{
+public:
+	//! Types
+	typedef Delegate<const Json::Value &>		NotifyCallback;
+	typedef Delegate<bool>						LogsCallback;
+
+	//! Construction
+	TelemetryChannel();
+	~TelemetryChannel();
+
+	//! Accessors
+	bool IsConnected() const
+	{
+		return m_bConnected;
+	}
+	//! True if log batches can be sent, gateways that don't acknowledge them get them over HTTP instead
+	bool CanSendLogs() const
+	{
+		return m_bConnected && !m_bAckTimedOut;
+	}
+	bool IsLogsPending() const
+	{
+		return m_LogsId != 0;
+	}
+	unsigned int GetMessagesSent() const
+	{
+		return m_MessagesSent;
+	}
+
+	//! Mutators
+	void SetRetryInterval( float a_Interval )
+	{
+		m_RetryInterval = a_Interval;
+	}
+	void SetAckTimeout( float a_Timeout )
+	{
+		m_AckTimeout = a_Timeout;
+	}
+
+	//! Open the channel, unless it's open or the last attempt was made less than the retry interval ago.
+	//! a_Callback receives every message from the gateway, plus {"op":"connected"} and {"op":"closed"}.
+	void Connect( const std::string & a_URL, const IWebClient::Headers & a_Headers, NotifyCallback a_Callback );
+	void Close();
+	//! Send a message, returns false if the channel isn't connected.
+	bool Send( const std::string & a_Op, const Json::Value & a_Data );
+	//! Send a batch of logs, a_Callback is invoked with true once the gateway acknowledges it, or with false
+	//! if the channel closes or the acknowledgement doesn't arrive in time. One batch is sent at a time.
+	bool SendLogs( const std::string & a_Body, bool a_bCompressed, LogsCallback a_Callback );
+	//! Fail a log batch that has waited longer than the ack timeout, should be called periodically.
+	void Update( double a_Now );
+
+private:
+	//! Data
+	IWebClient::SP		m_spClient;
+	NotifyCallback		m_Callback;
+	bool				m_bConnected;
+	float				m_RetryInterval;		// how long to wait between connection attempts
+	double				m_RetryTime;
+	float				m_AckTimeout;			// how long to wait for a log batch to be acknowledged
+	bool				m_bAckTimedOut;			// set if the gateway didn't acknowledge a batch on this connection
+	unsigned int		m_NextLogsId;
+	unsigned int		m_LogsId;				// id of the batch waiting for an ack, 0 if none
+	double				m_LogsSent;
+	LogsCallback		m_LogsCallback;
+	unsigned int		m_MessagesSent;
+
+	void CompleteLogs( bool a_bPersisted );
+	void Notify( const std::string & a_Op );
+
+	//! Callbacks
+	void OnState( IWebClient * a_pClient );
+	void OnFrame( IWebSocket::FrameSP a_spFrame );
+};
+
+#endif
@@ -63,7 +63,7 @@ void MotionAgent::OnMotion(const ThingEvent & a_ThingEvent)
 	if (spMotion)
 	{
 		Log::Debug("MotionAgent", "Status of motion is %d", spMotion->m_Active);
-		if (true) {
+		if (spMotion->IsActive()) {
 			Log::Debug("MotionAgent", "MOTION IS ACTIVE!");
 			SelfInstance::GetInstance()->GetBlackBoard()->AddThing(
 				Say::SP(new Say("Motion has been detected")));
@@ -45,52 +45,31 @@ RTTI_IMPL( Motion, IThing);
 void Motion::Serialize(Json::Value &json)
 {
     IThing::Serialize(json);
-
+    json["m_DeviceId"] = m_DeviceId;
+    json["m_Active"] = m_Active;
 }
 
 void Motion::Deserialize(const Json::Value &json)
 {
     IThing::Deserialize(json);
-
+    if (json["m_DeviceId"].isString())
+        m_DeviceId = json["m_DeviceId"].asString();
+    if (json["m_Active"].isBool())
+        m_Active = json["m_Active"].asBool();
 }
 
-bool Motion::Create(const Json::Value & a_Response) {
-    Log::Debug("Motion", "Created Motion Object");
-    Log::Debug("Motion", "Received value: %s", Json::FastWriter().write(a_Response).c_str());
-	std::string response = Json::FastWriter().write(a_Response);
-	if (Json::FastWriter().write(a_Response).find("in") != std::string::npos)
-	{
-		Log::Debug("Motion", "NOT ACTIVE!!");
-		m_Active = false;
-		Log::Debug("Motion", "m_Active is: %d", m_Active);
-	}
-	else
+bool Motion::Create(const Json::Value & a_Response)
+{
+	DeviceEvent::List events;
+	DeviceEvent::Parse(a_Response, events);
+	for (size_t i = 0; i < events.size(); ++i)
 	{
-		m_Active = true;
+		if (events[i].IsMotion())
+		{
+			m_DeviceId = events[i].m_DeviceId;
+			m_Active = events[i].IsActive();
+			return true;
+		}
 	}
-	return true;
-
-    /*m_Text = a_Active["text"].asString();
-
-    const std::string &top_class = a_Intent["top_class"].asString();
-    const std::string &parse = a_Parse["doc"]["sents"]["sent"][0]["parse"]["text"].asString();
-
-
-
-
-    if (top_class == "name_statement")
-    {
-        m_Target = top_class;
-        const std::string &type = a_Parse["doc"]["entities"]["entity"][0]["type"].asString();
-        if(type == "PERSON" && a_Parse["doc"]["entities"]["entity"].size() > 1)
-        {
-            m_Name = a_Parse["doc"]["entities"]["entity"][0]["mentref"][0]["text"].asString();
-        }
-        else
-        {
-            std::size_t found = m_Text.find_last_of(" ");
-            m_Name = m_Text.substr(found+1);
-        }
-    }*/
+	return false;
 }
-
@@ -20,6 +20,7 @@
 #define SELF_MOTION_H
 
 #include "blackboard/IThing.h"
+#include "sensors/DeviceEvent.h"
 
 class Motion : public IThing
 {
@@ -33,6 +34,9 @@ public:
     //To set set the default value.
 	Motion() : IThing( TT_PERCEPTION ), m_Active(false)
 	{}
+	Motion( const DeviceEvent & a_Event ) : IThing( TT_PERCEPTION ), 
+		m_DeviceId( a_Event.m_DeviceId ), m_Active( a_Event.IsActive() )
+	{}
 
     //! ISerializable interface
     virtual void Serialize(Json::Value &json);
@@ -41,6 +45,11 @@ public:
     virtual bool Create(const Json::Value &a_Response);
 
     //! Accessors and Mutators
+    const std::string & GetDeviceId() const
+    {
+        return m_DeviceId;
+    }
+
     // Used to check the active data
     bool IsActive()
     {
@@ -52,12 +61,8 @@ public:
         m_Active = a_Active;
     }
 
+	std::string m_DeviceId;
 	bool m_Active;
-
-private:
-
-    //! Data
-    
 };
 
 
@@ -19,6 +19,7 @@
 #include "SelfInstance.h"
 #include "blackboard/BlackBoard.h"
 #include "MotionExtractor.h"
+#include "sensors/DeviceEventData.h"
 
 REG_SERIALIZABLE(MotionExtractor);
 RTTI_IMPL(MotionExtractor, IExtractor);
@@ -46,6 +47,7 @@ bool MotionExtractor::OnStop()
 	for (SensorManager::SensorList::iterator iSensor = m_MotionSensors.begin(); iSensor != m_MotionSensors.end(); ++iSensor)
 		(*iSensor)->Unsubscribe(this);
 	m_MotionSensors.clear();
+	m_Active.clear();
 
 	Log::Status("MotionExtractor", "MotionExtractor stopped");
 	return true;
@@ -53,16 +55,38 @@ bool MotionExtractor::OnStop()
 
 void MotionExtractor::OnMotionData(IData * data)
 {
-	// TODO: Needs to make sense if it is an image, text, or environment - defaulting to environment now
-	// This is going to take in "data" from the sensor and add a live motion object to it.
+	// sensors that parse their payloads hand us the events, anything else is parsed here once
+	DeviceEventData * pEventData = DynamicCast<DeviceEventData>(data);
+	if (pEventData != NULL)
+	{
+		const DeviceEvent::List & events = pEventData->GetEvents();
+		for (size_t i = 0; i < events.size(); ++i)
+			OnMotionEvent(events[i]);
+		return;
+	}
+
 	RemoteDeviceData * pRemoteDevice = DynamicCast<RemoteDeviceData>(data);
 	if (pRemoteDevice != NULL)
 	{
-		Motion::SP spMotion(new Motion());
-		if (spMotion->Create(pRemoteDevice->GetContent()))
-			SelfInstance::GetInstance()->GetBlackBoard()->AddThing(spMotion);
+		DeviceEvent::List events;
+		DeviceEvent::Parse(pRemoteDevice->GetContent(), events);
+		for (size_t i = 0; i < events.size(); ++i)
+			OnMotionEvent(events[i]);
 	}
 }
 
+void MotionExtractor::OnMotionEvent(const DeviceEvent & a_Event)
+{
+	if (!a_Event.IsMotion())
+		return;
 
-
+	// only the inactive -> active edge is news, repeated reports of the same state are dropped
+	bool & bActive = m_Active[a_Event.m_DeviceId];
+	bool bWasActive = bActive;
+	bActive = a_Event.IsActive();
+	if (bActive && !bWasActive)
+	{
+		Log::Debug("MotionExtractor", "Motion started on device %s", a_Event.m_DeviceId.c_str());
+		SelfInstance::GetInstance()->GetBlackBoard()->AddThing(Motion::SP(new Motion(a_Event)));
+	}
+}
@@ -23,6 +23,7 @@
 #include "sensors/SensorManager.h"
 #include "sensors/RemoteDeviceData.h"
 #include "blackboard/Motion.h"
+#include "sensors/DeviceEvent.h"
 #include "utils/Factory.h"
 #include "SelfLib.h"
 
@@ -47,9 +48,11 @@ private:
 
 	//! Data
 	SensorList		                    m_MotionSensors;
+	std::map<std::string,bool>			m_Active;		// motion state of each device
 
 	//! Callback handler
 	void                                OnMotionData(IData * data);
+	void								OnMotionEvent(const DeviceEvent & a_Event);
 };
 
 #endif
@@ -0,0 +1,119 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "DeviceEvent.h"
+#include "utils/StringUtil.h"
+
+namespace {
+
+	std::string ToString( const Json::Value & a_Value )
+	{
+		if ( a_Value.isString() )
+			return a_Value.asString();
+		if ( a_Value.isBool() )
+			return a_Value.asBool() ? "true" : "false";
+		if ( a_Value.isNumeric() )
+			return StringUtil::Format( "%g", a_Value.asDouble() );
+		return std::string();
+	}
+
+	std::string GetDeviceId( const Json::Value & a_Object, const std::string & a_Parent )
+	{
+		if ( a_Object["deviceId"].isString() )
+			return a_Object["deviceId"].asString();
+		if ( a_Object["id"].isString() )
+			return a_Object["id"].asString();
+		return a_Parent;
+	}
+
+	void ParseValue( const Json::Value & a_Value, const std::string & a_DeviceId, DeviceEvent::List & a_Events )
+	{
+		if ( a_Value.isArray() )
+		{
+			for( Json::ValueConstIterator iValue = a_Value.begin(); iValue != a_Value.end(); ++iValue )
+				ParseValue( *iValue, a_DeviceId, a_Events );
+			return;
+		}
+		if (! a_Value.isObject() )
+			return;
+
+		std::string deviceId( GetDeviceId( a_Value, a_DeviceId ) );
+
+		// subscription / webhook event
+		if ( a_Value.isMember( "attribute" ) && a_Value.isMember( "value" ) )
+		{
+			a_Events.push_back( DeviceEvent( deviceId, a_Value["attribute"].asString(), ToString( a_Value["value"] ) ) );
+			return;
+		}
+		// SmartApp endpoint style name/value pair
+		if ( a_Value["name"].isString() && a_Value.isMember( "value" ) && !a_Value["value"].isObject() )
+		{
+			a_Events.push_back( DeviceEvent( deviceId, a_Value["name"].asString(), ToString( a_Value["value"] ) ) );
+			return;
+		}
+		// device status, components -> capabilities -> attributes -> { "value" }
+		if ( a_Value["components"].isObject() )
+		{
+			const Json::Value & components = a_Value["components"];
+			for( Json::ValueConstIterator iComponent = components.begin(); iComponent != components.end(); ++iComponent )
+			{
+				if (! (*iComponent).isObject() )
+					continue;
+				for( Json::ValueConstIterator iCapability = (*iComponent).begin(); iCapability != (*iComponent).end(); ++iCapability )
+				{
+					if (! (*iCapability).isObject() )
+						continue;
+					for( Json::ValueConstIterator iAttribute = (*iCapability).begin(); iAttribute != (*iCapability).end(); ++iAttribute )
+					{
+						if ( (*iAttribute).isObject() && (*iAttribute).isMember( "value" ) )
+							a_Events.push_back( DeviceEvent( deviceId, iAttribute.key().asString(), ToString( (*iAttribute)["value"] ) ) );
+					}
+				}
+			}
+			return;
+		}
+
+		// anything else, containers are searched and if there are none the plain members are attributes
+		bool bContainer = false;
+		for( Json::ValueConstIterator iMember = a_Value.begin(); iMember != a_Value.end(); ++iMember )
+		{
+			if ( (*iMember).isObject() || (*iMember).isArray() )
+			{
+				ParseValue( *iMember, deviceId, a_Events );
+				bContainer = true;
+			}
+		}
+		if ( bContainer )
+			return;
+
+		for( Json::ValueConstIterator iMember = a_Value.begin(); iMember != a_Value.end(); ++iMember )
+		{
+			std::string name( iMember.key().asString() );
+			if ( (*iMember).isString() && name != "deviceId" && name != "id" )
+				a_Events.push_back( DeviceEvent( deviceId, name, (*iMember).asString() ) );
+		}
+	}
+}
+
+bool DeviceEvent::Parse( const Json::Value & a_Content, List & a_Events )
+{
+	size_t count = a_Events.size();
+	ParseValue( a_Content, std::string(), a_Events );
+	return a_Events.size() > count;
+}
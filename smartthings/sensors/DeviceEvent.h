@@ -0,0 +1,65 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_DEVICEEVENT_H
+#define SELF_DEVICEEVENT_H
+
+#include <string>
+#include <vector>
+
+#include "jsoncpp/json/json.h"
+#include "SelfLib.h"
+
+//! One attribute change of a SmartThings device, e.g. motion becoming active. Payloads are parsed
+//! into these once where they arrive, so nothing downstream has to search the raw JSON again.
+struct DeviceEvent
+{
+	typedef std::vector<DeviceEvent>	List;
+
+	DeviceEvent()
+	{}
+	DeviceEvent( const std::string & a_DeviceId, const std::string & a_Attribute, const std::string & a_Value ) :
+		m_DeviceId( a_DeviceId ), m_Attribute( a_Attribute ), m_Value( a_Value )
+	{}
+
+	std::string		m_DeviceId;			// empty if the payload didn't say
+	std::string		m_Attribute;		// e.g. motion, contact, temperature
+	std::string		m_Value;
+
+	bool IsMotion() const
+	{
+		return m_Attribute == "motion";
+	}
+	bool IsActive() const
+	{
+		return m_Value == "active";
+	}
+	//! Key that identifies the attribute of a device, for tracking state per device.
+	std::string GetKey() const
+	{
+		return m_DeviceId + "/" + m_Attribute;
+	}
+
+	//! Parse the events from a SmartThings payload. Understands device status (components), 
+	//! subscription and webhook events (deviceEvent), name/value lists and flat attribute objects.
+	//! Returns false if no events were found.
+	static bool Parse( const Json::Value & a_Content, List & a_Events );
+};
+
+#endif
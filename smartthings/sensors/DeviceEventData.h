@@ -0,0 +1,49 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_DEVICEEVENTDATA_H
+#define SELF_DEVICEEVENTDATA_H
+
+#include "sensors/RemoteDeviceData.h"
+#include "DeviceEvent.h"
+#include "SelfLib.h"
+
+//! RemoteDeviceData that carries the events already parsed from its content, so consumers on the 
+//! main thread don't parse the payload again. Only the events that changed since the last time the
+//! sensor reported are included.
+class DeviceEventData : public RemoteDeviceData
+{
+public:
+	RTTI_DECL();
+
+	DeviceEventData( const Json::Value & a_Content, const DeviceEvent::List & a_Events ) :
+		RemoteDeviceData( a_Content ), m_Events( a_Events )
+	{}
+
+	const DeviceEvent::List & GetEvents() const
+	{
+		return m_Events;
+	}
+
+private:
+	//! Data
+	DeviceEvent::List		m_Events;
+};
+
+#endif
@@ -25,6 +25,13 @@
 #include "utils/TimerPool.h"
 #include "sensors/RemoteDeviceData.h"
 #include "sensors/ISensor.h"
+#include "DeviceEvent.h"
+#include "utils/RestConnectionPool.h"
+#include "utils/WebhookServer.h"
+#include "utils/HttpSignature.h"
+
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 #include "SelfLib.h"
 
 //! This is the base class for a interacting with external devices
@@ -91,7 +98,10 @@ public:
 
 	//Definging the sensor time
 	//! Construction
-	ExampleSensor() : ISensor("ExampleSensor"), m_fPollInterval( 1.0f )
+	ExampleSensor() : ISensor("ExampleSensor"), m_fPollInterval( 1.0f ), m_MaxIdleConnections( 4 ),
+		m_fIdleTimeout( 30.0f ), m_fRequestTimeout( 10.0f ), m_WebhookAddress( "127.0.0.1" ), m_WebhookPort( 0 ), 
+		m_fWebhookIdleTimeout( 30.0f ), m_bVerifySignature( true ), m_SmartThingsAPI( "https://api.smartthings.com/" ),
+		m_fReconcileInterval( 60.0f ), m_bPolling( false ), m_SkippedPolls( 0 )
 	{}
 
 	//! ISerializable interface
@@ -110,34 +120,102 @@ public:
 	virtual void OnResume();
 
 	void SendingData( RemoteDeviceData * a_pData );
+	//! True if a_URL is under a_API, a confirmation url anywhere else is never fetched.
+	static bool IsTrustedURL( const std::string & a_URL, const std::string & a_API );
 
 private:
 	//! Types
+	//! A Rest with its variable references found up front, so each poll only resolves the fields
+	//! that need it and knows which earlier responses it has to wait for.
+	struct Step
+	{
+		Step() : m_bResolveURL( false )
+		{}
+
+		Rest						m_Rest;
+		bool						m_bResolveURL;		// m_URL or m_Params contains a variable
+		std::vector<std::string>	m_ResolveHeaders;	// headers whose value contains a variable
+		std::vector<size_t>			m_Depends;			// steps whose response this step uses
+	};
+	typedef std::vector<Step>		StepList;
+
+	//! Shared by the sensor and its poll. OnStop() clears m_pSensor, so a poll still running
+	//! skips its remaining steps and never touches the sensor again.
+	struct PollLink
+	{
+		PollLink( ExampleSensor * a_pSensor ) : m_pSensor( a_pSensor )
+		{}
+
+		boost::mutex		m_Lock;
+		ExampleSensor *		m_pSensor;
+	};
+	typedef boost::shared_ptr<PollLink>		PollLinkSP;
+
+	//! Runs one poll of the steps, each step starts as soon as the steps it depends on are done
+	//! so independent requests are made in parallel.
 	class DeviceRequest
 	{
 	public:
-		DeviceRequest();
-		DeviceRequest(const std::vector<ExampleSensor::Rest> & Rests, ExampleSensor * a_pDevice);
+		DeviceRequest(const StepList & a_Steps, const PollLinkSP & a_spLink);
 		~DeviceRequest();
 
-		void OnState(IWebClient * a_pConnector);
-		void OnResponse(IWebClient::RequestData * a_pResponse);
-		void MakeRequest();
+		void Start();
 
 	private:
-		size_t m_Index;
-		ExampleSensor * m_pDevice;
-		std::vector<ExampleSensor::Rest> m_Rests;
-		IWebClient::SP m_spClient;
+		PollLinkSP m_spLink;
+		StepList m_Steps;
+		std::vector<bool> m_Started;
+		std::vector<bool> m_Done;
+		size_t m_Finished;
+		bool m_bFailed;			// a step got no response, so the poll has nothing to report
+		boost::mutex m_Lock;
 		ParamsMap m_Param;
+
+		void RunStep(size_t a_Index);
+		//! Find the steps that can start now and mark them started, m_Lock must be held.
+		void GetReady(std::vector<size_t> & a_Ready);
+		void Dispatch(const std::vector<size_t> & a_Ready);
+		bool IsCancelled();
+		//! Report the poll to the sensor if it's still running, then delete this.
+		void OnComplete();
 	};
 
 	//!Data
 	float					m_fPollInterval;
 	std::vector<Rest>       m_Rests;
+	size_t					m_MaxIdleConnections;	// keep-alive connections kept open per host
+	float					m_fIdleTimeout;
+	float					m_fRequestTimeout;		// seconds any step of a REST request may take
+	std::string				m_WebhookAddress;
+	int						m_WebhookPort;			// if not 0, device events are pushed to us on this port
+	std::string				m_WebhookPath;			// if not empty, only callbacks to this path are accepted
+	float					m_fWebhookIdleTimeout;	// seconds a webhook connection may sit without sending anything
+	bool					m_bVerifySignature;		// reject webhook requests not signed with m_SmartAppPublicKey
+	std::string				m_SmartAppPublicKey;	// PEM public key SmartThings signs callbacks with
+	std::string				m_SmartThingsAPI;		// confirmation urls are only fetched under this url
+	float					m_fReconcileInterval;	// poll interval while events are being pushed
+	StepList				m_Steps;
+	WebhookServer			m_Webhook;
+	HttpSignature			m_Signature;
 	TimerPool::ITimer::SP   m_spWaitTimer;
+	PollLinkSP				m_spPollLink;		// replaced on each start so polls from before a stop are dropped
+	boost::mutex			m_StateLock;
+	std::map<std::string,std::string>
+							m_LastValues;		// last value sent for each device attribute
+	bool					m_bPolling;			// a poll is still running, m_StateLock
+	unsigned int			m_SkippedPolls;
+
+	void					CompileSteps();
+	void					OnPollDone();
+	//! Send the events in a poll response or callback, or the raw content if no events were found.
+	void					ReceiveContent( const Json::Value & a_Content );
+	//! Handle a SmartThings SmartApp callback, or a plain device event posted to the webhook.
+	void					OnWebhook( WebhookServer::Request * a_pRequest );
+	void					ConfirmWebhook( std::string a_URL );
 
 	void                    StreamingThread();
+	//! Find the events whose value differs from what was last sent, so unchanged polls are dropped.
+	void					GetChanges( const DeviceEvent::List & a_Events, DeviceEvent::List & a_Changed );
 };
 
 #endif
@@ -0,0 +1,313 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "utils/TimerPool.h"
+#include "sensors/ExampleSensor.h"
+#include "sensors/DeviceEventData.h"
+#include "tests/StandInServer.h"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+#include <time.h>
+
+//! Drives the ExampleSensor webhook with signed and unsigned SmartApp callbacks. A stand-in server
+//! plays the SmartThings API the confirmation url points at.
+class TestExampleWebhook : UnitTest
+{
+public:
+	//! Construction
+	TestExampleWebhook() : UnitTest("TestExampleWebhook"),
+		m_pKey(NULL),
+		m_Confirmations(0),
+		m_Delivered(0),
+		m_EventData(0),
+		m_MotionEdges(0),
+		m_bMotion(false)
+	{ }
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+		TimerPool timers;
+
+		Test( ExampleSensor::IsTrustedURL( "https://api.smartthings.com/apps/1/confirm-registration?token=a", "https://api.smartthings.com" ) );
+		Test(! ExampleSensor::IsTrustedURL( "https://api.smartthings.com.example.com/x", "https://api.smartthings.com" ) );
+		Test(! ExampleSensor::IsTrustedURL( "https://api.smartthings.com@example.com/x", "https://api.smartthings.com/" ) );
+		Test(! ExampleSensor::IsTrustedURL( "http://169.254.169.254/latest/meta-data", "https://api.smartthings.com/" ) );
+		Test(! ExampleSensor::IsTrustedURL( "https://api.smartthings.com/x HTTP/1.1\r\nHost: example.com", "https://api.smartthings.com/" ) );
+
+		Test( CreateKey() );
+		StandInServer api( boost::bind( &TestExampleWebhook::ServeAPI, this, _1, _2, _3 ) );
+
+		Json::Value config;
+		config["m_WebhookPort"] = GetFreePort();
+		config["m_fWebhookIdleTimeout"] = 0.5f;
+		config["m_fReconcileInterval"] = 3600.0f;
+		config["m_SmartAppPublicKey"] = m_PublicKey;
+		config["m_SmartThingsAPI"] = api.GetURL() + "/";
+
+		ExampleSensor sensor;
+		Json::Value defaults;
+		sensor.Serialize( defaults );
+		Test( defaults["m_WebhookAddress"].asString() == "127.0.0.1" );
+
+		sensor.Deserialize( config );
+		Test( sensor.OnStart() );
+		int port = config["m_WebhookPort"].asInt();
+
+		// a signed ping is answered, unsigned, tampered or stale ones aren't
+		std::string ping( "{\"lifecycle\":\"PING\",\"pingData\":{\"challenge\":\"abc\"}}" );
+		std::string response;
+		Test( Post( port, ping, Sign( "/", ping ), response ) == 200 );
+		Test( response.find( "abc" ) != std::string::npos );
+		Test( Post( port, ping, "", response ) == 401 );
+		Test( Post( port, ping, Sign( "/", "{\"lifecycle\":\"PING\"}" ), response ) == 401 );
+		Test( Post( port, ping, Sign( "/other", ping ), response ) == 401 );
+		Test( Post( port, ping, Sign( "/", ping, time(NULL) - 3600 ), response ) == 401 );
+
+		// the confirmation url is only fetched on the configured API
+		std::string confirm( "{\"lifecycle\":\"CONFIRMATION\",\"confirmationData\":{\"confirmationUrl\":\"" 
+			+ api.GetURL() + "/apps/1/confirm-registration?token=t\"}}" );
+		Test( Post( port, confirm, Sign( "/", confirm ), response ) == 200 );
+		Test( Wait( m_Confirmations, 1 ) );
+		Test( m_ConfirmedPath == "/apps/1/confirm-registration?token=t" );
+
+		std::string elsewhere( "{\"lifecycle\":\"CONFIRMATION\",\"confirmationData\":{\"confirmationUrl\":\"" 
+			+ StringUtil::Format( "http://localhost:%d", api.GetPort() ) + "/apps/1/confirm-registration\"}}" );
+		Test( Post( port, elsewhere, Sign( "/", elsewhere ), response ) == 403 );
+		Test( Post( port, confirm, "", response ) == 401 );
+		boost::this_thread::sleep( boost::posix_time::milliseconds( 200 ) );
+		Test( m_Confirmations == 1 );
+
+		// signed events reach subscribers parsed, repeats of the same state are not sent again
+		sensor.Subscribe( DELEGATE( TestExampleWebhook, OnData, IData *, this ) );
+		Test( PostEvent( port, "inactive", response ) == 200 );
+		Test( response.find( "eventData" ) != std::string::npos );
+		Test( Wait( m_Delivered, 1 ) );
+		Test( m_EventData == 1 && m_Events.size() == 1 );
+		Test( m_Events.size() == 1 && m_Events[0].m_DeviceId == "d1" && m_Events[0].IsMotion() && !m_Events[0].IsActive() );
+		Test( m_MotionEdges == 0 );
+
+		Test( PostEvent( port, "inactive", response ) == 200 );
+		double pushed = Time().GetEpochTime();
+		Test( PostEvent( port, "active", response ) == 200 );
+		Test( Wait( m_Delivered, 2 ) );
+		double latency = m_fDeliveredTime - pushed;
+		Test( m_EventData == 2 && m_MotionEdges == 1 );
+		Test( m_Events.size() == 1 && m_Events[0].IsMotion() && m_Events[0].IsActive() );
+		Test( m_Content.isArray() && m_Content.size() == 1 );
+
+		Test( PostEvent( port, "active", response ) == 200 );
+		Test( Post( port, MakeEvent( "inactive" ), "", response ) == 401 );
+
+		// nothing recognizable in the events is still passed on, as plain device data
+		std::string empty( "{\"lifecycle\":\"EVENT\",\"eventData\":{\"events\":[]}}" );
+		Test( Post( port, empty, Sign( "/", empty ), response ) == 200 );
+		Test( Wait( m_Delivered, 3 ) );
+		Test( m_Delivered == 3 && m_EventData == 2 && m_MotionEdges == 1 );
+		Log::Status( "TestExampleWebhook", "EVENT push to delivery on the main thread %.2f ms", latency * 1000.0 );
+		sensor.Unsubscribe( this );
+
+		// a head that never ends and a client that never sends are both cut off
+		Test( SendRaw( port, "POST / HTTP/1.1\r\n" + std::string( 20 * 1024, 'x' ) ).find( " 431 " ) != std::string::npos );
+		Test( IdleIsClosed( port ) );
+
+		Test( sensor.OnStop() );
+		api.Stop();
+		EVP_PKEY_free( m_pKey );
+		m_pKey = NULL;
+	}
+
+private:
+	EVP_PKEY *			m_pKey;
+	std::string			m_PublicKey;
+	volatile int		m_Confirmations;
+	std::string			m_ConfirmedPath;
+	volatile int		m_Delivered;
+	int					m_EventData;
+	int					m_MotionEdges;
+	bool				m_bMotion;
+	double				m_fDeliveredTime;
+	DeviceEvent::List	m_Events;
+	Json::Value			m_Content;
+
+	bool CreateKey()
+	{
+		EVP_PKEY_CTX * pContext = EVP_PKEY_CTX_new_id( EVP_PKEY_RSA, NULL );
+		bool bCreated = pContext != NULL && EVP_PKEY_keygen_init( pContext ) == 1
+			&& EVP_PKEY_CTX_set_rsa_keygen_bits( pContext, 2048 ) == 1
+			&& EVP_PKEY_keygen( pContext, &m_pKey ) == 1;
+		if ( pContext != NULL )
+			EVP_PKEY_CTX_free( pContext );
+		if (! bCreated )
+			return false;
+
+		BIO * pBio = BIO_new( BIO_s_mem() );
+		PEM_write_bio_PUBKEY( pBio, m_pKey );
+		char * pData = NULL;
+		long length = BIO_get_mem_data( pBio, &pData );
+		m_PublicKey.assign( pData, length );
+		BIO_free( pBio );
+		return true;
+	}
+
+	//! Headers SmartThings would send with a_Body posted to a_Path, signed at a_Time.
+	std::string Sign( const std::string & a_Path, const std::string & a_Body, time_t a_Time = time(NULL) )
+	{
+		char date[64];
+		strftime( date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime( &a_Time ) );
+		std::string digest( HttpSignature::GetDigest( a_Body ) );
+		std::string signing( "(request-target): post " + a_Path + "\ndigest: " + digest + "\ndate: " + date );
+
+		std::string signature( EVP_PKEY_size( m_pKey ), '\0' );
+		size_t length = signature.size();
+		EVP_MD_CTX * pContext = EVP_MD_CTX_create();
+		EVP_DigestSignInit( pContext, NULL, EVP_sha256(), NULL, m_pKey );
+		EVP_DigestSignUpdate( pContext, signing.data(), signing.size() );
+		EVP_DigestSignFinal( pContext, (unsigned char *)&signature[0], &length );
+		EVP_MD_CTX_destroy( pContext );
+		signature.resize( length );
+
+		return "Digest: " + digest + "\r\nDate: " + date + "\r\nAuthorization: Signature keyId=\"/pl/useast1/test\","
+			"signature=\"" + StandInServer::Base64( signature ) + "\",headers=\"(request-target) digest date\",algorithm=\"rsa-sha256\"\r\n";
+	}
+
+	//! An EVENT lifecycle callback with one motion change on device d1, like SmartThings pushes.
+	std::string MakeEvent( const std::string & a_Value )
+	{
+		return "{\"lifecycle\":\"EVENT\",\"eventData\":{\"events\":[{\"eventType\":\"DEVICE_EVENT\",\"deviceEvent\":{"
+			"\"deviceId\":\"d1\",\"componentId\":\"main\",\"capability\":\"motionSensor\",\"attribute\":\"motion\","
+			"\"value\":\"" + a_Value + "\",\"stateChange\":true}}]}}";
+	}
+
+	int PostEvent( int a_Port, const std::string & a_Value, std::string & a_Response )
+	{
+		std::string body( MakeEvent( a_Value ) );
+		return Post( a_Port, body, Sign( "/", body ), a_Response );
+	}
+
+	//! Sees the data the way MotionExtractor does, counting each inactive to active edge
+	void OnData( IData * a_pData )
+	{
+		m_fDeliveredTime = Time().GetEpochTime();
+		RemoteDeviceData * pRemote = DynamicCast<RemoteDeviceData>( a_pData );
+		if ( pRemote != NULL )
+			m_Content = pRemote->GetContent();
+
+		DeviceEventData * pEvents = DynamicCast<DeviceEventData>( a_pData );
+		if ( pEvents != NULL )
+		{
+			m_EventData += 1;
+			m_Events = pEvents->GetEvents();
+			for(size_t i=0;i<m_Events.size();++i)
+			{
+				if (! m_Events[i].IsMotion() )
+					continue;
+				if ( m_Events[i].IsActive() && !m_bMotion )
+					m_MotionEdges += 1;
+				m_bMotion = m_Events[i].IsActive();
+			}
+		}
+		m_Delivered += 1;
+	}
+
+	//! POST a_Body to / with a_Headers, returns the status code.
+	int Post( int a_Port, const std::string & a_Body, const std::string & a_Headers, std::string & a_Response )
+	{
+		std::string request( StringUtil::Format( "POST / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n"
+			"Content-Type: application/json\r\nContent-Length: %u\r\n", (unsigned int)a_Body.size() ) );
+		request += a_Headers + "\r\n" + a_Body;
+
+		a_Response = SendRaw( a_Port, request );
+		size_t space = a_Response.find( ' ' );
+		return space != std::string::npos ? atoi( a_Response.c_str() + space + 1 ) : 0;
+	}
+
+	//! Write a_Request and read until the server closes the connection.
+	std::string SendRaw( int a_Port, const std::string & a_Request )
+	{
+		boost::asio::io_service service;
+		StandInServer::Socket socket( service );
+		socket.connect( boost::asio::ip::tcp::endpoint( boost::asio::ip::address::from_string( "127.0.0.1" ), (unsigned short)a_Port ) );
+		boost::system::error_code error;
+		boost::asio::write( socket, boost::asio::buffer( a_Request ), error );
+
+		std::string response;
+		char buffer[ 1024 ];
+		while(! error )
+		{
+			size_t bytes = socket.read_some( boost::asio::buffer( buffer ), error );
+			response.append( buffer, bytes );
+		}
+		return response;
+	}
+
+	bool IdleIsClosed( int a_Port )
+	{
+		boost::asio::io_service service;
+		StandInServer::Socket socket( service );
+		socket.connect( boost::asio::ip::tcp::endpoint( boost::asio::ip::address::from_string( "127.0.0.1" ), (unsigned short)a_Port ) );
+
+		Time start;
+		while( (Time().GetEpochTime() - start.GetEpochTime()) < 5.0 )
+		{
+			if ( StandInServer::IsClosed( socket ) )
+				return true;
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 20 ) );
+		}
+		return false;
+	}
+
+	int GetFreePort()
+	{
+		boost::asio::io_service service;
+		boost::asio::ip::tcp::acceptor acceptor( service, 
+			boost::asio::ip::tcp::endpoint( boost::asio::ip::address::from_string( "127.0.0.1" ), 0 ) );
+		return acceptor.local_endpoint().port();
+	}
+
+	bool Wait( volatile int & a_Value, int a_Target )
+	{
+		Time start;
+		while( a_Value < a_Target && (Time().GetEpochTime() - start.GetEpochTime()) < 10.0 )
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+		}
+		return a_Value >= a_Target;
+	}
+
+	void ServeAPI( StandInServer::Socket & a_Socket, boost::asio::streambuf & a_Buffer, const std::string & a_Request )
+	{
+		std::string line( a_Request.substr( 0, a_Request.find( "\r\n" ) ) );
+		if ( line.compare( 0, 4, "GET " ) == 0 )
+		{
+			m_ConfirmedPath = line.substr( 4, line.rfind( ' ' ) - 4 );
+			m_Confirmations += 1;
+		}
+		StandInServer::WriteResponse( a_Socket, 200, "{}" );
+	}
+};
+
+TestExampleWebhook TEST_EXAMPLE_WEBHOOK;
@@ -0,0 +1,250 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "HttpSignature.h"
+#include "utils/Time.h"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <vector>
+
+namespace {
+
+	std::string Base64Encode( const unsigned char * a_pData, size_t a_Size )
+	{
+		std::vector<unsigned char> out( 4 * ((a_Size + 2) / 3) + 1 );
+		int length = EVP_EncodeBlock( &out[0], a_pData, (int)a_Size );
+		return std::string( (const char *)&out[0], length );
+	}
+
+	bool Base64Decode( const std::string & a_Encoded, std::string & a_Decoded )
+	{
+		if ( a_Encoded.size() == 0 || (a_Encoded.size() % 4) != 0 )
+			return false;
+
+		std::vector<unsigned char> out( 3 * a_Encoded.size() / 4 + 1 );
+		int length = EVP_DecodeBlock( &out[0], (const unsigned char *)a_Encoded.data(), (int)a_Encoded.size() );
+		if ( length < 0 )
+			return false;
+
+		// EVP_DecodeBlock counts the padding as data
+		if ( a_Encoded[a_Encoded.size() - 1] == '=' )
+			length -= 1;
+		if ( a_Encoded[a_Encoded.size() - 2] == '=' )
+			length -= 1;
+		a_Decoded.assign( (const char *)&out[0], length );
+		return true;
+	}
+
+	//! Split the Authorization header parameters, key="value" pairs separated by commas.
+	bool ParseParams( const std::string & a_Params, std::map<std::string,std::string> & a_Values )
+	{
+		size_t offset = 0;
+		while( offset < a_Params.size() )
+		{
+			size_t equals = a_Params.find( "=\"", offset );
+			if ( equals == std::string::npos )
+				return false;
+			size_t end = a_Params.find( '"', equals + 2 );
+			if ( end == std::string::npos )
+				return false;
+
+			std::string key( a_Params.substr( offset, equals - offset ) );
+			size_t start = key.find_first_not_of( " ," );
+			a_Values[ start != std::string::npos ? key.substr( start ) : key ] = a_Params.substr( equals + 2, end - equals - 2 );
+			offset = end + 1;
+		}
+		return true;
+	}
+
+	//! Days since 1970-01-01 for a date in the proleptic Gregorian calendar
+	long DaysFromCivil( int a_Year, int a_Month, int a_Day )
+	{
+		a_Year -= a_Month <= 2 ? 1 : 0;
+		long era = (a_Year >= 0 ? a_Year : a_Year - 399) / 400;
+		long yoe = a_Year - era * 400;
+		long doy = (153 * (a_Month + (a_Month > 2 ? -3 : 9)) + 2) / 5 + a_Day - 1;
+		long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + doe - 719468;
+	}
+}
+
+HttpSignature::HttpSignature() : m_pKey( NULL ), m_MaxSkew( 300.0f )
+{}
+
+HttpSignature::~HttpSignature()
+{
+	if ( m_pKey != NULL )
+		EVP_PKEY_free( m_pKey );
+}
+
+bool HttpSignature::SetPublicKey( const std::string & a_PEM )
+{
+	if ( m_pKey != NULL )
+	{
+		EVP_PKEY_free( m_pKey );
+		m_pKey = NULL;
+	}
+
+	BIO * pBio = BIO_new_mem_buf( (void *)a_PEM.data(), (int)a_PEM.size() );
+	if ( pBio == NULL )
+		return false;
+	m_pKey = PEM_read_bio_PUBKEY( pBio, NULL, NULL, NULL );
+	BIO_free( pBio );
+
+	return m_pKey != NULL;
+}
+
+bool HttpSignature::Verify( const std::string & a_Method, const std::string & a_Path, const Headers & a_Headers,
+	const std::string & a_Body, std::string & a_Error ) const
+{
+	if ( m_pKey == NULL )
+	{
+		a_Error = "no public key";
+		return false;
+	}
+
+	Headers::const_iterator iAuthorization = a_Headers.find( "authorization" );
+	if ( iAuthorization == a_Headers.end() || iAuthorization->second.compare( 0, 10, "Signature " ) != 0 )
+	{
+		a_Error = "not signed";
+		return false;
+	}
+
+	std::map<std::string,std::string> params;
+	if (! ParseParams( iAuthorization->second.substr( 10 ), params ) )
+	{
+		a_Error = "invalid signature parameters";
+		return false;
+	}
+	if ( params.find( "algorithm" ) != params.end() && params["algorithm"] != "rsa-sha256" )
+	{
+		a_Error = "unsupported algorithm " + params["algorithm"];
+		return false;
+	}
+
+	// the signature must cover what we act on, the target and the body through its digest
+	std::string names( params["headers"] );
+	if ( (" " + names + " ").find( " (request-target) " ) == std::string::npos 
+		|| (" " + names + " ").find( " digest " ) == std::string::npos )
+	{
+		a_Error = "signature doesn't cover the request target and digest";
+		return false;
+	}
+
+	std::string signing;
+	for( size_t start = 0; start < names.size(); )
+	{
+		size_t end = names.find( ' ', start );
+		if ( end == std::string::npos )
+			end = names.size();
+		std::string name( names.substr( start, end - start ) );
+		start = end + 1;
+		if ( name.size() == 0 )
+			continue;
+
+		if ( signing.size() > 0 )
+			signing += "\n";
+		if ( name == "(request-target)" )
+		{
+			std::string method( a_Method );
+			for(size_t i=0;i<method.size();++i)
+				method[i] = (char)tolower( method[i] );
+			signing += name + ": " + method + " " + a_Path;
+			continue;
+		}
+
+		Headers::const_iterator iHeader = a_Headers.find( name );
+		if ( iHeader == a_Headers.end() )
+		{
+			a_Error = "signed header " + name + " is missing";
+			return false;
+		}
+		signing += name + ": " + iHeader->second;
+	}
+
+	Headers::const_iterator iDigest = a_Headers.find( "digest" );
+	if ( iDigest->second != GetDigest( a_Body ) )
+	{
+		a_Error = "digest doesn't match the body";
+		return false;
+	}
+
+	Headers::const_iterator iDate = a_Headers.find( "date" );
+	if ( iDate != a_Headers.end() && (" " + names + " ").find( " date " ) != std::string::npos )
+	{
+		double date = ParseDate( iDate->second );
+		if ( date < 0.0 || fabs( Time().GetEpochTime() - date ) > m_MaxSkew )
+		{
+			a_Error = "date " + iDate->second + " is out of range";
+			return false;
+		}
+	}
+
+	std::string signature;
+	if (! Base64Decode( params["signature"], signature ) )
+	{
+		a_Error = "invalid signature encoding";
+		return false;
+	}
+
+	bool bVerified = false;
+	EVP_MD_CTX * pContext = EVP_MD_CTX_create();
+	if ( pContext != NULL 
+		&& EVP_DigestVerifyInit( pContext, NULL, EVP_sha256(), NULL, m_pKey ) == 1
+		&& EVP_DigestVerifyUpdate( pContext, signing.data(), signing.size() ) == 1 )
+	{
+		bVerified = EVP_DigestVerifyFinal( pContext, (unsigned char *)signature.data(), signature.size() ) == 1;
+	}
+	if ( pContext != NULL )
+		EVP_MD_CTX_destroy( pContext );
+
+	if (! bVerified )
+		a_Error = "signature doesn't match";
+	return bVerified;
+}
+
+std::string HttpSignature::GetDigest( const std::string & a_Body )
+{
+	unsigned char digest[ EVP_MAX_MD_SIZE ];
+	unsigned int length = 0;
+	EVP_Digest( a_Body.data(), a_Body.size(), digest, &length, EVP_sha256(), NULL );
+	return "SHA-256=" + Base64Encode( digest, length );
+}
+
+double HttpSignature::ParseDate( const std::string & a_Date )
+{
+	static const char * MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+	// Tue, 07 Jun 2014 20:51:35 GMT
+	char month[4] = { 0 };
+	int day = 0, year = 0, hour = 0, minute = 0, second = 0;
+	if ( sscanf( a_Date.c_str(), "%*3s, %d %3s %d %d:%d:%d GMT", &day, month, &year, &hour, &minute, &second ) != 6 )
+		return -1.0;
+
+	for(int i=0;i<12;++i)
+	{
+		if ( strcmp( month, MONTHS[i] ) == 0 )
+			return (double)DaysFromCivil( year, i + 1, day ) * 86400.0 + hour * 3600 + minute * 60 + second;
+	}
+	return -1.0;
+}
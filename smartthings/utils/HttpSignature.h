@@ -0,0 +1,67 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_HTTPSIGNATURE_H
+#define SELF_HTTPSIGNATURE_H
+
+#include <string>
+#include <map>
+
+#include "SelfLib.h"
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+//! Checks the HTTP signature (draft-cavage-http-signatures, rsa-sha256) SmartThings puts on every
+//! SmartApp callback. The signature has to cover the request target and the Digest header, the
+//! digest has to match the body, and a signed Date header must be within the allowed clock skew.
+class HttpSignature
+{
+public:
+	//! Types
+	typedef std::map<std::string,std::string>	Headers;		// names are lower case
+
+	//! Construction
+	HttpSignature();
+	~HttpSignature();
+
+	//! Load the PEM public key requests must be signed with, returns false if it can't be read.
+	bool SetPublicKey( const std::string & a_PEM );
+	//! Seconds a signed Date header may differ from our clock.
+	void SetMaxSkew( float a_MaxSkew )
+	{
+		m_MaxSkew = a_MaxSkew;
+	}
+
+	//! Returns true if the request is signed by the key, a_Error says why if it isn't.
+	bool Verify( const std::string & a_Method, const std::string & a_Path, const Headers & a_Headers,
+		const std::string & a_Body, std::string & a_Error ) const;
+
+	//! Digest header value for a body, "SHA-256=<base64>".
+	static std::string GetDigest( const std::string & a_Body );
+	//! Seconds since the epoch for an RFC 1123 date, -1 if it can't be parsed.
+	static double ParseDate( const std::string & a_Date );
+
+private:
+	//! Data
+	EVP_PKEY *		m_pKey;
+	float			m_MaxSkew;
+
+	HttpSignature( const HttpSignature & );
+	HttpSignature & operator=( const HttpSignature & );
+};
+
+#endif
@@ -0,0 +1,357 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "WebhookServer.h"
+#include "utils/StringUtil.h"
+#include "utils/Log.h"
+
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+
+namespace {
+
+	const size_t MAX_CONTENT = 1024 * 1024;
+	//! Request line and headers, read_until fails once the buffer holds this much without the blank line
+	const size_t MAX_HEAD = 16 * 1024;
+
+	std::string ToLower( const std::string & a_String )
+	{
+		std::string lower( a_String );
+		std::transform( lower.begin(), lower.end(), lower.begin(), ::tolower );
+		return lower;
+	}
+
+	std::string Trim( const std::string & a_String )
+	{
+		size_t start = a_String.find_first_not_of( " \t\r\n" );
+		if ( start == std::string::npos )
+			return std::string();
+		size_t end = a_String.find_last_not_of( " \t\r\n" );
+		return a_String.substr( start, end - start + 1 );
+	}
+
+	const char * GetReason( int a_StatusCode )
+	{
+		switch( a_StatusCode )
+		{
+		case 200: return "OK";
+		case 202: return "Accepted";
+		case 204: return "No Content";
+		case 400: return "Bad Request";
+		case 401: return "Unauthorized";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 408: return "Request Timeout";
+		case 413: return "Payload Too Large";
+		case 431: return "Request Header Fields Too Large";
+		}
+		return a_StatusCode < 400 ? "OK" : "Error";
+	}
+}
+
+//! One client connection, kept open for as long as the client wants to reuse it. A connection
+//! that sends nothing for the idle timeout, or a head over MAX_HEAD, is closed.
+class WebhookServer::Session : public boost::enable_shared_from_this<Session>
+{
+public:
+	Session( WebhookServer * a_pServer ) : 
+		m_pServer( a_pServer ), 
+		m_Socket( *a_pServer->m_pService ),
+		m_Timer( *a_pServer->m_pService ),
+		m_Buffer( MAX_HEAD ),
+		m_ContentLength( 0 ),
+		m_ContentRead( 0 ),
+		m_bKeepAlive( false )
+	{}
+
+	boost::asio::ip::tcp::socket & GetSocket()
+	{
+		return m_Socket;
+	}
+
+	void ReadHeader()
+	{
+		StartDeadline();
+		boost::asio::async_read_until( m_Socket, m_Buffer, "\r\n\r\n",
+			boost::bind( &Session::OnHeader, shared_from_this(), boost::asio::placeholders::error ) );
+	}
+
+private:
+	//! Data
+	WebhookServer *					m_pServer;
+	boost::asio::ip::tcp::socket	m_Socket;
+	boost::asio::deadline_timer		m_Timer;
+	boost::asio::streambuf			m_Buffer;			// the head, limited to MAX_HEAD
+	Request							m_Request;
+	size_t							m_ContentLength;
+	size_t							m_ContentRead;
+	bool							m_bKeepAlive;
+	std::string						m_Output;
+
+	void StartDeadline()
+	{
+		m_Timer.expires_from_now( boost::posix_time::milliseconds( (int)(m_pServer->m_IdleTimeout * 1000.0f) ) );
+		m_Timer.async_wait( boost::bind( &Session::OnDeadline, shared_from_this(), boost::asio::placeholders::error ) );
+	}
+
+	void OnDeadline( const boost::system::error_code & a_Error )
+	{
+		if ( a_Error == boost::asio::error::operation_aborted 
+			|| m_Timer.expires_at() > boost::asio::deadline_timer::traits_type::now() )
+			return;
+
+		// fails the read in progress, which drops the last reference to this session
+		boost::system::error_code ignored;
+		m_Socket.close( ignored );
+	}
+
+	void OnHeader( const boost::system::error_code & a_Error )
+	{
+		m_Timer.cancel();
+		if ( a_Error == boost::asio::error::not_found )
+		{
+			SendError( 431 );
+			return;
+		}
+		if ( a_Error )
+			return;
+
+		m_Request = Request();
+		std::istream input( &m_Buffer );
+		std::string line;
+		std::getline( input, line );
+
+		std::vector<std::string> parts;
+		StringUtil::Split( Trim( line ), " ", parts );
+		if ( parts.size() < 3 )
+		{
+			SendError( 400 );
+			return;
+		}
+		m_Request.m_Method = parts[0];
+		m_Request.m_Path = parts[1];
+		m_bKeepAlive = parts[2] == "HTTP/1.1";
+
+		while( std::getline( input, line ) && line != "\r" && line.size() > 0 )
+		{
+			size_t colon = line.find( ':' );
+			if ( colon != std::string::npos )
+				m_Request.m_Headers[ ToLower( Trim( line.substr( 0, colon ) ) ) ] = Trim( line.substr( colon + 1 ) );
+		}
+
+		Headers::const_iterator iConnection = m_Request.m_Headers.find( "connection" );
+		if ( iConnection != m_Request.m_Headers.end() )
+		{
+			std::string connection( ToLower( iConnection->second ) );
+			if ( connection == "close" )
+				m_bKeepAlive = false;
+			else if ( connection == "keep-alive" )
+				m_bKeepAlive = true;
+		}
+
+		if ( m_Request.m_Headers.find( "transfer-encoding" ) != m_Request.m_Headers.end() )
+		{
+			// callbacks always send a length, chunked uploads aren't supported
+			SendError( 400 );
+			return;
+		}
+
+		Headers::const_iterator iLength = m_Request.m_Headers.find( "content-length" );
+		m_ContentLength = iLength != m_Request.m_Headers.end() ? strtoul( iLength->second.c_str(), NULL, 10 ) : 0;
+		if ( m_ContentLength > MAX_CONTENT )
+		{
+			SendError( 413 );
+			return;
+		}
+
+		// the content is read outside m_Buffer, so the head limit doesn't apply to it
+		m_Request.m_Content.resize( m_ContentLength );
+		m_ContentRead = std::min( m_ContentLength, m_Buffer.size() );
+		if ( m_ContentRead > 0 )
+		{
+			std::copy( boost::asio::buffers_begin( m_Buffer.data() ), 
+				boost::asio::buffers_begin( m_Buffer.data() ) + m_ContentRead, m_Request.m_Content.begin() );
+			m_Buffer.consume( m_ContentRead );
+		}
+		ReadContent();
+	}
+
+	void ReadContent()
+	{
+		if ( m_ContentRead >= m_ContentLength )
+		{
+			OnContent();
+			return;
+		}
+
+		StartDeadline();
+		m_Socket.async_read_some( boost::asio::buffer( &m_Request.m_Content[m_ContentRead], m_ContentLength - m_ContentRead ),
+			boost::bind( &Session::OnRead, shared_from_this(), boost::asio::placeholders::error, 
+			boost::asio::placeholders::bytes_transferred ) );
+	}
+
+	void OnRead( const boost::system::error_code & a_Error, size_t a_Bytes )
+	{
+		m_Timer.cancel();
+		if ( a_Error )
+			return;
+
+		m_ContentRead += a_Bytes;
+		ReadContent();
+	}
+
+	void OnContent()
+	{
+		if ( m_pServer->m_Handler.IsValid() )
+			m_pServer->m_Handler( &m_Request );
+		else
+			m_Request.m_StatusCode = 404;
+
+		Send( m_Request.m_StatusCode, m_Request.m_ContentType, m_Request.m_Response );
+	}
+
+	void SendError( int a_StatusCode )
+	{
+		m_bKeepAlive = false;
+		Send( a_StatusCode, "text/plain", GetReason( a_StatusCode ) );
+	}
+
+	void Send( int a_StatusCode, const std::string & a_ContentType, const std::string & a_Content )
+	{
+		m_Output = StringUtil::Format( "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n",
+			a_StatusCode, GetReason( a_StatusCode ), a_ContentType.c_str(), (unsigned int)a_Content.size(),
+			m_bKeepAlive ? "keep-alive" : "close" );
+		m_Output += a_Content;
+
+		StartDeadline();
+		boost::asio::async_write( m_Socket, boost::asio::buffer( m_Output ),
+			boost::bind( &Session::OnWrite, shared_from_this(), boost::asio::placeholders::error ) );
+	}
+
+	void OnWrite( const boost::system::error_code & a_Error )
+	{
+		m_Timer.cancel();
+		// the socket is closed when the last reference to this session goes away
+		if (! a_Error && m_bKeepAlive )
+			ReadHeader();
+	}
+};
+
+WebhookServer::WebhookServer() : m_pService( NULL ), m_pAcceptor( NULL ), m_pThread( NULL ), m_Port( 0 ), m_IdleTimeout( 30.0f )
+{}
+
+WebhookServer::~WebhookServer()
+{
+	Stop();
+}
+
+bool WebhookServer::Start( const std::string & a_Address, int a_Port, Handler a_Handler )
+{
+	if ( m_pAcceptor != NULL )
+		return false;
+
+	try {
+		boost::asio::ip::tcp::endpoint endpoint( boost::asio::ip::address::from_string( a_Address ), (unsigned short)a_Port );
+		m_pService = new boost::asio::io_service();
+		m_pAcceptor = new boost::asio::ip::tcp::acceptor( *m_pService );
+		m_pAcceptor->open( endpoint.protocol() );
+		m_pAcceptor->set_option( boost::asio::ip::tcp::acceptor::reuse_address( true ) );
+		m_pAcceptor->bind( endpoint );
+		m_pAcceptor->listen();
+		m_Port = m_pAcceptor->local_endpoint().port();
+	}
+	catch( const std::exception & e )
+	{
+		Log::Error( "WebhookServer", "Failed to listen on %s:%d: %s", a_Address.c_str(), a_Port, e.what() );
+		delete m_pAcceptor;
+		m_pAcceptor = NULL;
+		delete m_pService;
+		m_pService = NULL;
+		return false;
+	}
+
+	m_Handler = a_Handler;
+	Accept();
+	m_pThread = new boost::thread( boost::bind( &WebhookServer::ServerThread, this ) );
+
+	Log::Status( "WebhookServer", "Listening on %s:%d", a_Address.c_str(), m_Port );
+	return true;
+}
+
+void WebhookServer::Stop()
+{
+	if ( m_pAcceptor == NULL )
+		return;
+
+	m_pService->stop();
+	if ( m_pThread != NULL )
+	{
+		m_pThread->join();
+		delete m_pThread;
+		m_pThread = NULL;
+	}
+
+	// deleting the service destroys the pending handlers holding the sessions, which closes their sockets
+	delete m_pAcceptor;
+	m_pAcceptor = NULL;
+	delete m_pService;
+	m_pService = NULL;
+	m_Port = 0;
+	m_Handler = Handler();
+}
+
+void WebhookServer::Accept()
+{
+	SessionSP spSession( new Session( this ) );
+	m_pAcceptor->async_accept( spSession->GetSocket(),
+		boost::bind( &WebhookServer::OnAccept, this, spSession, boost::asio::placeholders::error ) );
+}
+
+void WebhookServer::OnAccept( SessionSP a_spSession, const boost::system::error_code & a_Error )
+{
+	if ( a_Error )
+	{
+		if ( a_Error == boost::asio::error::operation_aborted )
+			return;
+		Log::Warning( "WebhookServer", "Accept failed: %s", a_Error.message().c_str() );
+	}
+	else
+	{
+		a_spSession->GetSocket().set_option( boost::asio::ip::tcp::no_delay( true ) );
+		a_spSession->ReadHeader();
+	}
+
+	Accept();
+}
+
+void WebhookServer::ServerThread()
+{
+	try {
+		m_pService->run();
+	}
+	catch( const std::exception & e )
+	{
+		Log::Error( "WebhookServer", "Caught exception: %s", e.what() );
+	}
+}
@@ -0,0 +1,98 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_WEBHOOKSERVER_H
+#define SELF_WEBHOOKSERVER_H
+
+#include <string>
+#include <map>
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+#include "utils/Delegate.h"
+#include "SelfLib.h"
+
+//! Minimal HTTP/1.1 endpoint for receiving callbacks pushed by a device cloud. Requests are read 
+//! on the server's own thread and passed to the handler there, which fills in the response. 
+//! This isn't a general purpose web server, only small request heads and bodies are accepted and a
+//! connection that goes quiet for the idle timeout is closed.
+class WebhookServer
+{
+public:
+	//! Types
+	typedef std::map<std::string,std::string>	Headers;
+
+	struct Request
+	{
+		Request() : m_StatusCode( 200 ), m_ContentType( "application/json" )
+		{}
+
+		std::string		m_Method;
+		std::string		m_Path;
+		Headers			m_Headers;			// names are lower case
+		std::string		m_Content;
+
+		//! Response, set by the handler
+		int				m_StatusCode;
+		std::string		m_ContentType;
+		std::string		m_Response;
+	};
+	typedef Delegate<Request *>		Handler;
+
+	//! Construction
+	WebhookServer();
+	~WebhookServer();
+
+	//! Start listening, a_Port of 0 picks any free port.
+	bool Start( const std::string & a_Address, int a_Port, Handler a_Handler );
+	//! Stop listening and close all connections.
+	void Stop();
+	//! Seconds a connection may wait on the client before it's closed, set before Start().
+	void SetIdleTimeout( float a_IdleTimeout )
+	{
+		m_IdleTimeout = a_IdleTimeout;
+	}
+
+	//! The port we are listening on, 0 if not started.
+	int GetPort() const
+	{
+		return m_Port;
+	}
+
+private:
+	//! Types
+	class Session;
+	typedef boost::shared_ptr<Session>		SessionSP;
+
+	//! Data
+	boost::asio::io_service *	m_pService;
+	boost::asio::ip::tcp::acceptor *
+								m_pAcceptor;
+	boost::thread *				m_pThread;
+	Handler						m_Handler;
+	int							m_Port;
+	float						m_IdleTimeout;
+
+	void Accept();
+	void OnAccept( SessionSP a_spSession, const boost::system::error_code & a_Error );
+	void ServerThread();
+};
+
+#endif
@@ -0,0 +1,339 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_STAND_IN_SERVER_H
+#define SELF_STAND_IN_SERVER_H
+
+#include <string>
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "utils/Log.h"
+#include "utils/StringUtil.h"
+
+//! A server on loopback that stands in for a cloud service in tests. Each connection is served on a thread 
+//! of its own, the request head is read and the connection is handed to the handler, which answers with 
+//! plain HTTP or upgrades to a web socket. A web socket can stay open while plain requests are answered, so
+//! handlers may run at the same time. Header only, so any plugin's tests can use it.
+class StandInServer
+{
+public:
+	//! Types
+	typedef boost::asio::ip::tcp::socket		Socket;
+	typedef boost::function<void (Socket &, boost::asio::streambuf &, const std::string &)>	
+												Handler;			// socket, data read past the head, and the request head
+
+	enum Op
+	{
+		OP_TEXT = 0x1,
+		OP_BINARY = 0x2,
+		OP_CLOSE = 0x8
+	};
+
+	//! Construction
+	StandInServer( Handler a_Handler ) : 
+		m_Handler( a_Handler ),
+		m_Acceptor( m_Service, boost::asio::ip::tcp::endpoint( boost::asio::ip::address::from_string( "127.0.0.1" ), 0 ) ),
+		m_bStop( false ),
+		m_Connections( 0 )
+	{
+		m_Thread = boost::thread( boost::bind( &StandInServer::Serve, this ) );
+	}
+	~StandInServer()
+	{
+		Stop();
+	}
+
+	//! Accessors
+	int GetPort() const
+	{
+		return m_Acceptor.local_endpoint().port();
+	}
+	std::string GetURL() const
+	{
+		return StringUtil::Format( "http://127.0.0.1:%d", GetPort() );
+	}
+	int GetConnections() const
+	{
+		return m_Connections;
+	}
+
+	//! Stop accepting and wait for the open connections to finish.
+	void Stop()
+	{
+		if ( m_bStop )
+			return;
+
+		m_bStop = true;
+		try {
+			// wake up the accept
+			Socket wake( m_Service );
+			wake.connect( m_Acceptor.local_endpoint() );
+		}
+		catch( const std::exception & )
+		{}
+		m_Thread.join();
+	}
+
+	//! Value of a header in a request head, empty if it's not there.
+	static std::string Header( const std::string & a_Request, const std::string & a_Name )
+	{
+		std::string lower( a_Request ), name( "\r\n" + a_Name + ":" );
+		StringUtil::ToLower( lower );
+		StringUtil::ToLower( name );
+
+		size_t start = lower.find( name );
+		if ( start == std::string::npos )
+			return std::string();
+		start += name.size();
+		size_t end = a_Request.find( "\r\n", start );
+		return StringUtil::Trim( a_Request.substr( start, end - start ), " \t" );
+	}
+
+	//! Read a request body of Content-Length bytes, a_Buffer holds anything read past the head.
+	static std::string ReadBody( Socket & a_Socket, boost::asio::streambuf & a_Buffer, const std::string & a_Request )
+	{
+		size_t length = (size_t)strtoul( Header( a_Request, "Content-Length" ).c_str(), NULL, 10 );
+		if ( a_Buffer.size() < length )
+			boost::asio::read( a_Socket, a_Buffer, boost::asio::transfer_exactly( length - a_Buffer.size() ) );
+
+		std::string body( boost::asio::buffers_begin( a_Buffer.data() ), boost::asio::buffers_begin( a_Buffer.data() ) + length );
+		a_Buffer.consume( length );
+		return body;
+	}
+
+	//! Answer with a complete HTTP response and ask the client to close.
+	static void WriteResponse( Socket & a_Socket, int a_Status, const std::string & a_Body, 
+		const std::string & a_ContentType = "application/json", const std::string & a_Headers = std::string() )
+	{
+		std::string response( StringUtil::Format( "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n", 
+			a_Status, a_Status < 300 ? "OK" : "Error", a_ContentType.c_str(), (unsigned int)a_Body.size() ) );
+		response += a_Headers + "\r\n" + a_Body;
+		boost::asio::write( a_Socket, boost::asio::buffer( response ) );
+	}
+
+	//! Complete a web socket upgrade, returns false if the request wasn't one.
+	static bool Upgrade( Socket & a_Socket, const std::string & a_Request )
+	{
+		std::string key( Header( a_Request, "Sec-WebSocket-Key" ) );
+		if ( key.size() == 0 )
+			return false;
+
+		std::string response( "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+			"Sec-WebSocket-Accept: " + Base64( Sha1( key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11" ) ) + "\r\n\r\n" );
+		boost::asio::write( a_Socket, boost::asio::buffer( response ) );
+		return true;
+	}
+
+	//! True once the client has closed its end of the connection, this doesn't block.
+	static bool IsClosed( Socket & a_Socket )
+	{
+		char peek;
+		boost::system::error_code error;
+		a_Socket.non_blocking( true );
+		a_Socket.receive( boost::asio::buffer( &peek, 1 ), boost::asio::socket_base::message_peek, error );
+		a_Socket.non_blocking( false );
+		return error && error != boost::asio::error::would_block;
+	}
+
+	//! Read one web socket frame, frames from a client are always masked.
+	static bool ReadFrame( Socket & a_Socket, int & a_Op, std::string & a_Payload )
+	{
+		unsigned char head[2];
+		boost::asio::read( a_Socket, boost::asio::buffer( head, 2 ) );
+		a_Op = head[0] & 0x0f;
+
+		boost::uint64_t length = head[1] & 0x7f;
+		if ( length == 126 || length == 127 )
+		{
+			unsigned char ext[8];
+			size_t bytes = length == 126 ? 2 : 8;
+			boost::asio::read( a_Socket, boost::asio::buffer( ext, bytes ) );
+			length = 0;
+			for(size_t i=0;i<bytes;++i)
+				length = (length << 8) | ext[i];
+		}
+		if ( length > 16 * 1024 * 1024 )
+			return false;
+
+		unsigned char mask[4] = { 0, 0, 0, 0 };
+		if ( (head[1] & 0x80) != 0 )
+			boost::asio::read( a_Socket, boost::asio::buffer( mask, 4 ) );
+		a_Payload.resize( (size_t)length );
+		if ( length > 0 )
+			boost::asio::read( a_Socket, boost::asio::buffer( &a_Payload[0], a_Payload.size() ) );
+		for(size_t i=0;i<a_Payload.size();++i)
+			a_Payload[i] ^= mask[i % 4];
+		return true;
+	}
+
+	//! Write one unmasked web socket frame.
+	static void WriteFrame( Socket & a_Socket, int a_Op, const std::string & a_Payload )
+	{
+		std::string frame;
+		frame += (char)(0x80 | a_Op);
+		if ( a_Payload.size() < 126 )
+			frame += (char)a_Payload.size();
+		else if ( a_Payload.size() <= 0xffff )
+		{
+			frame += (char)126;
+			frame += (char)((a_Payload.size() >> 8) & 0xff);
+			frame += (char)(a_Payload.size() & 0xff);
+		}
+		else
+		{
+			frame += (char)127;
+			for(int i=7;i>=0;--i)
+				frame += (char)(((boost::uint64_t)a_Payload.size() >> (i * 8)) & 0xff);
+		}
+		frame += a_Payload;
+		boost::asio::write( a_Socket, boost::asio::buffer( frame ) );
+	}
+
+	static std::string Sha1( const std::string & a_Data )
+	{
+		boost::uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+		std::string msg( a_Data );
+		boost::uint64_t bits = (boost::uint64_t)a_Data.size() * 8;
+		msg += (char)0x80;
+		while( (msg.size() % 64) != 56 )
+			msg += (char)0;
+		for(int i=7;i>=0;--i)
+			msg += (char)((bits >> (i * 8)) & 0xff);
+
+		for(size_t chunk=0;chunk<msg.size();chunk+=64)
+		{
+			boost::uint32_t w[80];
+			for(int i=0;i<16;++i)
+			{
+				const unsigned char * p = (const unsigned char *)msg.data() + chunk + i * 4;
+				w[i] = ((boost::uint32_t)p[0] << 24) | ((boost::uint32_t)p[1] << 16) | ((boost::uint32_t)p[2] << 8) | p[3];
+			}
+			for(int i=16;i<80;++i)
+				w[i] = Rotate( w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1 );
+
+			boost::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+			for(int i=0;i<80;++i)
+			{
+				boost::uint32_t f, k;
+				if ( i < 20 ) { f = (b & c) | (~b & d); k = 0x5A827999; }
+				else if ( i < 40 ) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+				else if ( i < 60 ) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+				else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+				boost::uint32_t temp = Rotate( a, 5 ) + f + e + k + w[i];
+				e = d; d = c; c = Rotate( b, 30 ); b = a; a = temp;
+			}
+			h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+		}
+
+		std::string digest;
+		for(int i=0;i<5;++i)
+			for(int j=3;j>=0;--j)
+				digest += (char)((h[i] >> (j * 8)) & 0xff);
+		return digest;
+	}
+
+	static std::string Base64( const std::string & a_Data )
+	{
+		static const char CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		std::string out;
+		for(size_t i=0;i<a_Data.size();i+=3)
+		{
+			boost::uint32_t n = (boost::uint32_t)(unsigned char)a_Data[i] << 16;
+			if ( i + 1 < a_Data.size() ) n |= (boost::uint32_t)(unsigned char)a_Data[i + 1] << 8;
+			if ( i + 2 < a_Data.size() ) n |= (boost::uint32_t)(unsigned char)a_Data[i + 2];
+
+			out += CHARS[(n >> 18) & 0x3f];
+			out += CHARS[(n >> 12) & 0x3f];
+			out += i + 1 < a_Data.size() ? CHARS[(n >> 6) & 0x3f] : '=';
+			out += i + 2 < a_Data.size() ? CHARS[n & 0x3f] : '=';
+		}
+		return out;
+	}
+
+private:
+	//! Data
+	Handler							m_Handler;
+	boost::asio::io_service			m_Service;
+	boost::asio::ip::tcp::acceptor	m_Acceptor;
+	boost::thread					m_Thread;
+	boost::thread_group				m_ConnectionThreads;
+	volatile bool					m_bStop;
+	volatile int					m_Connections;
+
+	void Serve()
+	{
+		while(! m_bStop )
+		{
+			boost::shared_ptr<Socket> spSocket( new Socket( m_Service ) );
+			try {
+				m_Acceptor.accept( *spSocket );
+			}
+			catch( const std::exception & e )
+			{
+				Log::Debug( "StandInServer", "Stand-in accept failed: %s", e.what() );
+				continue;
+			}
+			if ( m_bStop )
+				break;
+
+			m_Connections += 1;
+			m_ConnectionThreads.create_thread( boost::bind( &StandInServer::ServeConnection, this, spSocket ) );
+		}
+		m_ConnectionThreads.join_all();
+	}
+
+	void ServeConnection( boost::shared_ptr<Socket> a_spSocket )
+	{
+		try {
+			boost::asio::streambuf buffer;
+			boost::asio::read_until( *a_spSocket, buffer, "\r\n\r\n" );
+			std::string head( boost::asio::buffers_begin( buffer.data() ), boost::asio::buffers_end( buffer.data() ) );
+			size_t end = head.find( "\r\n\r\n" ) + 4;
+			head.resize( end );
+			buffer.consume( end );
+
+			m_Handler( *a_spSocket, buffer, head );
+		}
+		catch( const std::exception & e )
+		{
+			Log::Debug( "StandInServer", "Stand-in connection closed: %s", e.what() );
+		}
+
+		// the thread group keeps the socket alive until Stop(), so close it here for clients that read to the end
+		boost::system::error_code error;
+		a_spSocket->shutdown( Socket::shutdown_both, error );
+		a_spSocket->close( error );
+	}
+
+	static boost::uint32_t Rotate( boost::uint32_t a_Value, int a_Bits )
+	{
+		return (a_Value << a_Bits) | (a_Value >> (32 - a_Bits));
+	}
+};
+
+#endif //SELF_STAND_IN_SERVER_H
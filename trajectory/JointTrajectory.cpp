@@ -0,0 +1,279 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "JointTrajectory.h"
+
+#include <math.h>
+
+namespace {
+
+	const int MAX_ITERATIONS = 20;
+	const int PEAK_SAMPLES = 16;
+}
+
+void JointTrajectory::SetLimits( double a_fMaxVelocity, double a_fMaxAcceleration )
+{
+	m_fMaxVelocity = a_fMaxVelocity > 0.0 ? a_fMaxVelocity : 1.0;
+	m_fMaxAcceleration = a_fMaxAcceleration > 0.0 ? a_fMaxAcceleration : 2.0;
+}
+
+void JointTrajectory::SetStart( const std::vector<double> & a_Positions )
+{
+	if ( m_Waypoints.size() == 0 )
+	{
+		m_Waypoints.push_back( a_Positions );
+		return;
+	}
+	m_Waypoints[0] = a_Positions;
+}
+
+void JointTrajectory::AddWaypoint( const std::vector<double> & a_Positions, double a_fTime /*= 0.0*/ )
+{
+	if ( m_Waypoints.size() == 0 )
+		m_Waypoints.push_back( a_Positions );		// no start given, start at the first waypoint
+
+	Segment segment;
+	segment.m_fMinTime = a_fTime;
+	segment.m_fTime = 0.0;
+	m_Segments.push_back( segment );
+	m_Waypoints.push_back( a_Positions );
+}
+
+void JointTrajectory::Clear()
+{
+	m_Waypoints.clear();
+	m_Segments.clear();
+	m_Velocities.clear();
+	m_Points.clear();
+	m_fDuration = 0.0;
+}
+
+double JointTrajectory::GetProfileTime( double a_fDistance ) const
+{
+	// trapezoid, or a triangle if the joint never gets up to speed
+	double distance = fabs( a_fDistance );
+	double v = m_fMaxVelocity, a = m_fMaxAcceleration;
+	if ( distance <= (v * v) / a )
+		return 2.0 * sqrt( distance / a );
+	return (distance / v) + (v / a);
+}
+
+void JointTrajectory::SetViaVelocities()
+{
+	size_t joints = m_Waypoints[0].size();
+	m_Velocities.assign( m_Waypoints.size(), std::vector<double>( joints, 0.0 ) );
+
+	// keep moving through a waypoint if the joint continues in the same direction, stop if it turns around
+	for(size_t i=1;i+1<m_Waypoints.size();++i)
+	{
+		if ( m_Segments[i - 1].m_fTime <= 0.0 || m_Segments[i].m_fTime <= 0.0 )
+			continue;
+		for(size_t j=0;j<joints;++j)
+		{
+			double before = (m_Waypoints[i][j] - m_Waypoints[i - 1][j]) / m_Segments[i - 1].m_fTime;
+			double after = (m_Waypoints[i + 1][j] - m_Waypoints[i][j]) / m_Segments[i].m_fTime;
+			if ( before * after <= 0.0 )
+				continue;
+
+			double v = (before + after) * 0.5;
+			if ( v > m_fMaxVelocity ) v = m_fMaxVelocity;
+			if ( v < -m_fMaxVelocity ) v = -m_fMaxVelocity;
+			m_Velocities[i][j] = v;
+		}
+	}
+}
+
+void JointTrajectory::Sample( size_t a_Segment, double a_fTime, Point & a_Point ) const
+{
+	// cubic hermite between the waypoints, so velocity is continuous through them
+	const std::vector<double> & p0 = m_Waypoints[a_Segment];
+	const std::vector<double> & p1 = m_Waypoints[a_Segment + 1];
+	const std::vector<double> & v0 = m_Velocities[a_Segment];
+	const std::vector<double> & v1 = m_Velocities[a_Segment + 1];
+	double T = m_Segments[a_Segment].m_fTime;
+	double s = T > 0.0 ? a_fTime / T : 1.0;
+	if ( s < 0.0 ) s = 0.0;
+	if ( s > 1.0 ) s = 1.0;
+
+	double s2 = s * s, s3 = s2 * s;
+	double h00 = 2.0 * s3 - 3.0 * s2 + 1.0, h10 = s3 - 2.0 * s2 + s, h01 = -2.0 * s3 + 3.0 * s2, h11 = s3 - s2;
+	double d00 = 6.0 * s2 - 6.0 * s, d10 = 3.0 * s2 - 4.0 * s + 1.0, d01 = -6.0 * s2 + 6.0 * s, d11 = 3.0 * s2 - 2.0 * s;
+	double a00 = 12.0 * s - 6.0, a10 = 6.0 * s - 4.0, a01 = -12.0 * s + 6.0, a11 = 6.0 * s - 2.0;
+
+	size_t joints = p0.size();
+	a_Point.m_Positions.resize( joints );
+	a_Point.m_Velocities.resize( joints );
+	a_Point.m_Accelerations.resize( joints );
+	for(size_t j=0;j<joints;++j)
+	{
+		if ( T <= 0.0 )
+		{
+			a_Point.m_Positions[j] = p1[j];
+			a_Point.m_Velocities[j] = 0.0;
+			a_Point.m_Accelerations[j] = 0.0;
+			continue;
+		}
+		a_Point.m_Positions[j] = h00 * p0[j] + h10 * T * v0[j] + h01 * p1[j] + h11 * T * v1[j];
+		a_Point.m_Velocities[j] = (d00 * p0[j] + d10 * T * v0[j] + d01 * p1[j] + d11 * T * v1[j]) / T;
+		a_Point.m_Accelerations[j] = (a00 * p0[j] + a10 * T * v0[j] + a01 * p1[j] + a11 * T * v1[j]) / (T * T);
+	}
+}
+
+double JointTrajectory::GetPeakVelocity( size_t a_Segment, double & a_fPeakAcceleration ) const
+{
+	double peak = 0.0;
+	a_fPeakAcceleration = 0.0;
+
+	Point point;
+	double T = m_Segments[a_Segment].m_fTime;
+	for(int i=0;i<=PEAK_SAMPLES;++i)
+	{
+		Sample( a_Segment, (T * i) / PEAK_SAMPLES, point );
+		for(size_t j=0;j<point.m_Velocities.size();++j)
+		{
+			if ( fabs( point.m_Velocities[j] ) > peak )
+				peak = fabs( point.m_Velocities[j] );
+			if ( fabs( point.m_Accelerations[j] ) > a_fPeakAcceleration )
+				a_fPeakAcceleration = fabs( point.m_Accelerations[j] );
+		}
+	}
+	return peak;
+}
+
+bool JointTrajectory::Plan( double a_fSampleTime )
+{
+	m_Points.clear();
+	m_fDuration = 0.0;
+	if ( m_Waypoints.size() < 2 || a_fSampleTime <= 0.0 )
+		return false;
+
+	size_t joints = m_Waypoints[0].size();
+	for(size_t i=1;i<m_Waypoints.size();++i)
+		if ( m_Waypoints[i].size() != joints )
+			return false;
+
+	// each segment takes as long as its slowest joint needs, so all joints arrive together
+	for(size_t i=0;i<m_Segments.size();++i)
+	{
+		double time = m_Segments[i].m_fMinTime;
+		for(size_t j=0;j<joints;++j)
+		{
+			double profile = GetProfileTime( m_Waypoints[i + 1][j] - m_Waypoints[i][j] );
+			if ( profile > time )
+				time = profile;
+		}
+		m_Segments[i].m_fTime = time;
+	}
+
+	// the cubic can overshoot the limits the profile was timed for, so stretch those segments until it doesn't
+	for(int k=0;k<MAX_ITERATIONS;++k)
+	{
+		SetViaVelocities();
+
+		bool bStretched = false;
+		for(size_t i=0;i<m_Segments.size();++i)
+		{
+			if ( m_Segments[i].m_fTime <= 0.0 )
+				continue;
+
+			double peakAcceleration = 0.0;
+			double peakVelocity = GetPeakVelocity( i, peakAcceleration );
+			double scale = peakVelocity / m_fMaxVelocity;
+			double accelerationScale = sqrt( peakAcceleration / m_fMaxAcceleration );
+			if ( accelerationScale > scale )
+				scale = accelerationScale;
+			if ( scale > 1.001 )
+			{
+				m_Segments[i].m_fTime *= scale;
+				bStretched = true;
+			}
+		}
+		if (! bStretched )
+			break;
+	}
+
+	for(size_t i=0;i<m_Segments.size();++i)
+		m_fDuration += m_Segments[i].m_fTime;
+
+	size_t segment = 0;
+	double segmentStart = 0.0;
+	size_t count = (size_t)ceil( m_fDuration / a_fSampleTime );
+	for(size_t n=1;n<=count;++n)
+	{
+		double time = n < count ? n * a_fSampleTime : m_fDuration;
+		while( segment + 1 < m_Segments.size() && time > segmentStart + m_Segments[segment].m_fTime )
+		{
+			segmentStart += m_Segments[segment].m_fTime;
+			segment += 1;
+		}
+
+		Point point;
+		point.m_fTime = time;
+		Sample( segment, time - segmentStart, point );
+		m_Points.push_back( point );
+	}
+
+	if ( m_Points.size() == 0 )
+	{
+		// nothing moves, still give the follower the target
+		Point point;
+		Sample( m_Segments.size() - 1, 0.0, point );
+		point.m_Positions = m_Waypoints.back();
+		m_Points.push_back( point );
+	}
+
+	return true;
+}
+
+void JointTrajectory::GetPoint( double a_fTime, Point & a_Point ) const
+{
+	a_Point.m_fTime = a_fTime;
+	if ( m_Segments.size() == 0 || m_Velocities.size() != m_Waypoints.size() )
+	{
+		a_Point.m_Positions = m_Waypoints.size() > 0 ? m_Waypoints.back() : std::vector<double>();
+		a_Point.m_Velocities.assign( a_Point.m_Positions.size(), 0.0 );
+		a_Point.m_Accelerations.assign( a_Point.m_Positions.size(), 0.0 );
+		return;
+	}
+
+	size_t segment = 0;
+	double segmentStart = 0.0;
+	while( segment + 1 < m_Segments.size() && a_fTime > segmentStart + m_Segments[segment].m_fTime )
+	{
+		segmentStart += m_Segments[segment].m_fTime;
+		segment += 1;
+	}
+	Sample( segment, a_fTime - segmentStart, a_Point );
+}
+
+void JointTrajectory::GetWindow( double a_fFrom, double a_fTo, PointList & a_Points ) const
+{
+	a_Points.clear();
+	for(size_t i=0;i<m_Points.size();++i)
+	{
+		const Point & point = m_Points[i];
+		if ( point.m_fTime <= a_fFrom && a_fFrom > 0.0 )
+			continue;
+		if ( point.m_fTime > a_fTo )
+			break;
+
+		a_Points.push_back( point );
+		a_Points.back().m_fTime -= a_fFrom;
+	}
+}
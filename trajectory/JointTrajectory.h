@@ -0,0 +1,99 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_JOINT_TRAJECTORY_H
+#define SELF_JOINT_TRAJECTORY_H
+
+#include <vector>
+
+#include "SelfLib.h"			// include last always
+
+//! A timed path through joint space. Waypoints are added with an optional time to reach them, Plan()
+//! times each segment so no joint exceeds the velocity and acceleration limits, and passes through 
+//! the waypoints in between without stopping. The result is sampled into evenly spaced points with 
+//! velocities and accelerations, ready to be sent to a trajectory follower many points at a time.
+class JointTrajectory
+{
+public:
+	//! Types
+	struct Point
+	{
+		Point() : m_fTime( 0.0 )
+		{}
+
+		double					m_fTime;			// seconds from the start of the trajectory
+		std::vector<double>		m_Positions;
+		std::vector<double>		m_Velocities;
+		std::vector<double>		m_Accelerations;
+	};
+	typedef std::vector<Point>		PointList;
+
+	//! Construction
+	JointTrajectory() : m_fMaxVelocity( 1.0 ), m_fMaxAcceleration( 2.0 ), m_fDuration( 0.0 )
+	{}
+
+	//! Limits applied to every joint, in the units of the positions per second.
+	void SetLimits( double a_fMaxVelocity, double a_fMaxAcceleration );
+	//! Where the joints are now, the trajectory starts here at rest.
+	void SetStart( const std::vector<double> & a_Positions );
+	//! Add a waypoint, a_fTime is the least time to reach it from the previous one, 0 for as fast as the limits allow.
+	void AddWaypoint( const std::vector<double> & a_Positions, double a_fTime = 0.0 );
+	void Clear();
+
+	//! Time the segments and sample the trajectory every a_fSampleTime seconds, the last point is 
+	//! always the final waypoint at rest. Returns false if the waypoints don't match the start.
+	bool Plan( double a_fSampleTime );
+
+	const PointList & GetPoints() const
+	{
+		return m_Points;
+	}
+	double GetDuration() const
+	{
+		return m_fDuration;
+	}
+	//! Evaluate the planned trajectory at any time, for followers that don't run at the sample rate.
+	void GetPoint( double a_fTime, Point & a_Point ) const;
+	//! The points after a_fFrom up to and including a_fTo, with times made relative to a_fFrom.
+	void GetWindow( double a_fFrom, double a_fTo, PointList & a_Points ) const;
+
+private:
+	//! Types
+	struct Segment
+	{
+		double		m_fMinTime;
+		double		m_fTime;
+	};
+
+	//! Data
+	double								m_fMaxVelocity;
+	double								m_fMaxAcceleration;
+	std::vector< std::vector<double> >	m_Waypoints;		// the start, then each waypoint
+	std::vector<Segment>				m_Segments;
+	std::vector< std::vector<double> >	m_Velocities;		// velocity of each joint at each waypoint
+	PointList							m_Points;
+	double								m_fDuration;
+
+	double GetProfileTime( double a_fDistance ) const;
+	void SetViaVelocities();
+	void Sample( size_t a_Segment, double a_fTime, Point & a_Point ) const;
+	double GetPeakVelocity( size_t a_Segment, double & a_fPeakAcceleration ) const;
+};
+
+#endif //SELF_JOINT_TRAJECTORY_H
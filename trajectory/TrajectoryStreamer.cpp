@@ -0,0 +1,87 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "TrajectoryStreamer.h"
+#include "utils/Log.h"
+
+TrajectoryStreamer::TrajectoryStreamer() : 
+	m_fWindow( 1.0 ), 
+	m_fLookahead( 0.5 ), 
+	m_Index( 0 ), 
+	m_bFinished( true )
+{}
+
+TrajectoryStreamer::~TrajectoryStreamer()
+{
+	Stop();
+}
+
+bool TrajectoryStreamer::Start( const JointTrajectory & a_Trajectory, double a_fWindow, double a_fLookahead, 
+	WindowCallback a_Callback )
+{
+	Stop();
+	if ( a_Trajectory.GetPoints().size() == 0 )
+		return false;
+
+	m_Trajectory = a_Trajectory;
+	m_fWindow = a_fWindow > 0.0 ? a_fWindow : 1.0;
+	m_fLookahead = a_fLookahead > 0.0 ? a_fLookahead : 0.0;
+	m_Callback = a_Callback;
+	m_Index = 0;
+	m_bFinished = false;
+
+	SendWindow();
+	if (! m_bFinished )
+	{
+		TimerPool * pTP = TimerPool::Instance();
+		if ( pTP != NULL )
+			m_spTimer = pTP->StartTimer( VOID_DELEGATE( TrajectoryStreamer, OnTimer, this ), (float)m_fWindow, true, true );
+		else
+			Log::Warning( "TrajectoryStreamer", "No TimerPool, only the first window was sent." );
+	}
+
+	return true;
+}
+
+void TrajectoryStreamer::Stop()
+{
+	m_bFinished = true;
+	m_spTimer.reset();
+}
+
+void TrajectoryStreamer::OnTimer()
+{
+	// the owner stops us once the last window is out, we never drop our own timer from inside its callback
+	if (! m_bFinished )
+		SendWindow();
+}
+
+void TrajectoryStreamer::SendWindow()
+{
+	Window window;
+	window.m_Index = m_Index++;
+	window.m_fStart = window.m_Index * m_fWindow;
+	window.m_bLast = window.m_fStart + m_fWindow + m_fLookahead >= m_Trajectory.GetDuration();
+	m_Trajectory.GetWindow( window.m_fStart, window.m_fStart + m_fWindow + m_fLookahead, window.m_Points );
+
+	if ( window.m_bLast )
+		m_bFinished = true;
+	if ( m_Callback.IsValid() )
+		m_Callback( window );
+}
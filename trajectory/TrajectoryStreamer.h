@@ -0,0 +1,79 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef SELF_TRAJECTORY_STREAMER_H
+#define SELF_TRAJECTORY_STREAMER_H
+
+#include "JointTrajectory.h"
+#include "utils/TimerPool.h"
+#include "utils/Delegate.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Feeds a planned JointTrajectory to a follower a window at a time. Every a_fWindow seconds the next 
+//! window is sent, holding the points for that window plus a_fLookahead seconds past it, with times
+//! relative to the start of the window. Each window replaces whatever the follower had queued, so 
+//! the lookahead keeps it moving smoothly if a window arrives late, and the robot is never more than 
+//! one window plus the lookahead ahead of the stream if it is stopped.
+class TrajectoryStreamer
+{
+public:
+	//! Types
+	struct Window
+	{
+		Window() : m_Index( 0 ), m_fStart( 0.0 ), m_bLast( false )
+		{}
+
+		size_t						m_Index;
+		double						m_fStart;			// seconds into the trajectory this window starts
+		bool						m_bLast;
+		JointTrajectory::PointList	m_Points;
+	};
+	typedef Delegate<const Window &>	WindowCallback;
+
+	//! Construction
+	TrajectoryStreamer();
+	~TrajectoryStreamer();
+
+	bool IsStreaming() const
+	{
+		return m_spTimer.get() != NULL && !m_bFinished;
+	}
+
+	//! Send the first window now and the rest on a timer, returns false if the trajectory has no points.
+	bool Start( const JointTrajectory & a_Trajectory, double a_fWindow, double a_fLookahead, 
+		WindowCallback a_Callback );
+	//! Stop sending windows, the follower will finish the points it already has.
+	void Stop();
+
+private:
+	//! Data
+	JointTrajectory			m_Trajectory;
+	double					m_fWindow;
+	double					m_fLookahead;
+	WindowCallback			m_Callback;
+	size_t					m_Index;
+	bool					m_bFinished;
+	TimerPool::ITimer::SP	m_spTimer;
+
+	void OnTimer();
+	void SendWindow();
+};
+
+#endif //SELF_TRAJECTORY_STREAMER_H
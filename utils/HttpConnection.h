@@ -0,0 +1,402 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+
+#ifndef SELF_HTTP_CONNECTION_H
+#define SELF_HTTP_CONNECTION_H
+
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/bind.hpp>
+
+#include <stdlib.h>
+#include <ctype.h>
+
+//! One client HTTP/1.1 connection, plain or TLS, for plugins that need more than IWebClient gives them:
+//! a body streamed from disk, a connection kept open between requests, or a response that never ends.
+//! Every network operation runs on the connection's own io_service with a deadline, a connection that 
+//! timed out or was cancelled can't be used again. Also holds the URL and response head parsing for 
+//! code that drives its own sockets. Header only, so any plugin can use it.
+class HttpConnection
+{
+public:
+	//! Types
+	typedef std::map<std::string,std::string>	Headers;
+	typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket>	Stream;
+
+	//! The parts of an http or https URL a request needs
+	struct URL
+	{
+		URL() : m_bSecure( false )
+		{}
+
+		//! Split a_URL, a URL without a scheme is http. Returns false for any other scheme.
+		bool Parse( const std::string & a_URL )
+		{
+			m_Protocol = "http";
+			std::string rest( a_URL );
+			size_t scheme = a_URL.find( "://" );
+			if ( scheme != std::string::npos )
+			{
+				m_Protocol = ToLower( a_URL.substr( 0, scheme ) );
+				rest = a_URL.substr( scheme + 3 );
+			}
+
+			size_t slash = rest.find( '/' );
+			m_Authority = rest.substr( 0, slash );
+			m_Path = slash != std::string::npos ? rest.substr( slash ) : "/";
+
+			m_bSecure = m_Protocol == "https";
+			m_Host = m_Authority;
+			m_Port = m_bSecure ? "443" : "80";
+			size_t colon = m_Authority.find( ':' );
+			if ( colon != std::string::npos )
+			{
+				m_Host = m_Authority.substr( 0, colon );
+				m_Port = m_Authority.substr( colon + 1 );
+			}
+
+			return m_bSecure || m_Protocol == "http";
+		}
+
+		std::string		m_Protocol;			// lower case
+		std::string		m_Host;
+		std::string		m_Port;
+		std::string		m_Authority;		// host and port as written, for the Host header
+		std::string		m_Path;				// path and query, at least "/"
+		bool			m_bSecure;
+	};
+
+	struct Response
+	{
+		Response() : m_StatusCode( 0 ), m_bKeepAlive( false )
+		{}
+
+		//! Parse the status line and headers, up to the blank line if it's there. Returns false if
+		//! there is no status line.
+		bool ParseHead( const std::string & a_Head )
+		{
+			m_StatusCode = 0;
+			m_bKeepAlive = false;
+			m_Headers.clear();
+
+			size_t end = a_Head.find( "\r\n\r\n" );
+			if ( end == std::string::npos )
+				end = a_Head.size();
+
+			size_t eol = std::min( a_Head.find( "\r\n" ), end );
+			std::string status( a_Head.substr( 0, eol ) );
+			size_t space = status.find( ' ' );
+			if ( space == std::string::npos || status.compare( 0, 5, "HTTP/" ) != 0 )
+				return false;
+			m_StatusCode = atoi( status.c_str() + space + 1 );
+			m_bKeepAlive = status.compare( 0, space, "HTTP/1.1" ) == 0;
+
+			for( size_t start = eol + 2; start < end; )
+			{
+				eol = std::min( a_Head.find( "\r\n", start ), end );
+				std::string line( a_Head.substr( start, eol - start ) );
+				size_t colon = line.find( ':' );
+				if ( colon != std::string::npos )
+					m_Headers[ ToLower( Trim( line.substr( 0, colon ) ) ) ] = Trim( line.substr( colon + 1 ) );
+				start = eol + 2;
+			}
+
+			std::string connection( ToLower( GetHeader( "connection" ) ) );
+			if ( connection == "close" )
+				m_bKeepAlive = false;
+			else if ( connection == "keep-alive" )
+				m_bKeepAlive = true;
+			return true;
+		}
+
+		//! Value of a header, a_Name must be lower case. Empty if it's not there.
+		std::string GetHeader( const std::string & a_Name ) const
+		{
+			Headers::const_iterator iHeader = m_Headers.find( a_Name );
+			return iHeader != m_Headers.end() ? iHeader->second : std::string();
+		}
+
+		int				m_StatusCode;		// 0 if the request failed
+		bool			m_bKeepAlive;		// the server will keep the connection open after this response
+		Headers			m_Headers;			// names are lower case
+		std::string		m_Content;
+	};
+
+	//! Construction
+	HttpConnection( float a_Timeout ) :
+		m_Timeout( a_Timeout ),
+		m_bSecure( false ),
+		m_bTimedOut( false ),
+		m_Context( boost::asio::ssl::context::sslv23_client ),
+		m_Stream( m_Service, m_Context ),
+		m_Timer( m_Service )
+	{}
+
+	//! Accessors
+	bool IsTimedOut() const
+	{
+		return m_bTimedOut;
+	}
+
+	//! Resolve, connect and for https verify the server. Throws if any step fails or takes too long.
+	void Open( const URL & a_URL )
+	{
+		IoResult resolved;
+		boost::asio::ip::tcp::resolver resolver( m_Service );
+		boost::asio::ip::tcp::resolver::query q( a_URL.m_Host, a_URL.m_Port );
+		resolver.async_resolve( q, boost::bind( &IoResult::OnEndpoints, &resolved, _1, _2 ) );
+		Check( resolved );
+
+		IoResult connected;
+		boost::asio::async_connect( m_Stream.lowest_layer(), resolved.m_Endpoints, 
+			boost::bind( &IoResult::OnEndpoints, &connected, _1, _2 ) );
+		Check( connected );
+		m_Stream.lowest_layer().set_option( boost::asio::ip::tcp::no_delay( true ) );
+
+		// a plain connection uses the socket under the unused TLS stream
+		m_bSecure = a_URL.m_bSecure;
+		if ( m_bSecure )
+		{
+			m_Context.set_default_verify_paths();
+			m_Stream.set_verify_mode( boost::asio::ssl::verify_peer );
+			m_Stream.set_verify_callback( boost::asio::ssl::rfc2818_verification( a_URL.m_Host ) );
+			SSL_set_tlsext_host_name( m_Stream.native_handle(), a_URL.m_Host.c_str() );
+
+			IoResult handshake;
+			m_Stream.async_handshake( boost::asio::ssl::stream_base::client, 
+				boost::bind( &IoResult::OnComplete, &handshake, _1 ) );
+			Check( handshake );
+		}
+	}
+
+	//! Fail the operation in progress and every one after it, may be called from any thread.
+	void Cancel()
+	{
+		m_Service.stop();
+	}
+
+	void Write( const std::string & a_Data )
+	{
+		Write( a_Data.data(), a_Data.size() );
+	}
+	void Write( const char * a_pData, size_t a_Bytes )
+	{
+		IoResult written;
+		if ( m_bSecure )
+			boost::asio::async_write( m_Stream, boost::asio::buffer( a_pData, a_Bytes ), boost::bind( &IoResult::OnIo, &written, _1, _2 ) );
+		else
+			boost::asio::async_write( m_Stream.next_layer(), boost::asio::buffer( a_pData, a_Bytes ), boost::bind( &IoResult::OnIo, &written, _1, _2 ) );
+		Check( written );
+	}
+
+	//! Read one response, a body is read by its Content-Length, chunked, or up to the server closing
+	//! the connection. Anything after it is kept for the next response. Throws on errors and timeouts.
+	void ReadResponse( Response & a_Response )
+	{
+		if (! a_Response.ParseHead( Take( ReadUntil( "\r\n\r\n" ) ) ) )
+			throw std::runtime_error( "invalid status line" );
+
+		a_Response.m_Content.clear();
+		int status = a_Response.m_StatusCode;
+		if ( status == 204 || status == 304 || (status >= 100 && status < 200) )
+			return;
+
+		std::string length( a_Response.GetHeader( "content-length" ) );
+		if ( ToLower( a_Response.GetHeader( "transfer-encoding" ) ).find( "chunked" ) != std::string::npos )
+		{
+			for(;;)
+			{
+				std::string line( ReadLine() );
+				size_t size = strtoul( line.c_str(), NULL, 16 );
+				if ( size == 0 )
+				{
+					// skip any trailers up to the blank line
+					while( ReadLine().size() > 0 )
+						;
+					break;
+				}
+
+				Fill( size + 2 );
+				a_Response.m_Content += Take( size );
+				m_Buffer.consume( 2 );
+			}
+		}
+		else if ( length.size() > 0 )
+		{
+			size_t bytes = strtoul( length.c_str(), NULL, 10 );
+			Fill( bytes );
+			a_Response.m_Content = Take( bytes );
+		}
+		else
+		{
+			// no length, the body ends when the server closes the connection
+			for(;;)
+			{
+				IoResult read;
+				if ( m_bSecure )
+					boost::asio::async_read( m_Stream, m_Buffer, boost::asio::transfer_at_least( 1 ), boost::bind( &IoResult::OnIo, &read, _1, _2 ) );
+				else
+					boost::asio::async_read( m_Stream.next_layer(), m_Buffer, boost::asio::transfer_at_least( 1 ), boost::bind( &IoResult::OnIo, &read, _1, _2 ) );
+				Wait( read );
+				if ( read.m_Error )
+					break;
+			}
+			a_Response.m_Content = Take( m_Buffer.size() );
+			a_Response.m_bKeepAlive = false;
+		}
+	}
+
+	static std::string ToLower( const std::string & a_String )
+	{
+		std::string lower( a_String );
+		for(size_t i=0;i<lower.size();++i)
+			lower[i] = (char)tolower( (unsigned char)lower[i] );
+		return lower;
+	}
+	static std::string Trim( const std::string & a_String )
+	{
+		size_t start = a_String.find_first_not_of( " \t\r\n" );
+		if ( start == std::string::npos )
+			return std::string();
+		size_t end = a_String.find_last_not_of( " \t\r\n" );
+		return a_String.substr( start, end - start + 1 );
+	}
+
+private:
+	//! Types
+	//! Completion of one async operation, run by Wait()
+	struct IoResult
+	{
+		IoResult() : m_bDone( false ), m_Bytes( 0 )
+		{}
+
+		void OnIo( const boost::system::error_code & a_Error, size_t a_Bytes )
+		{
+			m_bDone = true;
+			m_Error = a_Error;
+			m_Bytes = a_Bytes;
+		}
+		void OnComplete( const boost::system::error_code & a_Error )
+		{
+			OnIo( a_Error, 0 );
+		}
+		void OnEndpoints( const boost::system::error_code & a_Error, boost::asio::ip::tcp::resolver::iterator a_Endpoints )
+		{
+			OnIo( a_Error, 0 );
+			m_Endpoints = a_Endpoints;
+		}
+
+		bool						m_bDone;
+		boost::system::error_code	m_Error;
+		size_t						m_Bytes;
+		boost::asio::ip::tcp::resolver::iterator	m_Endpoints;
+	};
+
+	//! Data
+	float						m_Timeout;
+	bool						m_bSecure;
+	volatile bool				m_bTimedOut;
+	boost::asio::io_service		m_Service;
+	boost::asio::ssl::context	m_Context;
+	Stream						m_Stream;
+	boost::asio::deadline_timer	m_Timer;
+	boost::asio::streambuf		m_Buffer;
+
+	//! Run the service until a_Result is done. Throws if that takes longer than the timeout or the 
+	//! connection was cancelled, errors of the operation itself are left in a_Result.
+	void Wait( IoResult & a_Result )
+	{
+		if ( m_Service.stopped() )
+			throw std::runtime_error( m_bTimedOut ? "timed out earlier" : "cancelled" );
+
+		m_Timer.expires_from_now( boost::posix_time::milliseconds( (int)(m_Timeout * 1000.0f) ) );
+		m_Timer.async_wait( boost::bind( &HttpConnection::OnDeadline, this, _1 ) );
+		while(! a_Result.m_bDone )
+		{
+			m_Service.run_one();
+			// handlers left pending by a stopped service are dropped with it
+			if (! a_Result.m_bDone && m_Service.stopped() )
+				throw std::runtime_error( m_bTimedOut ? "timed out" : "cancelled" );
+		}
+		m_Timer.cancel();
+	}
+	//! Wait() and throw if the operation failed.
+	void Check( IoResult & a_Result )
+	{
+		Wait( a_Result );
+		if ( a_Result.m_Error )
+			throw boost::system::system_error( a_Result.m_Error );
+	}
+
+	//! Read up to and including a_pDelimiter, returns the number of bytes that takes from the buffer.
+	size_t ReadUntil( const char * a_pDelimiter )
+	{
+		IoResult read;
+		if ( m_bSecure )
+			boost::asio::async_read_until( m_Stream, m_Buffer, a_pDelimiter, boost::bind( &IoResult::OnIo, &read, _1, _2 ) );
+		else
+			boost::asio::async_read_until( m_Stream.next_layer(), m_Buffer, a_pDelimiter, boost::bind( &IoResult::OnIo, &read, _1, _2 ) );
+		Check( read );
+		return read.m_Bytes;
+	}
+	//! Read one line and return it without the line end.
+	std::string ReadLine()
+	{
+		std::string line( Take( ReadUntil( "\r\n" ) ) );
+		line.resize( line.size() - 2 );
+		return line;
+	}
+	//! Read until at least a_Bytes are buffered.
+	void Fill( size_t a_Bytes )
+	{
+		if ( m_Buffer.size() >= a_Bytes )
+			return;
+
+		IoResult read;
+		if ( m_bSecure )
+			boost::asio::async_read( m_Stream, m_Buffer, boost::asio::transfer_exactly( a_Bytes - m_Buffer.size() ), boost::bind( &IoResult::OnIo, &read, _1, _2 ) );
+		else
+			boost::asio::async_read( m_Stream.next_layer(), m_Buffer, boost::asio::transfer_exactly( a_Bytes - m_Buffer.size() ), boost::bind( &IoResult::OnIo, &read, _1, _2 ) );
+		Check( read );
+	}
+	std::string Take( size_t a_Bytes )
+	{
+		std::string data( boost::asio::buffers_begin( m_Buffer.data() ), boost::asio::buffers_begin( m_Buffer.data() ) + a_Bytes );
+		m_Buffer.consume( a_Bytes );
+		return data;
+	}
+
+	void OnDeadline( const boost::system::error_code & a_Error )
+	{
+		if ( a_Error == boost::asio::error::operation_aborted 
+			|| m_Timer.expires_at() > boost::asio::deadline_timer::traits_type::now() )
+			return;
+
+		m_bTimedOut = true;
+		m_Service.stop();
+	}
+};
+
+#endif
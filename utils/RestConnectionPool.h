@@ -0,0 +1,214 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#ifndef SELF_RESTCONNECTIONPOOL_H
+#define SELF_RESTCONNECTIONPOOL_H
+
+#include <string>
+#include <map>
+#include <list>
+
+#include <boost/thread.hpp>
+
+#include "utils/HttpConnection.h"
+#include "utils/StringUtil.h"
+#include "utils/Time.h"
+#include "utils/Log.h"
+
+//! Blocking HTTP/1.1 requests over keep-alive connections that are kept open per host, so polling
+//! a device cloud every second doesn't pay for a new TCP and TLS handshake on every request. 
+//! Requests are made from pool threads, any number of threads can share the pool. Every network
+//! operation has a deadline, so a server that stops answering fails the request instead of hanging it.
+//! Header only like HttpConnection, a plugin can use the shared Instance() or keep a pool of its own.
+class RestConnectionPool
+{
+public:
+	//! Types
+	typedef HttpConnection::Headers		Headers;
+	typedef HttpConnection::Response	Response;		// m_StatusCode is 0 if the request failed
+
+	//! Construction
+	RestConnectionPool() : m_MaxIdle( 4 ), m_IdleTimeout( 30.0f ), m_Timeout( 10.0f )
+	{}
+	~RestConnectionPool()
+	{
+		Close();
+	}
+
+	//! Singleton, shared by every sensor in the plugin
+	static RestConnectionPool * Instance()
+	{
+		static RestConnectionPool sInstance;
+		return &sInstance;
+	}
+
+	//! Idle connections kept per host, and how long an idle connection is kept open.
+	void SetLimits( size_t a_MaxIdle, float a_IdleTimeout )
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		m_MaxIdle = a_MaxIdle;
+		m_IdleTimeout = a_IdleTimeout;
+	}
+	//! Seconds connecting, sending or each read of the response may take before the request fails.
+	void SetTimeout( float a_Timeout )
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		m_Timeout = a_Timeout;
+	}
+
+	//! Make a request, returns false if no response was received.
+	bool Request( const std::string & a_URL, const std::string & a_Method, const Headers & a_Headers,
+		const std::string & a_Body, Response & a_Response )
+	{
+		a_Response.m_StatusCode = 0;
+
+		HttpConnection::URL url;
+		if (! url.Parse( a_URL ) )
+		{
+			Log::Error( "RestConnectionPool", "Unsupported protocol in %s", a_URL.c_str() );
+			return false;
+		}
+
+		std::string request( a_Method + " " + url.m_Path + " HTTP/1.1\r\nHost: " + url.m_Authority + "\r\nConnection: keep-alive\r\n" );
+		for( Headers::const_iterator iHeader = a_Headers.begin(); iHeader != a_Headers.end(); ++iHeader )
+			request += iHeader->first + ": " + iHeader->second + "\r\n";
+		if ( a_Body.size() > 0 || (a_Method != "GET" && a_Method != "HEAD" && a_Method != "DELETE") )
+			request += StringUtil::Format( "Content-Length: %u\r\n", (unsigned int)a_Body.size() );
+		request += "\r\n";
+		request += a_Body;
+
+		// a kept connection may have been closed by the server while idle, so idempotent requests 
+		// are retried once on a new connection
+		bool bIdempotent = a_Method == "GET" || a_Method == "HEAD" || a_Method == "PUT" || a_Method == "DELETE";
+		std::string key( url.m_Protocol + "://" + url.m_Host + ":" + url.m_Port );
+		for(int attempt=0;attempt<2;++attempt)
+		{
+			bool bReused = false;
+			Connection * pConnection = Acquire( key, bReused );
+			if ( pConnection == NULL )
+			{
+				float timeout = 0.0f;
+				{
+					boost::lock_guard<boost::mutex> lock( m_Lock );
+					timeout = m_Timeout;
+				}
+				pConnection = new Connection( timeout );
+				try {
+					pConnection->Open( url );
+				}
+				catch( const std::exception & e )
+				{
+					Log::Error( "RestConnectionPool", "Failed to connect to %s:%s: %s", url.m_Host.c_str(), url.m_Port.c_str(), e.what() );
+					delete pConnection;
+					return false;
+				}
+			}
+
+			try {
+				pConnection->Write( request );
+				pConnection->ReadResponse( a_Response );
+				if ( a_Response.m_bKeepAlive )
+					Release( key, pConnection );
+				else
+					delete pConnection;
+				return true;
+			}
+			catch( const std::exception & e )
+			{
+				Log::Debug( "RestConnectionPool", "Request to %s failed: %s", url.m_Host.c_str(), e.what() );
+				a_Response.m_StatusCode = 0;
+			}
+
+			// a server that didn't answer in time isn't asked again
+			bool bTimedOut = pConnection->IsTimedOut();
+			delete pConnection;
+			if (! bReused || !bIdempotent || bTimedOut )
+				break;
+		}
+
+		return false;
+	}
+
+	//! Close all idle connections.
+	void Close()
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+		for( IdleMap::iterator iHost = m_Idle.begin(); iHost != m_Idle.end(); ++iHost )
+		{
+			for( ConnectionList::iterator iConnection = iHost->second.begin(); iConnection != iHost->second.end(); ++iConnection )
+				delete *iConnection;
+		}
+		m_Idle.clear();
+	}
+
+private:
+	//! Types
+	//! A kept connection and when it was last used
+	class Connection : public HttpConnection
+	{
+	public:
+		Connection( float a_Timeout ) : HttpConnection( a_Timeout ), m_LastUsed( 0.0 )
+		{}
+
+		double		m_LastUsed;
+	};
+	typedef std::list<Connection *>						ConnectionList;
+	typedef std::map<std::string,ConnectionList>		IdleMap;
+
+	//! Data
+	boost::mutex		m_Lock;
+	IdleMap				m_Idle;				// idle connections keyed by scheme://host:port
+	size_t				m_MaxIdle;
+	float				m_IdleTimeout;
+	float				m_Timeout;
+
+	Connection * Acquire( const std::string & a_Key, bool & a_bReused )
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+
+		ConnectionList & idle = m_Idle[ a_Key ];
+		double now = Time().GetEpochTime();
+		while( idle.size() > 0 && (now - idle.front()->m_LastUsed) > m_IdleTimeout )
+		{
+			delete idle.front();
+			idle.pop_front();
+		}
+		if ( idle.size() == 0 )
+			return NULL;
+
+		Connection * pConnection = idle.back();
+		idle.pop_back();
+		a_bReused = true;
+		return pConnection;
+	}
+
+	void Release( const std::string & a_Key, Connection * a_pConnection )
+	{
+		boost::lock_guard<boost::mutex> lock( m_Lock );
+
+		a_pConnection->m_LastUsed = Time().GetEpochTime();
+		ConnectionList & idle = m_Idle[ a_Key ];
+		idle.push_back( a_pConnection );
+		while( idle.size() > m_MaxIdle )
+		{
+			delete idle.front();
+			idle.pop_front();
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,296 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "FrameSelector.h"
+#include "utils/ThreadPool.h"
+#include "utils/Time.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+
+namespace {
+
+	//! Thumbnail cells added around the changed region so objects aren't cut at the edge of the motion
+	const int ROI_MARGIN = 2;
+
+	void GrowSpan( int & a_Start, int & a_Length, int a_MinLength, int a_Limit )
+	{
+		if ( a_Length >= a_MinLength )
+			return;
+		a_Start -= (a_MinLength - a_Length) / 2;
+		a_Length = a_MinLength;
+		if ( a_Start + a_Length > a_Limit )
+			a_Start = a_Limit - a_Length;
+		if ( a_Start < 0 )
+			a_Start = 0;
+	}
+
+	bool IsInside( const Json::Value & a_Location, const VisualFrame::Region & a_Region )
+	{
+		double x = a_Location["left"].asDouble() + a_Location["width"].asDouble() / 2;
+		double y = a_Location["top"].asDouble() + a_Location["height"].asDouble() / 2;
+		return x >= a_Region.m_X && x < a_Region.m_X + a_Region.m_Width
+			&& y >= a_Region.m_Y && y < a_Region.m_Y + a_Region.m_Height;
+	}
+
+	Json::Value * FindByKey( Json::Value & a_List, const char * a_pKey, const Json::Value & a_Value )
+	{
+		if (! a_List.isArray() )
+			return NULL;
+		for(unsigned int i=0;i<a_List.size();++i)
+		{
+			const Json::Value & item = a_List[i];
+			if ( item.isObject() && item[a_pKey] == a_Value )
+				return &a_List[i];
+		}
+		return NULL;
+	}
+}
+
+FrameSelector::FrameSelector() : 
+	m_spLink( new Link( this ) ),
+	m_pPending( NULL ),
+	m_bHaveResult( false ),
+	m_UploadTime( 0.0 ),
+	m_FullTime( 0.0 ),
+	m_Frames( 0 ),
+	m_Uploads( 0 )
+{}
+
+FrameSelector::~FrameSelector()
+{
+	boost::lock_guard<boost::mutex> lock( m_spLink->m_Lock );
+	m_spLink->m_pSelector = NULL;
+}
+
+FrameSelector::Upload * FrameSelector::Select( const Options & a_Options, const std::string & a_ImageData, 
+	const std::string & a_Key, ResultCache * a_pCache, ResultCallback a_Callback )
+{
+	// decode outside the lock, this is the expensive part
+	VisualFrame frame;
+	frame.Analyze( a_ImageData );
+
+	VisualFrame::Region region;
+	Upload * pUpload = NULL;
+	unsigned int uploads = 0, frames = 0;
+	{
+		boost::lock_guard<boost::mutex> lock( m_spLink->m_Lock );
+		m_Frames += 1;
+
+		double now = Time().GetEpochTime();
+		bool bSameQuery = a_Key == m_Key;
+		float motion = frame.GetMotion( m_LastSeen );
+		m_LastSeen = frame;
+
+		if ( bSameQuery && (m_pPending != NULL || m_bHaveResult) && (now - m_UploadTime) < a_Options.m_RefreshInterval )
+		{
+			bool bDuplicate = frame.GetDistance( m_LastUploaded ) <= a_Options.m_DuplicateDistance;
+			bool bMoving = a_Options.m_MaxMotion > 0.0f && motion > a_Options.m_MaxMotion;
+			if ( bDuplicate || bMoving )
+			{
+				if ( m_pPending != NULL )
+					m_pPending->m_Callbacks.push_back( a_Callback );
+				else
+					new Answer( a_Callback, m_Result );
+				return NULL;
+			}
+		}
+
+		// a content hash only matches identical frames
+		Json::Value cached;
+		int maxDistance = frame.IsDecoded() ? a_Options.m_CacheDistance : 0;
+		if ( a_pCache != NULL && a_pCache->Find( frame.GetHash(), maxDistance, a_Key, now, cached ) )
+		{
+			new Answer( a_Callback, cached );
+			return NULL;
+		}
+
+		// a crop can only be sent when there is a recent full frame result to merge it into
+		bool bCanCrop = bSameQuery && m_bHaveResult && (now - m_FullTime) < a_Options.m_RefreshInterval;
+		if (! bCanCrop || !a_Options.m_bCropToMotion || !GetRegion( a_Options, frame, region ) )
+			region = VisualFrame::Region();
+
+		pUpload = new Upload( m_spLink, a_pCache, a_Key, frame.GetHash(), a_Callback );
+		if ( region.m_Width > 0 )
+			pUpload->m_Base = m_Result;
+		m_Key = a_Key;
+		m_LastUploaded = frame;
+		m_UploadTime = now;
+		m_pPending = pUpload;
+		uploads = ++m_Uploads;
+		frames = m_Frames;
+	}
+
+	// a crop is kept even if it didn't save bytes, a plain re-encode only if it made the frame smaller
+	if ( frame.Encode( region, a_Options.m_MaxImageSize, a_Options.m_JpegQuality, pUpload->m_Image, pUpload->m_Scale ) )
+	{
+		if ( region.m_Width == 0 && pUpload->m_Image.size() >= a_ImageData.size() )
+			pUpload->m_Image.clear();
+		else
+			pUpload->m_Region = region;
+	}
+	if ( pUpload->m_Image.size() == 0 )
+		pUpload->m_Scale = 1.0;
+
+	Log::Debug( "FrameSelector", "Uploading frame, %u of %u frames uploaded, %u bytes (%u original).",
+		uploads, frames, (unsigned int)pUpload->GetImage( a_ImageData ).size(), (unsigned int)a_ImageData.size() );
+	return pUpload;
+}
+
+bool FrameSelector::GetRegion( const Options & a_Options, const VisualFrame & a_Frame, VisualFrame::Region & a_Region ) const
+{
+	if (! a_Frame.GetChangedRegion( m_LastUploaded, a_Options.m_RoiThreshold, ROI_MARGIN, a_Region ) )
+		return false;
+
+	int width = a_Frame.GetWidth();
+	int height = a_Frame.GetHeight();
+	if ( (float)(a_Region.m_Width * a_Region.m_Height) > a_Options.m_MaxRoiArea * width * height )
+		return false;
+
+	GrowSpan( a_Region.m_X, a_Region.m_Width, (int)(a_Options.m_MinRoiSize * width), width );
+	GrowSpan( a_Region.m_Y, a_Region.m_Height, (int)(a_Options.m_MinRoiSize * height), height );
+	return true;
+}
+
+FrameSelector::Upload::Upload( const LinkSP & a_spLink, ResultCache * a_pCache, const std::string & a_Key,
+	boost::uint64_t a_Hash, ResultCallback a_Callback ) : 
+	m_spLink( a_spLink ), m_pCache( a_pCache ), m_Key( a_Key ), m_Hash( a_Hash ), m_Scale( 1.0 )
+{
+	m_Callbacks.push_back( a_Callback );
+}
+
+void FrameSelector::Upload::OnResponse( const Json::Value & a_Result )
+{
+	Json::Value result( a_Result );
+	if ( (m_Scale != 1.0 || m_Region.m_Width > 0) && result.isObject() && result.isMember( "images" ) )
+		MapLocations( result );
+	if ( m_Region.m_Width > 0 && result.isObject() )
+		Merge( result );
+
+	std::list<ResultCallback> callbacks;
+	{
+		boost::lock_guard<boost::mutex> lock( m_spLink->m_Lock );
+		FrameSelector * pSelector = m_spLink->m_pSelector;
+		if ( pSelector != NULL && pSelector->m_pPending == this )
+		{
+			pSelector->m_pPending = NULL;
+			pSelector->m_bHaveResult = !result.isNull();
+			if ( pSelector->m_bHaveResult )
+			{
+				pSelector->m_Result = result;
+				if ( m_Region.m_Width == 0 )
+					pSelector->m_FullTime = pSelector->m_UploadTime;
+			}
+			else
+				pSelector->m_LastUploaded = VisualFrame();		// failed, so the next frame is sent
+		}
+		// the cache belongs to the owner of the selector, so it's gone with it. A crop's result is 
+		// only valid for the frame it was merged into, so only full frames are cached under their hash.
+		if ( pSelector != NULL && m_pCache != NULL && !result.isNull() && m_Region.m_Width == 0 )
+			m_pCache->Add( m_Hash, m_Key, result, Time().GetEpochTime() );
+		callbacks.swap( m_Callbacks );
+	}
+
+	for( std::list<ResultCallback>::iterator iCallback = callbacks.begin(); iCallback != callbacks.end(); ++iCallback )
+		if ( iCallback->IsValid() )
+			(*iCallback)( result );
+	delete this;
+}
+
+void FrameSelector::Upload::MapLocations( Json::Value & a_Result ) const
+{
+	Json::Value & images = a_Result["images"];
+	for(unsigned int i=0;i<images.size();++i)
+	{
+		if (! images[i].isObject() || !images[i].isMember( "faces" ) )
+			continue;
+
+		Json::Value & faces = images[i]["faces"];
+		for(unsigned int j=0;j<faces.size();++j)
+		{
+			Json::Value & location = faces[j]["face_location"];
+			if (! location.isObject() )
+				continue;
+
+			location["left"] = (int)(location["left"].asDouble() / m_Scale) + m_Region.m_X;
+			location["top"] = (int)(location["top"].asDouble() / m_Scale) + m_Region.m_Y;
+			location["width"] = (int)(location["width"].asDouble() / m_Scale);
+			location["height"] = (int)(location["height"].asDouble() / m_Scale);
+		}
+	}
+}
+
+void FrameSelector::Upload::Merge( Json::Value & a_Result ) const
+{
+	Json::Value & images = a_Result["images"];
+	const Json::Value & baseImages = m_Base["images"];
+	if (! images.isArray() || images.size() == 0 || !images[0].isObject() 
+		|| !baseImages.isArray() || baseImages.size() == 0 || !baseImages[0].isObject() )
+		return;
+
+	Json::Value & image = images[0];
+	const Json::Value & baseImage = baseImages[0];
+
+	// faces inside the crop come from the crop, the ones outside it were outside the change
+	const Json::Value & baseFaces = baseImage["faces"];
+	if ( image.isMember( "faces" ) && baseFaces.isArray() )
+	{
+		Json::Value & faces = image["faces"];
+		for(unsigned int i=0;i<baseFaces.size();++i)
+			if ( baseFaces[i]["face_location"].isObject() && !IsInside( baseFaces[i]["face_location"], m_Region ) )
+				faces.append( baseFaces[i] );
+	}
+
+	// classes found in the full frame are kept, a class also found in the crop takes the new score
+	const Json::Value & baseClassifiers = baseImage["classifiers"];
+	if ( image.isMember( "classifiers" ) && baseClassifiers.isArray() )
+	{
+		Json::Value & classifiers = image["classifiers"];
+		for(unsigned int i=0;i<baseClassifiers.size();++i)
+		{
+			const Json::Value & baseClassifier = baseClassifiers[i];
+			Json::Value * pClassifier = FindByKey( classifiers, "classifier_id", baseClassifier["classifier_id"] );
+			if ( pClassifier == NULL )
+			{
+				classifiers.append( baseClassifier );
+				continue;
+			}
+
+			const Json::Value & baseClasses = baseClassifier["classes"];
+			Json::Value & classes = (*pClassifier)["classes"];
+			for(unsigned int j=0;j<baseClasses.size();++j)
+				if ( FindByKey( classes, "class", baseClasses[j]["class"] ) == NULL )
+					classes.append( baseClasses[j] );
+		}
+	}
+}
+
+FrameSelector::Answer::Answer( ResultCallback a_Callback, const Json::Value & a_Result ) :
+	m_Callback( a_Callback ), m_Result( a_Result )
+{
+	// keep the callback asynchronous like the service request
+	ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( Answer, OnAnswer, this ) );
+}
+
+void FrameSelector::Answer::OnAnswer()
+{
+	if ( m_Callback.IsValid() )
+		m_Callback( m_Result );
+	delete this;
+}
@@ -0,0 +1,181 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef WDC_FRAME_SELECTOR_H
+#define WDC_FRAME_SELECTOR_H
+
+#include <string>
+#include <list>
+
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "VisualFrame.h"
+#include "ResultCache.h"
+#include "utils/Delegate.h"
+#include "jsoncpp/json/json.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Decides which camera frames are worth sending to the service. A frame that looks like the last
+//! uploaded one, or that was taken while the scene was still moving, is answered with the result of
+//! the last upload (or queued behind it if it's still in flight). Other frames are looked up in an
+//! optional ResultCache of earlier scenes. Frames that do get uploaded can be cropped to the region 
+//! that changed and scaled down before they are sent, the result for a crop is merged into the last
+//! full frame result so what didn't change is still reported.
+class FrameSelector
+{
+public:
+	//! Types
+	typedef Delegate<const Json::Value &>	ResultCallback;
+
+	struct Options
+	{
+		Options() : 
+			m_DuplicateDistance( 6 ),
+			m_CacheDistance( 4 ),
+			m_MaxMotion( 0.08f ),
+			m_RefreshInterval( 30.0f ),
+			m_bCropToMotion( true ),
+			m_RoiThreshold( 0.12f ),
+			m_MaxRoiArea( 0.6f ),
+			m_MinRoiSize( 0.5f ),
+			m_MaxImageSize( 640 ),
+			m_JpegQuality( 85 )
+		{}
+
+		int		m_DuplicateDistance;	// hash bits that may differ for a frame to count as a duplicate
+		int		m_CacheDistance;		// hash bits that may differ for a cached result to be used
+		float	m_MaxMotion;			// frames moving more than this against the previous frame are skipped, 0 to disable
+		float	m_RefreshInterval;		// seconds before the last result is considered stale
+		bool	m_bCropToMotion;
+		float	m_RoiThreshold;			// per pixel change (0 - 1) that marks a thumbnail cell as changed
+		float	m_MaxRoiArea;			// crop only when the changed region is smaller than this fraction of the frame
+		float	m_MinRoiSize;			// a crop is at least this fraction of the frame on each side
+		int		m_MaxImageSize;			// long edge of uploaded frames in pixels, 0 for no limit
+		int		m_JpegQuality;
+	};
+
+	//! Shared by a selector and its uploads, the selector clears m_pSelector when it's destroyed so a
+	//! late response is still answered but no longer touches the selector or its cache.
+	struct Link
+	{
+		Link( FrameSelector * a_pSelector ) : m_pSelector( a_pSelector )
+		{}
+
+		boost::mutex		m_Lock;
+		FrameSelector *		m_pSelector;
+	};
+	typedef boost::shared_ptr<Link>		LinkSP;
+
+	class Upload
+	{
+	public:
+		Upload( const LinkSP & a_spLink, ResultCache * a_pCache, const std::string & a_Key,
+			boost::uint64_t a_Hash, ResultCallback a_Callback );
+
+		//! The image to upload, either a re-encoded crop or the original data.
+		const std::string & GetImage( const std::string & a_Original ) const
+		{
+			return m_Image.size() > 0 ? m_Image : a_Original;
+		}
+		//! Move the image to upload into a_Image, a re-encoded crop is swapped out rather than copied.
+		void TakeImage( const std::string & a_Original, std::string & a_Image )
+		{
+			if ( m_Image.size() > 0 )
+				a_Image.swap( m_Image );
+			else
+				a_Image = a_Original;
+		}
+
+		void OnResponse( const Json::Value & a_Result );
+
+	private:
+		friend class FrameSelector;
+
+		LinkSP						m_spLink;
+		ResultCache *				m_pCache;
+		std::string					m_Key;
+		boost::uint64_t				m_Hash;
+		std::list<ResultCallback>	m_Callbacks;
+		std::string					m_Image;
+		VisualFrame::Region			m_Region;			// crop that was uploaded, empty for the full frame
+		double						m_Scale;
+		Json::Value					m_Base;				// full frame result a crop is merged into
+
+		//! Move face locations from the uploaded image back into the original frame.
+		void MapLocations( Json::Value & a_Result ) const;
+		//! Keep what the full frame result found outside the crop.
+		void Merge( Json::Value & a_Result ) const;
+	};
+
+	//! Construction
+	FrameSelector();
+	~FrameSelector();
+
+	//! Accessors
+	unsigned int GetFrames() const
+	{
+		return m_Frames;
+	}
+	unsigned int GetUploads() const
+	{
+		return m_Uploads;
+	}
+
+	//! Returns the upload to make for this frame, or NULL if a_Callback will be answered from an 
+	//! earlier upload or a_pCache. a_Key identifies the query, a result is only reused for the same key.
+	Upload * Select( const Options & a_Options, const std::string & a_ImageData, 
+		const std::string & a_Key, ResultCache * a_pCache, ResultCallback a_Callback );
+
+private:
+	//! Types
+	class Answer
+	{
+	public:
+		Answer( ResultCallback a_Callback, const Json::Value & a_Result );
+
+	private:
+		ResultCallback	m_Callback;
+		Json::Value		m_Result;
+
+		void OnAnswer();
+	};
+
+	//! Data
+	LinkSP				m_spLink;			// m_spLink->m_Lock guards everything below
+	std::string			m_Key;
+	VisualFrame			m_LastSeen;
+	VisualFrame			m_LastUploaded;
+	Upload *			m_pPending;
+	bool				m_bHaveResult;
+	Json::Value			m_Result;
+	double				m_UploadTime;
+	double				m_FullTime;			// when the full frame m_Result is based on was uploaded
+	unsigned int		m_Frames;
+	unsigned int		m_Uploads;
+
+	bool GetRegion( const Options & a_Options, const VisualFrame & a_Frame, VisualFrame::Region & a_Region ) const;
+
+	//! a selector is referenced by its uploads, so it can't be copied
+	FrameSelector( const FrameSelector & );
+	FrameSelector & operator=( const FrameSelector & );
+};
+
+#endif
@@ -0,0 +1,217 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "MultipartBody.h"
+#include "utils/StringUtil.h"
+#include "utils/Log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+MultipartBody::MultipartBody() : m_Size( 0 ), m_bFinished( false ), m_FileSegment( 0 )
+{
+	m_Boundary = StringUtil::Format( "----SelfFormBoundary%08x%08x", rand(), rand() );
+	m_ContentType = "multipart/form-data; boundary=" + m_Boundary;
+}
+
+void MultipartBody::AddFilePart( const std::string & a_Name, const std::string & a_FileName, 
+	const std::string & a_Data, const std::string & a_ContentType /*= "application/octet-stream"*/ )
+{
+	if ( m_bFinished )
+	{
+		Log::Error( "MultipartBody", "AddFilePart() called after Finish()." );
+		return;
+	}
+
+	AddPartHead( a_Name, a_FileName, a_ContentType );
+	AddReference( a_Data );
+	AddOwned( "\r\n" );
+}
+
+void MultipartBody::TakeFilePart( const std::string & a_Name, const std::string & a_FileName, 
+	std::string & a_Data, const std::string & a_ContentType /*= "application/octet-stream"*/ )
+{
+	if ( m_bFinished )
+	{
+		Log::Error( "MultipartBody", "TakeFilePart() called after Finish()." );
+		return;
+	}
+
+	AddPartHead( a_Name, a_FileName, a_ContentType );
+	m_Owned.push_back( std::string() );
+	m_Owned.back().swap( a_Data );
+	AddReference( m_Owned.back() );
+	AddOwned( "\r\n" );
+}
+
+bool MultipartBody::AddFilePartFromPath( const std::string & a_Name, const std::string & a_Path,
+	const std::string & a_ContentType /*= "application/octet-stream"*/ )
+{
+	if ( m_bFinished )
+	{
+		Log::Error( "MultipartBody", "AddFilePartFromPath() called after Finish()." );
+		return false;
+	}
+
+	std::ifstream input( a_Path.c_str(), std::ios::in | std::ios::binary );
+	if (! input.is_open() )
+		return false;
+	input.seekg( 0, std::ios::end );
+	size_t size = (size_t)input.tellg();
+
+	std::string fileName( a_Path );
+	size_t slash = fileName.find_last_of( "/\\" );
+	if ( slash != std::string::npos )
+		fileName = fileName.substr( slash + 1 );
+
+	AddPartHead( a_Name, fileName, a_ContentType );
+	if ( size > 0 )
+	{
+		m_Segments.push_back( Segment( a_Path, size ) );
+		m_Size += size;
+	}
+	AddOwned( "\r\n" );
+	return true;
+}
+
+void MultipartBody::AddFormField( const std::string & a_Name, const std::string & a_Value )
+{
+	if ( m_bFinished )
+	{
+		Log::Error( "MultipartBody", "AddFormField() called after Finish()." );
+		return;
+	}
+
+	AddOwned( StringUtil::Format( "--%s\r\nContent-Disposition: form-data; name=\"%s\"\r\n\r\n",
+		m_Boundary.c_str(), a_Name.c_str() ) + a_Value + "\r\n" );
+}
+
+void MultipartBody::Finish()
+{
+	if (! m_bFinished )
+	{
+		AddOwned( "--" + m_Boundary + "--\r\n" );
+		m_bFinished = true;
+	}
+}
+
+bool MultipartBody::Gather( std::string & a_Body )
+{
+	a_Body.resize( m_Size );
+	if ( m_Size == 0 )
+		return true;
+	return Read( 0, &a_Body[0], m_Size ) == m_Size;
+}
+
+size_t MultipartBody::Read( size_t a_Offset, char * a_pBuffer, size_t a_Bytes )
+{
+	size_t copied = 0;
+	size_t start = 0;
+	for (size_t i = 0; i < m_Segments.size() && copied < a_Bytes; ++i)
+	{
+		const Segment & segment = m_Segments[i];
+		size_t end = start + segment.m_Size;
+		if ( a_Offset < end )
+		{
+			size_t skip = a_Offset - start;
+			size_t bytes = segment.m_Size - skip;
+			if ( bytes > a_Bytes - copied )
+				bytes = a_Bytes - copied;
+
+			if ( segment.m_pData != NULL )
+				memcpy( a_pBuffer + copied, segment.m_pData + skip, bytes );
+			else if ( ReadFile( i, skip, a_pBuffer + copied, bytes ) != bytes )
+				return copied;		// file changed or went away under us
+
+			copied += bytes;
+			a_Offset += bytes;
+		}
+		start = end;
+	}
+
+	return copied;
+}
+
+void MultipartBody::AddOwned( const std::string & a_Data )
+{
+	m_Owned.push_back( a_Data );
+	AddReference( m_Owned.back() );
+}
+
+size_t MultipartBody::Peek( size_t a_Offset, size_t a_Bytes, const char * & a_pData ) const
+{
+	size_t start = 0;
+	for (size_t i = 0; i < m_Segments.size(); ++i)
+	{
+		const Segment & segment = m_Segments[i];
+		size_t end = start + segment.m_Size;
+		if ( a_Offset < end )
+		{
+			if ( segment.m_pData == NULL )
+				return 0;
+
+			size_t skip = a_Offset - start;
+			a_pData = segment.m_pData + skip;
+			return std::min( segment.m_Size - skip, a_Bytes );
+		}
+		start = end;
+	}
+
+	return 0;
+}
+
+void MultipartBody::AddPartHead( const std::string & a_Name, const std::string & a_FileName, const std::string & a_ContentType )
+{
+	AddOwned( StringUtil::Format( "--%s\r\nContent-Disposition: form-data; name=\"%s\"; filename=\"%s\"\r\nContent-Type: %s\r\n\r\n",
+		m_Boundary.c_str(), a_Name.c_str(), a_FileName.c_str(), a_ContentType.c_str() ) );
+}
+
+size_t MultipartBody::ReadFile( size_t a_Segment, size_t a_Offset, char * a_pBuffer, size_t a_Bytes )
+{
+	if (! m_File.is_open() || m_FileSegment != a_Segment )
+	{
+		if ( m_File.is_open() )
+			m_File.close();
+		m_File.clear();
+		m_File.open( m_Segments[a_Segment].m_Path.c_str(), std::ios::in | std::ios::binary );
+		m_FileSegment = a_Segment;
+		if (! m_File.is_open() )
+		{
+			Log::Error( "MultipartBody", "Failed to open %s", m_Segments[a_Segment].m_Path.c_str() );
+			return 0;
+		}
+	}
+
+	if (! m_File.good() )
+		m_File.clear();
+	if ( (size_t)m_File.tellg() != a_Offset )
+		m_File.seekg( a_Offset, std::ios::beg );
+	m_File.read( a_pBuffer, a_Bytes );
+	return (size_t)m_File.gcount();
+}
+
+void MultipartBody::AddReference( const std::string & a_Data )
+{
+	if ( a_Data.size() > 0 )
+	{
+		m_Segments.push_back( Segment( a_Data.data(), a_Data.size() ) );
+		m_Size += a_Data.size();
+	}
+}
@@ -0,0 +1,111 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef WDC_MULTIPART_BODY_H
+#define WDC_MULTIPART_BODY_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <fstream>
+
+#include "SelfLib.h"			// include last always
+
+//! multipart/form-data body kept as a list of segments pointing at the caller's data, so building it
+//! copies nothing. Gather() flattens it with one copy of each part, a request that takes the body as
+//! a string copies that again, so send it with MultipartUploader which writes the segments in memory
+//! straight to the socket. Any string passed to AddFilePart() must stay valid until the body has been 
+//! sent, TakeFilePart() moves the data into the body instead for bodies that outlive the caller.
+//! Parts added from a path are read from disk as the body is read, so a body can be streamed 
+//! without ever holding the files in memory.
+class MultipartBody
+{
+public:
+	//! Construction
+	MultipartBody();
+
+	//! Accessors
+	const std::string & GetContentType() const
+	{
+		return m_ContentType;
+	}
+	size_t GetSize() const
+	{
+		return m_Size;
+	}
+
+	//! Reference a_Data as a file part, nothing is copied.
+	void AddFilePart( const std::string & a_Name, const std::string & a_FileName, 
+		const std::string & a_Data, const std::string & a_ContentType = "application/octet-stream" );
+	//! Take a_Data as a file part, its contents are swapped into the body so nothing is copied and
+	//! a_Data is left empty.
+	void TakeFilePart( const std::string & a_Name, const std::string & a_FileName, 
+		std::string & a_Data, const std::string & a_ContentType = "application/octet-stream" );
+	//! Reference a file on disk as a file part, returns false if the file can't be opened.
+	bool AddFilePartFromPath( const std::string & a_Name, const std::string & a_Path,
+		const std::string & a_ContentType = "application/octet-stream" );
+	//! Add a small text field, the value is copied.
+	void AddFormField( const std::string & a_Name, const std::string & a_Value );
+	//! Add the closing boundary, no parts can be added after this.
+	void Finish();
+
+	//! Copy the whole body into a_Body with a single allocation, for requests that need a string.
+	bool Gather( std::string & a_Body );
+	//! Copy up to a_Bytes of the body starting at a_Offset, returns the number of bytes copied which
+	//! is less than a_Bytes only at the end of the body or if a file couldn't be read.
+	size_t Read( size_t a_Offset, char * a_pBuffer, size_t a_Bytes );
+	//! Point a_pData at the body in memory at a_Offset, returns how many bytes up to a_Bytes can be
+	//! sent from there. Returns 0 if that part of the body comes from a file and has to be Read().
+	size_t Peek( size_t a_Offset, size_t a_Bytes, const char * & a_pData ) const;
+
+private:
+	//! Types
+	struct Segment
+	{
+		Segment( const char * a_pData, size_t a_Size ) : m_pData( a_pData ), m_Size( a_Size )
+		{}
+		Segment( const std::string & a_Path, size_t a_Size ) : m_pData( NULL ), m_Size( a_Size ), m_Path( a_Path )
+		{}
+
+		const char *	m_pData;			// NULL if the segment is read from m_Path
+		size_t			m_Size;
+		std::string		m_Path;
+	};
+
+	//! Data
+	std::string				m_Boundary;
+	std::string				m_ContentType;
+	std::list<std::string>	m_Owned;			// part headers and fields, a list so segments stay valid
+	std::vector<Segment>	m_Segments;
+	size_t					m_Size;
+	bool					m_bFinished;
+	std::ifstream			m_File;				// open file segment, so sequential reads don't reopen it
+	size_t					m_FileSegment;
+
+	void AddPartHead( const std::string & a_Name, const std::string & a_FileName, const std::string & a_ContentType );
+	void AddOwned( const std::string & a_Data );
+	void AddReference( const std::string & a_Data );
+	size_t ReadFile( size_t a_Segment, size_t a_Offset, char * a_pBuffer, size_t a_Bytes );
+
+	//! segments point into m_Owned, so a copy would point into the original
+	MultipartBody( const MultipartBody & );
+	MultipartBody & operator=( const MultipartBody & );
+};
+
+#endif
@@ -0,0 +1,328 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "MultipartUploader.h"
+#include "utils/ThreadPool.h"
+#include "utils/StringUtil.h"
+#include "utils/Time.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+
+namespace {
+
+	//! Bytes read from the body and written to the socket at a time
+	const size_t CHUNK_SIZE = 64 * 1024;
+	//! Report progress every 5% of the body, but not more often than every PROGRESS_BYTES
+	const size_t PROGRESS_STEPS = 20;
+	const size_t PROGRESS_BYTES = 1024 * 1024;
+}
+
+MultipartUploader::MultipartUploader() : 
+	m_Active( 0 ),
+	m_Timeout( 60.0f ),
+	m_MaxUploads( 2 ),
+	m_MaxBytesPerSecond( 0.0 ),
+	m_Tokens( 0.0 ),
+	m_TokenTime( 0.0 ),
+	m_bStopped( false )
+{}
+
+MultipartUploader::~MultipartUploader()
+{
+	Stop();
+}
+
+void MultipartUploader::SetLimits( int a_MaxUploads, double a_MaxBytesPerSecond )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_MaxUploads = a_MaxUploads;
+	m_MaxBytesPerSecond = a_MaxBytesPerSecond;
+}
+
+void MultipartUploader::SetTimeout( float a_Timeout )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Timeout = a_Timeout;
+}
+
+void MultipartUploader::Upload( const std::string & a_URL, const Headers & a_Headers, MultipartBody * a_pBody,
+	ResultCallback a_Callback, ProgressCallback a_Progress /*= ProgressCallback()*/ )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Queued.push_back( new Job( this, a_URL, a_Headers, a_pBody, a_Callback, a_Progress ) );
+	StartJobs();
+}
+
+void MultipartUploader::Stop()
+{
+	JobList queued, running;
+	{
+		boost::unique_lock<boost::mutex> lock( m_Lock );
+		m_bStopped = true;
+		m_Changed.notify_all();			// wakes throttled uploads
+		for( JobList::iterator iJob = m_Running.begin(); iJob != m_Running.end(); ++iJob )
+			(*iJob)->Cancel();
+		while( m_Active > 0 )
+			m_Changed.wait( lock );
+
+		queued.swap( m_Queued );
+		running.swap( m_Running );
+		m_bStopped = false;
+	}
+
+	// jobs that ran are still deleted by their OnDone(), which is already queued for the main thread
+	for( JobList::iterator iJob = running.begin(); iJob != running.end(); ++iJob )
+	{
+		(*iJob)->m_bCancelled = true;
+		if ( (*iJob)->m_Callback.IsValid() )
+			(*iJob)->m_Callback( Json::Value() );
+	}
+	for( JobList::iterator iJob = queued.begin(); iJob != queued.end(); ++iJob )
+	{
+		if ( (*iJob)->m_Callback.IsValid() )
+			(*iJob)->m_Callback( Json::Value() );
+		delete *iJob;
+	}
+}
+
+void MultipartUploader::StartJobs()
+{
+	while( m_Queued.size() > 0 && (m_MaxUploads <= 0 || m_Active < m_MaxUploads) )
+	{
+		Job * pJob = m_Queued.front();
+		m_Queued.pop_front();
+
+		m_Running.push_back( pJob );
+		m_Active += 1;
+		ThreadPool::Instance()->InvokeOnThread( VOID_DELEGATE( Job, Run, pJob ) );
+	}
+}
+
+void MultipartUploader::OnJobFinished()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Active -= 1;
+	m_Changed.notify_all();
+	if (! m_bStopped )
+		StartJobs();
+}
+
+void MultipartUploader::OnJobDone( Job * a_pJob )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Running.remove( a_pJob );
+}
+
+void MultipartUploader::Throttle( size_t a_Bytes )
+{
+	boost::unique_lock<boost::mutex> lock( m_Lock );
+	if ( m_MaxBytesPerSecond <= 0.0 )
+		return;
+
+	// token bucket holding at most one second of bandwidth, shared by all uploads
+	double now = Time().GetEpochTime();
+	m_Tokens = std::min( m_MaxBytesPerSecond, m_Tokens + (now - m_TokenTime) * m_MaxBytesPerSecond );
+	m_TokenTime = now;
+	m_Tokens -= a_Bytes;
+	if ( m_Tokens >= 0.0 )
+		return;
+
+	// Stop() wakes us, so a throttled upload doesn't hold it up
+	boost::system_time until = boost::get_system_time() + 
+		boost::posix_time::milliseconds( (int)(-m_Tokens / m_MaxBytesPerSecond * 1000.0) );
+	while(! m_bStopped && m_Changed.timed_wait( lock, until ) )
+		;
+}
+
+MultipartUploader::Job::Job( MultipartUploader * a_pUploader, const std::string & a_URL, const Headers & a_Headers,
+	MultipartBody * a_pBody, ResultCallback a_Callback, ProgressCallback a_Progress ) :
+	m_pUploader( a_pUploader ),
+	m_pConnection( NULL ),
+	m_Timeout( a_pUploader->m_Timeout ),
+	m_bCancelled( false ),
+	m_URL( a_URL ),
+	m_Headers( a_Headers ),
+	m_pBody( a_pBody ),
+	m_Callback( a_Callback ),
+	m_ProgressCallback( a_Progress ),
+	m_Reported( 0 )
+{
+	m_Progress.m_URL = a_URL.substr( 0, a_URL.find( '?' ) );		// leave the API key out of logs
+	m_Progress.m_Total = a_pBody->GetSize();
+}
+
+MultipartUploader::Job::~Job()
+{
+	delete m_pBody;
+}
+
+void MultipartUploader::Job::Run()
+{
+	HttpConnection::URL url;
+	HttpConnection connection( m_Timeout );
+	bool bStopped = false;
+	{
+		boost::lock_guard<boost::mutex> lock( m_pUploader->m_Lock );
+		m_pConnection = &connection;
+		bStopped = m_pUploader->m_bStopped;
+	}
+
+	if (! url.Parse( m_URL ) )
+		Log::Error( "MultipartUploader", "Unsupported protocol in %s", m_Progress.m_URL.c_str() );
+	else if (! bStopped )
+	{
+		try {
+			Send( connection, url );
+		}
+		catch( const std::exception & e )
+		{
+			Log::Error( "MultipartUploader", "Upload to %s failed: %s", m_Progress.m_URL.c_str(), e.what() );
+		}
+	}
+
+	{
+		boost::lock_guard<boost::mutex> lock( m_pUploader->m_Lock );
+		m_pConnection = NULL;
+	}
+
+	// Stop() may return and the uploader may be gone once this is called
+	m_pUploader->OnJobFinished();
+	ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( Job, OnDone, this ) );
+}
+
+void MultipartUploader::Job::Send( HttpConnection & a_Connection, const HttpConnection::URL & a_URL )
+{
+	a_Connection.Open( a_URL );
+	a_Connection.Write( GetHead( a_URL ) );
+	if (! SendBody( a_Connection ) )
+		return;
+
+	HttpConnection::Response response;
+	a_Connection.ReadResponse( response );
+	ParseResponse( response );
+}
+
+void MultipartUploader::Job::Cancel()
+{
+	if ( m_pConnection != NULL )
+		m_pConnection->Cancel();
+}
+
+bool MultipartUploader::Job::SendBody( HttpConnection & a_Connection )
+{
+	// parts in memory are written from where they are, only parts from files go through the chunk
+	std::vector<char> chunk( CHUNK_SIZE );
+	size_t total = m_pBody->GetSize();
+	for( size_t offset = 0; offset < total; )
+	{
+		const char * pData = NULL;
+		size_t bytes = m_pBody->Peek( offset, std::min( CHUNK_SIZE, total - offset ), pData );
+		if ( bytes == 0 )
+		{
+			bytes = m_pBody->Read( offset, &chunk[0], std::min( CHUNK_SIZE, total - offset ) );
+			pData = &chunk[0];
+		}
+		if ( bytes == 0 )
+		{
+			Log::Error( "MultipartUploader", "Failed to read the body for %s", m_Progress.m_URL.c_str() );
+			return false;
+		}
+
+		m_pUploader->Throttle( bytes );
+		a_Connection.Write( pData, bytes );
+		offset += bytes;
+
+		if (! OnSent( bytes ) )
+		{
+			Log::Status( "MultipartUploader", "Upload to %s aborted.", m_Progress.m_URL.c_str() );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool MultipartUploader::Job::OnSent( size_t a_Bytes )
+{
+	boost::lock_guard<boost::mutex> lock( m_ProgressLock );
+	m_Progress.m_Sent += a_Bytes;
+	size_t step = std::max( PROGRESS_BYTES, m_Progress.m_Total / PROGRESS_STEPS );
+	if ( m_ProgressCallback.IsValid() 
+		&& (m_Progress.m_Sent - m_Reported >= step || m_Progress.m_Sent == m_Progress.m_Total) )
+	{
+		m_Reported = m_Progress.m_Sent;
+		ThreadPool::Instance()->InvokeOnMain( VOID_DELEGATE( Job, OnProgress, this ) );
+	}
+
+	return !m_pUploader->m_bStopped;
+}
+
+std::string MultipartUploader::Job::GetHead( const HttpConnection::URL & a_URL ) const
+{
+	std::string head = StringUtil::Format( "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\nConnection: close\r\n",
+		a_URL.m_Path.c_str(), a_URL.m_Authority.c_str(), m_pBody->GetContentType().c_str(), (unsigned long)m_pBody->GetSize() );
+	for( Headers::const_iterator iHeader = m_Headers.begin(); iHeader != m_Headers.end(); ++iHeader )
+		head += iHeader->first + ": " + iHeader->second + "\r\n";
+	head += "\r\n";
+
+	return head;
+}
+
+void MultipartUploader::Job::ParseResponse( const HttpConnection::Response & a_Response )
+{
+	int status = a_Response.m_StatusCode;
+	if ( status < 200 || status >= 300 )
+	{
+		Log::Error( "MultipartUploader", "Upload to %s failed, status %d: %s", m_Progress.m_URL.c_str(), status, a_Response.m_Content.c_str() );
+		return;
+	}
+
+	Json::Reader reader;
+	if (! reader.parse( a_Response.m_Content, m_Result ) )
+	{
+		Log::Error( "MultipartUploader", "Failed to parse response from %s", m_Progress.m_URL.c_str() );
+		m_Result = Json::Value();
+	}
+}
+
+void MultipartUploader::Job::OnProgress()
+{
+	if ( m_bCancelled )
+		return;
+
+	Progress progress;
+	{
+		boost::lock_guard<boost::mutex> lock( m_ProgressLock );
+		progress = m_Progress;
+	}
+	m_ProgressCallback( progress );
+}
+
+void MultipartUploader::Job::OnDone()
+{
+	// a cancelled job was answered and forgotten by Stop(), the uploader may be gone
+	if (! m_bCancelled )
+	{
+		m_pUploader->OnJobDone( this );
+		if ( m_Callback.IsValid() )
+			m_Callback( m_Result );
+	}
+	delete this;
+}
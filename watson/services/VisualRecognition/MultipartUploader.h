@@ -0,0 +1,136 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef WDC_MULTIPART_UPLOADER_H
+#define WDC_MULTIPART_UPLOADER_H
+
+#include <string>
+#include <map>
+#include <list>
+
+#include <boost/thread.hpp>
+
+#include "MultipartBody.h"
+#include "utils/HttpConnection.h"
+#include "utils/Delegate.h"
+#include "jsoncpp/json/json.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Posts MultipartBody requests by streaming the body straight into the socket a chunk at a time, 
+//! so training sets of hundreds of MB are never held in memory. Uploads run on pool threads, at most
+//! m_MaxUploads at a time, and share a bandwidth cap so they don't starve the rest of the robot.
+//! Every network operation has a deadline, and Stop() aborts the uploads in flight and waits for them.
+class MultipartUploader
+{
+public:
+	//! Types
+	typedef std::map<std::string,std::string>	Headers;
+	typedef Delegate<const Json::Value &>		ResultCallback;
+
+	struct Progress
+	{
+		Progress() : m_Sent( 0 ), m_Total( 0 )
+		{}
+
+		std::string		m_URL;
+		size_t			m_Sent;
+		size_t			m_Total;
+	};
+	typedef Delegate<const Progress &>			ProgressCallback;
+
+	//! Construction
+	MultipartUploader();
+	~MultipartUploader();
+
+	//! Limit the number of uploads in flight and the total bytes per second, 0 for no limit.
+	void SetLimits( int a_MaxUploads, double a_MaxBytesPerSecond );
+	//! Seconds that connecting, sending a chunk or reading the response may take before the upload fails.
+	void SetTimeout( float a_Timeout );
+	//! POST a_pBody to a_URL, takes ownership of the body. The result is null if the upload failed. 
+	//! Callbacks are made on the main thread.
+	void Upload( const std::string & a_URL, const Headers & a_Headers, MultipartBody * a_pBody,
+		ResultCallback a_Callback, ProgressCallback a_Progress = ProgressCallback() );
+	//! Fail any queued uploads, abort the ones in flight and wait for their threads to finish. No
+	//! callback is made after this returns. Call from the main thread.
+	void Stop();
+
+private:
+	//! Types
+	class Job
+	{
+	public:
+		Job( MultipartUploader * a_pUploader, const std::string & a_URL, const Headers & a_Headers,
+			MultipartBody * a_pBody, ResultCallback a_Callback, ProgressCallback a_Progress );
+		~Job();
+
+		void Run();
+		void OnProgress();
+		void OnDone();
+		//! Abort the network operation in progress, called from Stop() with the uploader locked.
+		void Cancel();
+
+		//! Connect, send the request and read the response. Throws if the connection fails.
+		void Send( HttpConnection & a_Connection, const HttpConnection::URL & a_URL );
+		//! Stream the body a chunk at a time, returns false if it was aborted.
+		bool SendBody( HttpConnection & a_Connection );
+		//! Called from the transfer with each chunk, returns false to abort.
+		bool OnSent( size_t a_Bytes );
+		//! Build the request head with the method, path and headers.
+		std::string GetHead( const HttpConnection::URL & a_URL ) const;
+		//! Parse the response into m_Result.
+		void ParseResponse( const HttpConnection::Response & a_Response );
+
+		MultipartUploader *		m_pUploader;
+		HttpConnection *		m_pConnection;		// set while Run() is using it, guarded by the uploader lock
+		float					m_Timeout;
+		bool					m_bCancelled;		// Stop() has answered the callback, main thread only
+		boost::mutex			m_ProgressLock;		// guards m_Progress
+		std::string				m_URL;
+		Headers					m_Headers;
+		MultipartBody *			m_pBody;
+		ResultCallback			m_Callback;
+		ProgressCallback		m_ProgressCallback;
+		Progress				m_Progress;
+		size_t					m_Reported;			// bytes sent when progress was last reported
+		Json::Value				m_Result;
+	};
+	typedef std::list<Job *>	JobList;
+
+	//! Data
+	boost::mutex			m_Lock;
+	JobList					m_Queued;
+	JobList					m_Running;			// started and not yet delivered by OnDone()
+	boost::condition_variable	m_Changed;		// a job finished running, or the uploader was stopped
+	int						m_Active;			// jobs in m_Running whose Run() hasn't returned
+	float					m_Timeout;
+	int						m_MaxUploads;
+	double					m_MaxBytesPerSecond;
+	double					m_Tokens;			// bytes that can be sent right away, negative if over the cap
+	double					m_TokenTime;
+	volatile bool			m_bStopped;
+
+	void StartJobs();
+	void OnJobFinished();
+	void OnJobDone( Job * a_pJob );
+	//! Block until a_Bytes can be sent within the bandwidth cap.
+	void Throttle( size_t a_Bytes );
+};
+
+#endif
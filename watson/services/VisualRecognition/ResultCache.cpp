@@ -0,0 +1,109 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "ResultCache.h"
+#include "VisualFrame.h"
+
+ResultCache::ResultCache() : m_MaxEntries( 256 ), m_TTL( 300.0 ), m_Hits( 0 ), m_Misses( 0 )
+{}
+
+size_t ResultCache::GetSize() const
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	return m_Entries.size();
+}
+
+void ResultCache::SetLimits( size_t a_MaxEntries, double a_TTL )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_MaxEntries = a_MaxEntries;
+	m_TTL = a_TTL;
+	while( m_Entries.size() > m_MaxEntries )
+		m_Entries.pop_back();
+}
+
+bool ResultCache::Find( boost::uint64_t a_Hash, int a_MaxDistance, const std::string & a_Key, double a_Now, Json::Value & a_Result )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+
+	EntryList::iterator iBest = m_Entries.end();
+	int best = a_MaxDistance + 1;
+	for( EntryList::iterator iEntry = m_Entries.begin(); iEntry != m_Entries.end(); )
+	{
+		if ( (a_Now - iEntry->m_Time) > m_TTL )
+		{
+			iEntry = m_Entries.erase( iEntry );
+			continue;
+		}
+
+		if ( iEntry->m_Key == a_Key )
+		{
+			int distance = VisualFrame::CountBits( iEntry->m_Hash ^ a_Hash );
+			if ( distance < best )
+			{
+				best = distance;
+				iBest = iEntry;
+			}
+		}
+		++iEntry;
+	}
+
+	if ( iBest == m_Entries.end() )
+	{
+		m_Misses += 1;
+		return false;
+	}
+
+	m_Entries.splice( m_Entries.begin(), m_Entries, iBest );
+	a_Result = iBest->m_Result;
+	m_Hits += 1;
+	return true;
+}
+
+void ResultCache::Add( boost::uint64_t a_Hash, const std::string & a_Key, const Json::Value & a_Result, double a_Now )
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	if ( m_MaxEntries == 0 )
+		return;
+
+	for( EntryList::iterator iEntry = m_Entries.begin(); iEntry != m_Entries.end(); ++iEntry )
+	{
+		if ( iEntry->m_Hash == a_Hash && iEntry->m_Key == a_Key )
+		{
+			m_Entries.erase( iEntry );
+			break;
+		}
+	}
+
+	m_Entries.push_front( Entry() );
+	Entry & entry = m_Entries.front();
+	entry.m_Hash = a_Hash;
+	entry.m_Key = a_Key;
+	entry.m_Result = a_Result;
+	entry.m_Time = a_Now;
+
+	while( m_Entries.size() > m_MaxEntries )
+		m_Entries.pop_back();
+}
+
+void ResultCache::Clear()
+{
+	boost::lock_guard<boost::mutex> lock( m_Lock );
+	m_Entries.clear();
+}
@@ -0,0 +1,81 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef WDC_RESULT_CACHE_H
+#define WDC_RESULT_CACHE_H
+
+#include <string>
+#include <list>
+
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+
+#include "jsoncpp/json/json.h"
+
+#include "SelfLib.h"			// include last always
+
+//! Service results for recently seen scenes, keyed by the perceptual hash of the frame and the
+//! query (e.g. the classifier ids). A lookup returns the closest entry within a Hamming distance,
+//! entries expire after a TTL and the least recently used entry is dropped when the cache is full.
+class ResultCache
+{
+public:
+	//! Construction
+	ResultCache();
+
+	//! Accessors
+	unsigned int GetHits() const
+	{
+		return m_Hits;
+	}
+	unsigned int GetMisses() const
+	{
+		return m_Misses;
+	}
+	size_t GetSize() const;
+
+	//! Configure the cache, shrinks it if needed.
+	void SetLimits( size_t a_MaxEntries, double a_TTL );
+	//! Find the closest result for the same query, a_MaxDistance of 0 only matches an identical hash.
+	bool Find( boost::uint64_t a_Hash, int a_MaxDistance, const std::string & a_Key, double a_Now, Json::Value & a_Result );
+	//! Add or replace the result for a hash and query.
+	void Add( boost::uint64_t a_Hash, const std::string & a_Key, const Json::Value & a_Result, double a_Now );
+	void Clear();
+
+private:
+	//! Types
+	struct Entry
+	{
+		boost::uint64_t		m_Hash;
+		std::string			m_Key;
+		Json::Value			m_Result;
+		double				m_Time;
+	};
+	typedef std::list<Entry>	EntryList;
+
+	//! Data
+	mutable boost::mutex	m_Lock;
+	EntryList				m_Entries;		// most recently used first
+	size_t					m_MaxEntries;
+	double					m_TTL;
+	unsigned int			m_Hits;
+	unsigned int			m_Misses;
+};
+
+#endif
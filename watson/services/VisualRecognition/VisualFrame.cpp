@@ -0,0 +1,253 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#include "VisualFrame.h"
+#include "utils/Log.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef WATSON_ENABLE_OPENCV
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#endif
+
+namespace {
+
+	//! Only the lowest frequencies are used, the DC term is just brightness so it is left out of the median.
+	const int HASH_FREQUENCIES = 8;
+
+	struct CosineTable
+	{
+		CosineTable()
+		{
+			for (int u = 0; u < HASH_FREQUENCIES; ++u)
+				for (int x = 0; x < VisualFrame::THUMB_SIZE; ++x)
+					m_Values[u][x] = (float)cos( (2 * x + 1) * u * 3.14159265358979 / (2.0 * VisualFrame::THUMB_SIZE) );
+		}
+
+		float m_Values[HASH_FREQUENCIES][VisualFrame::THUMB_SIZE];
+	};
+	const CosineTable COSINES;
+}
+
+VisualFrame::VisualFrame() : m_bDecoded( false ), m_Hash( 0 ), m_Width( 0 ), m_Height( 0 )
+{}
+
+bool VisualFrame::Analyze( const std::string & a_ImageData )
+{
+	m_bDecoded = false;
+	m_Hash = 0;
+	m_Width = m_Height = 0;
+	m_Thumb.clear();
+	if ( a_ImageData.size() == 0 )
+		return false;
+
+#ifdef WATSON_ENABLE_OPENCV
+	try {
+		cv::Mat encoded( 1, (int)a_ImageData.size(), CV_8UC1, (void *)a_ImageData.data() );
+		m_Image = cv::imdecode( encoded, CV_LOAD_IMAGE_COLOR );
+		if ( m_Image.empty() )
+			return false;
+
+		cv::Mat gray, thumb;
+		cv::cvtColor( m_Image, gray, CV_BGR2GRAY );
+		cv::resize( gray, thumb, cv::Size( THUMB_SIZE, THUMB_SIZE ), 0, 0, cv::INTER_AREA );
+
+		m_Thumb.resize( THUMB_SIZE * THUMB_SIZE );
+		for (int y = 0; y < THUMB_SIZE; ++y)
+			memcpy( &m_Thumb[y * THUMB_SIZE], thumb.ptr<unsigned char>( y ), THUMB_SIZE );
+
+		m_Width = m_Image.cols;
+		m_Height = m_Image.rows;
+		m_Hash = HashThumbnail( &m_Thumb[0] );
+		m_bDecoded = true;
+		return true;
+	}
+	catch( const cv::Exception & e )
+	{
+		Log::Error( "VisualFrame", "Failed to decode image: %s", e.what() );
+		m_Image.release();
+		return false;
+	}
+#else
+	// FNV-1a, so identical frames are still recognized
+	boost::uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < a_ImageData.size(); ++i)
+	{
+		hash ^= (unsigned char)a_ImageData[i];
+		hash *= 1099511628211ULL;
+	}
+	m_Hash = hash;
+	return true;
+#endif
+}
+
+int VisualFrame::GetDistance( const VisualFrame & a_Other ) const
+{
+	if ( m_bDecoded != a_Other.m_bDecoded )
+		return MAX_DISTANCE;
+	if (! m_bDecoded )
+		return m_Hash == a_Other.m_Hash && m_Hash != 0 ? 0 : MAX_DISTANCE;
+	return CountBits( m_Hash ^ a_Other.m_Hash );
+}
+
+float VisualFrame::GetMotion( const VisualFrame & a_Other ) const
+{
+	if (! m_bDecoded || !a_Other.m_bDecoded )
+		return 0.0f;
+
+	int total = 0;
+	for (size_t i = 0; i < m_Thumb.size(); ++i)
+		total += abs( (int)m_Thumb[i] - (int)a_Other.m_Thumb[i] );
+	return (float)total / (255.0f * m_Thumb.size());
+}
+
+bool VisualFrame::GetChangedRegion( const VisualFrame & a_Other, float a_Threshold, int a_Margin, Region & a_Region ) const
+{
+	if (! m_bDecoded || !a_Other.m_bDecoded )
+		return false;
+
+	int threshold = (int)(a_Threshold * 255.0f);
+	int left = THUMB_SIZE, top = THUMB_SIZE, right = -1, bottom = -1;
+	for (int y = 0; y < THUMB_SIZE; ++y)
+	{
+		const unsigned char * pA = &m_Thumb[y * THUMB_SIZE];
+		const unsigned char * pB = &a_Other.m_Thumb[y * THUMB_SIZE];
+		for (int x = 0; x < THUMB_SIZE; ++x)
+		{
+			if ( abs( (int)pA[x] - (int)pB[x] ) > threshold )
+			{
+				left = std::min( left, x );
+				right = std::max( right, x );
+				top = std::min( top, y );
+				bottom = std::max( bottom, y );
+			}
+		}
+	}
+	if ( right < 0 )
+		return false;
+
+	left = std::max( left - a_Margin, 0 );
+	top = std::max( top - a_Margin, 0 );
+	right = std::min( right + a_Margin, THUMB_SIZE - 1 );
+	bottom = std::min( bottom + a_Margin, THUMB_SIZE - 1 );
+
+	a_Region.m_X = left * m_Width / THUMB_SIZE;
+	a_Region.m_Y = top * m_Height / THUMB_SIZE;
+	a_Region.m_Width = (right + 1) * m_Width / THUMB_SIZE - a_Region.m_X;
+	a_Region.m_Height = (bottom + 1) * m_Height / THUMB_SIZE - a_Region.m_Y;
+	return true;
+}
+
+bool VisualFrame::Encode( const Region & a_Region, int a_MaxSize, int a_Quality, std::string & a_Encoded, double & a_Scale ) const
+{
+	a_Scale = 1.0;
+#ifdef WATSON_ENABLE_OPENCV
+	if (! m_bDecoded )
+		return false;
+
+	bool bCrop = a_Region.m_Width > 0 && a_Region.m_Height > 0 
+		&& (a_Region.m_Width < m_Width || a_Region.m_Height < m_Height);
+	cv::Mat image = bCrop ? m_Image( cv::Rect( a_Region.m_X, a_Region.m_Y, a_Region.m_Width, a_Region.m_Height ) ) : m_Image;
+
+	int longEdge = std::max( image.cols, image.rows );
+	bool bScale = a_MaxSize > 0 && longEdge > a_MaxSize;
+	if (! bCrop && !bScale )
+		return false;
+
+	try {
+		cv::Mat scaled;
+		if ( bScale )
+		{
+			a_Scale = (double)a_MaxSize / longEdge;
+			cv::resize( image, scaled, cv::Size(), a_Scale, a_Scale, cv::INTER_AREA );
+		}
+
+		std::vector<int> params;
+		params.push_back( CV_IMWRITE_JPEG_QUALITY );
+		params.push_back( a_Quality );
+
+		std::vector<unsigned char> jpeg;
+		if (! cv::imencode( ".jpg", bScale ? scaled : image, jpeg, params ) )
+			return false;
+
+		a_Encoded.assign( (const char *)&jpeg[0], jpeg.size() );
+		return true;
+	}
+	catch( const cv::Exception & e )
+	{
+		Log::Error( "VisualFrame", "Failed to encode image: %s", e.what() );
+		return false;
+	}
+#else
+	return false;
+#endif
+}
+
+boost::uint64_t VisualFrame::HashThumbnail( const unsigned char * a_pGray )
+{
+	// separable DCT, rows first then columns, only for the frequencies we keep
+	float rows[THUMB_SIZE][HASH_FREQUENCIES];
+	for (int y = 0; y < THUMB_SIZE; ++y)
+	{
+		const unsigned char * pRow = a_pGray + y * THUMB_SIZE;
+		for (int u = 0; u < HASH_FREQUENCIES; ++u)
+		{
+			float sum = 0.0f;
+			for (int x = 0; x < THUMB_SIZE; ++x)
+				sum += pRow[x] * COSINES.m_Values[u][x];
+			rows[y][u] = sum;
+		}
+	}
+
+	float coefficients[HASH_FREQUENCIES * HASH_FREQUENCIES];
+	for (int v = 0; v < HASH_FREQUENCIES; ++v)
+	{
+		for (int u = 0; u < HASH_FREQUENCIES; ++u)
+		{
+			float sum = 0.0f;
+			for (int y = 0; y < THUMB_SIZE; ++y)
+				sum += rows[y][u] * COSINES.m_Values[v][y];
+			coefficients[v * HASH_FREQUENCIES + u] = sum;
+		}
+	}
+
+	const int count = HASH_FREQUENCIES * HASH_FREQUENCIES;
+	float sorted[count - 1];
+	memcpy( sorted, coefficients + 1, sizeof(sorted) );
+	std::nth_element( sorted, sorted + count / 2, sorted + count - 1 );
+	float median = sorted[count / 2];
+
+	boost::uint64_t hash = 0;
+	for (int i = 1; i < count; ++i)
+		if ( coefficients[i] > median )
+			hash |= ((boost::uint64_t)1) << i;
+	return hash;
+}
+
+int VisualFrame::CountBits( boost::uint64_t a_Value )
+{
+	a_Value = a_Value - ((a_Value >> 1) & 0x5555555555555555ULL);
+	a_Value = (a_Value & 0x3333333333333333ULL) + ((a_Value >> 2) & 0x3333333333333333ULL);
+	a_Value = (a_Value + (a_Value >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int)((a_Value * 0x0101010101010101ULL) >> 56);
+}
@@ -0,0 +1,107 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+
+
+#ifndef WDC_VISUAL_FRAME_H
+#define WDC_VISUAL_FRAME_H
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#ifdef WATSON_ENABLE_OPENCV
+#include <opencv2/core/core.hpp>
+#endif
+
+#include "SelfLib.h"			// include last always
+
+//! The cheap part of looking at a camera frame: a 64-bit perceptual hash and a small grayscale
+//! thumbnail used for motion and region-of-interest estimates. Without OpenCV the JPEG can't be
+//! decoded, so the hash falls back to a content hash that only matches identical bytes.
+class VisualFrame
+{
+public:
+	//! Constants
+	static const int		THUMB_SIZE = 32;		// thumbnail is THUMB_SIZE x THUMB_SIZE gray pixels
+	static const int		MAX_DISTANCE = 64;
+
+	//! Types
+	struct Region
+	{
+		Region() : m_X( 0 ), m_Y( 0 ), m_Width( 0 ), m_Height( 0 )
+		{}
+
+		int		m_X;
+		int		m_Y;
+		int		m_Width;
+		int		m_Height;
+	};
+
+	//! Construction
+	VisualFrame();
+
+	//! Accessors
+	bool IsDecoded() const
+	{
+		return m_bDecoded;
+	}
+	boost::uint64_t GetHash() const
+	{
+		return m_Hash;
+	}
+	int GetWidth() const
+	{
+		return m_Width;
+	}
+	int GetHeight() const
+	{
+		return m_Height;
+	}
+
+	//! Decode the JPEG and compute the hash and thumbnail, returns false if the data isn't an image.
+	bool Analyze( const std::string & a_ImageData );
+	//! Number of differing hash bits, 0 for the same scene, MAX_DISTANCE when nothing can be compared.
+	int GetDistance( const VisualFrame & a_Other ) const;
+	//! Mean absolute thumbnail difference in the range 0 - 1, 0 when either frame wasn't decoded.
+	float GetMotion( const VisualFrame & a_Other ) const;
+	//! Bounding box in image pixels of the thumbnail cells that changed by more than a_Threshold 
+	//! (0 - 1), grown by a_Margin cells. Returns false if nothing changed.
+	bool GetChangedRegion( const VisualFrame & a_Other, float a_Threshold, int a_Margin, Region & a_Region ) const;
+	//! Crop to a_Region (empty for the full frame), scale the long edge down to a_MaxSize (0 for no 
+	//! limit) and encode as JPEG. a_Scale is set to the encoded size over the cropped size. Returns 
+	//! false if there is nothing to gain over the original data.
+	bool Encode( const Region & a_Region, int a_MaxSize, int a_Quality, std::string & a_Encoded, double & a_Scale ) const;
+
+	//! Hash a THUMB_SIZE x THUMB_SIZE gray image, the low 8x8 DCT coefficients against their median.
+	static boost::uint64_t HashThumbnail( const unsigned char * a_pGray );
+	static int CountBits( boost::uint64_t a_Value );
+
+private:
+	//! Data
+	bool						m_bDecoded;
+	boost::uint64_t				m_Hash;
+	int							m_Width;
+	int							m_Height;
+	std::vector<unsigned char>	m_Thumb;
+#ifdef WATSON_ENABLE_OPENCV
+	cv::Mat						m_Image;
+#endif
+};
+
+#endif
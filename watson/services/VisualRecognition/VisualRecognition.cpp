@@ -17,10 +17,13 @@
 
 
 #include "VisualRecognition.h"
-#include "utils/Form.h"
+#include "MultipartBody.h"
+#include "SelfInstance.h"
 #include "utils/Path.h"
+#include "utils/Time.h"
 
 const std::string DEFAULT_CLASSIFIER( "default" );
+const std::string STATS_TOPIC( "visual-recognition-stats" );
 
 REG_SERIALIZABLE( VisualRecognition );
 REG_OVERRIDE_SERIALIZABLE( IVisualRecognition, VisualRecognition );
@@ -29,7 +32,16 @@ RTTI_IMPL( VisualRecognition, IVisualRecognition );
 VisualRecognition::VisualRecognition() : 
 	IVisualRecognition("VisualRecognitionV1", AUTH_USER ),
 	m_APIVersion( "2016-05-20" ),
-	m_ClassifyThreshold( 0.035f )
+	m_ClassifyThreshold( 0.035f ),
+	m_bSelectFrames( true ),
+	m_bCacheResults( true ),
+	m_CacheSize( 256 ),
+	m_CacheTTL( 300.0f ),
+	m_StatsInterval( 60.0f ),
+	m_StatsTime( 0.0 ),
+	m_MaxUploads( 2 ),
+	m_UploadBytesPerSecond( 0.0f ),
+	m_UploadTimeout( 60.0f )
 {}
 
 //! ISerializable
@@ -38,6 +50,24 @@ void VisualRecognition::Serialize(Json::Value & json)
 	IVisualRecognition::Serialize(json);
 	json["m_APIVersion"] = m_APIVersion;
 	json["m_ClassifyThreshold"] = m_ClassifyThreshold;
+	json["m_bSelectFrames"] = m_bSelectFrames;
+	json["m_DuplicateDistance"] = m_FrameOptions.m_DuplicateDistance;
+	json["m_CacheDistance"] = m_FrameOptions.m_CacheDistance;
+	json["m_MaxMotion"] = m_FrameOptions.m_MaxMotion;
+	json["m_RefreshInterval"] = m_FrameOptions.m_RefreshInterval;
+	json["m_bCropToMotion"] = m_FrameOptions.m_bCropToMotion;
+	json["m_RoiThreshold"] = m_FrameOptions.m_RoiThreshold;
+	json["m_MaxRoiArea"] = m_FrameOptions.m_MaxRoiArea;
+	json["m_MinRoiSize"] = m_FrameOptions.m_MinRoiSize;
+	json["m_MaxImageSize"] = m_FrameOptions.m_MaxImageSize;
+	json["m_JpegQuality"] = m_FrameOptions.m_JpegQuality;
+	json["m_bCacheResults"] = m_bCacheResults;
+	json["m_CacheSize"] = m_CacheSize;
+	json["m_CacheTTL"] = m_CacheTTL;
+	json["m_StatsInterval"] = m_StatsInterval;
+	json["m_MaxUploads"] = m_MaxUploads;
+	json["m_UploadBytesPerSecond"] = m_UploadBytesPerSecond;
+	json["m_UploadTimeout"] = m_UploadTimeout;
 }
 
 void VisualRecognition::Deserialize(const Json::Value & json)
@@ -47,6 +77,48 @@ void VisualRecognition::Deserialize(const Json::Value & json)
 		m_APIVersion = json["m_APIVersion"].asString();
 	if ( json["m_ClassifyThreshold"].isDouble() )
 		m_ClassifyThreshold = json["m_ClassifyThreshold"].asFloat();
+	if ( json["m_bSelectFrames"].isBool() )
+		m_bSelectFrames = json["m_bSelectFrames"].asBool();
+	if ( json["m_DuplicateDistance"].isNumeric() )
+		m_FrameOptions.m_DuplicateDistance = json["m_DuplicateDistance"].asInt();
+	if ( json["m_CacheDistance"].isNumeric() )
+		m_FrameOptions.m_CacheDistance = json["m_CacheDistance"].asInt();
+	if ( json["m_MaxMotion"].isNumeric() )
+		m_FrameOptions.m_MaxMotion = json["m_MaxMotion"].asFloat();
+	if ( json["m_RefreshInterval"].isNumeric() )
+		m_FrameOptions.m_RefreshInterval = json["m_RefreshInterval"].asFloat();
+	if ( json["m_bCropToMotion"].isBool() )
+		m_FrameOptions.m_bCropToMotion = json["m_bCropToMotion"].asBool();
+	if ( json["m_RoiThreshold"].isNumeric() )
+		m_FrameOptions.m_RoiThreshold = json["m_RoiThreshold"].asFloat();
+	if ( json["m_MaxRoiArea"].isNumeric() )
+		m_FrameOptions.m_MaxRoiArea = json["m_MaxRoiArea"].asFloat();
+	if ( json["m_MinRoiSize"].isNumeric() )
+		m_FrameOptions.m_MinRoiSize = json["m_MinRoiSize"].asFloat();
+	if ( json["m_MaxImageSize"].isNumeric() )
+		m_FrameOptions.m_MaxImageSize = json["m_MaxImageSize"].asInt();
+	if ( json["m_JpegQuality"].isNumeric() )
+		m_FrameOptions.m_JpegQuality = json["m_JpegQuality"].asInt();
+	if ( json["m_bCacheResults"].isBool() )
+		m_bCacheResults = json["m_bCacheResults"].asBool();
+	if ( json["m_CacheSize"].isNumeric() )
+		m_CacheSize = json["m_CacheSize"].asInt();
+	if ( json["m_CacheTTL"].isNumeric() )
+		m_CacheTTL = json["m_CacheTTL"].asFloat();
+	if ( json["m_StatsInterval"].isNumeric() )
+		m_StatsInterval = json["m_StatsInterval"].asFloat();
+	if ( json["m_MaxUploads"].isNumeric() )
+		m_MaxUploads = json["m_MaxUploads"].asInt();
+	if ( json["m_UploadBytesPerSecond"].isNumeric() )
+		m_UploadBytesPerSecond = json["m_UploadBytesPerSecond"].asFloat();
+	if ( json["m_UploadTimeout"].isNumeric() )
+		m_UploadTimeout = json["m_UploadTimeout"].asFloat();
+
+	m_ClassifyCache.SetLimits( m_CacheSize > 0 ? m_CacheSize : 0, m_CacheTTL );
+	m_Uploader.SetLimits( m_MaxUploads, m_UploadBytesPerSecond );
+	m_Uploader.SetTimeout( m_UploadTimeout );
+	m_QueryUploader.SetLimits( 0, 0.0 );
+	m_QueryUploader.SetTimeout( m_UploadTimeout );
 }
 
 //! IService interface
@@ -62,9 +134,26 @@ bool VisualRecognition::Start()
 	if (m_pConfig->m_User.size() == 0)
 		Log::Warning("VisualRecognition", "API-Key expected in user field.");
 
+	SelfInstance * pInstance = SelfInstance::GetInstance();
+	if ( pInstance != NULL && m_StatsInterval > 0.0f )
+		pInstance->GetTopics()->RegisterTopic( STATS_TOPIC, "application/json" );
+	m_StatsTime = Time().GetEpochTime();
+
 	return true;
 }
 
+bool VisualRecognition::Stop()
+{
+	SelfInstance * pInstance = SelfInstance::GetInstance();
+	if ( pInstance != NULL && m_StatsInterval > 0.0f )
+		pInstance->GetTopics()->UnregisterTopic( STATS_TOPIC );
+	m_ClassifyCache.Clear();
+	m_Uploader.Stop();
+	m_QueryUploader.Stop();
+
+	return IVisualRecognition::Stop();
+}
+
 void VisualRecognition::GetServiceStatus(ServiceStatusCallback a_Callback)
 {
 	if (m_pConfig != NULL)
@@ -107,17 +196,36 @@ void VisualRecognition::ClassifyImage(const std::string & a_ImageData,
 	Json::Value ids;
 	for(size_t i=0;i<a_Classifiers.size();++i)
 		ids["classifier_ids"][i] = a_Classifiers[i];
+	std::string params = ids.toStyledString();
 
-	Form form;
-	form.AddFilePart("parameters", "myparams.json", ids.toStyledString() );
-	form.AddFilePart("images_file", "imageToClassify.jpg", a_ImageData);
-	form.Finish();
+	ReportStats();
 
-	Headers headers;
-	headers["Content-Type"] = form.GetContentType();
-	headers["Accept-Language"] = "en";
+	OnClassifyImage callback = a_Callback;
+	FrameSelector::Upload * pUpload = NULL;
+	if ( m_bSelectFrames )
+	{
+		pUpload = m_ClassifySelector.Select( m_FrameOptions, a_ImageData, parameters + params, 
+			m_bCacheResults ? &m_ClassifyCache : NULL, a_Callback );
+		if ( pUpload == NULL )
+			return;		// answered from the last upload or the cache
+		callback = DELEGATE( FrameSelector::Upload, OnResponse, const Json::Value &, pUpload );
+	}
 
-	new RequestJson(this, parameters, "POST", headers, form.GetBody(), a_Callback);
+	// the body goes to the socket from where it is, the image is only copied if it's the caller's
+	std::string image;
+	if ( pUpload != NULL )
+		pUpload->TakeImage( a_ImageData, image );
+	else
+		image = a_ImageData;
+
+	MultipartBody * pBody = new MultipartBody();
+	pBody->TakeFilePart("parameters", "myparams.json", params, "application/json" );
+	pBody->TakeFilePart("images_file", "imageToClassify.jpg", image, "image/jpeg" );
+	pBody->Finish();
+
+	MultipartUploader::Headers headers;
+	headers["Accept-Language"] = "en";
+	m_QueryUploader.Upload( m_pConfig->m_URL + parameters, headers, pBody, callback );
 }
 
 
@@ -127,15 +235,32 @@ void VisualRecognition::DetectFaces(const std::string & a_ImageData, OnDetectFac
 	parameters += "?apikey=" + m_pConfig->m_User;
 	parameters += "&version=" + m_APIVersion;
 
-	Form form;
-	form.AddFilePart("images_file", "imageToClassify.jpg", a_ImageData);
-	form.Finish();
+	ReportStats();
 
-	Headers headers;
-	headers["Content-Type"] = form.GetContentType();
-	headers["Accept-Language"] = "en";
+	OnDetectFaces callback = a_Callback;
+	FrameSelector::Upload * pUpload = NULL;
+	if ( m_bSelectFrames )
+	{
+		pUpload = m_FaceSelector.Select( m_FrameOptions, a_ImageData, parameters, NULL, a_Callback );
+		if ( pUpload == NULL )
+			return;
+		callback = DELEGATE( FrameSelector::Upload, OnResponse, const Json::Value &, pUpload );
+	}
+
+	// the body goes to the socket from where it is, the image is only copied if it's the caller's
+	std::string image;
+	if ( pUpload != NULL )
+		pUpload->TakeImage( a_ImageData, image );
+	else
+		image = a_ImageData;
+
+	MultipartBody * pBody = new MultipartBody();
+	pBody->TakeFilePart("images_file", "imageToClassify.jpg", image, "image/jpeg" );
+	pBody->Finish();
 
-	new RequestJson(this, parameters, "POST", headers, form.GetBody(), a_Callback);
+	MultipartUploader::Headers headers;
+	headers["Accept-Language"] = "en";
+	m_QueryUploader.Upload( m_pConfig->m_URL + parameters, headers, pBody, callback );
 }
 
 void VisualRecognition::CreateClassifier( 
@@ -148,21 +273,20 @@ void VisualRecognition::CreateClassifier(
 	parameters += "?apikey=" + m_pConfig->m_User;
 	parameters += "&version=" + m_APIVersion;
 
-	Form form;
-	form.AddFormField("name", a_ClassifierName );
+	MultipartBody * pBody = new MultipartBody();
+	pBody->AddFormField("name", a_ClassifierName );
 	for(size_t i=0;i<a_PositiveExamples.size();++i)
 	{
-		if (! form.AddFilePartFromPath( Path( a_PositiveExamples[i] ).GetFile(), a_PositiveExamples[i] ) )
+		if (! pBody->AddFilePartFromPath( Path( a_PositiveExamples[i] ).GetFile(), a_PositiveExamples[i] ) )
 			Log::Error( "VisualRecognition", "Failed to load positive examples." );
 	}
 	if ( a_NegativeExamples.size() > 0 )
-		form.AddFilePartFromPath( "negative_examples", a_NegativeExamples );
-	form.Finish();
-
-	Headers headers;
-	headers["Content-Type"] = form.GetContentType();
+		pBody->AddFilePartFromPath( "negative_examples", a_NegativeExamples );
+	pBody->Finish();
 
-	new RequestJson(this, parameters, "POST", headers, form.GetBody(), a_Callback);
+	// training sets can be huge, so the files are streamed from disk instead of loaded into a request
+	m_Uploader.Upload( m_pConfig->m_URL + parameters, MultipartUploader::Headers(), pBody, a_Callback, 
+		DELEGATE( VisualRecognition, OnUploadProgress, const MultipartUploader::Progress &, this ) );
 }
 
 void VisualRecognition::UpdateClassifier(
@@ -177,21 +301,19 @@ void VisualRecognition::UpdateClassifier(
 	parameters += "?apikey=" + m_pConfig->m_User;
 	parameters += "&version=" + m_APIVersion;
 
-	Form form;
-	form.AddFormField("name", a_ClassifierName );
+	MultipartBody * pBody = new MultipartBody();
+	pBody->AddFormField("name", a_ClassifierName );
 	for(size_t i=0;i<a_PositiveExamples.size();++i)
 	{
-		if (! form.AddFilePartFromPath( Path( a_PositiveExamples[i] ).GetFile(), a_PositiveExamples[i] ) )
+		if (! pBody->AddFilePartFromPath( Path( a_PositiveExamples[i] ).GetFile(), a_PositiveExamples[i] ) )
 			Log::Error( "VisualRecognition", "Failed to load positive examples." );
 	}
 	if ( a_NegativeExamples.size() > 0 )
-		form.AddFilePartFromPath( "negative_examples", a_NegativeExamples );
-	form.Finish();
-
-	Headers headers;
-	headers["Content-Type"] = form.GetContentType();
+		pBody->AddFilePartFromPath( "negative_examples", a_NegativeExamples );
+	pBody->Finish();
 
-	new RequestJson(this, parameters, "POST", headers, form.GetBody(), a_Callback);
+	m_Uploader.Upload( m_pConfig->m_URL + parameters, MultipartUploader::Headers(), pBody, a_Callback, 
+		DELEGATE( VisualRecognition, OnUploadProgress, const MultipartUploader::Progress &, this ) );
 }
 
 void VisualRecognition::DeleteClassifier( const std::string & a_ClassifierId,
@@ -206,6 +328,42 @@ void VisualRecognition::DeleteClassifier( const std::string & a_ClassifierId,
 }
 
 
+void VisualRecognition::ReportStats()
+{
+	double now = Time().GetEpochTime();
+	double elapsed = now - m_StatsTime;
+	if ( m_StatsInterval <= 0.0f || elapsed < m_StatsInterval )
+		return;
+	m_StatsTime = now;
+
+	unsigned int hits = m_ClassifyCache.GetHits();
+	unsigned int misses = m_ClassifyCache.GetMisses();
+
+	Json::Value stats;
+	stats["frames"] = m_ClassifySelector.GetFrames();
+	stats["uploads"] = m_ClassifySelector.GetUploads();
+	stats["cacheHits"] = hits;
+	stats["cacheMisses"] = misses;
+	stats["cacheSize"] = (unsigned int)m_ClassifyCache.GetSize();
+	stats["hitRate"] = (hits + misses) > 0 ? (double)hits / (hits + misses) : 0.0;
+	stats["faceFrames"] = m_FaceSelector.GetFrames();
+	stats["faceUploads"] = m_FaceSelector.GetUploads();
+
+	Log::DebugLow( "VisualRecognition", "Classify: %u frames, %u uploads, cache %u hits / %u misses. Faces: %u frames, %u uploads.",
+		m_ClassifySelector.GetFrames(), m_ClassifySelector.GetUploads(), hits, misses,
+		m_FaceSelector.GetFrames(), m_FaceSelector.GetUploads() );
+
+	SelfInstance * pInstance = SelfInstance::GetInstance();
+	if ( pInstance != NULL )
+		pInstance->GetTopics()->Publish( STATS_TOPIC, stats.toStyledString(), false, false );
+}
+
+void VisualRecognition::OnUploadProgress( const MultipartUploader::Progress & a_Progress )
+{
+	Log::Status( "VisualRecognition", "Uploaded %u of %u KB to %s", (unsigned int)(a_Progress.m_Sent / 1024), 
+		(unsigned int)(a_Progress.m_Total / 1024), a_Progress.m_URL.c_str() );
+}
+
 VisualRecognition::ServiceStatusChecker::ServiceStatusChecker(VisualRecognition * a_pService, ServiceStatusCallback a_Callback)
 	: m_pService(a_pService), m_Callback(a_Callback)
 {
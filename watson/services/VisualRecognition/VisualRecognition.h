@@ -22,6 +22,9 @@
 #include "utils/Delegate.h"
 #include "utils/DataCache.h"
 #include "services/IVisualRecognition.h"
+#include "FrameSelector.h"
+#include "ResultCache.h"
+#include "MultipartUploader.h"
 
 class VisualRecognition : public IVisualRecognition
 {
@@ -40,6 +43,7 @@ public:
 
 	//! IService interface
 	virtual bool Start();
+	virtual bool Stop();
 	virtual void GetServiceStatus(ServiceStatusCallback a_Callback);
 
 	//! IVisualRecognition interface
@@ -83,6 +87,24 @@ private:
 	//! Data
 	std::string				m_APIVersion;
 	float					m_ClassifyThreshold;
+	bool					m_bSelectFrames;
+	FrameSelector::Options	m_FrameOptions;
+	FrameSelector			m_ClassifySelector;
+	FrameSelector			m_FaceSelector;
+	bool					m_bCacheResults;
+	int						m_CacheSize;				// most classify results kept in m_ClassifyCache
+	float					m_CacheTTL;					// seconds a cached classify result is valid
+	ResultCache				m_ClassifyCache;
+	float					m_StatsInterval;			// seconds between publishing frame and cache statistics, 0 to disable
+	double					m_StatsTime;
+	int						m_MaxUploads;				// classifier training uploads that can run at once
+	float					m_UploadBytesPerSecond;		// shared cap for training uploads, 0 for no limit
+	float					m_UploadTimeout;			// seconds any step of an upload may take
+	MultipartUploader		m_Uploader;
+	MultipartUploader		m_QueryUploader;			// classify and face uploads, not limited like training
+
+	void ReportStats();
+	void OnUploadProgress( const MultipartUploader::Progress & a_Progress );
 };
 
 #endif
@@ -0,0 +1,203 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "services/VisualRecognition/FrameSelector.h"
+#include "services/VisualRecognition/ResultCache.h"
+#include "services/VisualRecognition/VisualFrame.h"
+
+#ifdef WATSON_ENABLE_OPENCV
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#endif
+
+//! Feeds camera frames through a FrameSelector and plays the service by answering its uploads.
+class TestFrameSelector : UnitTest
+{
+public:
+	//! Construction
+	TestFrameSelector() : UnitTest("TestFrameSelector"),
+		m_Answered(0)
+	{ }
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+
+		TestDuplicates();
+#ifdef WATSON_ENABLE_OPENCV
+		TestRegion();
+#endif
+		TestLateResponse();
+	}
+
+	void TestDuplicates()
+	{
+		ResultCache cache;
+		FrameSelector selector;
+		FrameSelector::Options options;
+		std::string frame( MakeFrame( false ) );
+
+		m_Answered = 0;
+		FrameSelector::Upload * pUpload = selector.Select( options, frame, "q", &cache,
+			DELEGATE( TestFrameSelector, OnResult, const Json::Value &, this ) );
+		Test( pUpload != NULL );
+
+		// the same scene while the upload is in flight is queued behind it
+		Test( selector.Select( options, frame, "q", &cache,
+			DELEGATE( TestFrameSelector, OnResult, const Json::Value &, this ) ) == NULL );
+		Test( m_Answered == 0 );
+
+		pUpload->OnResponse( MakeResult( "person", 20, 20 ) );
+		Test( m_Answered == 2 );
+		Test( m_Result["images"][0]["classifiers"][0]["classes"][0]["class"].asString() == "person" );
+
+		// and once it's answered, gets the last result on the main thread
+		Test( selector.Select( options, frame, "q", &cache,
+			DELEGATE( TestFrameSelector, OnResult, const Json::Value &, this ) ) == NULL );
+		Test( m_Answered == 2 );
+		ThreadPool::Instance()->ProcessMainThread();
+		Test( m_Answered == 3 );
+
+		// a different query doesn't reuse the result
+		pUpload = selector.Select( options, frame, "other", &cache,
+			DELEGATE( TestFrameSelector, OnResult, const Json::Value &, this ) );
+		Test( pUpload != NULL );
+		if ( pUpload != NULL )
+			pUpload->OnResponse( Json::Value() );
+		Test( m_Answered == 4 );
+
+		Test( selector.GetFrames() == 4 );
+		Test( selector.GetUploads() == 2 );
+		Test( cache.GetSize() == 1 );
+	}
+
+#ifdef WATSON_ENABLE_OPENCV
+	void TestRegion()
+	{
+		FrameSelector selector;
+		FrameSelector::Options options;
+		options.m_DuplicateDistance = -1;
+		options.m_MaxMotion = 0.0f;
+
+		// the first frame goes up whole
+		std::string first( MakeFrame( false ) );
+		FrameSelector::Upload * pUpload = selector.Select( options, first, "q", NULL,
+			DELEGATE( TestFrameSelector, OnResult, const Json::Value &, this ) );
+		Test( pUpload != NULL );
+
+		Json::Value full( MakeResult( "person", 20, 20 ) );
+		Json::Value face;
+		face["face_location"]["left"] = 250;
+		face["face_location"]["top"] = 170;
+		face["face_location"]["width"] = 20;
+		face["face_location"]["height"] = 20;
+		full["images"][0]["faces"].append( face );
+		pUpload->OnResponse( full );
+
+		// a box appearing in the bottom right corner only sends that corner
+		std::string second( MakeFrame( true ) );
+		pUpload = selector.Select( options, second, "q", NULL,
+			DELEGATE( TestFrameSelector, OnResult, const Json::Value &, this ) );
+		Test( pUpload != NULL );
+		if ( pUpload == NULL )
+			return;
+		Test( pUpload->GetImage( second ).size() < second.size() );
+
+		pUpload->OnResponse( MakeResult( "chair", 80, 40 ) );
+
+		// the face moves back into the frame, the one outside the crop is kept, the one inside replaced
+		const Json::Value & image = m_Result["images"][0];
+		Test( image["faces"].size() == 2 );
+		Test( image["faces"][0]["face_location"]["left"].asInt() >= 160 );
+		Test( image["faces"][1]["face_location"]["left"].asInt() == 20 );
+		Test( image["classifiers"].size() == 1 );
+		Test( image["classifiers"][0]["classes"].size() == 2 );
+		Test( selector.GetUploads() == 2 );
+	}
+#endif
+
+	void TestLateResponse()
+	{
+		ResultCache cache;
+		std::string frame( MakeFrame( true ) );
+
+		m_Answered = 0;
+		FrameSelector * pSelector = new FrameSelector();
+		FrameSelector::Upload * pUpload = pSelector->Select( FrameSelector::Options(), frame, "late", &cache,
+			DELEGATE( TestFrameSelector, OnResult, const Json::Value &, this ) );
+		Test( pUpload != NULL );
+		delete pSelector;
+
+		// the caller still gets its answer, but the result isn't cached for a selector that's gone
+		pUpload->OnResponse( MakeResult( "person", 20, 20 ) );
+		Test( m_Answered == 1 );
+
+		VisualFrame analyzed;
+		analyzed.Analyze( frame );
+		Json::Value cached;
+		Test(! cache.Find( analyzed.GetHash(), 0, "late", Time().GetEpochTime(), cached ) );
+		Test( cache.GetSize() == 0 );
+	}
+
+	//! A gray frame with a white box in the top left corner and optionally another in the bottom right.
+	static std::string MakeFrame( bool a_bSecondBox )
+	{
+#ifdef WATSON_ENABLE_OPENCV
+		cv::Mat image( 240, 320, CV_8UC3, cv::Scalar( 60, 60, 60 ) );
+		cv::rectangle( image, cv::Rect( 20, 20, 40, 40 ), cv::Scalar( 255, 255, 255 ), -1 );
+		if ( a_bSecondBox )
+			cv::rectangle( image, cv::Rect( 240, 160, 40, 40 ), cv::Scalar( 255, 255, 255 ), -1 );
+
+		std::vector<unsigned char> encoded;
+		cv::imencode( ".jpg", image, encoded );
+		return std::string( encoded.begin(), encoded.end() );
+#else
+		// without OpenCV frames are compared by content only
+		return StringUtil::Format( "frame %d", a_bSecondBox ? 2 : 1 );
+#endif
+	}
+
+	static Json::Value MakeResult( const char * a_pClass, int a_Left, int a_Top )
+	{
+		Json::Value result;
+		Json::Value & image = result["images"][0];
+		image["classifiers"][0]["classifier_id"] = "default";
+		image["classifiers"][0]["classes"][0]["class"] = a_pClass;
+		image["classifiers"][0]["classes"][0]["score"] = 0.9;
+		image["faces"][0]["face_location"]["left"] = a_Left;
+		image["faces"][0]["face_location"]["top"] = a_Top;
+		image["faces"][0]["face_location"]["width"] = 40;
+		image["faces"][0]["face_location"]["height"] = 40;
+		return result;
+	}
+
+	void OnResult( const Json::Value & a_Result )
+	{
+		m_Result = a_Result;
+		m_Answered += 1;
+	}
+
+	int				m_Answered;
+	Json::Value		m_Result;
+};
+
+TestFrameSelector TEST_FRAME_SELECTOR;
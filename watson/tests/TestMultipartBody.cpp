@@ -0,0 +1,114 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "services/VisualRecognition/MultipartBody.h"
+
+#include <stdio.h>
+#include <fstream>
+
+class TestMultipartBody : UnitTest
+{
+public:
+	//! Construction
+	TestMultipartBody() : UnitTest("TestMultipartBody")
+	{ }
+
+	virtual void RunTest()
+	{
+		const char * pPath = "TestMultipartBody.txt";
+		{
+			std::ofstream output( pPath, std::ios::out | std::ios::binary );
+			output << "from disk";
+		}
+
+		std::string image( "jpeg bytes" );
+		std::string taken( "zip bytes" );
+
+		MultipartBody body;
+		std::string contentType( body.GetContentType() );
+		Test( contentType.find( "multipart/form-data; boundary=" ) == 0 );
+		std::string boundary( contentType.substr( contentType.find( '=' ) + 1 ) );
+
+		body.AddFormField( "parameters", "{\"threshold\":0.5}" );
+		body.AddFilePart( "images_file", "image.jpg", image, "image/jpeg" );
+		body.TakeFilePart( "positive_examples", "cats.zip", taken );
+		Test( taken.size() == 0 );
+		Test( body.AddFilePartFromPath( "negative_examples", pPath ) );
+		Test(! body.AddFilePartFromPath( "missing", "TestMultipartBody.missing" ) );
+		body.Finish();
+
+		std::string expected( 
+			"--" + boundary + "\r\nContent-Disposition: form-data; name=\"parameters\"\r\n\r\n{\"threshold\":0.5}\r\n"
+			"--" + boundary + "\r\nContent-Disposition: form-data; name=\"images_file\"; filename=\"image.jpg\"\r\n"
+				"Content-Type: image/jpeg\r\n\r\njpeg bytes\r\n"
+			"--" + boundary + "\r\nContent-Disposition: form-data; name=\"positive_examples\"; filename=\"cats.zip\"\r\n"
+				"Content-Type: application/octet-stream\r\n\r\nzip bytes\r\n"
+			"--" + boundary + "\r\nContent-Disposition: form-data; name=\"negative_examples\"; filename=\"TestMultipartBody.txt\"\r\n"
+				"Content-Type: application/octet-stream\r\n\r\nfrom disk\r\n"
+			"--" + boundary + "--\r\n" );
+
+		std::string gathered;
+		Test( body.Gather( gathered ) );
+		Test( gathered == expected );
+		Test( body.GetSize() == expected.size() );
+
+		// reading in small pieces gives the same bytes across segment and file boundaries
+		std::string read;
+		char buffer[7];
+		size_t bytes = 0;
+		while( (bytes = body.Read( read.size(), buffer, sizeof(buffer) )) > 0 )
+			read.append( buffer, bytes );
+		Test( read == expected );
+
+		// peek points into memory for everything but the file
+		std::string peeked;
+		size_t fileStart = expected.find( "from disk" );
+		const char * pData = NULL;
+		while( peeked.size() < expected.size() )
+		{
+			bytes = body.Peek( peeked.size(), 5, pData );
+			if ( bytes == 0 )
+			{
+				Test( peeked.size() >= fileStart && peeked.size() < fileStart + 9 );
+				bytes = body.Read( peeked.size(), buffer, sizeof(buffer) );
+				Test( bytes > 0 );
+				if ( bytes == 0 )
+					break;
+				peeked.append( buffer, bytes );
+				continue;
+			}
+			Test( bytes <= 5 );
+			peeked.append( pData, bytes );
+		}
+		Test( peeked == expected );
+
+		// referenced data isn't copied, a part sees changes made before it's sent
+		image[0] = 'J';
+		Test( body.Gather( gathered ) );
+		Test( gathered.find( "Jpeg bytes" ) != std::string::npos );
+
+		// parts can't be added once the body is finished
+		body.AddFormField( "late", "x" );
+		Test( body.GetSize() == expected.size() );
+
+		remove( pPath );
+	}
+};
+
+TestMultipartBody TEST_MULTIPART_BODY;
@@ -0,0 +1,160 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "utils/Time.h"
+#include "utils/StringUtil.h"
+#include "utils/ThreadPool.h"
+#include "services/VisualRecognition/MultipartUploader.h"
+#include "tests/StandInServer.h"
+
+//! Streams bodies to a stand-in service that either answers once it has read the whole body or 
+//! stalls without answering.
+class TestMultipartUploader : UnitTest
+{
+public:
+	//! Construction
+	TestMultipartUploader() : UnitTest("TestMultipartUploader"),
+		m_bStall(false),
+		m_Results(0),
+		m_Failures(0),
+		m_Reports(0)
+	{ }
+
+	virtual void RunTest()
+	{
+		ThreadPool pool(1);
+
+		StandInServer service( boost::bind( &TestMultipartUploader::ServeUpload, this, _1, _2, _3 ) );
+		std::string url( service.GetURL() + "/v3/classifiers?version=2016-05-20" );
+		std::string data( 384 * 1024, 'x' );
+
+		MultipartUploader uploader;
+		uploader.SetTimeout( 5.0f );
+
+		// unthrottled, the body arrives intact with its content type
+		MultipartBody * pBody = MakeBody( data );
+		std::string expected;
+		Test( pBody->Gather( expected ) );
+		std::string contentType( pBody->GetContentType() );
+		uploader.Upload( url, MultipartUploader::Headers(), pBody,
+			DELEGATE( TestMultipartUploader, OnResult, const Json::Value &, this ),
+			DELEGATE( TestMultipartUploader, OnProgress, const MultipartUploader::Progress &, this ) );
+		Test( Wait( m_Results, 1 ) );
+		Test( m_Failures == 0 );
+		Test( m_Result["received"].asUInt() == expected.size() );
+		Test( m_Body == expected );
+		Test( m_ContentType == contentType );
+		Test( m_Request.find( "POST /v3/classifiers?version=2016-05-20 HTTP/1.1\r\n" ) == 0 );
+		Test( m_Reports > 0 );
+		Test( m_Progress.m_Sent == m_Progress.m_Total );
+		Test( m_Progress.m_URL.find( '?' ) == std::string::npos );
+
+		// at 128 KB a second the burst covers the first second, the rest takes two more
+		uploader.SetLimits( 1, 128 * 1024 );
+		Time start;
+		uploader.Upload( url, MultipartUploader::Headers(), MakeBody( data ),
+			DELEGATE( TestMultipartUploader, OnResult, const Json::Value &, this ) );
+		Test( Wait( m_Results, 2 ) );
+		double elapsed = Time().GetEpochTime() - start.GetEpochTime();
+		Log::Status( "TestMultipartUploader", "Throttled upload took %.2f seconds.", elapsed );
+		Test( m_Failures == 0 );
+		Test( m_Body.size() == expected.size() );
+		Test( elapsed > 1.5 && elapsed < 4.0 );
+
+		// a service that never answers fails the upload when the deadline passes
+		uploader.SetLimits( 1, 0.0 );
+		uploader.SetTimeout( 0.5f );
+		m_bStall = true;
+		start = Time();
+		uploader.Upload( url, MultipartUploader::Headers(), MakeBody( data ),
+			DELEGATE( TestMultipartUploader, OnResult, const Json::Value &, this ) );
+		Test( Wait( m_Results, 3 ) );
+		elapsed = Time().GetEpochTime() - start.GetEpochTime();
+		Test( m_Failures == 1 );
+		Log::Status( "TestMultipartUploader", "Stalled upload failed after %.2f seconds.", elapsed );
+		Test( elapsed > 0.4 && elapsed < 3.0 );
+
+		uploader.Stop();
+		service.Stop();
+	}
+
+	MultipartBody * MakeBody( const std::string & a_Data )
+	{
+		MultipartBody * pBody = new MultipartBody();
+		pBody->AddFormField( "name", "cats" );
+		pBody->AddFilePart( "positive_examples", "cats.zip", a_Data, "application/zip" );
+		pBody->Finish();
+		return pBody;
+	}
+
+	void ServeUpload( StandInServer::Socket & a_Socket, boost::asio::streambuf & a_Buffer, const std::string & a_Request )
+	{
+		if ( m_bStall )
+		{
+			// take the body but never answer, until the client gives up and closes
+			char buffer[ 4096 ];
+			boost::system::error_code error;
+			while(! error )
+				a_Socket.read_some( boost::asio::buffer( buffer ), error );
+			return;
+		}
+
+		m_Request = a_Request;
+		m_ContentType = StandInServer::Header( a_Request, "Content-Type" );
+		m_Body = StandInServer::ReadBody( a_Socket, a_Buffer, a_Request );
+		StandInServer::WriteResponse( a_Socket, 200, StringUtil::Format( "{\"received\":%u}", (unsigned int)m_Body.size() ) );
+	}
+
+	void OnResult( const Json::Value & a_Result )
+	{
+		m_Result = a_Result;
+		if ( a_Result.isNull() )
+			m_Failures += 1;
+		m_Results += 1;
+	}
+
+	void OnProgress( const MultipartUploader::Progress & a_Progress )
+	{
+		m_Progress = a_Progress;
+		m_Reports += 1;
+	}
+
+	bool Wait( volatile int & a_Value, int a_Target )
+	{
+		Time start;
+		while( a_Value < a_Target && (Time().GetEpochTime() - start.GetEpochTime()) < 10.0 )
+		{
+			ThreadPool::Instance()->ProcessMainThread();
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 5 ) );
+		}
+		return a_Value >= a_Target;
+	}
+
+	volatile bool		m_bStall;
+	volatile int		m_Results;
+	int					m_Failures;
+	int					m_Reports;
+	std::string			m_Request;
+	std::string			m_ContentType;
+	std::string			m_Body;
+	Json::Value			m_Result;
+	MultipartUploader::Progress	m_Progress;
+};
+
+TestMultipartUploader TEST_MULTIPART_UPLOADER;
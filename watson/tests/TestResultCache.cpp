@@ -0,0 +1,98 @@
+/**
+* Copyright 2017 IBM Corp. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*/
+
+#include "utils/UnitTest.h"
+#include "utils/Log.h"
+#include "services/VisualRecognition/ResultCache.h"
+
+class TestResultCache : UnitTest
+{
+public:
+	//! Construction
+	TestResultCache() : UnitTest("TestResultCache")
+	{ }
+
+	virtual void RunTest()
+	{
+		ResultCache cache;
+		cache.SetLimits( 2, 10.0 );
+
+		Json::Value result;
+		Test(! cache.Find( 0xf0, 4, "q", 0.0, result ) );
+		Test( cache.GetMisses() == 1 );
+
+		cache.Add( 0xf0, "q", MakeResult( "a" ), 0.0 );
+		Test( cache.GetSize() == 1 );
+
+		// a near hash is a hit, but only for the same query and within the distance
+		Test( cache.Find( 0xf1, 4, "q", 1.0, result ) );
+		Test( result["class"].asString() == "a" );
+		Test(! cache.Find( 0xf0, 4, "other", 1.0, result ) );
+		Test(! cache.Find( 0x0f, 4, "q", 1.0, result ) );
+		Test(! cache.Find( 0xf1, 0, "q", 1.0, result ) );
+		Test( cache.GetHits() == 1 );
+		Test( cache.GetMisses() == 4 );
+
+		// the closest entry wins
+		cache.Add( 0xf3, "q", MakeResult( "b" ), 1.0 );
+		Test( cache.Find( 0xf7, 4, "q", 2.0, result ) );
+		Test( result["class"].asString() == "b" );
+
+		// adding the same hash and query replaces the entry
+		cache.Add( 0xf3, "q", MakeResult( "c" ), 2.0 );
+		Test( cache.GetSize() == 2 );
+		Test( cache.Find( 0xf3, 0, "q", 2.0, result ) );
+		Test( result["class"].asString() == "c" );
+
+		// looking up 0xf0 makes 0xf3 the least recently used, so it's the one dropped
+		Test( cache.Find( 0xf0, 0, "q", 3.0, result ) );
+		cache.Add( 0x0f, "q", MakeResult( "d" ), 3.0 );
+		Test( cache.GetSize() == 2 );
+		Test(! cache.Find( 0xf3, 0, "q", 3.0, result ) );
+		Test( cache.Find( 0xf0, 0, "q", 3.0, result ) );
+		Test( cache.Find( 0x0f, 0, "q", 3.0, result ) );
+
+		// 0xf0 was added at 0 and 0x0f at 3, so only 0xf0 has expired at 11
+		Test(! cache.Find( 0xf0, 0, "q", 11.0, result ) );
+		Test( cache.GetSize() == 1 );
+		Test( cache.Find( 0x0f, 0, "q", 11.0, result ) );
+		Test( result["class"].asString() == "d" );
+
+		// shrinking drops the least recently used entries, a size of 0 disables the cache
+		cache.Add( 0xff, "q", MakeResult( "e" ), 11.0 );
+		cache.SetLimits( 1, 10.0 );
+		Test( cache.GetSize() == 1 );
+		Test( cache.Find( 0xff, 0, "q", 11.0, result ) );
+		cache.SetLimits( 0, 10.0 );
+		cache.Add( 0xf0, "q", MakeResult( "f" ), 11.0 );
+		Test( cache.GetSize() == 0 );
+
+		cache.SetLimits( 2, 10.0 );
+		cache.Add( 0xf0, "q", MakeResult( "g" ), 11.0 );
+		cache.Clear();
+		Test( cache.GetSize() == 0 );
+	}
+
+	static Json::Value MakeResult( const char * a_pClass )
+	{
+		Json::Value result;
+		result["class"] = a_pClass;
+		return result;
+	}
+};
+
+TestResultCache TEST_RESULT_CACHE;
@@ -17,6 +17,7 @@
 
 
 #include "Wayblazer.h"
+#include "utils/Time.h"
 
 REG_SERIALIZABLE( Wayblazer );
 REG_OVERRIDE_SERIALIZABLE( IBrowser, Wayblazer );
@@ -25,7 +26,7 @@ RTTI_IMPL( Wayblazer, IBrowser );
 class RequestURL : public IService::RequestJson
 {
 public:
-	RequestURL( IService * a_pService,
+	RequestURL( Wayblazer * a_pService,
 		const std::string & a_Parameters,		// additional data to append onto the endpoint
 		const std::string & a_RequestType,		// type of request GET, POST, DELETE
 		const Headers & a_Headers,				// additional headers to add to the request
@@ -33,7 +34,7 @@ public:
 		Delegate<IBrowser::URLServiceData *> a_Callback,
 		const Url::SP & a_spUrl,
 		float a_fTimeOut = 30.0f ) :
-		m_Callback(a_Callback), m_spUrl(a_spUrl),
+		m_pWayblazer(a_pService), m_Callback(a_Callback), m_spUrl(a_spUrl),
 		RequestJson(a_pService, a_Parameters, a_RequestType, a_Headers, a_Body,
 			DELEGATE(RequestURL, OnResponse, const Json::Value &, this), NULL, a_fTimeOut )
 	{}
@@ -41,6 +42,10 @@ public:
 private:
 	void OnResponse( const Json::Value & a_JsonResponseData )
 	{
+		// a successful request proves the server is up, so the next heartbeat can be skipped
+		if (! a_JsonResponseData.isNull() )
+			m_pWayblazer->m_LastContact = Time().GetEpochTime();
+
 		IBrowser::URLServiceData * urlServiceData = new IBrowser::URLServiceData();
 		urlServiceData->m_JsonValue = a_JsonResponseData;
 		urlServiceData->m_spUrl = m_spUrl;
@@ -49,11 +54,14 @@ private:
 			m_Callback( urlServiceData );
 	}
 
+	Wayblazer * m_pWayblazer;
 	Url::SP m_spUrl;
 	IBrowser::UrlCallback	m_Callback;
 };
 
 Wayblazer::Wayblazer() : IBrowser( "URLServiceV1" ),
+	m_HeartBeatInterval( 30 ),
+	m_LastContact( 0 ),
 	m_AvailabilitySuffix( "/heartbeat" ),
 	m_FunctionalSuffix( "/displayurl" )
 {}
@@ -62,7 +70,7 @@ void Wayblazer::Serialize(Json::Value & json)
 {
 	IBrowser::Serialize( json );
 
-	json["m_HeartBeatInterface"] = m_HeartBeatInterval;
+	json["m_HeartBeatInterval"] = m_HeartBeatInterval;
 	json["m_AvailabilitySuffix"] = m_AvailabilitySuffix;
 	json["m_FunctionalSuffix"] = m_FunctionalSuffix;
 }
@@ -147,6 +155,9 @@ void Wayblazer::ShowURL( const Url::SP & a_spUrl, UrlCallback a_Callback )
 
 void Wayblazer::MakeHeartBeat()
 {
+	if ( (Time().GetEpochTime() - m_LastContact) < m_HeartBeatInterval )
+		return;
+
 	new RequestJson( this, m_AvailabilitySuffix, "GET", NULL_HEADERS, EMPTY_STRING, 
 		DELEGATE(Wayblazer, OnHeartBeatResponse, const Json::Value &, this)  );
 }
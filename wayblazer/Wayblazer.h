@@ -49,6 +49,7 @@ protected:
 	//! Data
 	int m_HeartBeatInterval;
 	TimerPool::ITimer::SP m_spHeartBeatTimer;
+	double m_LastContact;			// last time any request to the server succeeded
 	std::string	m_AvailabilitySuffix;
 	std::string	m_FunctionalSuffix;
 
@@ -67,6 +68,8 @@ protected:
 
 	void MakeHeartBeat();
 	void OnHeartBeatResponse(const Json::Value & a_Response);
+
+	friend class RequestURL;
 };
 
 #endif